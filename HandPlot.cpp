@@ -8,38 +8,16 @@
 
 #include "ftd2xx.h"
 #include "LibFT4222.h"
+#include "hand/Acquisition.h"
+#include "hand/Dashboard.h"
+#include "hand/SimulatedHand.h"
+#include "hand/ProfileOverlay.h"
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 //#include "dongle/driver.h"
 //#include "dongle/rundemos.h"
 
-#define DATASIZE 128
-
-typedef union {
-	uint8_t bytes[24];
-	int16_t vals[12];
-}motordata_t;
-
-/*
-* @brief helper function to find checksum
-* @param handDataTX indicates to only calculate part of buffer that is hand data or the entire SPI message to the STM
-*/
-uint8_t checkSum(uint8_t* arr, uint8_t length, bool handDataTX) {
-	int8_t sum = 0;
-	if (handDataTX) {
-		for (uint8_t b = 1; b < length - 2; b++) { 															// start at first index to ignore length of SPI message byte
-			sum += (int8_t)arr[b];
-		}
-	}
-	else {
-		for (uint8_t b = 0; b < length - 1; b++) { 															// parse each byte except checksum (last byte)
-			sum += (int8_t)arr[b];
-		}
-	}
-	sum = 0x100 - sum;																						// subtract sum of other bytes from zero to get checksum
-	return sum;
-}
-
-
 /*
 * @brief get version of library and chip
 */
@@ -150,132 +128,272 @@ int setupDevice(DWORD* locationID)
 	return 0;
 }
 
-/* 
-* @brief sinusoidal function and data size allocation 
+/*
+* @brief writes the stage timings of morph::Profiler to prefix.csv and prefix.json
 */
-void FingerWave(float* deg, int& txdatasize, int& rxdatasize, int& readtxsize, double time) {
-	txdatasize = 75;																						// sending 17 real populated bytes but zeropadding so we can receive 72 + length & format
-	rxdatasize = 75;
-	readtxsize = 17;
-	
-	double ft = time * 6;
-	for (int ch = 0; ch < 6; ch++)										// parse through each finger channel & set new associated degree value
-	{
-		deg[ch] = ( (0.5 * sin((ft + (float)ch)) + .5) * 45 + 15);				// sinusoidal function on all fingers
-	}
-	deg[5] = -deg[5];					// negate thumb rotator
+static void exportProfile(const std::string& prefix)
+{
+	morph::Profiler& prof = morph::Profiler::i();
+	if (prof.writeCsv(prefix + ".csv") && prof.writeJson(prefix + ".json"))
+		printf("Stage timings written to %s.csv and %s.json\n", prefix.c_str(), prefix.c_str());
+	else
+		printf("Could not write the stage timings to %s.csv/.json\n", prefix.c_str());
 }
 
-/* 
-* @brief converts degree outputs from previous function into gear ratio and packages data into TX array 
+/*
+* @brief the dashboard window: a morph::Visual in which G shows or hides the timing overlay and E exports the stage timings
 */
-void LoadTXDegrees(float* arr, uint8_t* send_data) {
-	send_data[0] = 0x11;																					// length of message (17)
-	send_data[1] = 0x50;																					// hand address
-	send_data[2] = 0x10;																					// position control mode
+class HandVisual : public morph::Visual
+{
+public:
+	HandVisual(int width, int height, const std::string& title, const std::string& _profileprefix)
+		: morph::Visual(width, height, title)
+		, profileprefix(_profileprefix) {}
 
-	int sdidx = 3;																							// counter to keep track of sendData index values (starts @ 3 so it ignores first 3 values)
-	for (int i = 0; i < 6; i++) {
+	hand::ProfileOverlay* overlay = nullptr;
 
-		float pdigital = arr[i] * 32767.f / 150.f;															// ratio equation to get position values from degrees
-		int16_t hexp = (int16_t)pdigital;
+protected:
+	void key_callback_extra(GLFWwindow* _window, int key, int scancode, int action, int mods) override
+	{
+		if (action != GLFW_PRESS)
+			return;
+		if (key == GLFW_KEY_G && this->overlay != nullptr) {
+			this->overlay->toggle();
+		}
+		else if (key == GLFW_KEY_E) {
+			exportProfile(this->profileprefix);
+		}
+	}
 
-		send_data[sdidx + 1] = hexp >> 8;																	// split message into bytes
-		send_data[sdidx] = hexp & 0xff;
-		sdidx += 2;																							// increment to next set of two bytes
+private:
+	std::string profileprefix;
+};
+
+/*
+* @brief records (if recordpath isn't NULL) and plots everything acq produces until the window is closed. history_rate_hz
+* is the rate of the samples in session time, which sets how many samples make up the dashboard's 10 s of history.
+* The stage timings are written to profileprefix.csv/.json on E and, if exportatexit, when the window is closed
+*/
+static int run(hand::Acquisition& acq, const char* recordpath, double history_rate_hz, const char* linkname,
+	const std::string& profileprefix, bool exportatexit)
+{
+	hand::SessionWriter recorder;
+	if (recordpath != NULL) {
+		if (!recorder.open(recordpath, acq.getRate()))
+			return -300;
+		acq.setRecorder(&recorder);
 	}
 
-	send_data[15] = checkSum(send_data, send_data[0], TRUE);							// checksum for just data being sent directly to the hand
-	send_data[16] = checkSum(send_data, send_data[0], FALSE);								// checksum for entire SPI message
-}
+	HandVisual v(1600, 900, std::string("HandPlot (") + linkname + ")", profileprefix);
+
+	// 10 s of every channel at the full rate. Pushing samples onto a strip chart is O(1) per sample however long
+	// the window is, so the charts can hold every sample.
+	hand::Dashboard dash(v, history_rate_hz, 10.0);
 
+	// In front of the middle of the dashboard, hidden until G is pressed
+	hand::ProfileOverlay overlay(v, { "SPI transfer", "Command", "Decode", "Dashboard::flush", "GraphVisual::pushstrip",
+		"GraphVisual::uploadStripPending", "VisualModel::reinit_buffers", "Visual::render" }, { 1.3f, -0.6f, 0.5f });
+	v.overlay = &overlay;
 
+	GLFWwindow* win = glfwGetCurrentContext();
+	hand::PeriodicTimer frames(60.0);
 
+	bool ended = false;
+	acq.start();
+	frames.start();
+	while (v.readyToFinish == false)
+	{
+		frames.wait();
+		glfwPollEvents();
+
+		// The cursor demo follows the mouse's height in the window
+		double cx = 0.0, cy = 0.0;
+		int ww = 0, wh = 0;
+		glfwGetCursorPos(win, &cx, &cy);
+		glfwGetWindowSize(win, &ww, &wh);
+		if (wh > 0)
+			acq.setCursor((float)(cy / wh));
+
+		// Take everything the acquisition thread produced since the last frame, then hand it to the graphs in one go
+		acq.samples.drain ([&dash](const hand::Sample& s) { dash.append(s); });
+		dash.flush();
+		if (acq.finished() && !ended) {
+			// The window stays up, showing the end of the session, until it is closed
+			printf("End of session\n");
+			ended = true;
+		}
+		overlay.update();
+		// Only draws if a chart has new data or the view has changed
+		v.render();
+	}
 
+	acq.stop();
+	printf("%llu transfers (%.0f frames/s), %llu overruns, %llu samples dropped\n", (unsigned long long)acq.transfers(),
+		acq.achievedRate(), (unsigned long long)acq.overruns(), (unsigned long long)acq.samples.drops());
+	acq.latency().print("Command to reply");
+	acq.transferTime().print("SPI transfer    ");
+	if (acq.getRate() > 0.0)
+		acq.jitter().print("Wake up jitter  ");
+	for (const auto& st : morph::Profiler::i().snapshot()) {
+		if (st.second.count() > 0)
+			st.second.print(st.first.c_str());
+	}
+	if (exportatexit)
+		exportProfile(profileprefix);
+	if (recordpath != NULL) {
+		acq.setRecorder(nullptr);
+		recorder.close();
+		printf("%llu frames recorded to %s, %llu dropped\n",
+			(unsigned long long)recorder.written(), recordpath, (unsigned long long)recorder.drops());
+	}
+	return 0;
+}
 
-int main()
+/*
+* @brief usage: HandPlot [rate_hz] [--sim] [--demo wave|cursor|voltage] [--fifo priority] [--cpu n] [--calibrate]
+*                 [--depth n] [--record session.bin] [--profile prefix]
+*        HandPlot --replay session.bin [speed]
+*
+* The SPI transfers run on their own thread (see hand/Acquisition.h) at rate_hz (default 1000 Hz; 0 runs as fast as
+* the link allows), with up to n frames in flight (default 2). That thread runs the chosen demo's command generator
+* (see hand/Demos.h) on absolute deadlines; --fifo and --cpu put it on the SCHED_FIFO scheduler and pin it to a CPU
+* (see hand/Timing.h). This thread only drains the decoded frames into the dashboard (see hand/Dashboard.h) and
+* renders at 60 Hz. --calibrate times each SPI clock divider first and uses the
+* fastest one that gives intact replies (otherwise the divider is 256). With --record, every TX/RX frame is also
+* written to a session file. --sim talks to a simulated hand instead of the FT4222, and --replay plays a recorded
+* session back on its recorded timestamps, speed times faster (default 1), stopping after its last frame; neither
+* needs any hardware.
+*
+* When built with MORPH_PROFILE, each stage of the loop (SPI transfer, decode, strip chart updates, buffer uploads and
+* rendering) is timed (see morph/Profiler.h) and the percentiles printed at exit. In the window, G shows a chart of
+* the stage times and E writes them to prefix.csv and prefix.json (prefix handplot_profile by default). --profile
+* also writes them when the window is closed.
+*/
+int main(int argc, char** argv)
 {
-	DWORD locationID = 0;
-	int ret = setupDevice(&locationID);
-	printf("\n \n Attempting SPI SetUp...\n \n");
+	double rate_hz = 1000.0;
+	double speed = 1.0;
+	const char* recordpath = NULL;
+	const char* replaypath = NULL;
+	bool sim = false;
+	bool calibrate = false;
+	size_t depth = 2;
+	hand::Demo demo = hand::Demo::Wave;
+	hand::RealtimeOptions rt;
+	std::string profileprefix = "handplot_profile";
+	bool exportatexit = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replaypath = argv[++i];
+			// The speed is optional, so the next argument is only taken as one if it is a positive number
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+				char* end = NULL;
+				double s = std::strtod(argv[i + 1], &end);
+				if (end != argv[i + 1] && *end == '\0' && s > 0.0) {
+					speed = s;
+					i++;
+				}
+			}
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordpath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--sim") == 0) {
+			sim = true;
+		}
+		else if (strcmp(argv[i], "--demo") == 0 && i + 1 < argc) {
+			if (!hand::ParseDemo(argv[++i], demo)) {
+				printf("Unknown demo %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--fifo") == 0 && i + 1 < argc) {
+			rt.fifo_priority = std::atoi(argv[++i]);
+			if (rt.fifo_priority < 1 || rt.fifo_priority > 99) {
+				printf("Invalid SCHED_FIFO priority %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+			rt.cpu = std::atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			profileprefix = argv[++i];
+			exportatexit = true;
+		}
+		else if (strcmp(argv[i], "--calibrate") == 0) {
+			calibrate = true;
+		}
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+			int d = std::atoi(argv[++i]);
+			if (d < 1) {
+				printf("Invalid depth %s\n", argv[i]);
+				return -1;
+			}
+			depth = (size_t)d;
+		}
+		else {
+			rate_hz = std::atof(argv[i]);
+			if (rate_hz < 0.0) {
+				printf("Invalid acquisition rate %s\n", argv[i]);
+				return -1;
+			}
+		}
+	}
 
-	FT_HANDLE ftHandle = NULL;
-	FT_STATUS ftStatus;
-	FT4222_STATUS ft4222Status;
+	// Choose what's on the other end of the SPI link
+	hand::SessionReader session;
+	hand::Transport* link = NULL;
+	if (replaypath != NULL) {
+		if (!session.open(replaypath))
+			return -300;
+		// The replay is paced by the records' own times, so acquisition runs free and waits on the link
+		rate_hz = 0.0;
+		printf("Replaying %zu frames (%.1f s, recorded at %.0f Hz) at %gx\n",
+			session.size(), session.duration(), session.header()->rate_hz, speed);
+		link = new hand::ReplayTransport(session, speed);
+	}
+	else if (sim) {
+		// A USB round trip of 125 us, as on a full speed bus; the SPI time comes on top of that
+		link = new hand::SimulatedHand(rate_hz > 0.0 ? 1.0 / rate_hz : 0.001, 0.05, 125.0);
+	}
+	else {
+		DWORD locationID = 0;
+		setupDevice(&locationID);
+		printf("\n \n Attempting SPI SetUp...\n \n");
+		link = new hand::Ft4222Transport();
+	}
 
-	ftStatus = FT_Open(0, &ftHandle);
-	if (ftStatus != FT_OK)
-		return -100;
-
-	ft4222Status = FT4222_SPIMaster_Init(ftHandle, SPI_IO_SINGLE, CLK_DIV_256, CLK_IDLE_LOW, CLK_LEADING, 0x01);
-	if (ft4222Status != FT4222_OK)
-		return -200;
-
-	printf("SPI INIT SUCCESS\n");
-
-	int txsize = 0;
-	int rxsize = 0;
-	int txactualsize = 0;
-	uint16 sizeTransferred;
-	uint8 sendData[DATASIZE] = { 0 };		
-	uint8 readData[DATASIZE] = { 0 };
-	float degrees[6] = { 0 };
-	
-	
-	
-	
-	morph::Visual v(1024, 768, "Continuous redrawing of GraphVisual");
-
-	auto gv = new morph::GraphVisual<double> (v.shaderprog, v.tshaderprog, {0,0,0});
-
-	morph::vVector<double> x;
-	morph::vVector<double> y;
-	gv->setsize(2,2);
-	v.setSceneTransXY(-1, -1);
-	x.linspace (-morph::mathconst<double>::pi, morph::mathconst<double>::pi, 100);
-	y.linspace (-10.1, 120.000000001, 100);
-	
-	gv->setdata (x, y);
-	gv->finalize();
-
-	v.addVisualModel (gv);
-
-	auto start = std::chrono::high_resolution_clock::now();
-	//while (v.readyToFinish == false) 
-	int loopiterator = 0;
-	while(1)
+	int ret = 0;
 	{
-	
-		auto finish = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> t = finish - start;
-		FingerWave(degrees, txsize, rxsize, txactualsize, t.count());
-		LoadTXDegrees(degrees, sendData);
-		ft4222Status = FT4222_SPIMaster_SingleReadWrite(ftHandle, &readData[0], &sendData[0], txsize, &sizeTransferred, 1);
-		motordata_t posdata;
-		for (int i = 0; i < 24; i++) {
-			posdata.bytes[i] = readData[i + 3];
+		hand::Acquisition acq(*link, rate_hz);
+		ret = acq.open(CLK_DIV_256);
+		if (ret == 0 && calibrate && replaypath == NULL) {
+			// Calibrate with the wave's first command, which is where the hand is about to be sent anyway
+			float degrees[6] = { 0 };
+			uint8_t sendData[DATASIZE] = { 0 };
+			int txsize = 0, rxsize = 0, txactualsize = 0;
+			hand::FingerWave(degrees, txsize, rxsize, txactualsize, 0.0);
+			hand::LoadTXDegrees(degrees, sendData);
+			hand::CalibrateClock(*link, sendData, (uint16_t)txsize);
 		}
-		for (int ch = 0; ch < 6; ch++) {
-			degrees[ch] = ((float)posdata.vals[ch * 2]) * 150.f / 32767.f;
+		acq.setTimeScale(speed);
+		acq.setDepth(depth);
+		acq.setDemo(demo);
+		acq.setRealtime(rt);
+		// The charts hold 10 s worth at the rate the samples come in (in session time), or at 1 kHz when running free
+		double history_rate_hz = rate_hz > 0.0 ? rate_hz : 1000.0;
+		if (replaypath != NULL) {
+			// A session recorded running free has no rate in its header, so go by the records
+			const double span = session.size() > 1 ? (double)(session[session.size() - 1].t_ns - session[0].t_ns) * 1e-9 : 0.0;
+			if (session.header()->rate_hz > 0.0)
+				history_rate_hz = session.header()->rate_hz;
+			else if (span > 0.0)
+				history_rate_hz = (double)(session.size() - 1) / span;
 		}
-
-		
-		glfwWaitEventsTimeout (0.01667); // 16.67 ms ~ 60 Hz
-		
-		double p = degrees[3];
-		
-		for(int i=0; i<y.size()-1; i++)
-		{
-			y[i] = y[i+1];
-		}
-		y[y.size()-1] = p;
-		gv->update (x, y, 0);
-		
-		loopiterator++;
-		if(loopiterator % 100 == 0)
-			v.render();
-		
+		if (ret == 0)
+			ret = run(acq, recordpath, history_rate_hz, link->name(), profileprefix, exportatexit);
 	}
-
-	return 0;
+	delete link;
+	return ret;
 }
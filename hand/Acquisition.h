@@ -0,0 +1,274 @@
+/*
+*
+* @file Acquisition.h
+*
+* @brief The real-time I/O side of HandPlot. An Acquisition drives a Transport (see hand/Transport.h) from its own
+* thread which, once per period of a PeriodicTimer (see hand/Timing.h), collects the replies that have come back,
+* computes the next command of the selected demo (see hand/Demos.h), loads it into the TX buffer and hands it to a
+* TransactionScheduler (see hand/Scheduler.h) for transfer. Each decoded reply (a HandFrame) is published into a
+* lock-free ring. The GUI thread drains the ring at its own frame rate, so a slow render can no longer stretch the
+* control period.
+*
+* @attention Only the acquisition thread touches the Transport once start() has been called.
+*
+*/
+
+#pragma once
+
+#include "hand/Protocol.h"
+#include "hand/SpscRing.h"
+#include "hand/SessionLog.h"
+#include "hand/Transport.h"
+#include "hand/Scheduler.h"
+#include "hand/Stats.h"
+#include "hand/Timing.h"
+#include "hand/Demos.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace hand {
+
+	class Acquisition
+	{
+	public:
+		/*
+		* @param rate_hz the command rate. Zero (or less) runs free, as fast as the link will go
+		*/
+		explicit Acquisition(Transport& _link, double rate_hz = 1000.0, size_t ring_capacity = 1 << 14)
+			: samples(ring_capacity)
+			, link(_link)
+			, rate(rate_hz) {}
+
+		~Acquisition()
+		{
+			this->stop();
+			this->close();
+		}
+
+		Acquisition(const Acquisition&) = delete;
+		Acquisition& operator=(const Acquisition&) = delete;
+
+		/*
+		* @brief opens the transport. Returns 0 or the same negative codes main() always used
+		*/
+		int open(FT4222_SPIClock clk_div = CLK_DIV_256) { return this->link.open(clk_div); }
+
+		void close() { this->link.close(); }
+
+		/*
+		* @brief launches the acquisition thread. The rate is fixed for the lifetime of the thread
+		*/
+		void start()
+		{
+			if (this->running.load()) { return; }
+			this->latencies.clear();
+			this->transfertimes.clear();
+			this->wakejitter.clear();
+			this->stopped.store(0);
+			this->ended.store(false);
+			this->running.store(true);
+			this->worker = std::thread(&Acquisition::run, this);
+		}
+
+		void stop()
+		{
+			this->running.store(false);
+			if (this->worker.joinable()) { this->worker.join(); }
+		}
+
+		/*
+		* @brief sends a copy of every TX/RX frame to rec (which must already be open). Call before start(); pass nullptr to stop recording
+		*/
+		void setRecorder(SessionWriter* rec) { this->recorder = rec; }
+
+		/*
+		* @brief sample times are the time since start() times scale. For a replay running at n times the recorded rate, pass n
+		* so that times (and the velocities derived from them) are in session seconds. Call before start()
+		*/
+		void setTimeScale(double scale) { this->timescale = scale; }
+
+		/*
+		* @brief how many SPI frames may be in flight at once (see hand/Scheduler.h). 1 gives strict command, transfer,
+		* decode lockstep; 2 (the default) lets the next command be queued while the current transfer is on the wire.
+		* Call before start()
+		*/
+		void setDepth(size_t _depth) { this->depth = _depth; }
+
+		/*
+		* @brief which command generator to run. Call before start()
+		*/
+		void setDemo(Demo _demo) { this->demo = _demo; }
+
+		/*
+		* @brief the cursor height for Demo::Cursor, 0 at the top of the window to 1 at the bottom. May be called from any thread
+		*/
+		void setCursor(float y) { this->cursor.store(y, std::memory_order_relaxed); }
+
+		/*
+		* @brief scheduling for the acquisition thread (see hand/Timing.h). The transfer thread is left on the normal
+		* scheduler, as it spends its time blocked in USB transfers. Call before start()
+		*/
+		void setRealtime(const RealtimeOptions& opts) { this->rtopts = opts; }
+
+		double getRate() const { return this->rate; }
+		//! Number of SPI transfers completed so far
+		uint64_t transfers() const { return this->count.load(std::memory_order_relaxed); }
+		//! True once the link has answered all the transfers it can (see Transport::maxTransfers()) and the thread has stopped
+		bool finished() const { return this->ended.load(std::memory_order_relaxed); }
+		//! Number of periods whose command was not sent: deadlines missed altogether, or the link still busy with depth frames
+		uint64_t overruns() const { return this->late.load(std::memory_order_relaxed); }
+
+		//! The frame rate actually achieved since start() (until stop(), if stopped)
+		double achievedRate() const
+		{
+			using clock = std::chrono::steady_clock;
+			auto t1 = this->stopped.load();
+			if (t1 == 0) { t1 = clock::now().time_since_epoch().count(); }
+			double secs = std::chrono::duration<double>(clock::duration(t1 - this->started.load())).count();
+			return secs > 0.0 ? (double)this->transfers() / secs : 0.0;
+		}
+
+		//! Time from a command being queued to its reply coming back. Read only once stop() has returned
+		const LatencyHistogram& latency() const { return this->latencies; }
+		//! Time the transfer itself took. Read only once stop() has returned
+		const LatencyHistogram& transferTime() const { return this->transfertimes; }
+		//! How late the control thread woke for each period. Empty when running free. Read only once stop() has returned
+		const LatencyHistogram& jitter() const { return this->wakejitter; }
+
+		//! Decoded samples, produced by the acquisition thread and consumed by the GUI thread
+		SpscRing<Sample> samples;
+
+	private:
+		void run()
+		{
+			using clock = std::chrono::steady_clock;
+
+			TransactionScheduler sched(this->link, this->depth);
+			sched.start();
+			MakeRealtime(this->rtopts, "acquisition");
+
+			int txsize = 0;
+			int rxsize = 0;
+			int txactualsize = 0;
+			uint8 sendData[DATASIZE] = { 0 };
+			float degrees[6] = { 0 };
+			float voltage[6] = { 0 };
+			HandFrame prev;
+			double tprev = -1.0;																		// no previous frame yet
+			bool feedback = false;																		// prev is an intact reply
+
+			const auto start = clock::now();
+			this->started.store(start.time_since_epoch().count());
+			// Commands queued so far, which stop at the link's limit
+			const uint64_t limit = this->link.maxTransfers();
+			uint64_t submitted = 0;
+			// True once every transfer the link will answer has been collected
+			auto exhausted = [&]() { return submitted >= limit && sched.outstanding() == 0; };
+
+			// Builds the next command of the demo at time t (s since start) and queues it. Returns false if the link is full
+			auto command = [&](double t) {
+				MORPH_PROFILE_SCOPE("Command");
+				switch (this->demo) {
+				case Demo::Cursor:
+					FingerWave(degrees, txsize, rxsize, txactualsize, t);								// for the sizes
+					CursorDemo(degrees, this->cursor.load(std::memory_order_relaxed));
+					LoadTXDegrees(degrees, sendData);
+					break;
+				case Demo::Voltage:
+					FingerWave(degrees, txsize, rxsize, txactualsize, t);
+					if (feedback) { VoltageControl(voltage, degrees, prev); }
+					LoadTXVoltage(voltage, sendData);													// zero volts until there is something to control from
+					break;
+				default:
+					FingerWave(degrees, txsize, rxsize, txactualsize, t);
+					LoadTXDegrees(degrees, sendData);
+					break;
+				}
+				return sched.submit(sendData, (uint16_t)txsize);
+			};
+
+			// Decodes and publishes everything that has come back
+			auto collect = [&]() {
+				return sched.drain([&](const Transaction& tr) {
+					MORPH_PROFILE_SCOPE("Decode");
+					Sample s;
+					s.status = tr.status;
+					s.t = std::chrono::duration<double>(tr.done - start).count() * this->timescale;
+					if (this->recorder != nullptr) {
+						FrameRecord r;
+						r.t_ns = (uint64_t)(s.t * 1e9);
+						memcpy(r.tx, tr.tx, TXFRAMESIZE);
+						memcpy(r.rx, tr.rx, SPIFRAMESIZE);
+						r.status = (int32_t)s.status;
+						this->recorder->record(r);
+					}
+					DecodeHandFrame(tr.rx, prev, tprev < 0.0 ? 0.0 : s.t - tprev, s.frame);
+					prev = s.frame;
+					tprev = s.t;
+					feedback = tr.status == FT4222_OK && RXCheckSumOK(tr.rx);
+					this->samples.push(s);
+					this->latencies.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(tr.done - tr.submitted).count());
+					this->transfertimes.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(tr.done - tr.started).count());
+					this->count.fetch_add(1, std::memory_order_relaxed);
+				});
+			};
+
+			if (this->rate > 0.0) {
+				// One command per period, on absolute deadlines, so that a late period doesn't push every later one back too.
+				// The replies to the previous periods' commands are collected first, so the voltage controller always
+				// works from the latest reply.
+				PeriodicTimer timer(this->rate);
+				timer.start();
+				while (this->running.load(std::memory_order_relaxed)) {
+					uint64_t missed = timer.wait();
+					collect();
+					if (exhausted()) { break; }
+					if (submitted < limit) {
+						if (command(std::chrono::duration<double>(clock::now() - start).count())) { submitted++; }
+						else { missed++; }
+					}
+					if (missed > 0) { this->late.fetch_add(missed, std::memory_order_relaxed); }
+				}
+				this->wakejitter = timer.wakeJitter();
+			}
+			else {
+				// Keep the link busy: up to depth commands in flight, each built as soon as there is room for it
+				while (this->running.load(std::memory_order_relaxed)) {
+					while (submitted < limit && sched.outstanding() < sched.getDepth()) {
+						if (command(std::chrono::duration<double>(clock::now() - start).count())) { submitted++; }
+					}
+					if (collect() == 0) {
+						if (exhausted()) { break; }
+						sched.waitForCompletion();
+					}
+				}
+			}
+			sched.stop();
+			this->stopped.store(clock::now().time_since_epoch().count());
+			this->ended.store(exhausted());
+		}
+
+		Transport& link;
+		SessionWriter* recorder = nullptr;
+		double rate;
+		double timescale = 1.0;
+		size_t depth = 2;
+		Demo demo = Demo::Wave;
+		std::atomic<float> cursor{ 0.5f };
+		RealtimeOptions rtopts;
+		LatencyHistogram latencies;
+		LatencyHistogram transfertimes;
+		LatencyHistogram wakejitter;
+		std::atomic<std::chrono::steady_clock::rep> started{ 0 };
+		std::atomic<std::chrono::steady_clock::rep> stopped{ 0 };
+		std::thread worker;
+		std::atomic<bool> running{ false };
+		std::atomic<bool> ended{ false };
+		std::atomic<uint64_t> count{ 0 };
+		std::atomic<uint64_t> late{ 0 };
+	};
+
+} // namespace hand
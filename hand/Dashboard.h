@@ -0,0 +1,113 @@
+/*
+*
+* @file Dashboard.h
+*
+* @brief A live view of every channel in the hand's reply: a grid of GraphVisuals in one morph::Visual showing finger
+* position, velocity and current and the 30 touch sensors (one panel per finger) as scrolling strip charts.
+*
+* @note Samples are appended into per-channel staging buffers as they are drained from the acquisition ring, and each
+* channel's buffer is handed to its strip chart in one call per rendered frame (see flush()), so the cost of a frame
+* does not grow with the number of channels times the sample rate.
+*
+*/
+
+#pragma once
+
+#include <morph/Visual.h>
+#include <morph/GraphVisual.h>
+#include "hand/Acquisition.h"
+#include <array>
+#include <vector>
+#include <string>
+
+namespace hand {
+
+	class Dashboard
+	{
+	public:
+		static constexpr int numChannels = 3 * NUMFINGERS + NUMTOUCH;
+
+		/*
+		* @brief builds the panels and adds them to v. history_s seconds of data at rate_hz are shown in each strip chart
+		*/
+		Dashboard(morph::Visual& v, double rate_hz, double history_s = 10.0)
+		{
+			const size_t window = (size_t)(history_s * rate_hz);
+			const char* fingers[NUMFINGERS] = { "Index", "Middle", "Ring", "Pinky", "Thumb F", "Thumb R" };
+			const char* touchfingers[5] = { "Index", "Middle", "Ring", "Pinky", "Thumb" };
+
+			// Four columns, two rows. Positions, velocities and currents, then a panel for each finger's touch sensors
+			int c = 0;
+			for (int p = 0; p < 8; p++) {
+				morph::Vector<float> offset = { (p % 4) * pitch_x, -(p / 4) * pitch_y, 0.0f };
+				auto gv = new morph::GraphVisual<float> (v.shaderprog, v.tshaderprog, offset);
+				gv->setsize (panel_w, panel_h);
+				if (p == 0) {
+					gv->setlimits (-history_s, 0.0, -90.0, 120.0);
+					gv->ylabel = "Position (deg)";
+				} else if (p == 1) {
+					gv->setlimits (-history_s, 0.0, -300.0, 300.0);
+					gv->ylabel = "Velocity (deg/s)";
+				} else if (p == 2) {
+					gv->setlimits (-history_s, 0.0, -2.0, 2.0);
+					gv->ylabel = "Current (A)";
+				} else {
+					gv->setlimits (-history_s, 0.0, 0.0, 4095.0);
+					gv->ylabel = std::string(touchfingers[p - 3]) + " touch";
+				}
+				gv->xlabel = "t (s)";
+				for (int ch = 0; ch < 6; ch++, c++) {
+					std::string name = p < 3 ? fingers[ch] : std::to_string(ch + 1);
+					this->channels[c].gv = gv;
+					this->channels[c].didx = gv->prepstrip (window, name);
+					this->channels[c].staged.reserve ((size_t)(rate_hz * 0.1));
+				}
+				gv->finalize();
+				v.addVisualModel (gv);
+			}
+
+			// Centre the grid in the window
+			v.setSceneTrans (-(3 * pitch_x + panel_w) / 2.0f, (pitch_y - panel_h) / 2.0f, -6.5f);
+		}
+
+		/*
+		* @brief stages every channel of one sample. Nothing is drawn until flush()
+		*/
+		void append(const Sample& s)
+		{
+			int c = 0;
+			for (int ch = 0; ch < NUMFINGERS; ch++) { this->channels[c++].staged.push_back (s.frame.position[ch]); }
+			for (int ch = 0; ch < NUMFINGERS; ch++) { this->channels[c++].staged.push_back (s.frame.velocity[ch]); }
+			for (int ch = 0; ch < NUMFINGERS; ch++) { this->channels[c++].staged.push_back (s.frame.current[ch]); }
+			for (int i = 0; i < NUMTOUCH; i++) { this->channels[c++].staged.push_back ((float)s.frame.touch[i]); }
+		}
+
+		/*
+		* @brief hands each channel's staged samples to its strip chart in one call. Returns the number of samples flushed
+		*/
+		size_t flush()
+		{
+			MORPH_PROFILE_SCOPE("Dashboard::flush");
+			size_t n = this->channels[0].staged.size();
+			for (auto& ch : this->channels) {
+				ch.gv->pushstrip (ch.staged.data(), ch.staged.size(), ch.didx);
+				ch.staged.clear();
+			}
+			return n;
+		}
+
+	private:
+		struct Channel {
+			morph::GraphVisual<float>* gv = nullptr;
+			size_t didx = 0;
+			std::vector<float> staged;
+		};
+		std::array<Channel, numChannels> channels;
+
+		static constexpr float panel_w = 1.0f;
+		static constexpr float panel_h = 0.6f;
+		static constexpr float pitch_x = 1.4f;
+		static constexpr float pitch_y = 1.0f;
+	};
+
+} // namespace hand
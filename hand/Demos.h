@@ -0,0 +1,60 @@
+/*
+*
+* @file Demos.h
+*
+* @brief The command generators of the dongle demos (dongle/rundemos.cpp), for the acquisition thread: the finger wave
+* (FingerWave, in hand/Protocol.h), the cursor demo, and the voltage controller which makes the fingers follow the wave. Each is
+* called once per control period, so their timing is set by the acquisition rate and not by the render loop.
+*
+*/
+
+#pragma once
+
+#include "hand/Protocol.h"
+#include <cstring>
+
+#define CURSORCONTROLRANGE	90.f																			// degrees of flexion from the top to the bottom of the window
+#define VOLTAGE_KP			50.f																			// duty per degree of position error (K in dongle/VoltageWave_Demo.h)
+#define VOLTAGE_KD			1.f																			// duty per degree/s of finger velocity (unit gain, as in dongle/VoltageWave_Demo.h)
+
+namespace hand {
+
+	enum class Demo {
+		Wave,																								// position commands from FingerWave
+		Cursor,																								// position commands from the mouse
+		Voltage																								// voltage commands which make the fingers follow FingerWave
+	};
+
+	/*
+	* @brief "wave", "cursor" or "voltage" to a Demo. Returns false for anything else
+	*/
+	inline bool ParseDemo(const char* name, Demo& demo) {
+		if (strcmp(name, "wave") == 0) { demo = Demo::Wave; }
+		else if (strcmp(name, "cursor") == 0) { demo = Demo::Cursor; }
+		else if (strcmp(name, "voltage") == 0) { demo = Demo::Voltage; }
+		else { return false; }
+		return true;
+	}
+
+	/*
+	* @brief opens and closes the fingers with the mouse
+	* @param cursor_y the height of the cursor in the window, 0 at the top to 1 at the bottom
+	*/
+	inline void CursorDemo(float* deg, float cursor_y) {
+		float y = cursor_y < 0.f ? 0.f : (cursor_y > 1.f ? 1.f : cursor_y);
+		for (int ch = 0; ch < 6; ch++) {
+			deg[ch] = y * CURSORCONTROLRANGE;
+		}
+		deg[5] = -deg[5];																					// negate thumb rotator
+	}
+
+	/*
+	* @brief the voltage controller of dongle/VoltageWave_Demo.cpp: u = KP (desired - measured) - KD (finger velocity)
+	*/
+	inline void VoltageControl(float* volt, const float* deg, const HandFrame& measured) {
+		for (int ch = 0; ch < 6; ch++) {
+			volt[ch] = VOLTAGE_KP * (deg[ch] - measured.position[ch]) - VOLTAGE_KD * measured.velocity[ch];
+		}
+	}
+
+} // namespace hand
@@ -0,0 +1,87 @@
+/*
+*
+* @file ProfileOverlay.h
+*
+* @brief A strip chart of where the time goes in HandPlot: one trace per profiled stage (see morph/Profiler.h), each
+* point the mean time that stage took over the last update interval. It is drawn in front of the dashboard and starts
+* hidden; HandPlot toggles it with the G key.
+*
+*/
+
+#pragma once
+
+#include <morph/Visual.h>
+#include <morph/GraphVisual.h>
+#include <morph/Profiler.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace hand {
+
+	class ProfileOverlay
+	{
+	public:
+		/*
+		* @brief adds the chart to v at offset. stages are the names of the stages to trace; a stage that never runs stays at 0
+		*/
+		ProfileOverlay(morph::Visual& v, const std::vector<std::string>& stages, morph::Vector<float> offset,
+			double interval_s = 0.5, double history_s = 60.0, float max_us = 1000.0f)
+			: interval(interval_s)
+		{
+			this->gv = new morph::GraphVisual<float> (v.shaderprog, v.tshaderprog, offset);
+			this->gv->setsize (2.4f, 1.2f);
+			this->gv->setlimits (-history_s, 0.0, 0.0, max_us);
+			this->gv->xlabel = "t (s)";
+			this->gv->ylabel = "Mean stage time (us)";
+			for (const auto& name : stages) {
+				Trace t;
+				t.id = morph::Profiler::i().stage (name);
+				t.didx = this->gv->prepstrip ((size_t)(history_s / interval_s), name);
+				this->traces.push_back (t);
+			}
+			this->gv->finalize();
+			this->gv->setHide (true);
+			v.addVisualModel (this->gv);
+			this->last = std::chrono::steady_clock::now();
+		}
+
+		void toggle() { this->gv->toggleHide(); }
+
+		/*
+		* @brief adds a point to every trace if interval has passed since the last one. Call once per rendered frame. Returns
+		* true if the chart changed
+		*/
+		bool update()
+		{
+			const auto now = std::chrono::steady_clock::now();
+			if (std::chrono::duration<double>(now - this->last).count() < this->interval) { return false; }
+			this->last = now;
+
+			auto snap = morph::Profiler::i().snapshot();
+			for (auto& t : this->traces) {
+				const morph::TimeHistogram& h = snap[t.id].second;
+				const uint64_t dn = h.count() - t.n;
+				const float mean_us = dn > 0 ? (float)((h.sum() - t.sum) / dn) * 1e-3f : 0.0f;
+				t.n = h.count();
+				t.sum = h.sum();
+				this->gv->pushstrip (mean_us, t.didx);
+			}
+			return true;
+		}
+
+	private:
+		struct Trace {
+			int id = 0;
+			size_t didx = 0;
+			uint64_t n = 0;																					// count and sum at the previous point
+			uint64_t sum = 0;
+		};
+
+		morph::GraphVisual<float>* gv = nullptr;
+		std::vector<Trace> traces;
+		double interval;
+		std::chrono::steady_clock::time_point last;
+	};
+
+} // namespace hand
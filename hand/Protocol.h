@@ -0,0 +1,215 @@
+/*
+*
+* @file Protocol.h
+*
+* @brief The SPI message layout shared by the dongle and HandPlot: the TX position command that is sent to the
+* PSYONIC hand and the decoding of the 75 byte reply.
+*
+* @note The STM on the dongle prepends three bytes to the 72 byte reply variant from the hand, so the position
+* data starts at index 3 of the RX buffer (see dongle/read.cpp).
+*
+*/
+
+#pragma once
+
+#include "ftd2xx.h"
+#include "LibFT4222.h"
+#include <cstdint>
+#include <cmath>
+
+#define DATASIZE		128
+#define SPIFRAMESIZE	75																					// 17 populated TX bytes, zeropadded so we can receive 72 + length & format
+#define TXFRAMESIZE		17
+#define RXMOTOROFFSET	3																					// the STM's three bytes come first
+#define RXTOUCHOFFSET	(RXMOTOROFFSET + 24)																// 30 x 12 bit touch values follow the 6 x 4 motor bytes
+#define RXHANDSIZE		(SPIFRAMESIZE - RXMOTOROFFSET)														// the hand's own 72 byte reply, which ends in its checksum
+#define NUMFINGERS		6
+#define NUMTOUCH		30
+#define VOLTAGELIMIT	3546																				// largest duty the hand takes in voltage mode
+
+namespace hand {
+
+	typedef union {
+		uint8_t bytes[24];
+		int16_t vals[12];
+	}motordata_t;
+
+	/*
+	* @brief everything decoded from one reply of the hand, in engineering units
+	* @note the reply to a position command (mode 0x10) carries a position and a current word for each finger. The hand
+	* does not send velocity in this reply variant, so velocity is the backward difference of the position (see DecodeHandFrame)
+	*/
+	struct HandFrame {
+		float position[NUMFINGERS] = { 0 };																	// degrees
+		float velocity[NUMFINGERS] = { 0 };																	// degrees/s
+		float current[NUMFINGERS] = { 0 };																	// amps
+		uint16_t touch[NUMTOUCH] = { 0 };																	// raw 12 bit, 6 sensors per finger in the order index, middle, ring, pinky, thumb
+	};
+
+	/*
+	* @brief one decoded reply from the hand, stamped with the time (s since acquisition started) at which its transfer completed
+	*/
+	struct Sample {
+		double t = 0.0;
+		HandFrame frame;
+		FT4222_STATUS status = FT4222_OK;
+	};
+
+	/*
+	* @brief helper function to find checksum
+	* @param handDataTX indicates to only calculate part of buffer that is hand data or the entire SPI message to the STM
+	*/
+	inline uint8_t checkSum(uint8_t* arr, uint8_t length, bool handDataTX) {
+		int8_t sum = 0;
+		if (handDataTX) {
+			for (uint8_t b = 1; b < length - 2; b++) { 														// start at first index to ignore length of SPI message byte
+				sum += (int8_t)arr[b];
+			}
+		}
+		else {
+			for (uint8_t b = 0; b < length - 1; b++) { 														// parse each byte except checksum (last byte)
+				sum += (int8_t)arr[b];
+			}
+		}
+		sum = 0x100 - sum;																					// subtract sum of other bytes from zero to get checksum
+		return sum;
+	}
+
+	/*
+	* @brief sinusoidal function and data size allocation
+	*/
+	inline void FingerWave(float* deg, int& txdatasize, int& rxdatasize, int& readtxsize, double time) {
+		txdatasize = SPIFRAMESIZE;																			// sending 17 real populated bytes but zeropadding so we can receive 72 + length & format
+		rxdatasize = SPIFRAMESIZE;
+		readtxsize = TXFRAMESIZE;
+
+		double ft = time * 6;
+		for (int ch = 0; ch < 6; ch++)																		// parse through each finger channel & set new associated degree value
+		{
+			deg[ch] = ( (0.5 * sin((ft + (float)ch)) + .5) * 45 + 15);										// sinusoidal function on all fingers
+		}
+		deg[5] = -deg[5];																					// negate thumb rotator
+	}
+
+	/*
+	* @brief converts degree outputs from previous function into gear ratio and packages data into TX array
+	*/
+	inline void LoadTXDegrees(float* arr, uint8_t* send_data) {
+		send_data[0] = 0x11;																				// length of message (17)
+		send_data[1] = 0x50;																				// hand address
+		send_data[2] = 0x10;																				// position control mode
+
+		int sdidx = 3;																						// counter to keep track of sendData index values (starts @ 3 so it ignores first 3 values)
+		for (int i = 0; i < 6; i++) {
+
+			float pdigital = arr[i] * 32767.f / 150.f;														// ratio equation to get position values from degrees
+			int16_t hexp = (int16_t)pdigital;
+
+			send_data[sdidx + 1] = hexp >> 8;																// split message into bytes
+			send_data[sdidx] = hexp & 0xff;
+			sdidx += 2;																						// increment to next set of two bytes
+		}
+
+		send_data[15] = checkSum(send_data, send_data[0], TRUE);											// checksum for just data being sent directly to the hand
+		send_data[16] = checkSum(send_data, send_data[0], FALSE);											// checksum for entire SPI message
+	}
+
+	/*
+	* @brief packages one voltage (duty) per finger into a voltage mode TX command, as LoadTXVoltage in dongle/VoltageWave_Demo.cpp.
+	* Values are clamped to the +/-VOLTAGELIMIT the hand accepts
+	*/
+	inline void LoadTXVoltage(const float* arr, uint8_t* send_data) {
+		send_data[0] = TXFRAMESIZE;																			// length of SPI message
+		send_data[1] = 0x50;																				// hand address
+		send_data[2] = 0x40;																				// voltage control mode
+
+		int sdidx = 3;
+		for (int i = 0; i < 6; i++) {
+			float v = arr[i] > VOLTAGELIMIT ? VOLTAGELIMIT : (arr[i] < -VOLTAGELIMIT ? -VOLTAGELIMIT : arr[i]);
+			int16_t hexv = (int16_t)v;
+
+			send_data[sdidx + 1] = hexv >> 8;																// split message into bytes
+			send_data[sdidx] = hexv & 0xff;
+			sdidx += 2;
+		}
+
+		send_data[15] = checkSum(send_data, send_data[0], TRUE);											// checksum for just data being sent directly to the hand
+		send_data[16] = checkSum(send_data, send_data[0], FALSE);											// checksum for entire SPI message
+	}
+
+	/*
+	* @brief copies the position words out of an RX buffer (position data starts at index 3, see note above)
+	*/
+	inline void UnpackPositions(const uint8_t* read_data, motordata_t& posdata) {
+		for (int i = 0; i < 24; i++) {
+			posdata.bytes[i] = read_data[i + RXMOTOROFFSET];
+		}
+	}
+
+	/*
+	* @brief unpacks little endian packed 12 bit values (the touch sensor data), as unpack_8bit_into_12bit in dongle/helpers.cpp
+	*/
+	inline void Unpack12Bit(const uint8_t* arr, uint16_t* vals, int valsize) {
+		for (int i = 0; i < valsize; i++)
+			vals[i] = 0;																					// clear the buffer before loading it with |=
+		for (int bidx = valsize * 12 - 4; bidx >= 0; bidx -= 4)
+		{
+			int validx = bidx / 12;
+			int arridx = bidx / 8;
+			int shift_val = (bidx % 8);
+			vals[validx] |= ((arr[arridx] >> shift_val) & 0x0F) << (bidx % 12);
+		}
+	}
+
+	/*
+	* @brief the inverse of Unpack12Bit: packs valsize 12 bit values into valsize * 3 / 2 bytes
+	*/
+	inline void Pack12Bit(const uint16_t* vals, uint8_t* arr, int valsize) {
+		for (int i = 0; i < valsize * 12 / 8; i++)
+			arr[i] = 0;
+		for (int bidx = valsize * 12 - 4; bidx >= 0; bidx -= 4)
+		{
+			int validx = bidx / 12;
+			int arridx = bidx / 8;
+			arr[arridx] |= ((vals[validx] >> (bidx % 12)) & 0x0F) << (bidx % 8);
+		}
+	}
+
+	/*
+	* @brief true if the hand's part of an RX buffer sums to zero (and isn't all zeros), as isRXCheckSumCorrect in dongle/helpers.cpp
+	*/
+	inline bool RXCheckSumOK(const uint8_t* read_data) {
+		uint8_t ORsum = 0;
+		int8_t sum = 0;
+		for (int b = RXMOTOROFFSET; b < SPIFRAMESIZE; b++) {
+			sum += (int8_t)read_data[b];
+			ORsum |= read_data[b];
+		}
+		return sum == 0 && ORsum != 0;
+	}
+
+	/*
+	* @brief converts the position words of a motordata_t into degrees for each of the six fingers
+	*/
+	inline void PositionsToDegrees(const motordata_t& posdata, float* deg) {
+		for (int ch = 0; ch < 6; ch++) {
+			deg[ch] = ((float)posdata.vals[ch * 2]) * 150.f / 32767.f;
+		}
+	}
+
+	/*
+	* @brief decodes a whole RX buffer into a HandFrame. Call once per SPI transaction
+	* @param prev the previous frame, dt the time since it was received (s): used to estimate the velocity. Pass dt <= 0 for the first frame
+	*/
+	inline void DecodeHandFrame(const uint8_t* read_data, const HandFrame& prev, double dt, HandFrame& frame) {
+		motordata_t motordata;
+		UnpackPositions(read_data, motordata);
+		PositionsToDegrees(motordata, frame.position);
+		for (int ch = 0; ch < NUMFINGERS; ch++) {
+			frame.current[ch] = ((float)motordata.vals[ch * 2 + 1]) * 0.540f / 7000.f;						// current equation from PSYONIC API documentation (see getCurrent)
+			frame.velocity[ch] = dt > 0.0 ? (float)((frame.position[ch] - prev.position[ch]) / dt) : 0.f;
+		}
+		Unpack12Bit(&read_data[RXTOUCHOFFSET], frame.touch, NUMTOUCH);
+	}
+
+} // namespace hand
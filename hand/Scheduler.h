@@ -0,0 +1,222 @@
+/*
+*
+* @file Scheduler.h
+*
+* @brief Keeps the SPI link busy. Every FT4222_SPIMaster_SingleReadWrite is a full USB round trip during which the
+* calling thread can do nothing, so a loop which builds a command, transfers it and then decodes the reply leaves the
+* link idle for part of every cycle. A TransactionScheduler owns an I/O thread which does nothing but transfer: the
+* control thread submits TX frames (up to depth of them may be outstanding) and collects completed Transactions,
+* each stamped with the times it was submitted, started and finished.
+*
+* CalibrateClock measures the achievable frame rate and the reply integrity at each SPI clock divider and picks
+* the fastest divider at which the replies still arrive intact.
+*
+*/
+
+#pragma once
+
+#include "hand/Transport.h"
+#include "hand/Protocol.h"
+#include "hand/SpscRing.h"
+#include "hand/Stats.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+namespace hand {
+
+	/*
+	* @brief one SPI frame, in both directions, with its timing
+	*/
+	struct Transaction {
+		uint8_t tx[SPIFRAMESIZE] = { 0 };
+		uint8_t rx[SPIFRAMESIZE] = { 0 };
+		uint16_t size = SPIFRAMESIZE;
+		FT4222_STATUS status = FT4222_OK;
+		std::chrono::steady_clock::time_point submitted;
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point done;
+	};
+
+	class TransactionScheduler
+	{
+	public:
+		TransactionScheduler(Transport& _link, size_t _depth = 2)
+			: link(_link)
+			, depth(_depth < 1 ? 1 : _depth)
+			, pending(_depth)
+			, completed(4 * _depth + 64) {}
+
+		~TransactionScheduler() { this->stop(); }
+
+		TransactionScheduler(const TransactionScheduler&) = delete;
+		TransactionScheduler& operator=(const TransactionScheduler&) = delete;
+
+		void start()
+		{
+			if (this->running.load()) { return; }
+			this->running.store(true);
+			this->io = std::thread(&TransactionScheduler::run, this);
+		}
+
+		/*
+		* @brief stops the I/O thread after the transfer in progress. Frames still queued are not sent
+		*/
+		void stop()
+		{
+			if (!this->running.load()) { return; }
+			this->running.store(false);
+			this->wake(this->pendingMutex, this->pendingCv);
+			if (this->io.joinable()) { this->io.join(); }
+		}
+
+		/*
+		* @brief queues tx (size bytes, at most SPIFRAMESIZE) for transfer. Returns false if depth frames are already outstanding
+		*/
+		bool submit(const uint8_t* tx, uint16_t size)
+		{
+			if (this->outstanding() >= this->depth) { return false; }
+			Transaction tr;
+			tr.size = size < SPIFRAMESIZE ? size : SPIFRAMESIZE;
+			memcpy(tr.tx, tx, tr.size);
+			tr.submitted = std::chrono::steady_clock::now();
+			this->pending.push(tr);
+			this->nsubmitted++;
+			this->wake(this->pendingMutex, this->pendingCv);
+			return true;
+		}
+
+		/*
+		* @brief calls fn(Transaction) for each completed transfer, oldest first, and returns how many there were
+		*/
+		template <typename F>
+		size_t drain(F&& fn)
+		{
+			size_t n = this->completed.drain(fn);
+			this->ncollected += n;
+			return n;
+		}
+
+		/*
+		* @brief blocks until at least one transfer has completed (or timeout has passed)
+		*/
+		void waitForCompletion(std::chrono::microseconds timeout = std::chrono::microseconds(1000))
+		{
+			std::unique_lock<std::mutex> lk(this->completedMutex);
+			this->completedCv.wait_for(lk, timeout, [this] { return !this->completed.empty() || !this->running.load(); });
+		}
+
+		//! Frames submitted but not yet collected with drain()
+		size_t outstanding() const { return (size_t)(this->nsubmitted - this->ncollected); }
+		size_t getDepth() const { return this->depth; }
+
+	private:
+		void run()
+		{
+			Transaction tr;
+			while (this->running.load(std::memory_order_relaxed)) {
+				if (!this->pending.pop(tr)) {
+					std::unique_lock<std::mutex> lk(this->pendingMutex);
+					this->pendingCv.wait_for(lk, std::chrono::milliseconds(10), [this] { return !this->pending.empty() || !this->running.load(); });
+					continue;
+				}
+				uint16_t sizeTransferred = 0;
+				tr.started = std::chrono::steady_clock::now();
+				{
+					MORPH_PROFILE_SCOPE("SPI transfer");
+					tr.status = this->link.transfer(tr.rx, tr.tx, tr.size, &sizeTransferred);
+				}
+				tr.done = std::chrono::steady_clock::now();
+				this->completed.push(tr);
+				this->wake(this->completedMutex, this->completedCv);
+			}
+		}
+
+		//! Notify a waiter. Taking the lock first means a waiter can't miss the notification between its check and its wait
+		static void wake(std::mutex& m, std::condition_variable& cv)
+		{
+			{ std::lock_guard<std::mutex> lk(m); }
+			cv.notify_one();
+		}
+
+		Transport& link;
+		size_t depth;
+		SpscRing<Transaction> pending;
+		SpscRing<Transaction> completed;
+		std::thread io;
+		std::atomic<bool> running{ false };
+		uint64_t nsubmitted = 0;																			// control thread only
+		uint64_t ncollected = 0;																			// control thread only
+		std::mutex pendingMutex;
+		std::condition_variable pendingCv;
+		std::mutex completedMutex;
+		std::condition_variable completedCv;
+	};
+
+	/*
+	* @brief the result of timing one clock divider
+	*/
+	struct ClockTrial {
+		FT4222_SPIClock clk = CLK_DIV_256;
+		double frames_per_s = 0.0;
+		double good_fraction = 0.0;																			// replies with a correct hand checksum
+		LatencyHistogram transfer;
+	};
+
+	/*
+	* @brief times frames transfers of tx at each divider in candidates, prints a table and leaves the link set to, and
+	* returns, the divider with the highest frame rate whose replies were at least min_good intact. If none was good
+	* enough, the first candidate is chosen.
+	* @attention tx is really sent to the hand, frames times per divider, so it should be a command that is safe to repeat
+	*/
+	inline FT4222_SPIClock CalibrateClock(Transport& link, const uint8_t* tx, uint16_t size, int frames = 200,
+		const std::vector<FT4222_SPIClock>& candidates = { CLK_DIV_512, CLK_DIV_256, CLK_DIV_128, CLK_DIV_64, CLK_DIV_32, CLK_DIV_16, CLK_DIV_8, CLK_DIV_4 },
+		double min_good = 0.99)
+	{
+		using clock = std::chrono::steady_clock;
+		uint8_t txbuf[DATASIZE] = { 0 };
+		uint8_t rxbuf[DATASIZE] = { 0 };
+		memcpy(txbuf, tx, size < DATASIZE ? size : DATASIZE);
+
+		std::vector<ClockTrial> trials;
+		for (FT4222_SPIClock clk : candidates) {
+			ClockTrial trial;
+			trial.clk = clk;
+			if (link.setClock(clk) != FT4222_OK) { continue; }
+			int good = 0;
+			const auto t0 = clock::now();
+			for (int i = 0; i < frames; i++) {
+				uint16_t sizeTransferred = 0;
+				const auto ts = clock::now();
+				FT4222_STATUS st = link.transfer(rxbuf, txbuf, size, &sizeTransferred);
+				trial.transfer.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - ts).count());
+				if (st == FT4222_OK && RXCheckSumOK(rxbuf)) { good++; }
+			}
+			trial.frames_per_s = frames / std::chrono::duration<double>(clock::now() - t0).count();
+			trial.good_fraction = (double)good / frames;
+			trials.push_back(trial);
+		}
+
+		printf("SPI clock calibration (%s, %d frames each):\n", link.name(), frames);
+		printf("  divider   SPI clock   frames/s   intact   transfer p50/p99 (us)\n");
+		const ClockTrial* best = nullptr;
+		for (const ClockTrial& t : trials) {
+			printf("  %7d   %6.3f MHz   %8.0f   %5.1f%%   %.1f / %.1f\n", 1 << (int)t.clk, SpiClockHz(t.clk) * 1e-6,
+				t.frames_per_s, 100.0 * t.good_fraction, t.transfer.percentile(0.5) * 1e-3, t.transfer.percentile(0.99) * 1e-3);
+			if (t.good_fraction >= min_good && (best == nullptr || t.frames_per_s > best->frames_per_s)) { best = &t; }
+		}
+
+		FT4222_SPIClock chosen = candidates.empty() ? CLK_DIV_256 : candidates.front();
+		if (best != nullptr) { chosen = best->clk; }
+		else { printf("  No divider gave %.0f%% intact replies\n", 100.0 * min_good); }
+		link.setClock(chosen);
+		printf("  Using divide by %d\n", 1 << (int)chosen);
+		return chosen;
+	}
+
+} // namespace hand
@@ -0,0 +1,273 @@
+/*
+*
+* @file SessionLog.h
+*
+* @brief Recording and replay of the raw SPI traffic of a HandPlot session. A session file is a SessionHeader
+* followed by fixed size FrameRecords, one per SPI transaction, in the order they happened:
+*
+*	{ t_ns, tx[TXFRAMESIZE], rx[SPIFRAMESIZE], status }
+*
+* SessionWriter is fed by the acquisition thread and never touches the disk itself: records go through a lock-free
+* ring to a flusher thread which writes them out in large blocks. SessionReader maps a finished file into memory, so
+* a replay (ReplayTransport) reads the records in place without copying or parsing them.
+*
+* @attention The file is written in the host's byte order and is not meant to be portable between architectures.
+*
+*/
+
+#pragma once
+
+#include "hand/Protocol.h"
+#include "hand/SpscRing.h"
+#include "hand/Transport.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hand {
+
+	/*
+	* @brief the start of every session file
+	*/
+	struct SessionHeader {
+		char magic[8] = { 'H', 'A', 'N', 'D', 'L', 'O', 'G', '\0' };
+		uint32_t version = 1;
+		uint32_t record_size = 0;																			// sizeof(FrameRecord), to catch layout changes
+		uint32_t tx_size = TXFRAMESIZE;
+		uint32_t rx_size = SPIFRAMESIZE;
+		double rate_hz = 0.0;																				// the requested acquisition rate
+	};
+
+	/*
+	* @brief one SPI transaction. t_ns is on the steady (monotonic) clock, counted from the start of acquisition
+	*/
+	struct FrameRecord {
+		uint64_t t_ns = 0;
+		uint8_t tx[TXFRAMESIZE] = { 0 };
+		uint8_t rx[SPIFRAMESIZE] = { 0 };
+		int32_t status = 0;																					// FT4222_STATUS
+	};
+	static_assert(sizeof(FrameRecord) == 104, "FrameRecord must stay unpadded; bump SessionHeader::version if it changes");
+
+	class SessionWriter
+	{
+	public:
+		explicit SessionWriter(size_t ring_capacity = 1 << 16) : records(ring_capacity) {}
+
+		~SessionWriter() { this->close(); }
+
+		SessionWriter(const SessionWriter&) = delete;
+		SessionWriter& operator=(const SessionWriter&) = delete;
+
+		/*
+		* @brief creates (or truncates) path, writes the header and starts the flusher thread. Returns false if the file can't be written
+		*/
+		bool open(const std::string& path, double rate_hz)
+		{
+			this->fp = fopen(path.c_str(), "wb");
+			if (this->fp == NULL) {
+				printf("Could not open %s for writing\n", path.c_str());
+				return false;
+			}
+			SessionHeader hdr;
+			hdr.record_size = sizeof(FrameRecord);
+			hdr.rate_hz = rate_hz;
+			if (fwrite(&hdr, sizeof(hdr), 1, this->fp) != 1) {
+				fclose(this->fp);
+				this->fp = NULL;
+				return false;
+			}
+			this->running.store(true);
+			this->flusher = std::thread(&SessionWriter::run, this);
+			return true;
+		}
+
+		/*
+		* @brief stops the flusher once everything queued so far has been written, and closes the file
+		*/
+		void close()
+		{
+			this->running.store(false);
+			if (this->flusher.joinable()) { this->flusher.join(); }
+			if (this->fp != NULL) {
+				this->flush();
+				fclose(this->fp);
+				this->fp = NULL;
+			}
+		}
+
+		/*
+		* @brief queues one record. Called by the acquisition thread only; never blocks. Returns false if the record was dropped
+		*/
+		bool record(const FrameRecord& r) { return this->records.push(r); }
+
+		//! Records written to the file so far
+		uint64_t written() const { return this->nwritten.load(std::memory_order_relaxed); }
+		//! Records lost because the flusher fell a whole ring behind
+		uint64_t drops() const { return this->records.drops(); }
+
+	private:
+		void run()
+		{
+			while (this->running.load(std::memory_order_relaxed)) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				this->flush();
+			}
+		}
+
+		//! Writes out everything currently queued in one block
+		void flush()
+		{
+			this->block.clear();
+			this->records.drain([this](const FrameRecord& r) { this->block.push_back(r); });
+			if (this->block.empty()) { return; }
+			size_t n = fwrite(this->block.data(), sizeof(FrameRecord), this->block.size(), this->fp);
+			this->nwritten.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		SpscRing<FrameRecord> records;
+		std::vector<FrameRecord> block;
+		FILE* fp = NULL;
+		std::thread flusher;
+		std::atomic<bool> running{ false };
+		std::atomic<uint64_t> nwritten{ 0 };
+	};
+
+	class SessionReader
+	{
+	public:
+		SessionReader() {}
+		~SessionReader() { this->close(); }
+
+		SessionReader(const SessionReader&) = delete;
+		SessionReader& operator=(const SessionReader&) = delete;
+
+		/*
+		* @brief maps path into memory and checks its header. Returns false (with a message) if it is not a usable session file
+		*/
+		bool open(const std::string& path)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				printf("Could not open %s\n", path.c_str());
+				return false;
+			}
+			struct stat sb;
+			if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(SessionHeader)) {
+				printf("%s is too short to be a session file\n", path.c_str());
+				::close(fd);
+				return false;
+			}
+			void* p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);																					// the mapping keeps the file open
+			if (p == MAP_FAILED) {
+				printf("Could not map %s\n", path.c_str());
+				return false;
+			}
+			this->base = static_cast<const uint8_t*>(p);
+			this->length = (size_t)sb.st_size;
+
+			const SessionHeader* hdr = this->header();
+			if (memcmp(hdr->magic, SessionHeader().magic, sizeof(hdr->magic)) != 0
+				|| hdr->version != 1 || hdr->record_size != sizeof(FrameRecord)) {
+				printf("%s is not a version 1 session file\n", path.c_str());
+				this->close();
+				return false;
+			}
+			// A recording that was cut short may end in a partial record, which is ignored
+			this->nrecords = (this->length - sizeof(SessionHeader)) / sizeof(FrameRecord);
+			madvise(p, this->length, MADV_SEQUENTIAL);
+			return true;
+		}
+
+		void close()
+		{
+			if (this->base != nullptr) {
+				munmap(const_cast<uint8_t*>(this->base), this->length);
+				this->base = nullptr;
+				this->length = 0;
+				this->nrecords = 0;
+			}
+		}
+
+		const SessionHeader* header() const { return reinterpret_cast<const SessionHeader*>(this->base); }
+		//! The records, in place in the mapping
+		const FrameRecord* frames() const { return reinterpret_cast<const FrameRecord*>(this->base + sizeof(SessionHeader)); }
+		size_t size() const { return this->nrecords; }
+		const FrameRecord& operator[](size_t i) const { return this->frames()[i]; }
+		//! Length of the session in seconds
+		double duration() const { return this->nrecords > 0 ? (double)this->frames()[this->nrecords - 1].t_ns * 1e-9 : 0.0; }
+
+	private:
+		const uint8_t* base = nullptr;
+		size_t length = 0;
+		size_t nrecords = 0;
+	};
+
+	/*
+	* @brief a Transport which answers each transfer with the next recorded reply of a mapped session. The TX frame is
+	* ignored. Each reply is held back until its recorded time, (t_ns - the first record's t_ns) / speed after the first
+	* transfer, so a session replays with its original timing (jitter and gaps included), or speed times faster, whatever
+	* rate the caller runs at; run Acquisition free (rate 0) to let the records set the pace. The session ends after its
+	* last record (see maxTransfers()).
+	*/
+	class ReplayTransport : public Transport
+	{
+	public:
+		explicit ReplayTransport(const SessionReader& _session, double _speed = 1.0)
+			: session(_session)
+			, speed(_speed > 0.0 ? _speed : 1.0) {}
+
+		int open(FT4222_SPIClock clk_div) override
+		{
+			this->next = 0;
+			return this->session.size() > 0 ? 0 : -100;
+		}
+
+		void close() override {}
+
+		FT4222_STATUS setClock(FT4222_SPIClock clk_div) override { return FT4222_OK; }
+
+		FT4222_STATUS transfer(uint8_t* rx, uint8_t* tx, uint16_t size, uint16_t* transferred) override
+		{
+			if (this->next >= this->session.size()) {
+				*transferred = 0;
+				return FT4222_OTHER_ERROR;
+			}
+			const FrameRecord& r = this->session[this->next];
+			if (this->next == 0) {
+				this->origin = std::chrono::steady_clock::now();
+			}
+			else {
+				const double dt_ns = (double)((int64_t)r.t_ns - (int64_t)this->session[0].t_ns) / this->speed;
+				std::this_thread::sleep_until(this->origin + std::chrono::nanoseconds((int64_t)dt_ns));
+			}
+			this->next++;
+			const uint16_t n = size < SPIFRAMESIZE ? size : SPIFRAMESIZE;
+			memcpy(rx, r.rx, n);
+			memset(rx + n, 0, size - n);
+			*transferred = size;
+			return (FT4222_STATUS)r.status;
+		}
+
+		const char* name() const override { return "replay"; }
+
+		uint64_t maxTransfers() const override { return this->session.size(); }
+
+	private:
+		const SessionReader& session;
+		double speed;
+		size_t next = 0;
+		std::chrono::steady_clock::time_point origin;
+	};
+
+} // namespace hand
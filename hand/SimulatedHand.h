@@ -0,0 +1,167 @@
+/*
+*
+* @file SimulatedHand.h
+*
+* @brief A Transport that behaves like the dongle with a PSYONIC hand attached, so that the acquisition, decoding and
+* plotting loop can be run and benchmarked on any machine.
+*
+* Each transfer decodes the position or voltage command in the TX frame (ignoring it, as the hand would, if either
+* checksum is wrong), advances every finger by one step of first order dynamics towards its target (or at a speed
+* proportional to its voltage) and writes a reply with
+* the same byte layout as the real 75 byte frame: position and current words for each finger, 30 packed touch
+* values and a valid hand checksum.
+*
+* @note The model time advances by a fixed dt per transfer rather than by the wall clock, so a given sequence of
+* commands always produces the same replies. With a non-zero latency, each transfer also takes as long as the USB
+* round trip plus the frame's bits at the SPI clock, and replies clocked faster than the STM can follow (max_spi_hz)
+* arrive corrupted, so that CalibrateClock (hand/Scheduler.h) has something realistic to measure.
+*
+*/
+
+#pragma once
+
+#include "hand/Transport.h"
+#include "hand/Protocol.h"
+#include <chrono>
+#include <cstring>
+
+namespace hand {
+
+	class SimulatedHand : public Transport
+	{
+	public:
+		/*
+		* @param dt_s model time per transfer, tau_s motor time constant, latency_us the USB round trip time of a transfer
+		*/
+		explicit SimulatedHand(double dt_s = 0.001, double tau_s = 0.05, double latency_us = 0.0, double max_spi_hz = 7.5e6)
+			: dt(dt_s)
+			, tau(tau_s)
+			, latency(latency_us)
+			, maxspi(max_spi_hz) {}
+
+		int open(FT4222_SPIClock clk_div) override
+		{
+			this->setClock(clk_div);
+			return 0;
+		}
+
+		void close() override {}
+
+		FT4222_STATUS setClock(FT4222_SPIClock clk_div) override
+		{
+			this->clk = clk_div;
+			return FT4222_OK;
+		}
+
+		FT4222_STATUS transfer(uint8_t* rx, uint8_t* tx, uint16_t size, uint16_t* transferred) override
+		{
+			const auto t0 = std::chrono::steady_clock::now();
+			if (size < SPIFRAMESIZE) {
+				*transferred = 0;
+				return FT4222_INVALID_PARAMETER;
+			}
+
+			this->command(tx);
+			this->step();
+			this->reply(rx);
+			memset(rx + SPIFRAMESIZE, 0, size - SPIFRAMESIZE);
+			*transferred = size;
+
+			if (this->latency > 0.0) {
+				const double spihz = SpiClockHz(this->clk);
+				if (spihz > this->maxspi) { rx[RXMOTOROFFSET + (this->ntransfers % RXHANDSIZE)] ^= 0x10; }		// a flipped bit somewhere in the reply
+				const double us = this->latency + 8.0 * size / spihz * 1e6;
+				const auto until = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(us));
+				while (std::chrono::steady_clock::now() < until) {}												// spin, as a blocking USB transfer would hold the thread
+			}
+			this->ntransfers++;
+			return FT4222_OK;
+		}
+
+		const char* name() const override { return "simulated hand"; }
+
+		//! The current model position of finger ch, in degrees
+		float position(int ch) const { return this->pos[ch]; }
+
+	private:
+		//! Take new targets (or voltages) from a position (or voltage) mode command with good checksums
+		void command(const uint8_t* tx)
+		{
+			if (tx[0] != TXFRAMESIZE || (tx[2] != 0x10 && tx[2] != 0x40)) { return; }
+			if (tx[15] != checkSum(const_cast<uint8_t*>(tx), tx[0], TRUE) || tx[16] != checkSum(const_cast<uint8_t*>(tx), tx[0], FALSE)) { return; }
+			this->voltagemode = tx[2] == 0x40;
+			for (int ch = 0; ch < NUMFINGERS; ch++) {
+				int16_t word = (int16_t)(tx[3 + 2 * ch] | (tx[4 + 2 * ch] << 8));
+				if (this->voltagemode) { this->duty[ch] = (float)word; }
+				else { this->target[ch] = (float)word * 150.f / 32767.f; }
+			}
+		}
+
+		//! One step of d(pos)/dt = (target - pos) / tau, or in voltage mode d(pos)/dt = duty * degPerSecPerDuty
+		void step()
+		{
+			const float a = (float)(this->dt / (this->tau + this->dt));									// backward Euler, stable for any dt
+			for (int ch = 0; ch < NUMFINGERS; ch++) {
+				if (this->voltagemode) {
+					this->vel[ch] = this->duty[ch] * degPerSecPerDuty;
+					this->pos[ch] += this->vel[ch] * (float)this->dt;
+					this->target[ch] = this->pos[ch];														// hold here if position commands resume
+				}
+				else {
+					this->vel[ch] = (this->target[ch] - this->pos[ch]) * a / (float)this->dt;
+					this->pos[ch] += (this->target[ch] - this->pos[ch]) * a;
+				}
+			}
+		}
+
+		void reply(uint8_t* rx)
+		{
+			memset(rx, 0, SPIFRAMESIZE);
+			rx[0] = RXHANDSIZE;
+			rx[1] = 0x50;
+			rx[2] = 0x10;
+
+			motordata_t motordata;
+			for (int ch = 0; ch < NUMFINGERS; ch++) {
+				motordata.vals[ch * 2] = (int16_t)(this->pos[ch] * 32767.f / 150.f);
+				// Current follows the speed of the motor; inverse of the scaling in DecodeHandFrame
+				float amps = this->vel[ch] * ampsPerDegPerSec;
+				motordata.vals[ch * 2 + 1] = (int16_t)(amps * 7000.f / 0.540f);
+			}
+			memcpy(&rx[RXMOTOROFFSET], motordata.bytes, sizeof(motordata.bytes));
+
+			// Six sensors per finger (the thumb rotator has none). A flexed finger presses on its sensors,
+			// the fingertip ones hardest.
+			uint16_t touch[NUMTOUCH];
+			for (int f = 0; f < 5; f++) {
+				for (int s = 0; s < 6; s++) {
+					float press = (this->pos[f] - contactDegrees) * (40.f + 10.f * s);
+					touch[f * 6 + s] = press <= 0.f ? 0 : (press >= 4095.f ? 4095 : (uint16_t)press);
+				}
+			}
+			Pack12Bit(touch, &rx[RXTOUCHOFFSET], NUMTOUCH);
+
+			rx[RXTOUCHOFFSET + NUMTOUCH * 3 / 2] = 0x01;															// not hot, not cold
+			int8_t sum = 0;
+			for (int b = RXMOTOROFFSET; b < SPIFRAMESIZE - 1; b++) { sum += (int8_t)rx[b]; }
+			rx[SPIFRAMESIZE - 1] = (uint8_t)(-sum);
+		}
+
+		static constexpr float ampsPerDegPerSec = 0.002f;
+		static constexpr float contactDegrees = 50.f;
+		static constexpr float degPerSecPerDuty = 0.2f;
+
+		double dt;
+		double tau;
+		double latency;
+		double maxspi;
+		uint64_t ntransfers = 0;
+		FT4222_SPIClock clk = CLK_DIV_256;
+		float pos[NUMFINGERS] = { 0 };
+		float vel[NUMFINGERS] = { 0 };
+		float target[NUMFINGERS] = { 0 };
+		float duty[NUMFINGERS] = { 0 };
+		bool voltagemode = false;
+	};
+
+} // namespace hand
@@ -0,0 +1,94 @@
+/*
+*
+* @file SpscRing.h
+*
+* @brief A bounded, lock-free, single-producer/single-consumer ring buffer. Used to hand samples from the
+* acquisition thread to the GUI thread without either side ever blocking on the other.
+*
+* @note Exactly one thread may call push() and exactly one (other) thread may call pop()/drain(). The capacity
+* is rounded up to a power of two so that wrapping is a mask rather than a modulo.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace hand {
+
+	template <typename T>
+	class SpscRing
+	{
+	public:
+		explicit SpscRing(size_t min_capacity = 4096)
+		{
+			size_t cap = 2;
+			while (cap < min_capacity) { cap <<= 1; }
+			this->buf.resize(cap);
+			this->mask = cap - 1;
+		}
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		/*
+		* @brief producer side. Returns false (and counts a drop) if the consumer has fallen a whole ring behind
+		*/
+		bool push(const T& item)
+		{
+			const size_t h = this->head.load(std::memory_order_relaxed);
+			if (h - this->tail.load(std::memory_order_acquire) > this->mask) {
+				this->dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			this->buf[h & this->mask] = item;
+			this->head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*
+		* @brief consumer side. Returns false if there was nothing to pop
+		*/
+		bool pop(T& item)
+		{
+			const size_t t = this->tail.load(std::memory_order_relaxed);
+			if (t == this->head.load(std::memory_order_acquire)) { return false; }
+			item = this->buf[t & this->mask];
+			this->tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*
+		* @brief consumer side. Calls fn(item) for every item available right now and returns how many there were.
+		* The tail is published once at the end, so the producer sees the whole batch freed at once.
+		*/
+		template <typename F>
+		size_t drain(F&& fn)
+		{
+			const size_t t = this->tail.load(std::memory_order_relaxed);
+			const size_t h = this->head.load(std::memory_order_acquire);
+			for (size_t i = t; i != h; ++i) { fn(this->buf[i & this->mask]); }
+			this->tail.store(h, std::memory_order_release);
+			return h - t;
+		}
+
+		//! Approximate number of queued items (exact when called from either the producer or the consumer)
+		size_t size() const { return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire); }
+		size_t capacity() const { return this->mask + 1; }
+		bool empty() const { return this->size() == 0; }
+		//! How many pushes were refused because the ring was full
+		uint64_t drops() const { return this->dropped.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<T> buf;
+		size_t mask = 0;
+		//! head and tail live on their own cache lines so producer and consumer don't false-share
+		alignas(64) std::atomic<size_t> head{ 0 };
+		alignas(64) std::atomic<size_t> tail{ 0 };
+		alignas(64) std::atomic<uint64_t> dropped{ 0 };
+	};
+
+} // namespace hand
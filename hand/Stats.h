@@ -0,0 +1,20 @@
+/*
+*
+* @file Stats.h
+*
+* @brief A fixed size log-linear histogram of durations, for reporting latency percentiles of long runs without
+* keeping every sample. Values below 64 ns are counted exactly; above that each power of two is split into 32
+* buckets, so a percentile is reported to within about 3%. This is the histogram that morph's Profiler keeps for
+* every MORPH_PROFILE_SCOPE stage (see morph/Profiler.h), so the two can be merged and printed alike.
+*
+*/
+
+#pragma once
+
+#include <morph/Profiler.h>
+
+namespace hand {
+
+	typedef morph::TimeHistogram LatencyHistogram;
+
+} // namespace hand
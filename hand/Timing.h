@@ -0,0 +1,135 @@
+/*
+*
+* @file Timing.h
+*
+* @brief Fixed rate loops on Linux. A PeriodicTimer sleeps with clock_nanosleep(TIMER_ABSTIME) until each deadline on
+* CLOCK_MONOTONIC, so the period does not drift by however long the work in the loop took, and keeps statistics of how
+* late each wake up was (jitter) and how many deadlines were missed altogether (overruns).
+*
+* MakeRealtime optionally moves the calling thread to the SCHED_FIFO policy and pins it to one CPU, which is what
+* takes the jitter from hundreds of microseconds down to a few on a loaded desktop. Both need privileges (root, or
+* CAP_SYS_NICE / an rtprio limit), so they are off by default and a refusal only prints a warning.
+*
+*/
+
+#pragma once
+
+#include "hand/Stats.h"
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace hand {
+
+	/*
+	* @brief how a time critical thread should be scheduled. The defaults leave the thread as it is
+	*/
+	struct RealtimeOptions {
+		int fifo_priority = 0;																				// 1 to 99 for SCHED_FIFO; 0 keeps the normal scheduler
+		int cpu = -1;																						// CPU to pin to; -1 lets the thread run anywhere
+	};
+
+	/*
+	* @brief applies opts to the calling thread. Returns false (after printing why) if anything was refused
+	*/
+	inline bool MakeRealtime(const RealtimeOptions& opts, const char* label)
+	{
+		bool ok = true;
+		if (opts.cpu >= 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(opts.cpu, &set);
+			int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			if (err != 0) {
+				printf("%s: could not pin to CPU %d (%s)\n", label, opts.cpu, strerror(err));
+				ok = false;
+			}
+		}
+		if (opts.fifo_priority > 0) {
+			sched_param sp;
+			sp.sched_priority = opts.fifo_priority;
+			int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+			if (err != 0) {
+				printf("%s: could not switch to SCHED_FIFO priority %d (%s)\n", label, opts.fifo_priority, strerror(err));
+				ok = false;
+			}
+		}
+		return ok;
+	}
+
+	class PeriodicTimer
+	{
+	public:
+		explicit PeriodicTimer(double rate_hz)
+			: period_ns(rate_hz > 0.0 ? (int64_t)(1e9 / rate_hz + 0.5) : 0) {}
+
+		/*
+		* @brief makes now the start of the first period, so the first wait() returns one period from now
+		*/
+		void start()
+		{
+			this->next = now_ns() + this->period_ns;
+			this->jitter.clear();
+			this->ncycles = 0;
+			this->nmissed = 0;
+		}
+
+		/*
+		* @brief sleeps until the next deadline and returns the number of deadlines that had already passed (0 when on
+		* time). After an overrun the schedule restarts from now rather than firing the missed periods back to back
+		*/
+		uint64_t wait()
+		{
+			timespec ts = to_timespec(this->next);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+			const int64_t woke = now_ns();
+			const int64_t late = woke - this->next;
+			this->jitter.add(late > 0 ? (uint64_t)late : 0);
+			this->ncycles++;
+
+			uint64_t missed = 0;
+			if (late >= this->period_ns) {
+				missed = (uint64_t)(late / this->period_ns);
+				this->nmissed += missed;
+				this->next = woke;
+			}
+			this->next += this->period_ns;
+			return missed;
+		}
+
+		int64_t period() const { return this->period_ns; }
+		//! How late each wake up was, in ns
+		const LatencyHistogram& wakeJitter() const { return this->jitter; }
+		uint64_t cycles() const { return this->ncycles; }
+		//! Deadlines missed completely, summed over all cycles
+		uint64_t overruns() const { return this->nmissed; }
+
+		static int64_t now_ns()
+		{
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+		}
+
+	private:
+		static timespec to_timespec(int64_t ns)
+		{
+			timespec ts;
+			ts.tv_sec = (time_t)(ns / 1000000000);
+			ts.tv_nsec = (long)(ns % 1000000000);
+			return ts;
+		}
+
+		int64_t period_ns;
+		int64_t next = 0;
+		LatencyHistogram jitter;
+		uint64_t ncycles = 0;
+		uint64_t nmissed = 0;
+	};
+
+} // namespace hand
@@ -0,0 +1,108 @@
+/*
+*
+* @file Transport.h
+*
+* @brief The link between HandPlot and the hand. A Transport opens the link, sets the SPI clock divider and does one
+* full duplex transfer of an SPI frame. Acquisition only talks to a Transport, so the same control and plotting loop
+* runs against the real FT4222 (Ft4222Transport, below), a simulated hand (hand/SimulatedHand.h) or a recorded
+* session (ReplayTransport in hand/SessionLog.h).
+*
+*/
+
+#pragma once
+
+#include "ftd2xx.h"
+#include "LibFT4222.h"
+#include <cstdio>
+#include <cstdint>
+
+namespace hand {
+
+	/*
+	* @brief the SPI clock frequency for a divider of the FT4222's system clock (60 MHz unless FT4222_SetClock has changed it)
+	*/
+	inline double SpiClockHz(FT4222_SPIClock clk_div, double sysclk_hz = 60e6) {
+		return clk_div == CLK_NONE ? sysclk_hz : sysclk_hz / (double)(1 << (int)clk_div);
+	}
+
+	class Transport
+	{
+	public:
+		virtual ~Transport() {}
+
+		/*
+		* @brief opens the link with SPI clock clk_div. Returns 0, or -100 if the device can't be opened and -200 if SPI can't be initialised
+		*/
+		virtual int open(FT4222_SPIClock clk_div) = 0;
+
+		virtual void close() = 0;
+
+		/*
+		* @brief changes the SPI clock divider of an open link
+		*/
+		virtual FT4222_STATUS setClock(FT4222_SPIClock clk_div) = 0;
+
+		/*
+		* @brief sends size bytes of tx while receiving size bytes into rx, as one SPI transaction
+		*/
+		virtual FT4222_STATUS transfer(uint8_t* rx, uint8_t* tx, uint16_t size, uint16_t* transferred) = 0;
+
+		//! A short name for messages
+		virtual const char* name() const = 0;
+
+		/*
+		* @brief the number of transfers the link will answer before it has nothing more to say, e.g. the length of a
+		* recorded session. Acquisition stops once that many have come back. Unlimited for a live link
+		*/
+		virtual uint64_t maxTransfers() const { return UINT64_MAX; }
+	};
+
+	/*
+	* @brief the FT4222H in mode 3, as SPI master to the dongle's STM
+	*/
+	class Ft4222Transport : public Transport
+	{
+	public:
+		Ft4222Transport() {}
+		~Ft4222Transport() { this->close(); }
+
+		int open(FT4222_SPIClock clk_div) override
+		{
+			FT_STATUS ftStatus = FT_Open(0, &this->ftHandle);
+			if (ftStatus != FT_OK)
+				return -100;
+
+			if (this->setClock(clk_div) != FT4222_OK)
+				return -200;
+
+			printf("SPI INIT SUCCESS\n");
+			return 0;
+		}
+
+		void close() override
+		{
+			if (this->ftHandle != NULL) {
+				FT4222_UnInitialize(this->ftHandle);
+				FT_Close(this->ftHandle);
+				this->ftHandle = NULL;
+			}
+		}
+
+		FT4222_STATUS setClock(FT4222_SPIClock clk_div) override
+		{
+			// The divider is a parameter of SPI master initialisation, so changing it means initialising again
+			return FT4222_SPIMaster_Init(this->ftHandle, SPI_IO_SINGLE, clk_div, CLK_IDLE_LOW, CLK_LEADING, 0x01);
+		}
+
+		FT4222_STATUS transfer(uint8_t* rx, uint8_t* tx, uint16_t size, uint16_t* transferred) override
+		{
+			return FT4222_SPIMaster_SingleReadWrite(this->ftHandle, rx, tx, size, transferred, 1);
+		}
+
+		const char* name() const override { return "FT4222"; }
+
+	private:
+		FT_HANDLE ftHandle = NULL;
+	};
+
+} // namespace hand
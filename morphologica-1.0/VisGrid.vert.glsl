@@ -0,0 +1,110 @@
+// The coded-in shaders tell non-Mac platforms that they use OpenGL 4.5, but Mac limited to 4.1
+#version 410
+
+// Computes the heights, normals and colours of a HexGridVisual or CartGridVisual from
+// the raw data (see HexGridVisual::gpuData), so that an update of the data uploads one
+// float per element rather than a whole mesh. The vertex buffer holds only the x and y
+// of each vertex. Elements have grid_layout.x vertices each (1 for Triangles mode, 7
+// for hexes or 5 for rects), the centre first and then the corners, in element order,
+// so gl_VertexID gives the element and the corner. Vertices beyond the last element
+// belong to the flat zero grid. Use with Visual.frag.glsl.
+
+uniform mat4 m_matrix; // model matrix
+uniform mat4 v_matrix; // scene view matrix
+uniform mat4 p_matrix; // projection matrix
+uniform float alpha;
+
+uniform samplerBuffer grid_data;  // One datum per element
+// Eight neighbours per element, -1 where there is none. For hexes, NE, NNE, NNW, NW,
+// NSW, NSE (then two unused); for rects, NE, NNE, NN, NNW, NW, NSW, NS, NSE.
+uniform isamplerBuffer grid_nbrs;
+uniform sampler1D grid_cmap;      // The colour map at 256 points over [0,1] (VisualGridData::lutSize)
+uniform vec3 grid_zscale;         // m, c and 1 if logarithmic: z = m * x + c (or m * log(x) + c)
+uniform vec3 grid_cscale;         // The same for the colour
+uniform ivec2 grid_layout;        // Vertices per element and the number of elements
+uniform vec2 grid_corner;         // Offset of the NE corner from the centre (SE is (x, -y))
+
+layout(location = 0) in vec4 position;
+
+out VERTEX
+{
+    vec4 normal;
+    vec4 color;
+    vec3 fragpos;
+} vertex;
+
+float scaled (float x, vec3 s)
+{
+    return s.x * (s.z > 0.5 ? log(x) : x) + s.y;
+}
+
+float zof (int e)
+{
+    return scaled (texelFetch(grid_data, e).r, grid_zscale);
+}
+
+int nbr (int e, int i)
+{
+    return texelFetch(grid_nbrs, 2 * e + i / 4)[i % 4];
+}
+
+// The height of corner k (NE, SE, S, SW, NW, N) of hex e, whose own height is zc
+float hexCorner (int e, float zc, int k)
+{
+    const ivec2 sharers[6] = ivec2[6](ivec2(1, 0), ivec2(0, 5), ivec2(5, 4),
+                                     ivec2(3, 4), ivec2(2, 3), ivec2(2, 1));
+    int a = nbr (e, sharers[k - 1].x);
+    int b = nbr (e, sharers[k - 1].y);
+    if (a >= 0 && b >= 0) { return 0.3333333 * (zc + zof(a) + zof(b)); }
+    if (a >= 0) { return 0.5 * (zc + zof(a)); }
+    if (b >= 0) { return 0.5 * (zc + zof(b)); }
+    return zc;
+}
+
+// The height of corner k (NE, SE, SW, NW) of rect e. The vertical, horizontal and
+// diagonal neighbours share the corner; if not all three exist, prefer the horizontal.
+float rectCorner (int e, float zc, int k)
+{
+    const ivec3 sharers[4] = ivec3[4](ivec3(2, 0, 1), ivec3(6, 0, 7), ivec3(6, 4, 5), ivec3(2, 4, 3));
+    int v = nbr (e, sharers[k - 1].x);
+    int h = nbr (e, sharers[k - 1].y);
+    int d = nbr (e, sharers[k - 1].z);
+    if (v >= 0 && h >= 0 && d >= 0) { return 0.25 * (zc + zof(v) + zof(h) + zof(d)); }
+    if (h >= 0) { return 0.5 * (zc + zof(h)); }
+    if (v >= 0) { return 0.5 * (zc + zof(v)); }
+    return zc;
+}
+
+float corner (int e, float zc, int k)
+{
+    if (k == 0) { return zc; }
+    return grid_layout.x == 7 ? hexCorner (e, zc, k) : rectCorner (e, zc, k);
+}
+
+void main (void)
+{
+    int e = gl_VertexID / grid_layout.x;
+    int k = gl_VertexID % grid_layout.x;
+
+    float z = 0.0;
+    vec3 norm = vec3(0.0, 0.0, 1.0);
+    vec3 clr = vec3(0.8, 0.8, 0.8);
+    if (e < grid_layout.y) {
+        float zc = zof (e);
+        z = corner (e, zc, k);
+        if (grid_layout.x > 1) {
+            // The same normal as the CPU path, from the centre, NE and SE vertices
+            vec3 p1 = vec3(grid_corner, corner (e, zc, 1) - zc);
+            vec3 p2 = vec3(grid_corner.x, -grid_corner.y, corner (e, zc, 2) - zc);
+            norm = normalize(cross(p2, p1));
+        }
+        float c = clamp(scaled (texelFetch(grid_data, e).r, grid_cscale), 0.0, 1.0);
+        clr = texture(grid_cmap, (c * 255.0 + 0.5) / 256.0).rgb;
+    }
+
+    vec4 p = vec4(position.xy, z, 1.0);
+    gl_Position = (p_matrix * v_matrix * m_matrix * p);
+    vertex.color = vec4(clr, alpha);
+    vertex.fragpos = vec3(m_matrix * p);
+    vertex.normal = vec4(norm, 0.0);
+}
@@ -0,0 +1,88 @@
+// The coded-in shaders tell non-Mac platforms that they use OpenGL 4.5, but Mac limited to 4.1
+#version 410
+
+// Expands a polyline, uploaded as bare points, into a flat line of width line_width
+// with mitred joins. Each line segment is one instance of a 4 vertex triangle strip.
+// The points buffer holds the points with the first and last repeated at either end,
+// and it is bound to all four attributes at successive offsets, so that instance i
+// sees the points before, at the start of, at the end of and after segment i.
+// Use with Visual.frag.glsl.
+
+uniform mat4 m_matrix; // model matrix
+uniform mat4 v_matrix; // scene view matrix
+uniform mat4 p_matrix; // projection matrix
+uniform float alpha;
+
+uniform vec3 line_colour;
+uniform float line_width;
+// If > 0, the segments are not joined, and stop this far short of the data points
+// (where the markers are)
+uniform float line_gap;
+// Added to the points' z, to lift the line in front of the plot and the axes
+uniform float line_z;
+// Width and height of the graph axes, then 1 to hide segments which leave the axes
+uniform vec3 axes_clip;
+
+layout(location = 0) in vec3 pprev; // The point before the segment
+layout(location = 1) in vec3 p0;    // The start of the segment
+layout(location = 2) in vec3 p1;    // The end of the segment
+layout(location = 3) in vec3 pnext; // The point after the segment
+
+out VERTEX
+{
+    vec4 normal;
+    vec4 color;
+    vec3 fragpos;
+} vertex;
+
+bool outside (vec3 p)
+{
+    return p.x < 0.0 || p.x > axes_clip.x || p.y < 0.0 || p.y > axes_clip.y;
+}
+
+// The offset (in units of half the line width) from a join between segments with
+// directions da and db, for the segment with normal n. The mitre is limited to 4.
+vec2 mitre (vec2 da, vec2 db, vec2 n)
+{
+    vec2 t = da + db;
+    if (length(t) < 1e-6) { return n; }
+    t = normalize(t);
+    vec2 m = vec2(t.y, -t.x);
+    return m / max(dot(m, n), 0.25);
+}
+
+void main (void)
+{
+    int end = gl_VertexID / 2;                     // 0 at p0, 1 at p1
+    float side = (gl_VertexID % 2 == 0) ? 1.0 : -1.0;
+    vec3 p = (end == 0) ? p0 : p1;
+    vec2 d = p1.xy - p0.xy;
+    float len = length(d);
+
+    // A zero offset collapses the segment to nothing
+    vec2 off = vec2(0.0);
+    if (len > 0.0 && !(axes_clip.z > 0.5 && (outside(p0) || outside(p1)))) {
+        d /= len;
+        vec2 n = vec2(d.y, -d.x);
+        if (line_gap > 0.0) {
+            if (len > 2.0 * line_gap) {
+                p.xy += (end == 0 ? line_gap : -line_gap) * d;
+                off = n;
+            }
+        } else {
+            vec2 o = (end == 0) ? p0.xy - pprev.xy : pnext.xy - p1.xy;
+            float olen = length(o);
+            if (olen > 0.0) {
+                off = (end == 0) ? mitre(o / olen, d, n) : mitre(d, o / olen, n);
+            } else {
+                off = n; // The first or last point
+            }
+        }
+    }
+
+    vec4 position = vec4(p.xy + side * 0.5 * line_width * off, p.z + line_z, 1.0);
+    gl_Position = (p_matrix * v_matrix * m_matrix * position);
+    vertex.color = vec4(line_colour, alpha);
+    vertex.fragpos = vec3(m_matrix * position);
+    vertex.normal = vec4(0.0, 0.0, 1.0, 0.0);
+}
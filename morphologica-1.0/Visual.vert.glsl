@@ -14,6 +14,11 @@ uniform float alpha;
 layout(location = 0) in vec4 position; // Attrib location 0
 layout(location = 1) in vec4 normalin; // Attrib location 1
 layout(location = 2) in vec3 color;    // Attrib location 2
+// Per-instance attributes, for models drawn with glDrawElementsInstanced (see
+// VisualModel::instanced). When a model doesn't supply them, these take the default
+// value of a disabled attribute, (0,0,0,1), which leaves position and color unchanged.
+layout(location = 4) in vec4 instance;  // Offset (xyz) and scale (w) of this instance
+layout(location = 5) in vec4 instcolor; // Colour of this instance; w=1 keeps the vertex colour
 
 out VERTEX
 {
@@ -24,9 +29,10 @@ out VERTEX
 
 void main (void)
 {
-    gl_Position = (p_matrix * v_matrix * m_matrix * position);
-    vertex.color = vec4(color, alpha);
-    vertex.fragpos = vec3(m_matrix * position);
+    vec4 p = vec4(position.xyz * instance.w + instance.xyz, 1.0);
+    gl_Position = (p_matrix * v_matrix * m_matrix * p);
+    vertex.color = vec4(mix(instcolor.rgb, color, instcolor.w), alpha);
+    vertex.fragpos = vec3(m_matrix * p);
     // Normals are all automatically computed, so there's no need for
     // this line and the cube program doesn't bother to pass in the
     // normals. Maybe required only for lighting?
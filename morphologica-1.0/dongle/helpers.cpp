@@ -42,13 +42,10 @@ void unpack_8bit_into_12bit(uint8_t* arr, uint16_t* vals, int valsize)
 }
 
 /*
-* @brief get nanosecond count (used for delay in rundemos.h)
+* @brief get nanosecond count on a monotonic clock (used for delay in rundemos.h)
 */
 uint64_t ns() {
-	FILETIME ft;
-	GetSystemTimeAsFileTime(&ft);
-	uint64_t t = (((uint64_t)ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
-	return t;
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 /* 
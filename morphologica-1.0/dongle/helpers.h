@@ -8,6 +8,7 @@
 #include <string>
 #include <cstring>
 #include <ctime>
+#include <chrono>
 
 int getDecimal(uint8_t byte);
 float getDegrees(uint8_t byte1, uint8_t byte2);
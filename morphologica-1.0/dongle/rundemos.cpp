@@ -135,9 +135,10 @@ int SPI_Demos_Handler(DWORD locationId) {
 
 	int input;																																// kyeboard input to select what to send over SPI
 	std::cin >> input;
+	uint64_t deadline = ns();
 	while (1)
 	{
-		uint64_t startTime = ns();																											// get nanosecond count for delay
+		deadline += DEMOPERIOD;																												// absolute deadlines, so the time spent below doesn't add to the period
 
 		/* Commands that Set TX */
 		switch (input) {
@@ -220,7 +221,9 @@ int SPI_Demos_Handler(DWORD locationId) {
 			return 0;
 		}
 
-		while (ns() <= startTime + 15000) {}																																// delay
+		if (ns() > deadline)
+			deadline = ns();																												// overran; start the next period from here
+		while (ns() < deadline) {}																											// delay (Windows sleeps are too coarse for this period)
 	}
 
 	FT4222_UnInitialize(ftHandle);
@@ -8,6 +8,8 @@
 #include "Cursor_Demo.h"
 #include "VoltageWave_Demo.h"
 
+#define DEMOPERIOD		1500000																// ns between commands (the old GetSystemTimeAsFileTime delay of 15000 counted 100 ns ticks)
+
 void OpenHand(uint8_t* TX, int& txdatasize, int& rxdatasize, int& readtxsize);
 void CloseHand(uint8_t* TX, int& txdatasize, int& rxdatasize, int& readtxsize);
 int SPI_Demos_Handler(DWORD locationId);
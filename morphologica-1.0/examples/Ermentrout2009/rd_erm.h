@@ -149,92 +149,38 @@ public:
     //! Computes the Laplacian Stable with dt = 0.0001;
     void compute_lapl (std::vector<Flt>& fa, unsigned int i)
     {
-#pragma omp parallel for schedule(static) shared(lapl, fa, i)
-        for (unsigned int hi=0; hi<this->nhex; ++hi) {
-
-            // 1. The D Del^2 term
-
-            // Compute the sum around the neighbours
-            Flt thesum = Flt{-6} * fa[hi];
-            if (HAS_NE(hi)) {
-                thesum += fa[NE(hi)];
-            } else {
-                thesum += fa[hi]; // A ghost neighbour-east with same value as Hex_0
-            }
-            if (HAS_NNE(hi)) {
-                thesum += fa[NNE(hi)];
-            } else {
-                thesum += fa[hi];
-            }
-            if (HAS_NNW(hi)) {
-                thesum += fa[NNW(hi)];
-            } else {
-                thesum += fa[hi];
-            }
-            if (HAS_NW(hi)) {
-                thesum += fa[NW(hi)];
-            } else {
-                thesum += fa[hi];
-            }
-            if (HAS_NSW(hi)) {
-                thesum += fa[NSW(hi)];
-            } else {
-                thesum += fa[hi];
-            }
-            if (HAS_NSE(hi)) {
-                thesum += fa[NSE(hi)];
-            } else {
-                thesum += fa[hi];
-            }
-
-            this->lapl[i][hi] = this->twoover3dd * thesum;
-        }
+        // RD_Base's stencil, with a ghost neighbour (with the same value as hex hi) in
+        // place of any that hex hi lacks
+        this->compute_laplace (fa, this->lapl[i]);
     }
 
     //! Computes the Poisson term. Stable with dt = 0.0001;
     void compute_poiss (std::vector<Flt>& fa1, std::vector<Flt>& fa2, unsigned int i)
     {
+        this->check_stencils();
+        const Flt* f1 = fa1.data();
+        const Flt* f2 = fa2.data();
+        Flt* po = this->poiss[i].data();
+        // The neighbours, each of which is hex hi itself where there's no neighbour
+        const unsigned int* ne = this->gh_ne.data();
+        const unsigned int* nne = this->gh_nne.data();
+        const unsigned int* nnw = this->gh_nnw.data();
+        const unsigned int* nw = this->gh_nw.data();
+        const unsigned int* nsw = this->gh_nsw.data();
+        const unsigned int* nse = this->gh_nse.data();
+
         // Compute non-linear term
-#pragma omp parallel for schedule(static) shared(poiss, fa1, fa2)
+#pragma omp parallel for simd schedule(static)
         for (unsigned int hi=0; hi<this->nhex; ++hi) {
-
-            std::vector<Flt> dum1(6,fa1[hi]);
-            std::vector<Flt> dum2(6,fa2[hi]);
-
-            if (HAS_NE(hi)) {
-                dum1[0] = fa1[NE(hi)];
-                dum2[0] = fa2[NE(hi)];
-            }
-            if (HAS_NNE(hi)) {
-                dum1[1] = fa1[NNE(hi)];
-                dum2[1] = fa2[NNE(hi)];
-            }
-            if (HAS_NNW(hi)) {
-                dum1[2] = fa1[NNW(hi)];
-                dum2[2] = fa2[NNW(hi)];
-            }
-            if (HAS_NW(hi)) {
-                dum1[3] = fa1[NW(hi)];
-                dum2[3] = fa2[NW(hi)];
-            }
-            if (HAS_NSW(hi)) {
-                dum1[4] = fa1[NSW(hi)];
-                dum2[4] = fa2[NSW(hi)];
-            }
-            if (HAS_NSE(hi)) {
-                dum1[5] = fa1[NSE(hi)];
-                dum2[5] = fa2[NSE(hi)];
-            }
-
             // John Brooke's final thesis solution (based on 'finite volume method'
             // of Lee et al. https://doi.org/10.1080/00207160.2013.864392
-            Flt val = (dum1[0]+fa1[hi]) * (dum2[0]-fa2[hi])
-                + (dum1[1]+fa1[hi]) * (dum2[1]-fa2[hi])
-                + (dum1[2]+fa1[hi]) * (dum2[2]-fa2[hi])
-                + (dum1[3]+fa1[hi]) * (dum2[3]-fa2[hi])
-                + (dum1[4]+fa1[hi]) * (dum2[4]-fa2[hi])
-                + (dum1[5]+fa1[hi]) * (dum2[5]-fa2[hi]);
-            this->poiss[i][hi] = val * this->oneover3dd;// / (3 * this->d * this->d);
+            Flt val = (f1[ne[hi]]+f1[hi]) * (f2[ne[hi]]-f2[hi])
+                + (f1[nne[hi]]+f1[hi]) * (f2[nne[hi]]-f2[hi])
+                + (f1[nnw[hi]]+f1[hi]) * (f2[nnw[hi]]-f2[hi])
+                + (f1[nw[hi]]+f1[hi]) * (f2[nw[hi]]-f2[hi])
+                + (f1[nsw[hi]]+f1[hi]) * (f2[nsw[hi]]-f2[hi])
+                + (f1[nse[hi]]+f1[hi]) * (f2[nse[hi]]-f2[hi]);
+            po[hi] = val * this->oneover3dd;// / (3 * this->d * this->d);
         }
     }
 
@@ -78,22 +78,16 @@ public:
 
     void compute_dudt (std::vector<Flt>& u_, std::vector<Flt>& dudt)
     {
-        std::vector<Flt> lapu(this->nhex, 0.0);
-        this->compute_laplace (u_, lapu);
-#pragma omp parallel for
-        for (unsigned int h=0; h<this->nhex; ++h) {
-            dudt[h] = this->D1 * lapu[h] + (u_[h] * (a1 - b1 * u_[h] - c1 * v[h]));
-        }
+        this->compute_laplace_fused (u_, [&](unsigned int h, Flt lapu) {
+            dudt[h] = this->D1 * lapu + (u_[h] * (a1 - b1 * u_[h] - c1 * v[h]));
+        });
     }
 
     void compute_dvdt (std::vector<Flt>& v_, std::vector<Flt>& dvdt)
     {
-        std::vector<Flt> lapv(this->nhex, 0.0);
-        this->compute_laplace (v_, lapv);
-#pragma omp parallel for
-        for (unsigned int h=0; h<this->nhex; ++h) {
-            dvdt[h] = this->D2 * lapv[h] + (v_[h] * (a2 - b2 * v_[h] - c2 * u[h]));
-        }
+        this->compute_laplace_fused (v_, [&](unsigned int h, Flt lapv) {
+            dvdt[h] = this->D2 * lapv + (v_[h] * (a2 - b2 * v_[h] - c2 * u[h]));
+        });
     }
 
     void step (void)
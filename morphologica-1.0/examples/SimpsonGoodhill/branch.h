@@ -3,6 +3,7 @@
 #include <vector>
 #include <deque>
 #include <morph/Vector.h>
+#include <morph/SpatialBins.h>
 
 // A retinotectal axon branch class. Holds current and historical positions, a preferred
 // termination zone, and the algorithm for computing the next position. Could derive
@@ -10,9 +11,11 @@
 template<typename T>
 struct branch
 {
-    // Compute the next position for this branch, using information from all other
-    // branches and the parameters vector, m
-    void compute_next (const std::vector<branch<T>>& branches, const morph::Vector<T, 4>& m)
+    // Compute the next position for this branch, using information from the other
+    // branches and the parameters vector, m. bins holds the current positions of all the
+    // branches, binned so that only those within two_r of this one need be visited.
+    void compute_next (const std::vector<branch<T>>& branches, const morph::SpatialBins<T>& bins,
+                       const morph::Vector<T, 4>& m)
     {
         // Current location is named b
         morph::Vector<T, 2> b = path.back();
@@ -25,14 +28,16 @@ struct branch
         morph::Vector<T, 2> nullvec = {0, 0}; // null vector
         // Other branches are called k, making a set B_b, with a number of members that I call n_k
         T n_k = T{0};
-        for (auto k : branches) {
-            if (k.id == this->id) { continue; } // Don't interact with self
+        bins.forEachNear (b, [&](const size_t ki, const morph::Vector<T, 2>& kpos) {
             // Paper deals with U_C(b,k) - the vector from branch b to branch k - and
             // sums these. However, that gives a competition term with a sign error. So
             // here, sum up the unit vectors kb.
-            morph::Vector<T, 2> kb = b - k.path.back();
+            morph::Vector<T, 2> kb = b - kpos;
             T d = kb.length();
-            T W = d <= this->two_r ? (T{1} - d/this->two_r) : T{0};
+            if (d > this->two_r) { return; } // W would be 0
+            const branch<T>& k = branches[ki];
+            if (k.id == this->id) { return; } // Don't interact with self
+            T W = T{1} - d/this->two_r;
             T Q = k.EphA / this->EphA; // forward signalling (used predominantly in paper)
             //T Q = this->EphA / k.EphA; // reverse signalling
             //T Q = std::max(k.EphA / this->EphA, this->EphA / k.EphA); // bi-dir signalling
@@ -40,7 +45,7 @@ struct branch
             I += Q > this->s ? kb * W : nullvec;
             C += kb * W;
             if (W > T{0}) { n_k += T{1}; }
-        }
+        });
 
         // Do the 1/|B_b| multiplication
         if (n_k > T{0}) {
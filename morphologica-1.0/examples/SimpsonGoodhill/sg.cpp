@@ -64,10 +64,15 @@ struct SimpsonGoodhill
 
     void step()
     {
+        // Bin the current positions, so each branch need only look at its neighbours
+        for (unsigned int i = 0; i < this->branches.size(); ++i) {
+            this->positions[i] = this->branches[i].path.back();
+        }
+        this->bins.build (this->positions, branch<T>::two_r);
         // Compute the next position for each branch:
-#pragma omp parallel for
+#pragma omp parallel for schedule(static)
         for (unsigned int i = 0; i < this->branches.size(); ++i) {
-            this->branches[i].compute_next (this->branches, this->m);
+            this->branches[i].compute_next (this->branches, this->bins, this->m);
         }
         // Update centroids
         for (unsigned int i = 0; i < this->retina->num(); ++i) { this->ax_centroids.p[i] = {T{0}, T{0}, T{0}}; }
@@ -97,6 +102,7 @@ struct SimpsonGoodhill
         this->retina->setBoundaryOnOuterEdge();
         std::cout << "Retina has " << this->retina->num() << " cells\n";
         this->branches.resize(this->retina->num() * bpa);
+        this->positions.resize(this->branches.size());
 
         std::cout << "Retina is " << this->retina->widthnum() << " wide and " << this->retina->depthnum() << " high\n";
         this->ax_centroids.init (this->retina->widthnum(), this->retina->depthnum());
@@ -196,6 +202,9 @@ struct SimpsonGoodhill
     morph::Vector<T,2> centre = { T{0.5}, T{0.5} }; // FIXME get from CartGrid
     // (rgcside^2 * bpa) branches, as per the paper
     std::vector<branch<T>> branches;
+    // The current position of each branch, and the same binned for neighbour searches
+    std::vector<morph::Vector<T, 2>> positions;
+    morph::SpatialBins<T> bins;
     // Centroid of the branches for each axon
     net<T> ax_centroids;
     // A visual environment
@@ -48,6 +48,8 @@ int main()
     morph::HexGridVisual<float>* hgv = new morph::HexGridVisual<float>(v.shaderprog, v.tshaderprog, &hg, offset);
     hgv->setScalarData (&data);
     hgv->hexVisMode = morph::HexVisMode::Triangles;
+    // Uncomment to compute the surface on the GPU, so that updateData() uploads only the data
+    // hgv->gpuData = true;
     hgv->finalize();
     unsigned int gridId = v.addVisualModel (hgv);
     std::cout << "Added HexGridVisual with gridId " << gridId << std::endl;
@@ -107,13 +107,10 @@ public:
      */
     void compute_dAdt (std::vector<Flt>& A_, std::vector<Flt>& dAdt)
     {
-        std::vector<Flt> lapA(this->nhex, 0.0);
-        this->compute_laplace (A_, lapA);
-#pragma omp parallel for
-        for (unsigned int h=0; h<this->nhex; ++h) {
+        this->compute_laplace_fused (A_, [&](unsigned int h, Flt lapA) {
             dAdt[h] = this->k1 - (this->k2 * A_[h])
-                + (this->k3 * A_[h] * A_[h] * this->B[h]) + this->D_A * lapA[h];
-        }
+                + (this->k3 * A_[h] * A_[h] * this->B[h]) + this->D_A * lapA;
+        });
     }
 
     /*!
@@ -121,13 +118,10 @@ public:
      */
     void compute_dBdt (std::vector<Flt>& B_, std::vector<Flt>& dBdt)
     {
-        std::vector<Flt> lapB(this->nhex, 0.0);
-        this->compute_laplace (B_, lapB);
-#pragma omp parallel for
-        for (unsigned int h=0; h<this->nhex; ++h) {
+        this->compute_laplace_fused (B_, [&](unsigned int h, Flt lapB) {
             // G = k4        - k3 A^2 B
-            dBdt[h] = this->k4 - (this->k3 * this->A[h] * this->A[h] * B_[h]) + this->D_B * lapB[h];
-        }
+            dBdt[h] = this->k4 - (this->k3 * this->A[h] * this->A[h] * B_[h]) + this->D_B * lapB;
+        });
     }
 
     /*!
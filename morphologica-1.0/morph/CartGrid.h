@@ -10,6 +10,8 @@
 #include <morph/BezCoord.h>
 #include <morph/MathConst.h>
 #include <morph/HdfData.h>
+#include <morph/KdTree.h>
+#include <morph/LatticeConvolution.h>
 #include <morph/Vector.h>
 
 #include <set>
@@ -1241,8 +1243,20 @@ namespace morph {
          * Using this CartGrid as the domain, convolve the domain data \a data with the
          * kernel data \a kerneldata, which exists on another CartGrid, \a
          * kernelgrid. Return the result in \a result.
+         *
+         * Each result is the sum, over the kernel rects, of the kernel value times the
+         * datum of the rect offset from the result's rect by the kernel rect's (xi, yi);
+         * rects outside the boundary contribute nothing. The offsets are worked out
+         * (see morph::LatticeConvolution) on the first call, and again only when the
+         * (xi, yi) of this grid's or the kernel grid's rects differ from the last
+         * call's, so repeated convolutions only gather and sum, in parallel. For large
+         * kernels, the sum is made with an FFT, which agrees to within rounding error.
+         *
+         * The offsets are kept in this CartGrid, so convolve() must not be called on one
+         * CartGrid from more than one thread at once. To convolve from several threads,
+         * get a morph::LatticeConvolution from convolution() and call its (const)
+         * convolve() instead.
          */
-#ifdef DO_LATER
         template<typename T>
         void convolve (const CartGrid& kernelgrid, const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result)
         {
@@ -1252,87 +1266,88 @@ namespace morph {
             if (result.size() != data.size()) {
                 throw std::runtime_error ("The data vector is not the same size as the CartGrid.");
             }
-            if (kernelgrid.getd() != this->d) {
-                throw std::runtime_error ("The kernel CartGrid must have same d as this CartGrid to carry out convolution.");
+            if (kernelgrid.getd() != this->d || kernelgrid.getv() != this->v) {
+                throw std::runtime_error ("The kernel CartGrid must have same d and v as this CartGrid to carry out convolution.");
             }
             if (&data == &result) {
                 throw std::runtime_error ("Pass in separate memory for the result.");
             }
 
-            // For each rect in this CartGrid, compute the convolution kernel
-            std::list<Rect>::iterator hi = this->rects.begin();
-            for (; hi != this->rects.end(); ++hi) {
-                T sum = T{0};
-                // For each kernel rect, sum up.
-                for (auto kh : kernelgrid.rects) {
-                    std::list<Rect>::iterator dhi = hi;
-                    // Kernel hex coords r,g are: kh.ri, kh.gi, which may be (are EXPECTED to be) +ve or -ve
-                    //
-                    // Origin hex coords are h.ri, h.gi
-                    //
-                    // To get the hex whose data we want to multiply with kh's value,
-                    // can go via neighbour relations, but must be prepared to take a
-                    // variable path because going directly in r direction then directly
-                    // in g direction could take us temporarily outside the boundary of
-                    // the CartGrid.
-                    int rr = kh.ri;
-                    int gg = kh.gi;
-                    bool failed = false;
-                    bool finished = false;
-                    //while (gg != 0 && rr != 0) {
-                    while (!finished) {
-                        bool moved = false;
-                        // Try to move in r direction
-                        if (rr > 0) {
-                            if (dhi->has_ne()) {
-                                dhi = dhi->ne;
-                                --rr;
-                                moved = true;
-                            } // Didn't move in +r direction
-                        } else if (rr < 0) {
-                            if (dhi->has_nw()) {
-                                dhi = dhi->nw;
-                                ++rr;
-                                moved = true;
-                            } // Didn't move in -r direction
-                        }
-                        // Try to move in g direction
-                        if (gg > 0) {
-                            if (dhi->has_nne()) {
-                                dhi = dhi->nne;
-                                --gg;
-                                moved = true;
-                            } // Didn't move in +g direction
-                        } else if (gg < 0) {
-                            if (dhi->has_nsw()) {
-                                dhi = dhi->nsw;
-                                ++gg;
-                                moved = true;
-                            } // Didn't move in -g direction
-                        }
-
-                        if (rr == 0 && gg == 0) {
-                            finished = true;
-                            break;
-                        }
+            // Set up the convolution again unless both grids' rects are where they were
+            // last time. They are compared in full, not by the kernel grid's address,
+            // which a new grid may reuse once the old one has gone.
+            std::vector<std::array<int, 2>> dcoords, kcoords;
+            std::vector<unsigned int> dindex, kindex;
+            this->latticeLayout (dcoords, dindex);
+            kernelgrid.latticeLayout (kcoords, kindex);
+            if (dcoords != this->conv_dcoords || dindex != this->conv_dindex
+                || kcoords != this->conv_kcoords || kindex != this->conv_kindex) {
+                this->conv.init (dcoords, dindex, kcoords, kindex);
+                this->conv_dcoords.swap (dcoords);
+                this->conv_dindex.swap (dindex);
+                this->conv_kcoords.swap (kcoords);
+                this->conv_kindex.swap (kindex);
+            }
+            this->conv.convolve (kerneldata, data, result);
+        }
 
-                        if (!moved) {
-                            // We're stuck; Can't move in r or g direction, so can't add a contribution
-                            failed = true;
-                            break;
-                        }
-                    }
+        /*!
+         * The convolution of data on this CartGrid with kernel data on \a kernelgrid,
+         * as carried out by convolve(), for the caller to keep. Its convolve() is const,
+         * so it may be called from any number of threads at once. It holds no reference
+         * to either grid, but must be made again if the rects of either change.
+         */
+        morph::LatticeConvolution convolution (const CartGrid& kernelgrid) const
+        {
+            if (kernelgrid.getd() != this->d || kernelgrid.getv() != this->v) {
+                throw std::runtime_error ("The kernel CartGrid must have same d and v as this CartGrid to carry out convolution.");
+            }
+            std::vector<std::array<int, 2>> dcoords, kcoords;
+            std::vector<unsigned int> dindex, kindex;
+            this->latticeLayout (dcoords, dindex);
+            kernelgrid.latticeLayout (kcoords, kindex);
+            morph::LatticeConvolution c;
+            c.init (dcoords, dindex, kcoords, kindex);
+            return c;
+        }
 
-                    if (!failed) {
-                        // Can do the sum
-                        sum +=  data[dhi->vi] * kerneldata[kh.vi];
-                    }
-                }
+        /*!
+         * Find the Rect in the Rect grid which is closest to the x,y position given by
+         * pos. Where several are equally close, the first in rects is returned; if pos
+         * is not finite (or there are no rects), rects.end() is.
+         *
+         * The position is rounded to the (xi, yi) of the nearest point on the grid's
+         * lattice, which is looked up in a table; only if that Rect isn't in the grid
+         * (because pos is outside it) is the search made with a k-d tree. The table is
+         * built on the first call after rects changes size, the tree when it is first needed.
+         */
+        std::list<Rect>::iterator findRectNearest (const std::pair<float, float>& pos)
+        {
+            this->buildNearestIndex();
+            int k = this->nearestRect (pos);
+            if (k == -2) {
+                this->buildNearestTree();
+                k = static_cast<int>(this->nearest_tree.nearest ({ pos.first, pos.second }));
+            }
+            return k < 0 ? this->rects.end() : this->nearest_its[k];
+        }
 
-                result[hi->vi] = sum;
+        //! findRectNearest() for each of \a positions, found in parallel
+        std::vector<std::list<Rect>::iterator> findRectsNearest (const std::vector<std::pair<float, float>>& positions)
+        {
+            this->buildNearestIndex();
+            this->buildNearestTree();
+            std::vector<std::list<Rect>::iterator> nearest (positions.size());
+            const int n = static_cast<int>(positions.size());
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i) {
+                int k = this->nearestRect (positions[i]);
+                if (k == -2) { k = static_cast<int>(this->nearest_tree.nearest ({ positions[i].first, positions[i].second })); }
+                nearest[i] = k < 0 ? this->rects.end() : this->nearest_its[k];
             }
+            return nearest;
         }
-#endif
+
         /*!
          * What shape domain to set? Set this to the non-default BEFORE calling
          * CartGrid::setBoundary (const BezCurvePath& p) - that's where the domainShape
@@ -2065,28 +2080,6 @@ namespace morph {
             return extents;
         }
 
-        /*!
-         * Find the Rect in the Rect grid which is closest to the x,y position given by
-         * pos.
-         */
-        std::list<Rect>::iterator findRectNearest (const std::pair<float, float>& pos)
-        {
-            std::list<morph::Rect>::iterator nearest = this->rects.end();
-            std::list<morph::Rect>::iterator ri = this->rects.begin();
-            float dist = std::numeric_limits<float>::max();
-            while (ri != this->rects.end()) {
-                float dx = pos.first - ri->x;
-                float dy = pos.second - ri->y;
-                float dl = std::sqrt (dx*dx + dy*dy);
-                if (dl < dist) {
-                    dist = dl;
-                    nearest = ri;
-                }
-                ++ri;
-            }
-            return nearest;
-        }
-
         /*!
          * Does what it says on the tin. Re-number the Rect::vi vector index in each
          * Rect in the CartGrid, from the start of the list<Rect> rects until the end.
@@ -2137,6 +2130,132 @@ namespace morph {
          * the #vertexNE, #vertexSW, and similar iterators are no longer valid.
          */
         bool gridReduced = false;
+
+        //! The (xi, yi) and vi of each Rect in rects, for a morph::LatticeConvolution
+        void latticeLayout (std::vector<std::array<int, 2>>& coords, std::vector<unsigned int>& index) const
+        {
+            coords.reserve (this->rects.size());
+            index.reserve (this->rects.size());
+            for (const Rect& r : this->rects) {
+                coords.push_back ({{ r.xi, r.yi }});
+                index.push_back (r.vi);
+            }
+        }
+
+        //! (Re)build the lookup table for findRectNearest(), if rects has changed
+        void buildNearestIndex()
+        {
+            const Rect* front = this->rects.empty() ? nullptr : &this->rects.front();
+            if (this->nearest_its.size() == this->rects.size() && this->nearest_front == front) { return; }
+            this->nearest_front = front;
+            this->nearest_its.clear();
+            this->nearest_table.clear();
+            this->nearest_tree_built = false;
+            std::array<int, 4> ext = { std::numeric_limits<int>::max(), std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max(), std::numeric_limits<int>::min() };
+            for (auto ri = this->rects.begin(); ri != this->rects.end(); ++ri) {
+                this->nearest_its.push_back (ri);
+                ext[0] = std::min (ext[0], ri->xi);
+                ext[1] = std::max (ext[1], ri->xi);
+                ext[2] = std::min (ext[2], ri->yi);
+                ext[3] = std::max (ext[3], ri->yi);
+            }
+            if (this->rects.empty()) { return; }
+
+            // The table covers the bounding box of (xi, yi); each cell holds the position
+            // in rects of the first Rect there, or -1
+            this->nearest_ext = ext;
+            this->nearest_dx = this->rects.front().dx;
+            this->nearest_dy = this->rects.front().dy;
+            const size_t nx = static_cast<size_t>(ext[1] - ext[0] + 1);
+            const size_t ny = static_cast<size_t>(ext[3] - ext[2] + 1);
+            this->nearest_table.assign (nx * ny, -1);
+            for (size_t k = this->nearest_its.size(); k-- > 0;) {
+                const Rect& r = *this->nearest_its[k];
+                this->nearest_table[(r.yi - ext[2]) * nx + (r.xi - ext[0])] = static_cast<int>(k);
+            }
+        }
+
+        //! Build the k-d tree for findRectNearest(), if it hasn't been since buildNearestIndex() was
+        void buildNearestTree()
+        {
+            if (this->nearest_tree_built == true) { return; }
+            std::vector<morph::Vector<float, 2>> pts (this->nearest_its.size());
+            for (size_t k = 0; k < this->nearest_its.size(); ++k) {
+                pts[k] = { this->nearest_its[k]->x, this->nearest_its[k]->y };
+            }
+            this->nearest_tree.build (pts);
+            this->nearest_tree_built = true;
+        }
+
+        //! The position in rects of the Rect at lattice coordinates (xi, yi), or -1
+        int nearestTableAt (const int xi, const int yi) const
+        {
+            if (xi < this->nearest_ext[0] || xi > this->nearest_ext[1]
+                || yi < this->nearest_ext[2] || yi > this->nearest_ext[3]) { return -1; }
+            const size_t nx = static_cast<size_t>(this->nearest_ext[1] - this->nearest_ext[0] + 1);
+            return this->nearest_table[(yi - this->nearest_ext[2]) * nx + (xi - this->nearest_ext[0])];
+        }
+
+        /*!
+         * The position in rects of the Rect nearest to \a pos by way of the lookup table
+         * (once buildNearestIndex() has been called), or -1 if there is none, or -2 if pos
+         * is off the grid and the k-d tree is needed. Safe to call in parallel.
+         */
+        int nearestRect (const std::pair<float, float>& pos) const
+        {
+            if (this->nearest_its.empty() || !std::isfinite (pos.first) || !std::isfinite (pos.second)) {
+                return -1;
+            }
+            const float fx = pos.first / this->nearest_dx;
+            const float fy = pos.second / this->nearest_dy;
+            if (fx < this->nearest_ext[0] - 1.0f || fx > this->nearest_ext[1] + 1.0f
+                || fy < this->nearest_ext[2] - 1.0f || fy > this->nearest_ext[3] + 1.0f) {
+                return -2;
+            }
+            const int xi = static_cast<int>(std::round (fx));
+            const int yi = static_cast<int>(std::round (fy));
+
+            int k = this->nearestTableAt (xi, yi);
+            if (k < 0) { return -2; } // pos is off the grid
+            // The nearest lattice point is in the grid, so it is the nearest Rect, but for
+            // rounding error and ties, which are settled among its neighbours
+            const Rect& rk = *this->nearest_its[k];
+            float dist = std::sqrt ((pos.first - rk.x) * (pos.first - rk.x) + (pos.second - rk.y) * (pos.second - rk.y));
+            for (int j = -1; j <= 1; ++j) {
+                for (int i = -1; i <= 1; ++i) {
+                    const int kn = (i == 0 && j == 0) ? -1 : this->nearestTableAt (xi + i, yi + j);
+                    if (kn < 0) { continue; }
+                    const Rect& rn = *this->nearest_its[kn];
+                    const float dl = std::sqrt ((pos.first - rn.x) * (pos.first - rn.x) + (pos.second - rn.y) * (pos.second - rn.y));
+                    if (dl < dist || (dl == dist && kn < k)) {
+                        dist = dl;
+                        k = kn;
+                    }
+                }
+            }
+            return k;
+        }
+
+        //! For findRectNearest(): iterators to the rects, in order; the lattice lookup table
+        //! and its extents {xmin, xmax, ymin, ymax}; the lattice spacing and a k-d tree of the
+        //! rect positions. nearest_front records which list they were built from.
+        std::vector<std::list<Rect>::iterator> nearest_its;
+        std::vector<int> nearest_table;
+        std::array<int, 4> nearest_ext = {{0, 0, 0, 0}};
+        float nearest_dx = 1.0f;
+        float nearest_dy = 1.0f;
+        morph::KdTree<float> nearest_tree;
+        bool nearest_tree_built = false;
+        const Rect* nearest_front = nullptr;
+
+        //! For convolve(): the convolution, and the (xi, yi) and vi of this grid's and
+        //! the kernel grid's rects when it was set up
+        morph::LatticeConvolution conv;
+        std::vector<std::array<int, 2>> conv_dcoords;
+        std::vector<unsigned int> conv_dindex;
+        std::vector<std::array<int, 2>> conv_kcoords;
+        std::vector<unsigned int> conv_kindex;
     };
 
 } // namespace morph
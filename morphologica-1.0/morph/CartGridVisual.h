@@ -9,6 +9,7 @@
 #endif
 #include <morph/tools.h>
 #include <morph/VisualDataModel.h>
+#include <morph/VisualGridData.h>
 #include <morph/ColourMap.h>
 #include <morph/CartGrid.h>
 #include <morph/MathAlgo.h>
@@ -74,6 +75,10 @@ namespace morph {
         //! HexGrid.
         void initializeVertices()
         {
+            if (this->gpuData == true) {
+                this->initializeVerticesGPU();
+                return;
+            }
             switch (this->cartVisMode) {
             case CartVisMode::Triangles:
             {
@@ -118,45 +123,49 @@ namespace morph {
                 std::cout << "R maxmin: " << maxmin.first << ","<< maxmin.second
                           << " and G maxmin: " << maxmin2.first << ","<< maxmin2.second << std::endl;
             }
+            if (this->cm.getType() != morph::ColourMapType::Duochrome) {
+                this->cm.convert (this->dcolour, this->dclr);
+            }
 
+            // One vertex per element, so each element can be written independently
+            this->vertexPositions.resize (3 * nrect);
+            this->vertexNormals.resize (3 * nrect);
+            this->vertexColors.resize (3 * nrect);
+#pragma omp parallel for schedule(static)
             for (unsigned int ri = 0; ri < nrect; ++ri) {
                 std::array<float, 3> clr = this->setColour (ri);
-                this->vertex_push (this->cg->d_x[ri], this->cg->d_y[ri], dcopy[ri], this->vertexPositions);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+                float* p = this->vertexPositions.data() + 3 * ri;
+                float* n = this->vertexNormals.data() + 3 * ri;
+                float* c = this->vertexColors.data() + 3 * ri;
+                p[0] = this->cg->d_x[ri];
+                p[1] = this->cg->d_y[ri];
+                p[2] = this->dcopy[ri];
+                n[0] = 0.0f;
+                n[1] = 0.0f;
+                n[2] = 1.0f;
+                c[0] = clr[0];
+                c[1] = clr[1];
+                c[2] = clr[2];
             }
 
-            // Build indices based on neighbour relations in the CartGrid
-            for (unsigned int ri = 0; ri < nrect; ++ri) {
-                if (HAS_NNE(ri) && HAS_NE(ri)) {
-                    this->indices.push_back (ri);
-                    this->indices.push_back (NNE(ri));
-                    this->indices.push_back (NE(ri));
-                }
-
-                if (HAS_NW(ri) && HAS_NSW(ri)) {
-                    this->indices.push_back (ri);
-                    this->indices.push_back (NW(ri));
-                    this->indices.push_back (NSW(ri));
-                }
-            }
+            this->initializeIndicesTris();
         }
 
         //! Show a set of hexes at the zero?
         bool zerogrid = false;
 
-        //! Initialize as a rectangle made of 4 triangles for each rect, with z position
-        //! of each of the 4 outer edges of the triangles interpolated, but a single colour
-        //! for each rectangle. Gives a smooth surface in which you can see the pixels.
+        /*!
+         * Initialize as a rectangle made of 4 triangles for each rect, with z position
+         * of each of the 4 outer edges of the triangles interpolated, but a single colour
+         * for each rectangle. Gives a smooth surface in which you can see the pixels.
+         *
+         * Every rect is 5 vertices and 12 indices, so the buffers are sized up front and
+         * the rects are filled in independently, in parallel when compiled with OpenMP.
+         * Note that setColour() is called from several threads at once.
+         */
         void initializeVerticesRectsInterpolated()
         {
-            float dx = this->cg->getd();
-            float hx = 0.5f * dx;
-            float dy = this->cg->getv();
-            float vy = 0.5f * dy;
-
             unsigned int nrect = this->cg->num();
-            unsigned int idx = 0;
 
             if (this->scalarData != nullptr) {
                 this->dcopy.resize (this->scalarData->size());
@@ -180,145 +189,68 @@ namespace morph {
                 std::cout << "R maxmin: " << maxmin.first << ","<< maxmin.second
                           << " and G maxmin: " << maxmin2.first << ","<< maxmin2.second << std::endl;
             }
-            float datumC = 0.0f;   // datum at the centre
-            float datumNE = 0.0f;  // datum at the hex to the east.
-            float datumNNE = 0.0f;
-            float datumNN = 0.0f;
-            float datumNNW = 0.0f;
-            float datumNW = 0.0f;
-            float datumNSW = 0.0f;
-            float datumNS = 0.0f;
-            float datumNSE = 0.0f;
-
-            float datum = 0.0f;
-
-            morph::Vector<float> vtx_0, vtx_1, vtx_2;
+            if (this->cm.getType() != morph::ColourMapType::Duochrome) {
+                this->cm.convert (this->dcolour, this->dclr);
+            }
+            this->vertexPositions.resize (15 * nrect);
+            this->vertexNormals.resize (15 * nrect);
+            this->vertexColors.resize (15 * nrect);
+            this->indices.resize (12 * nrect);
+
+#pragma omp parallel for schedule(static)
             for (unsigned int ri = 0; ri < nrect; ++ri) {
 
                 // Use the linear scaled copy of the data, dcopy.
-                datumC  = dcopy[ri];
-                datumNE =  HAS_NE(ri)  ? dcopy[NE(ri)] : datumC;
-                //std::cout << "NE? " << (HAS_NE(ri) ? "yes\n" : "no\n");
-                datumNN =  HAS_NN(ri)  ? dcopy[NN(ri)] : datumC;
-                datumNW =  HAS_NW(ri)  ? dcopy[NW(ri)] : datumC;
-                //std::cout << "NW? " << (HAS_NW(ri) ? "yes\n" : "no\n");
-                datumNS =  HAS_NS(ri)  ? dcopy[NS(ri)] : datumC;
-                datumNNE = HAS_NNE(ri) ? dcopy[NNE(ri)] : datumC;
-                datumNNW = HAS_NNW(ri) ? dcopy[NNW(ri)] : datumC;
-                datumNSW = HAS_NSW(ri) ? dcopy[NSW(ri)] : datumC;
-                datumNSE = HAS_NSE(ri) ? dcopy[NSE(ri)] : datumC;
+                const float datumC   = this->dcopy[ri];
+                const float datumNE  = HAS_NE(ri)  ? this->dcopy[NE(ri)] : datumC;
+                const float datumNN  = HAS_NN(ri)  ? this->dcopy[NN(ri)] : datumC;
+                const float datumNW  = HAS_NW(ri)  ? this->dcopy[NW(ri)] : datumC;
+                const float datumNS  = HAS_NS(ri)  ? this->dcopy[NS(ri)] : datumC;
+                const float datumNNE = HAS_NNE(ri) ? this->dcopy[NNE(ri)] : datumC;
+                const float datumNNW = HAS_NNW(ri) ? this->dcopy[NNW(ri)] : datumC;
+                const float datumNSW = HAS_NSW(ri) ? this->dcopy[NSW(ri)] : datumC;
+                const float datumNSE = HAS_NSE(ri) ? this->dcopy[NSE(ri)] : datumC;
+
+                // The centre, then the NE, SE, SW and NW vertices
+                std::array<float, 5> px;
+                std::array<float, 5> py;
+                this->rectCorners (ri, px, py);
+                const std::array<float, 5> z = {
+                    datumC,
+                    cornerDatum (datumC, HAS_NN(ri), datumNN, HAS_NE(ri), datumNE, HAS_NNE(ri), datumNNE),
+                    cornerDatum (datumC, HAS_NS(ri), datumNS, HAS_NE(ri), datumNE, HAS_NSE(ri), datumNSE),
+                    cornerDatum (datumC, HAS_NS(ri), datumNS, HAS_NW(ri), datumNW, HAS_NSW(ri), datumNSW),
+                    cornerDatum (datumC, HAS_NN(ri), datumNN, HAS_NW(ri), datumNW, HAS_NNW(ri), datumNNW)
+                };
 
                 // Use a single colour for each rect, even though rectangle's z
                 // positions are interpolated. Do the _colour_ scaling:
                 std::array<float, 3> clr = this->setColour (ri);
 
-                // First push the 5 positions of the triangle vertices, starting with the centre
-                this->vertex_push (this->cg->d_x[ri], this->cg->d_y[ri], datumC, this->vertexPositions);
-
-                // Use the centre position as the first location for finding the normal vector
-                vtx_0 = {{this->cg->d_x[ri], this->cg->d_y[ri], datumC}};
-
-                // NE vertex
-                // Compute mean of this->data[ri] and N, NE and E elements
-                //datum = 0.25f * (datumC + datumNN + datumNE + datumNNE);
-                if (HAS_NN(ri) && HAS_NE(ri) && HAS_NNE(ri)) {
-                    datum = 0.25f * (datumC + datumNN + datumNE + datumNNE);
-                } else if (HAS_NE(ri)) {
-                    // Assume no NN and no NNE
-                    datum = 0.5f * (datumC + datumNE);
-                } else if (HAS_NN(ri)) {
-                    // Assume no NE and no NNE
-                    datum = 0.5f * (datumC + datumNN);
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->cg->d_x[ri]+hx, this->cg->d_y[ri]+vy, datum, this->vertexPositions);
-                vtx_1 = {{this->cg->d_x[ri]+hx, this->cg->d_y[ri]+vy, datum}};
-
-                // SE vertex
-                //datum = 0.25f * (datumC + datumNS + datumNE + datumNSE);
-                // SE vertex
-                if (HAS_NS(ri) && HAS_NE(ri) && HAS_NSE(ri)) {
-                    datum = 0.25f * (datumC + datumNS + datumNE + datumNSE);
-                } else if (HAS_NE(ri)) {
-                    // Assume no NS and no NSE
-                    datum = 0.5f * (datumC + datumNE);
-                } else if (HAS_NS(ri)) {
-                    // Assume no NE and no NSE
-                    datum = 0.5f * (datumC + datumNS);
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->cg->d_x[ri]+hx, this->cg->d_y[ri]-vy, datum, this->vertexPositions);
-                vtx_2 = {{this->cg->d_x[ri]+hx, this->cg->d_y[ri]-vy, datum}};
-
-
-                // SW vertex
-                //datum = 0.25f * (datumC + datumNS + datumNW + datumNSW);
-                if (HAS_NS(ri) && HAS_NW(ri) && HAS_NSW(ri)) {
-                    datum = 0.25f * (datumC + datumNS + datumNW + datumNSW);
-                } else if (HAS_NW(ri)) {
-                    datum = 0.5f * (datumC + datumNW);
-                } else if (HAS_NS(ri)) {
-                    datum = 0.5f * (datumC + datumNS);
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->cg->d_x[ri]-hx, this->cg->d_y[ri]-vy, datum, this->vertexPositions);
-
-                // NW vertex
-                //datum = 0.25f * (datumC + datumNN + datumNW + datumNNW);
-                if (HAS_NN(ri) && HAS_NW(ri) && HAS_NNW(ri)) {
-                    datum = 0.25f * (datumC + datumNN + datumNW + datumNNW);
-                } else if (HAS_NW(ri)) {
-                    datum = 0.5f * (datumC + datumNW);
-                } else if (HAS_NN(ri)) {
-                    datum = 0.5f * (datumC + datumNN);
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->cg->d_x[ri]-hx, this->cg->d_y[ri]+vy, datum, this->vertexPositions);
-
-                // From vtx_0,1,2 compute normal. This sets the correct normal, but note
-                // that there is only one 'layer' of vertices; the back of the
-                // HexGridVisual will be coloured the same as the front. To get lighting
-                // effects to look really good, the back of the surface could need the
-                // opposite normal.
-                morph::Vector<float> plane1 = vtx_1 - vtx_0;
-                morph::Vector<float> plane2 = vtx_2 - vtx_0;
+                // From the centre, NE and SE vertices compute normal. This sets the
+                // correct normal, but note that there is only one 'layer' of vertices; the
+                // back of the CartGridVisual will be coloured the same as the front. To
+                // get lighting effects to look really good, the back of the surface could
+                // need the opposite normal.
+                morph::Vector<float> plane1 = { px[1] - px[0], py[1] - py[0], z[1] - z[0] };
+                morph::Vector<float> plane2 = { px[2] - px[0], py[2] - py[0], z[2] - z[0] };
                 morph::Vector<float> vnorm = plane2.cross (plane1);
                 vnorm.renormalize();
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-
-                // Five vertices with the same colour
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-
-                // Define indices now to produce the 4 triangles in the hex
-                this->indices.push_back (idx+1);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+2);
-
-                this->indices.push_back (idx+2);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+3);
-
-                this->indices.push_back (idx+3);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+4);
-
-                this->indices.push_back (idx+4);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+1);
-
-                idx += 5; // 5 vertices (each of 3 floats for x/y/z), 15 indices.
+
+                float* p = this->vertexPositions.data() + 15 * ri;
+                float* n = this->vertexNormals.data() + 15 * ri;
+                float* c = this->vertexColors.data() + 15 * ri;
+                for (unsigned int k = 0; k < 5; ++k) {
+                    p[3 * k] = px[k];
+                    p[3 * k + 1] = py[k];
+                    p[3 * k + 2] = z[k];
+                    for (unsigned int j = 0; j < 3; ++j) {
+                        n[3 * k + j] = vnorm[j];
+                        c[3 * k + j] = clr[j];
+                    }
+                }
+
+                this->rectIndices (ri);
             }
 
 #if 0
@@ -413,6 +345,105 @@ namespace morph {
         //! How to render the elements. Triangles are faster.
         CartVisMode cartVisMode = CartVisMode::Triangles;
 
+        /*!
+         * If true, the surface is computed on the GPU, by the grid shader program
+         * (VisGrid.vert.glsl), from the scalarData as it is. The vertices and indices
+         * depend only on the CartGrid, so they're uploaded once, by finalize(), and
+         * thereafter updateData() (or updateZScale() or updateCScale()) uploads one float
+         * per element, rather than rebuilding the whole mesh. Set before finalize().
+         * Either cartVisMode may be used, but only with scalarData, and the colour of an
+         * element always comes from the colour map, so an overridden setColour() (as in
+         * CartGridVisualManual) has no effect.
+         */
+        bool gpuData = false;
+
+        //! For gpuData, update the data (and the scaling) on the GPU without re-meshing
+        void reinitData() override
+        {
+            if (this->gpuData == false) {
+                this->reinit();
+                return;
+            }
+            this->uploadData();
+            this->changed = true;
+        }
+
+        //! Render, first setting the grid program up, for gpuData
+        void render() override
+        {
+            if (this->gpuData == true && this->hide == false) {
+                glUseProgram (this->shaderprog);
+                const int vpe = this->cartVisMode == CartVisMode::Triangles ? 1 : 5;
+                this->griddata.bind (this->uniforms(), this->gpu_zscale, this->gpu_cscale, vpe,
+                                     static_cast<int>(this->cg->num()),
+                                     {0.5f * this->cg->getd(), 0.5f * this->cg->getv()});
+            }
+            VisualDataModel<T>::render();
+        }
+
+        /*!
+         * Initialize for gpuData: the x and y of each vertex (the shader sets z), the
+         * indices and the neighbours of each element, none of which depend on the data.
+         * Then upload the data.
+         */
+        void initializeVerticesGPU()
+        {
+            if (this->scalarData == nullptr) {
+                throw std::runtime_error ("CartGridVisual: gpuData requires scalarData");
+            }
+            unsigned int nrect = this->cg->num();
+            this->useGridProgram();
+
+            if (this->cartVisMode == CartVisMode::Triangles) {
+                this->vertexPositions.resize (3 * nrect);
+#pragma omp parallel for schedule(static)
+                for (unsigned int ri = 0; ri < nrect; ++ri) {
+                    float* p = this->vertexPositions.data() + 3 * ri;
+                    p[0] = this->cg->d_x[ri];
+                    p[1] = this->cg->d_y[ri];
+                    p[2] = 0.0f;
+                }
+                this->initializeIndicesTris();
+            } else {
+                this->vertexPositions.resize (15 * nrect);
+                this->indices.resize (12 * nrect);
+#pragma omp parallel for schedule(static)
+                for (unsigned int ri = 0; ri < nrect; ++ri) {
+                    std::array<float, 5> px;
+                    std::array<float, 5> py;
+                    this->rectCorners (ri, px, py);
+                    float* p = this->vertexPositions.data() + 15 * ri;
+                    for (unsigned int k = 0; k < 5; ++k) {
+                        p[3 * k] = px[k];
+                        p[3 * k + 1] = py[k];
+                        p[3 * k + 2] = 0.0f;
+                    }
+                    this->rectIndices (ri);
+                }
+            }
+            // The shader computes the normals and colours
+            this->vertexNormals.clear();
+            this->vertexColors.clear();
+
+            // In the order VisGrid.vert.glsl expects
+            std::vector<GLint> nbrs (8 * nrect);
+#pragma omp parallel for schedule(static)
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                GLint* nb = nbrs.data() + 8 * ri;
+                nb[0] = NE(ri);
+                nb[1] = NNE(ri);
+                nb[2] = NN(ri);
+                nb[3] = NNW(ri);
+                nb[4] = NW(ri);
+                nb[5] = NSW(ri);
+                nb[6] = NS(ri);
+                nb[7] = NSE(ri);
+            }
+            this->griddata.setNeighbours (nbrs);
+
+            this->uploadData();
+        }
+
     protected:
         //! An overridable function to set the colour of hex hi
         virtual std::array<float, 3> setColour (unsigned int hi)
@@ -422,11 +453,81 @@ namespace morph {
                 // Use vectorData
                 clr = this->cm.convert (this->dcolour[hi], this->dcolour2[hi]);
             } else {
-                clr = this->cm.convert (this->dcolour[hi]);
+                clr = this->dclr[hi];
             }
             return clr;
         }
 
+        /*!
+         * The z of a rect corner from the centre datum \a c and those of the vertical
+         * neighbour \a v, the horizontal neighbour \a h and the diagonal neighbour \a d
+         * which share the corner. Where not all three exist, the horizontal neighbour is
+         * preferred to the vertical.
+         */
+        static float cornerDatum (const float c, const bool has_v, const float v,
+                                  const bool has_h, const float h, const bool has_d, const float d)
+        {
+            if (has_v && has_h && has_d) { return 0.25f * (c + v + h + d); }
+            if (has_h) { return 0.5f * (c + h); }
+            if (has_v) { return 0.5f * (c + v); }
+            return c;
+        }
+
+        //! The x and y of the centre, then the NE, SE, SW and NW vertices of rect \a ri
+        void rectCorners (const unsigned int ri, std::array<float, 5>& px, std::array<float, 5>& py) const
+        {
+            const float hx = 0.5f * this->cg->getd();
+            const float vy = 0.5f * this->cg->getv();
+            const float x = this->cg->d_x[ri];
+            const float y = this->cg->d_y[ri];
+            px = { x, x + hx, x + hx, x - hx, x - hx };
+            py = { y, y + vy, y - vy, y - vy, y + vy };
+        }
+
+        //! The indices of the 4 triangles in rect \a ri, each from the centre to two
+        //! adjacent corners
+        void rectIndices (const unsigned int ri)
+        {
+            const VBOint base = static_cast<VBOint>(5 * ri);
+            VBOint* ix = this->indices.data() + 12 * ri;
+            for (VBOint t = 0; t < 4; ++t) {
+                ix[3 * t] = base + 1 + t;
+                ix[3 * t + 1] = base;
+                ix[3 * t + 2] = base + 1 + (t + 1) % 4;
+            }
+        }
+
+        //! Build the Triangles mode indices from the neighbour relations in the CartGrid
+        void initializeIndicesTris()
+        {
+            unsigned int nrect = this->cg->num();
+            // Each element starts zero, one or two triangles, so first count them to find
+            // where each element's indices go, then fill them in.
+            this->tri_first.resize (nrect + 1);
+            this->tri_first[0] = 0;
+#pragma omp parallel for schedule(static)
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                this->tri_first[ri + 1] = 3 * ((HAS_NNE(ri) && HAS_NE(ri) ? 1 : 0) + (HAS_NW(ri) && HAS_NSW(ri) ? 1 : 0));
+            }
+            for (unsigned int ri = 0; ri < nrect; ++ri) { this->tri_first[ri + 1] += this->tri_first[ri]; }
+
+            this->indices.resize (this->tri_first[nrect]);
+#pragma omp parallel for schedule(static)
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                VBOint* ix = this->indices.data() + this->tri_first[ri];
+                if (HAS_NNE(ri) && HAS_NE(ri)) {
+                    *ix++ = ri;
+                    *ix++ = NNE(ri);
+                    *ix++ = NE(ri);
+                }
+                if (HAS_NW(ri) && HAS_NSW(ri)) {
+                    *ix++ = ri;
+                    *ix++ = NW(ri);
+                    *ix++ = NSW(ri);
+                }
+            }
+        }
+
         //! The CartGrid to visualize
         const CartGrid* cg;
 
@@ -435,6 +536,35 @@ namespace morph {
         //! A copy of the scalarData (or first field of vectorData), scaled to be a colour value
         std::vector<float> dcolour;
         std::vector<float> dcolour2;
+        //! dcolour through the colour map (unless Duochrome), converted in one pass for setColour()
+        std::vector<std::array<float, 3>> dclr;
+        //! In Triangles mode, where each element's indices start (and, at [num()], where they end)
+        std::vector<VBOint> tri_first;
+
+        //! For gpuData, switch to the grid program
+        void useGridProgram()
+        {
+            GLuint gprog = VisualResources::i()->getGridProgram (glfwGetCurrentContext());
+            if (this->shaderprog != gprog) {
+                this->shaderprog = gprog;
+                this->ulocs = nullptr;
+            }
+        }
+
+        //! For gpuData, upload the data, the scaling and the colour map
+        void uploadData()
+        {
+            this->griddata.setData (*this->scalarData);
+            this->gpu_zscale = VisualGridData::scaleParams (this->zScale, *this->scalarData);
+            this->gpu_cscale = VisualGridData::scaleParams (this->colourScale, *this->scalarData);
+            this->griddata.setColourMap (this->cm);
+        }
+
+        //! For gpuData, the textures from which the shader computes the surface
+        VisualGridData griddata;
+        //! For gpuData, the z and colour scaling as the shader takes them
+        std::array<float, 3> gpu_zscale;
+        std::array<float, 3> gpu_cscale;
     };
 
     //! Extended CartGridVisual class for plotting with individual red, green and blue
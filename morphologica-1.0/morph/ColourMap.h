@@ -4,6 +4,9 @@
 
 #include <stdexcept>
 #include <cmath>
+#include <array>
+#include <vector>
+#include <algorithm>
 #include <morph/tools.h>
 
 namespace morph {
@@ -262,10 +265,71 @@ namespace morph {
         //! Convert the scalar datum into an RGB (or BGR) colour
         std::array<float, 3> convert (T _datum)
         {
-            float datum = 0.0f;
+            float datum = this->toUnit (_datum);
+            // Check for nan and return a 'nan' colour for the colour map
+            if (std::isnan(datum) == true) { return ColourMap<T>::nanColour(this->type); }
+            return this->convertUnit (datum);
+        }
+
+        /*!
+         * Convert every datum in \a data into a colour in \a colours, which is resized to
+         * match. This gives the same colours as convert(T) (for the matplotlib maps,
+         * exactly; for the others to within 1/lutIntervals of the datum), but looks each
+         * one up in a table, so it's much faster for a large container. The table is
+         * (re)built on the first call after the map changes. Split over threads when
+         * compiled with OpenMP.
+         */
+        void convert (const std::vector<T>& data, std::vector<std::array<float, 3>>& colours)
+        {
+            this->buildLut();
+            const std::array<float, 3> nanc = ColourMap<T>::nanColour (this->type);
+            const std::array<float, 3>* lt = this->lut.data();
+            const size_t n = data.size();
+            colours.resize (n);
+            std::array<float, 3>* out = colours.data();
+
+            if (this->lut_nearest == true) {
+                // A copy of the map's own table, looked up as the map does, by rounding
+                const float scale = static_cast<float>(this->lut.size() - 1);
+#pragma omp parallel for schedule(static)
+                for (size_t i = 0; i < n; ++i) {
+                    const float x = this->toUnit (data[i]);
+                    out[i] = std::isnan(x) ? nanc : lt[static_cast<size_t>(x * scale + 0.5f)];
+                }
+                return;
+            }
+
+            // Interpolate linearly between the points. The Rainbow maps with a special
+            // colour for zero take it from convert(T).
+            const bool zerospecial = this->type == ColourMapType::RainbowZeroBlack
+                                     || this->type == ColourMapType::RainbowZeroWhite;
+            const std::array<float, 3> zc = this->convertUnit (0.0f);
+            const float scale = static_cast<float>(lutIntervals);
+#pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < n; ++i) {
+                const float x = this->toUnit (data[i]);
+                const float fi = (std::isnan(x) ? 0.0f : x) * scale;
+                const size_t j = std::min (static_cast<size_t>(fi), lutIntervals - 1);
+                const float f = fi - static_cast<float>(j);
+                const std::array<float, 3>& c0 = lt[j];
+                const std::array<float, 3>& c1 = lt[j + 1];
+                const std::array<float, 3> c = { c0[0] + f * (c1[0] - c0[0]),
+                                                 c0[1] + f * (c1[1] - c0[1]),
+                                                 c0[2] + f * (c1[2] - c0[2]) };
+                out[i] = std::isnan(x) ? nanc : ((zerospecial && x == 0.0f) ? zc : c);
+            }
+        }
+
+        //! The number of intervals in the table used by the container convert() for the
+        //! colour maps which are computed, rather than given by a table
+        static constexpr size_t lutIntervals = 4096;
 
-            // Convert T into a suitable value (with a suitable scaling as necessary) to
-            // make the conversion to array<float,3> colour.
+    private:
+        //! Convert T into a value in the range [0,1] (or nan), with a suitable scaling
+        //! as necessary, ready to convert to an array<float,3> colour.
+        float toUnit (const T _datum) const
+        {
+            float datum = 0.0f;
             if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
                 // Copy, enforce range
                 datum = _datum > T{1} ? 1.0f : static_cast<float>(_datum);
@@ -287,15 +351,14 @@ namespace morph {
             } else {
                 throw std::runtime_error ("Unhandled ColourMap data type.");
             }
+            return datum;
+        }
 
+        //! Convert \a datum, in the range [0,1], into a colour
+        std::array<float, 3> convertUnit (const float datum)
+        {
             std::array<float, 3> c = {0.0f, 0.0f, 0.0f};
 
-            // Check for nan and return a 'nan' colour for the colour map
-            if constexpr (std::is_same<std::decay_t<T>, double>::value == true
-                          || std::is_same<std::decay_t<T>, float>::value == true) {
-                if (std::isnan(datum) == true) { c = ColourMap<T>::nanColour(this->type); return c; }
-            }
-
             switch (this->type) {
             case ColourMapType::Jet:
             {
@@ -393,6 +456,48 @@ namespace morph {
             return c;
         }
 
+        //! The length of the table of a map which is given by a table, else 0
+        size_t tableLength() const
+        {
+            switch (this->type) {
+            case ColourMapType::Magma: { return morph::cm_magma_len; }
+            case ColourMapType::Inferno: { return morph::cm_inferno_len; }
+            case ColourMapType::Plasma: { return morph::cm_plasma_len; }
+            case ColourMapType::Viridis: { return morph::cm_viridis_len; }
+            case ColourMapType::Cividis: { return morph::cm_cividis_len; }
+            case ColourMapType::Twilight: { return morph::cm_twilight_len; }
+            default: { return 0; }
+            }
+        }
+
+        //! Fill lut for the map as it is now, unless it's already filled for it
+        void buildLut()
+        {
+            const std::array<float, 5> key = { static_cast<float>(this->type), this->hue, this->sat, this->val,
+                                               static_cast<float>(this->range_max) };
+            if (!this->lut.empty() && key == this->lut_key) { return; }
+            this->lut_key = key;
+            const size_t tlen = this->tableLength();
+            this->lut_nearest = tlen > 0;
+            const size_t npts = this->lut_nearest ? tlen : lutIntervals + 1;
+            this->lut.resize (npts);
+            for (size_t i = 0; i < npts; ++i) {
+                this->lut[i] = this->convertUnit (static_cast<float>(i) / static_cast<float>(npts - 1));
+            }
+            // The special colour for zero belongs to zero alone, not to the interval above it
+            if (this->type == ColourMapType::RainbowZeroBlack || this->type == ColourMapType::RainbowZeroWhite) {
+                this->lut[0] = ColourMap::rainbow (0.0f);
+            }
+        }
+
+        //! The colours at evenly spaced points over [0,1], for the container convert()
+        std::vector<std::array<float, 3>> lut;
+        //! True if lut is a copy of the map's own table, to be looked up without interpolation
+        bool lut_nearest = false;
+        //! What lut was built for: type, hue, sat, val and range_max
+        std::array<float, 5> lut_key;
+
+    public:
         //! Getter for type, the ColourMapType of this ColourMap.
         ColourMapType getType() const { return this->type; }
 
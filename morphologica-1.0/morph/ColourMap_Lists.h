@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 /*!
  * Listed colour maps, copied from _cm_listed.py
  */
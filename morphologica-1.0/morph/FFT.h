@@ -0,0 +1,117 @@
+/*!
+ * \file
+ *
+ * A radix-2 fast Fourier transform, in one and two dimensions, for sizes which are
+ * powers of two. The inverse transforms are scaled by 1/n, so that a forward then an
+ * inverse transform gives back the original data.
+ */
+#pragma once
+
+#include <morph/MathConst.h>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace morph {
+
+    template <typename T>
+    struct FFT
+    {
+        //! True if \a n is a power of two (1, 2, 4, ...)
+        static bool isPow2 (const size_t n) { return n > 0 && (n & (n - 1)) == 0; }
+
+        //! The smallest power of two >= \a n
+        static size_t nextPow2 (const size_t n)
+        {
+            size_t p = 1;
+            while (p < n) { p <<= 1; }
+            return p;
+        }
+
+        //! Transform \a x in place. x.size() must be a power of two.
+        static void transform (std::vector<std::complex<T>>& x, const bool inverse = false)
+        {
+            if (!isPow2 (x.size())) { throw std::runtime_error ("FFT::transform: size must be a power of two"); }
+            std::vector<std::complex<T>> tw = twiddles (x.size());
+            transformAt (x.data(), x.size(), tw, inverse);
+        }
+
+        /*!
+         * Transform \a x in place as a 2D array of \a h rows of \a w elements. w and h
+         * must be powers of two. Rows, then columns, are transformed in parallel.
+         */
+        static void transform2 (std::vector<std::complex<T>>& x, const size_t w, const size_t h,
+                                const bool inverse = false)
+        {
+            if (!isPow2 (w) || !isPow2 (h)) { throw std::runtime_error ("FFT::transform2: sizes must be powers of two"); }
+            if (x.size() != w * h) { throw std::runtime_error ("FFT::transform2: x must have w * h elements"); }
+            const std::vector<std::complex<T>> tww = twiddles (w);
+            const std::vector<std::complex<T>> twh = twiddles (h);
+            const int nrows = static_cast<int>(h);
+            const int ncols = static_cast<int>(w);
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < nrows; ++j) { transformAt (x.data() + j * w, w, tww, inverse); }
+#pragma omp parallel
+            {
+                // Each column is copied out, so that it is transformed in contiguous memory
+                std::vector<std::complex<T>> col (h);
+#pragma omp for schedule(static)
+                for (int i = 0; i < ncols; ++i) {
+                    for (size_t j = 0; j < h; ++j) { col[j] = x[j * w + i]; }
+                    transformAt (col.data(), h, twh, inverse);
+                    for (size_t j = 0; j < h; ++j) { x[j * w + i] = col[j]; }
+                }
+            }
+        }
+
+    private:
+        //! exp(-2 pi i k / n) for k in [0, n/2)
+        static std::vector<std::complex<T>> twiddles (const size_t n)
+        {
+            std::vector<std::complex<T>> tw (n / 2);
+            for (size_t k = 0; k < n / 2; ++k) {
+                const double a = -morph::TWO_PI_D * static_cast<double>(k) / static_cast<double>(n);
+                tw[k] = std::complex<T> (static_cast<T>(std::cos (a)), static_cast<T>(std::sin (a)));
+            }
+            return tw;
+        }
+
+        //! The iterative Cooley-Tukey transform of the \a n elements at \a x
+        static void transformAt (std::complex<T>* x, const size_t n, const std::vector<std::complex<T>>& tw,
+                                 const bool inverse)
+        {
+            // Bit reversal permutation
+            for (size_t i = 1, j = 0; i < n; ++i) {
+                size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1) { j ^= bit; }
+                j ^= bit;
+                if (i < j) { std::swap (x[i], x[j]); }
+            }
+            // Butterflies, on spans of length len
+            for (size_t len = 2; len <= n; len <<= 1) {
+                const size_t half = len / 2;
+                const size_t step = n / len;
+                for (size_t i = 0; i < n; i += len) {
+                    for (size_t k = 0; k < half; ++k) {
+                        const std::complex<T> w = inverse ? std::conj (tw[k * step]) : tw[k * step];
+                        const std::complex<T> u = x[i + k];
+                        const std::complex<T> b = x[i + k + half];
+                        // Multiplied out, as operator* checks for infinities, which is slow
+                        const std::complex<T> v (b.real() * w.real() - b.imag() * w.imag(),
+                                                 b.real() * w.imag() + b.imag() * w.real());
+                        x[i + k] = u + v;
+                        x[i + k + half] = u - v;
+                    }
+                }
+            }
+            if (inverse) {
+                const T s = T{1} / static_cast<T>(n);
+                for (size_t i = 0; i < n; ++i) { x[i] *= s; }
+            }
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,185 @@
+/*!
+ * \file
+ *
+ * Writes captured frames to files on worker threads, so that encoding never holds up
+ * rendering. morph::Visual hands frames over as they come back from the GPU (see
+ * Visual::startRecording). A frame is RGBA, 8 bits per channel, with its rows either
+ * bottom up as glReadPixels returns them (the rows are flipped on the worker thread) or
+ * top down. The file format follows the file name: ".png" gives a PNG (via lodepng) and
+ * anything else the raw RGBA bytes, top row first, which is much faster to write (and
+ * which ffmpeg can read with -f rawvideo -pixel_format rgba).
+ *
+ * The queue is bounded. If the encoders fall behind, submit() blocks until there's
+ * room, so a long recording takes a bounded amount of memory and drops no frames.
+ * Buffers go back to a pool after encoding; get them with buffer() to avoid allocating
+ * a frame's worth of memory every frame.
+ */
+#pragma once
+
+// lodepng.h contains its implementation, unguarded, so include it from here only
+#include <morph/lodepng.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace morph {
+
+    class FrameEncoder
+    {
+    public:
+        /*!
+         * Start \a nthreads encoding threads, with room for \a maxqueue frames waiting.
+         * PNG encoding is slow (tens of ms for a full HD frame) so a recording at video
+         * rates needs several threads; raw output needs only one.
+         */
+        FrameEncoder (unsigned int nthreads = 2, size_t maxqueue = 8)
+            : maxq(std::max (maxqueue, size_t{1}))
+        {
+            for (unsigned int t = 0; t < std::max (nthreads, 1u); ++t) {
+                this->workers.emplace_back (&FrameEncoder::work, this);
+            }
+        }
+
+        ~FrameEncoder()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_all();
+            for (auto& w : this->workers) { w.join(); }
+        }
+
+        FrameEncoder (const FrameEncoder&) = delete;
+        FrameEncoder& operator= (const FrameEncoder&) = delete;
+
+        //! A buffer of at least \a bytes, from the pool if one is free
+        std::vector<uint8_t> buffer (const size_t bytes)
+        {
+            std::vector<uint8_t> b;
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                if (!this->pool.empty()) {
+                    b = std::move (this->pool.back());
+                    this->pool.pop_back();
+                }
+            }
+            b.resize (bytes);
+            return b;
+        }
+
+        /*!
+         * Queue the w by h RGBA image in \a rgba to be written to \a path. If \a bottom_up,
+         * the first row in rgba is the bottom of the image. Blocks while the queue is full.
+         */
+        void submit (std::vector<uint8_t>&& rgba, const unsigned int w, const unsigned int h,
+                     const std::string& path, const bool bottom_up = true)
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_room.wait (lk, [this]{ return this->jobs.size() < this->maxq; });
+            this->jobs.push_back (job{std::move (rgba), w, h, path, bottom_up});
+            ++this->unfinished;
+            lk.unlock();
+            this->cv_work.notify_one();
+        }
+
+        //! Wait until every frame submitted so far has been written
+        void finish()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_done.wait (lk, [this]{ return this->unfinished == 0; });
+        }
+
+        //! The number of frames written, and the number that could not be
+        uint64_t written() const { std::lock_guard<std::mutex> lk (this->m); return this->nwritten; }
+        uint64_t failed() const { std::lock_guard<std::mutex> lk (this->m); return this->nfailed; }
+
+        //! Reverse the order of the h rows of w RGBA pixels in \a rgba
+        static void flipRows (std::vector<uint8_t>& rgba, const unsigned int w, const unsigned int h)
+        {
+            const size_t stride = static_cast<size_t>(w) * 4;
+            for (unsigned int i = 0; i < h / 2; ++i) {
+                std::swap_ranges (rgba.begin() + i * stride, rgba.begin() + (i + 1) * stride,
+                                  rgba.begin() + (h - 1 - i) * stride);
+            }
+        }
+
+    private:
+        struct job
+        {
+            std::vector<uint8_t> rgba;
+            unsigned int w;
+            unsigned int h;
+            std::string path;
+            bool bottom_up;
+        };
+
+        static bool isPng (const std::string& path)
+        {
+            return path.size() >= 4 && path.compare (path.size() - 4, 4, ".png") == 0;
+        }
+
+        //! Write one frame. Returns false on failure.
+        static bool write (job& j)
+        {
+            if (j.bottom_up) { flipRows (j.rgba, j.w, j.h); }
+            if (isPng (j.path)) {
+                unsigned int error = lodepng::encode (j.path, j.rgba.data(), j.w, j.h);
+                if (error) {
+                    std::cerr << "FrameEncoder: " << j.path << ": " << lodepng_error_text (error) << std::endl;
+                    return false;
+                }
+                return true;
+            }
+            std::ofstream f (j.path, std::ios::binary | std::ios::trunc);
+            f.write (reinterpret_cast<const char*>(j.rgba.data()), static_cast<std::streamsize>(j.w) * j.h * 4);
+            if (!f.good()) {
+                std::cerr << "FrameEncoder: could not write " << j.path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        void work()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            for (;;) {
+                this->cv_work.wait (lk, [this]{ return this->stopping || !this->jobs.empty(); });
+                if (this->jobs.empty()) { return; } // stopping, and nothing left to do
+                job j = std::move (this->jobs.front());
+                this->jobs.pop_front();
+                lk.unlock();
+                this->cv_room.notify_one();
+
+                bool ok = write (j);
+
+                lk.lock();
+                ok ? ++this->nwritten : ++this->nfailed;
+                this->pool.push_back (std::move (j.rgba));
+                if (--this->unfinished == 0) { this->cv_done.notify_all(); }
+            }
+        }
+
+        size_t maxq;
+        mutable std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_room;
+        std::condition_variable cv_done;
+        std::deque<job> jobs;
+        std::vector<std::vector<uint8_t>> pool;
+        size_t unfinished = 0;
+        uint64_t nwritten = 0;
+        uint64_t nfailed = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+
+} // namespace morph
@@ -22,11 +22,13 @@
 #include <morph/ColourMap.h>
 #include <morph/colour.h>
 #include <morph/histo.h>
+#include <morph/MinMaxPyramid.h>
 #include <iostream>
 #include <vector>
 #include <deque>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <sstream>
 
 namespace morph {
@@ -172,7 +174,13 @@ namespace morph {
             this->twodimensional = true;
         }
 
-        ~GraphVisual() { for (auto& gdc : this->graphDataCoords) { delete gdc; } }
+        ~GraphVisual()
+        {
+            for (auto& gdc : this->graphDataCoords) { delete gdc; }
+            for (auto& st : this->strips) { this->deleteStripBuffers (st); }
+            for (auto& md : this->markers) { this->deleteMarkerBuffers (md); }
+            for (auto& ld : this->lines) { this->deleteLineBuffers (ld); }
+        }
 
         //! Set true for any optional debugging
         static constexpr bool gv_debug = false;
@@ -183,6 +191,7 @@ namespace morph {
         void append (const Flt& _abscissa, const Flt& _ordinate, const size_t didx)
         {
             this->pendingAppended = true;
+            this->changed = true;
             // Transfor the data into temporary containers sd and ad
             Flt o = Flt{0};
             if (this->datastyles[didx].axisside == morph::axisside::left) {
@@ -213,6 +222,11 @@ namespace morph {
             }
             // Now do the usual drawing stuff from VisualModel:
             VisualModel::render();
+            // Lines drawn by the line shader, then data markers, which are instanced
+            if (!this->lines.empty()) { this->renderLines(); }
+            if (!this->markers.empty()) { this->renderMarkers(); }
+            // Strip chart datasets have their own buffers and their own model matrix
+            if (!this->strips.empty()) { this->renderStrips(); }
         }
 
         //! Clear all the data for the graph, but leave the containers in place.
@@ -222,6 +236,10 @@ namespace morph {
             for (size_t i = 0; i < dsize; ++i) {
                 this->graphDataCoords[i]->clear();
             }
+            for (auto& st : this->strips) {
+                st.count = 0;
+                st.pending = 0;
+            }
             this->reinit();
         }
 
@@ -229,6 +247,7 @@ namespace morph {
         void update (const std::vector<Flt>& _abscissae,
                      const std::vector<Flt>& _data, const size_t data_idx)
         {
+            MORPH_PROFILE_SCOPE ("GraphVisual::update");
             size_t dsize = _data.size();
 
             if (_abscissae.size() != dsize) {
@@ -245,23 +264,118 @@ namespace morph {
 
             // May need a re-autoscaling option somewhere in here.
 
-            // Transfor the data into temporary containers sd and ad
-            std::vector<Flt> sd (dsize, Flt{0});
-            std::vector<Flt> ad (dsize, Flt{0});
-            this->ord1_scale.transform (_data, sd);
-            this->abscissa_scale.transform (_abscissae, ad);
+            // Transform the data into the scratch containers sd and ad
+            this->sd.resize (dsize);
+            this->ad.resize (dsize);
+            this->ord1_scale.transform (_data, this->sd);
+            this->abscissa_scale.transform (_abscissae, this->ad);
 
             // Now sd and ad can be used to construct dataCoords x/y. They are used to
             // set the position of each datum into dataCoords
             for (size_t i = 0; i < dsize; ++i) {
-                (*this->graphDataCoords[data_idx])[i][0] = static_cast<Flt>(ad[i]);
-                (*this->graphDataCoords[data_idx])[i][1] = static_cast<Flt>(sd[i]);
+                (*this->graphDataCoords[data_idx])[i][0] = static_cast<Flt>(this->ad[i]);
+                (*this->graphDataCoords[data_idx])[i][1] = static_cast<Flt>(this->sd[i]);
                 (*this->graphDataCoords[data_idx])[i][2] = Flt{0};
             }
 
             this->reinit();
         }
 
+        /*!
+         * Prepare a 'strip chart' dataset: a scrolling window which always shows the
+         * most recent \a window samples pushed with pushstrip(). The samples are spread
+         * evenly across the width of the x axis, with the newest at the right hand end,
+         * so the x axis limits should describe the window (e.g. setlimits_x (-2, 0) for
+         * 2 s of history).
+         *
+         * Strip chart data lives in its own ring buffer and its own OpenGL buffers.
+         * Pushing a sample is O(1): the ordinate is transformed and stored and, on the
+         * next render, the one new line segment is uploaded with glBufferSubData. The
+         * scrolling is done by translating the model matrix, so the vertices of the
+         * older samples are never recomputed.
+         *
+         * Strip charts are drawn as lines only (no markers). The y scaling must already
+         * be known, so call setlimits() (or setlimits_y()) before prepstrip().
+         *
+         * \return the data index to pass to pushstrip()
+         */
+        size_t prepstrip (const size_t window, const std::string name = "",
+                          const morph::axisside axisside = morph::axisside::left)
+        {
+            DatasetStyle ds(morph::stylepolicy::lines);
+            ds.axisside = axisside;
+            if (!name.empty()) { ds.datalabel = name; }
+            ds.linecolour = GraphVisual<Flt>::datacolour (this->graphDataCoords.size());
+            return this->prepstrip (window, ds);
+        }
+
+        //! Prepare a strip chart dataset with a pre-configured DatasetStyle
+        size_t prepstrip (const size_t window, const DatasetStyle& _ds)
+        {
+            if (window < 2) { throw std::runtime_error ("GraphVisual::prepstrip: window must be at least 2 samples"); }
+            const morph::Scale<Flt>& oscale = _ds.axisside == morph::axisside::left ? this->ord1_scale : this->ord2_scale;
+            if (!oscale.ready()) {
+                throw std::runtime_error ("GraphVisual::prepstrip: The y scaling is not yet known.\n"
+                                          "Hint: call GraphVisual::setlimits_y() BEFORE GraphVisual::prepstrip()");
+            }
+            DatasetStyle ds = _ds;
+            ds.markerstyle = morph::markerstyle::none;
+            ds.showlines = true;
+
+            // An empty entry in graphDataCoords keeps the data indices and the legend consistent
+            std::vector<Flt> emptyabsc;
+            std::vector<Flt> emptyord;
+            size_t didx = this->graphDataCoords.size();
+            this->setdata (emptyabsc, emptyord, ds);
+
+            stripdata st;
+            st.didx = didx;
+            st.window = window;
+            st.ys.assign (window, this->height * 0.5f);
+            this->strip_of.resize (didx + 1, -1);
+            this->strip_of[didx] = static_cast<int>(this->strips.size());
+            this->strips.push_back (st);
+            return didx;
+        }
+
+        //! Push one new sample onto the end of strip chart dataset didx. O(1).
+        void pushstrip (const Flt& _ordinate, const size_t didx)
+        {
+            this->pushstrip (&_ordinate, 1, didx);
+        }
+
+        //! Push several samples (oldest first) onto strip chart dataset didx.
+        void pushstrip (const std::vector<Flt>& _ordinates, const size_t didx)
+        {
+            this->pushstrip (_ordinates.data(), _ordinates.size(), didx);
+        }
+
+        /*!
+         * Push \a n samples (oldest first) from \a _ordinates onto strip chart dataset
+         * didx. This is the call to use when a frame's worth of samples has been
+         * buffered up: the dataset is looked up once and, if more than a window's worth
+         * of samples arrive at once, only the last window of them is transformed.
+         */
+        void pushstrip (const Flt* _ordinates, const size_t n, const size_t didx)
+        {
+            MORPH_PROFILE_SCOPE ("GraphVisual::pushstrip");
+            stripdata& st = this->strip (didx);
+            const morph::Scale<Flt>& oscale = this->datastyles[didx].axisside == morph::axisside::left ?
+            this->ord1_scale : this->ord2_scale;
+            const size_t skip = n > st.window ? n - st.window : 0;
+            st.count += skip;
+            const float h = this->height;
+            for (size_t i = skip; i < n; ++i) {
+                // Keep the trace inside the axes
+                float of = static_cast<float>(oscale.transform_one (_ordinates[i]));
+                of = of < 0.0f ? 0.0f : (of > h ? h : of);
+                st.ys[st.count % st.window] = of;
+                ++st.count;
+            }
+            st.pending += n;
+            if (n > 0) { this->changed = true; }
+        }
+
         //! Set marker and colours in ds, according the 'style policy'
         void setstyle (morph::DatasetStyle& ds, std::array<float, 3> col, morph::markerstyle ms)
         {
@@ -427,21 +541,21 @@ namespace morph {
             }
 
             if (dsize > 0) {
-                // Transform the data into temporary containers sd and ad
-                std::vector<Flt> sd (dsize, Flt{0});
-                std::vector<Flt> ad (dsize, Flt{0});
+                // Transform the data into the scratch containers sd and ad
+                this->sd.resize (dsize);
+                this->ad.resize (dsize);
                 if (ds.axisside == morph::axisside::left) {
-                    this->ord1_scale.transform (_data, sd);
+                    this->ord1_scale.transform (_data, this->sd);
                 } else {
-                    this->ord2_scale.transform (_data, sd);
+                    this->ord2_scale.transform (_data, this->sd);
                 }
-                this->abscissa_scale.transform (_abscissae, ad);
+                this->abscissa_scale.transform (_abscissae, this->ad);
 
                 // Now sd and ad can be used to construct dataCoords x/y. They are used to
                 // set the position of each datum into dataCoords
                 for (size_t i = 0; i < dsize; ++i) {
-                    (*this->graphDataCoords[didx])[i][0] = static_cast<Flt>(ad[i]);
-                    (*this->graphDataCoords[didx])[i][1] = static_cast<Flt>(sd[i]);
+                    (*this->graphDataCoords[didx])[i][0] = static_cast<Flt>(this->ad[i]);
+                    (*this->graphDataCoords[didx])[i][1] = static_cast<Flt>(this->sd[i]);
                     (*this->graphDataCoords[didx])[i][2] = Flt{0};
                 }
             }
@@ -783,6 +897,20 @@ namespace morph {
         //! dsi: data set iterator
         void drawDataCommon (size_t dsi, size_t coords_start, size_t coords_end, bool appending = false)
         {
+            // Level of detail datasets are decimated, and their lines drawn by the line shader, at render time
+            if (this->lod == true && this->datastyles[dsi].markerstyle != markerstyle::bar) {
+                if (this->pyramids.size() <= dsi) { this->pyramids.resize (dsi + 1); }
+                for (size_t i = coords_start; i < coords_end; ++i) {
+                    this->pyramids[dsi].push ((*this->graphDataCoords[dsi])[i][1]);
+                }
+                if (this->datastyles[dsi].showlines == true) {
+                    if (this->lines.size() <= dsi) { this->lines.resize (dsi + 1); }
+                    this->lines[dsi].active = true;
+                    this->lines[dsi].lod = true;
+                }
+                return;
+            }
+
             // Draw data markers
             if (this->datastyles[dsi].markerstyle != markerstyle::none) {
                 if (this->datastyles[dsi].markerstyle == markerstyle::bar) {
@@ -790,15 +918,22 @@ namespace morph {
                         this->bar ((*this->graphDataCoords[dsi])[i], this->datastyles[dsi]);
                     }
                 } else {
+                    if (this->markers.size() <= dsi) { this->markers.resize (dsi + 1); }
+                    std::vector<float>& inst = this->markers[dsi].instances;
                     for (size_t i = coords_start; i < coords_end; ++i) {
-                        if (this->within_axes ((*this->graphDataCoords[dsi])[i])) {
-                            this->marker ((*this->graphDataCoords[dsi])[i], this->datastyles[dsi]);
+                        morph::Vector<float>& p = (*this->graphDataCoords[dsi])[i];
+                        if (this->within_axes (p)) {
+                            inst.insert (inst.end(), {p[0], p[1], p[2] + this->thickness, 1.0f});
                         } // else marker is outside graph axes so don't draw it
                     }
                 }
             }
             if (this->datastyles[dsi].markerstyle == markerstyle::bar && this->datastyles[dsi].showlines == true) {
                 // No need to do anything, lines will have been drawn by GraphVisual::bar()
+            } else if (this->datastyles[dsi].showlines == true && this->shaderlines == true) {
+                // No vertices needed. renderLines() uploads the points that it hasn't already got.
+                if (this->lines.size() <= dsi) { this->lines.resize (dsi + 1); }
+                this->lines[dsi].active = true;
             } else if (this->datastyles[dsi].showlines == true) {
 
                 // If appending markers to a dataset, need to add the line preceding the first marker
@@ -879,6 +1014,19 @@ namespace morph {
         {
             size_t coords_start = 0;
             this->coords_lengths.resize (this->graphDataCoords.size());
+            // All the marker instances are regenerated, and the marker styles may have changed
+            for (auto& md : this->markers) {
+                md.instances.clear();
+                md.uploaded = 0;
+                md.stale = true;
+            }
+            for (auto& ld : this->lines) {
+                ld.active = false;
+                ld.lod = false;
+                ld.uploaded = 0;
+                ld.lodstate = {};
+            }
+            for (auto& pyr : this->pyramids) { pyr.clear(); }
             for (size_t dsi = 0; dsi < this->graphDataCoords.size(); ++dsi) {
                 size_t coords_end = this->graphDataCoords[dsi]->size();
                 // Record coords length for future appending:
@@ -887,6 +1035,557 @@ namespace morph {
             }
         }
 
+        /*
+         * Strip chart machinery. Each strip dataset owns a ring of transformed
+         * ordinates and a vertex buffer holding 2 * window line segments (4 vertices
+         * each). Sample n is written into segment slot k = n % window AND into slot
+         * k + window. Slot s is given the abscissa s * dx, so the most recent window
+         * samples always occupy a contiguous run of slots with monotonically increasing
+         * x, which can be drawn with one glDrawElements call, shifted left by the model
+         * matrix. Nothing ever has to be moved. A strip is a single colour and lies flat
+         * in the graph, so colour and normal are passed as constant vertex attributes
+         * rather than as arrays, which keeps long windows to a third of the memory.
+         */
+        struct stripdata
+        {
+            //! Index into graphDataCoords/datastyles
+            size_t didx = 0;
+            //! Number of samples shown
+            size_t window = 0;
+            //! Ring of transformed ordinates
+            std::vector<float> ys;
+            //! Total samples pushed
+            uint64_t count = 0;
+            //! Samples pushed since the vertex buffer was last updated
+            uint64_t pending = 0;
+            GLuint vao = 0;
+            GLuint posvbo = 0;
+            GLuint idxvbo = 0;
+            //! Scratch space for generating vertex positions on upload
+            std::vector<float> scratch;
+        };
+
+        //! Strip chart datasets
+        std::vector<stripdata> strips;
+        //! Index into strips for each data index, or -1
+        std::vector<int> strip_of;
+
+        stripdata& strip (const size_t didx)
+        {
+            if (didx >= this->strip_of.size() || this->strip_of[didx] < 0) {
+                throw std::runtime_error ("GraphVisual: data index is not a strip chart dataset (see prepstrip)");
+            }
+            return this->strips[this->strip_of[didx]];
+        }
+
+        //! The x distance between two samples of a strip chart
+        float stripdx (const stripdata& st) const
+        {
+            return static_cast<float>(this->abscissa_scale.range_max - this->abscissa_scale.range_min)
+            / static_cast<float>(st.window - 1);
+        }
+
+        //! Fill st.scratch with the vertex positions for segment slots [s0, s1) and upload them
+        void uploadStripSegments (stripdata& st, const size_t s0, const size_t s1)
+        {
+            if (s1 <= s0) { return; }
+            const size_t N = st.window;
+            const float dx = this->stripdx (st);
+            const float hw = 0.5f * this->datastyles[st.didx].linewidth;
+            st.scratch.resize ((s1 - s0) * 12);
+            float* p = st.scratch.data();
+            for (size_t s = s0; s < s1; ++s) {
+                size_t k = s % N;
+                float y1 = st.ys[k];
+                // The very first sample has no predecessor
+                float y0 = (st.count <= N && k == 0) ? y1 : st.ys[(k + N - 1) % N];
+                float x1 = static_cast<float>(s) * dx;
+                float x0 = x1 - dx;
+                // Unit vector along the segment, rotated by -90 degrees (as v.cross(uz)
+                // does in computeFlatLine) and scaled to half the line width
+                float vx = x1 - x0;
+                float vy = y1 - y0;
+                float len = std::sqrt (vx * vx + vy * vy);
+                float wx = vy / len * hw;
+                float wy = -vx / len * hw;
+                *p++ = x0 + wx; *p++ = y0 + wy; *p++ = 0.0f;
+                *p++ = x0 - wx; *p++ = y0 - wy; *p++ = 0.0f;
+                *p++ = x1 - wx; *p++ = y1 - wy; *p++ = 0.0f;
+                *p++ = x1 + wx; *p++ = y1 + wy; *p++ = 0.0f;
+            }
+            glBindBuffer (GL_ARRAY_BUFFER, st.posvbo);
+            glBufferSubData (GL_ARRAY_BUFFER, s0 * 12 * sizeof(float), st.scratch.size() * sizeof(float), st.scratch.data());
+        }
+
+        //! Upload the segments for the most recent st.pending samples (at most 4 small uploads)
+        void uploadStripPending (stripdata& st)
+        {
+            if (st.pending == 0 || st.count == 0) { return; }
+            MORPH_PROFILE_SCOPE ("GraphVisual::uploadStripPending");
+            const size_t N = st.window;
+            const size_t p = st.pending >= N ? N : static_cast<size_t>(st.pending);
+            const size_t h = (st.count - 1) % N;      // slot of the newest sample
+            const size_t k0 = (h + N + 1 - p) % N;    // slot of the oldest pending sample
+            if (p == N) {
+                this->uploadStripSegments (st, 0, 2 * N);
+            } else if (k0 <= h) {
+                this->uploadStripSegments (st, k0, h + 1);
+                this->uploadStripSegments (st, k0 + N, h + 1 + N);
+            } else {
+                // The pending samples wrap; [k0, h+N] is contiguous across the two copies
+                this->uploadStripSegments (st, k0, h + 1 + N);
+                this->uploadStripSegments (st, 0, h + 1);
+                this->uploadStripSegments (st, k0 + N, 2 * N);
+            }
+            st.pending = 0;
+        }
+
+        //! Create the OpenGL buffers for a strip dataset. Called once, from render(), with a context current.
+        void setupStripBuffers (stripdata& st)
+        {
+            const size_t nseg = 2 * st.window;
+            glGenVertexArrays (1, &st.vao);
+            glBindVertexArray (st.vao);
+            glGenBuffers (1, &st.idxvbo);
+            glGenBuffers (1, &st.posvbo);
+
+            // Indices never change: two triangles per segment
+            std::vector<VBOint> ind (nseg * 6);
+            for (size_t s = 0; s < nseg; ++s) {
+                VBOint v = static_cast<VBOint>(4 * s);
+                ind[6*s] = v;   ind[6*s+1] = v+1; ind[6*s+2] = v+2;
+                ind[6*s+3] = v; ind[6*s+4] = v+2; ind[6*s+5] = v+3;
+            }
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, st.idxvbo);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, ind.size() * sizeof(VBOint), ind.data(), GL_STATIC_DRAW);
+
+            // Normals and colours are constant attributes, set in renderStrips(). Positions
+            // are allocated once and then only ever updated with glBufferSubData
+            glBindBuffer (GL_ARRAY_BUFFER, st.posvbo);
+            glBufferData (GL_ARRAY_BUFFER, nseg * 12 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            glVertexAttribPointer (gl::posnLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (gl::posnLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+
+            // Anything pushed before the first render
+            if (st.count > 0) {
+                st.pending = st.count;
+                this->uploadStripPending (st);
+            }
+            glBindVertexArray (0);
+        }
+
+        void deleteStripBuffers (stripdata& st)
+        {
+            if (st.vao != 0) {
+                glDeleteBuffers (1, &st.posvbo);
+                glDeleteBuffers (1, &st.idxvbo);
+                glDeleteVertexArrays (1, &st.vao);
+                st.vao = 0;
+            }
+        }
+
+        //! Draw the visible window of each strip dataset
+        void renderStrips()
+        {
+            if (this->hide == true) { return; }
+
+            glUseProgram (this->shaderprog);
+
+            const morph::gl::UniformLocations& ul = this->uniforms();
+            if (ul.alpha != -1) { glUniform1f (ul.alpha, this->alpha); }
+            if (ul.v_matrix != -1) { glUniformMatrix4fv (ul.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+
+            for (auto& st : this->strips) {
+                if (st.vao == 0) { this->setupStripBuffers (st); }
+                glBindVertexArray (st.vao);
+                this->uploadStripPending (st);
+                if (st.count < 2) { continue; }
+
+                // The normal and colour arrays are disabled in st.vao, so these apply to every vertex
+                glVertexAttrib3f (gl::normLoc, this->uz[0], this->uz[1], this->uz[2]);
+                glVertexAttrib3fv (gl::colLoc, this->datastyles[st.didx].linecolour.data());
+
+                // Which segment slots are visible, and how far must they be scrolled?
+                const size_t N = st.window;
+                size_t first = 1;
+                size_t nseg = st.count - 1;
+                if (st.count > N) {
+                    first = (st.count - 1) % N + 2;
+                    nseg = N - 1;
+                }
+                const float dx = this->stripdx (st);
+                TransformMatrix<float> scroll;
+                scroll.translate (static_cast<float>(this->abscissa_scale.range_min) - static_cast<float>(first - 1) * dx,
+                                  0.0f, this->thickness);
+                if (ul.m_matrix != -1) {
+                    glUniformMatrix4fv (ul.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix * scroll).mat.data());
+                }
+                glDrawElements (GL_TRIANGLES, nseg * 6, VBO_ENUM_TYPE, (void*)(first * 6 * sizeof(VBOint)));
+            }
+            glBindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        /*
+         * Data markers. All the markers of a dataset have the same shape, size and
+         * colour, so each dataset has a single marker mesh, centred on the origin, which
+         * is drawn at every data point by one glDrawElementsInstanced call. The per-point
+         * data is just an offset (four floats, the last being the scale), so appending a
+         * point to a graph uploads 16 bytes rather than a whole polygon.
+         */
+        struct markerdata
+        {
+            //! Per instance offsets (x, y, z) and scale (1)
+            std::vector<float> instances;
+            //! Number of instances already in instvbo
+            size_t uploaded = 0;
+            //! Bytes allocated for instvbo
+            size_t capacity = 0;
+            //! True if the mesh must be regenerated from the dataset's style
+            bool stale = true;
+            VBOint nidx = 0;
+            GLuint vao = 0;
+            GLuint posvbo = 0;
+            GLuint idxvbo = 0;
+            GLuint instvbo = 0;
+        };
+
+        //! Marker meshes and instances, one per dataset (indexed as graphDataCoords)
+        std::vector<markerdata> markers;
+
+        //! The number of sides of a marker polygon and whether it has a flat top (rather than a vertex) pointing up
+        static void markerShape (const morph::markerstyle ms, int& sides, bool& flattop)
+        {
+            flattop = false;
+            switch (ms) {
+            case morph::markerstyle::triangle:
+            case morph::markerstyle::uptriangle: { sides = 3; break; }
+            case morph::markerstyle::downtriangle: { sides = 3; flattop = true; break; }
+            case morph::markerstyle::square: { sides = 4; flattop = true; break; }
+            case morph::markerstyle::diamond: { sides = 4; break; }
+            case morph::markerstyle::pentagon: { sides = 5; flattop = true; break; }
+            case morph::markerstyle::uppentagon: { sides = 5; break; }
+            case morph::markerstyle::hexagon: { sides = 6; flattop = true; break; }
+            case morph::markerstyle::uphexagon: { sides = 6; break; }
+            case morph::markerstyle::heptagon: { sides = 7; flattop = true; break; }
+            case morph::markerstyle::upheptagon: { sides = 7; break; }
+            case morph::markerstyle::octagon: { sides = 8; flattop = true; break; }
+            case morph::markerstyle::upoctagon: { sides = 8; break; }
+            case morph::markerstyle::circle:
+            default: { sides = 20; break; }
+            }
+        }
+
+        //! The marker mesh of dataset dsi: the same triangle fan as computeFlatPoly, about the origin
+        void markerMesh (const size_t dsi, std::vector<float>& pos, std::vector<VBOint>& ind) const
+        {
+            int n = 20;
+            bool flattop = false;
+            markerShape (this->datastyles[dsi].markerstyle, n, flattop);
+            const float r = this->datastyles[dsi].markersize * 0.5f;
+            const float rotation = flattop ? morph::PI_F / static_cast<float>(n) : 0.0f;
+            pos = {0.0f, 0.0f, 0.0f};
+            ind.clear();
+            for (int j = 0; j < n; ++j) {
+                float t = rotation + j * morph::TWO_PI_F / static_cast<float>(n);
+                pos.insert (pos.end(), {std::sin (t) * r, std::cos (t) * r, 0.0f});
+                ind.insert (ind.end(), {VBOint{0}, static_cast<VBOint>(1 + j), static_cast<VBOint>(1 + (j + 1) % n)});
+            }
+        }
+
+        //! For Visual::savegltf(), add a copy of the marker mesh at each data marker
+        void gltf_append (std::vector<VBOint>& idx, std::vector<float>& posn,
+                          std::vector<float>& col, std::vector<float>& norm) override
+        {
+            std::vector<float> mpos;
+            std::vector<VBOint> mind;
+            for (size_t dsi = 0; dsi < this->markers.size(); ++dsi) {
+                const std::vector<float>& inst = this->markers[dsi].instances;
+                if (inst.empty()) { continue; }
+                this->markerMesh (dsi, mpos, mind);
+                const std::array<float, 3>& clr = this->datastyles[dsi].markercolour;
+                for (size_t k = 0; k < inst.size(); k += 4) {
+                    const VBOint base = static_cast<VBOint>(posn.size() / 3);
+                    for (auto i : mind) { idx.push_back (base + i); }
+                    for (size_t j = 0; j < mpos.size(); j += 3) {
+                        posn.insert (posn.end(), {mpos[j] * inst[k+3] + inst[k], mpos[j+1] * inst[k+3] + inst[k+1],
+                                                  mpos[j+2] * inst[k+3] + inst[k+2]});
+                        col.insert (col.end(), clr.begin(), clr.end());
+                        norm.insert (norm.end(), {this->uz[0], this->uz[1], this->uz[2]});
+                    }
+                }
+            }
+            for (const linedata& ld : this->lines) {
+                if (ld.active) {
+                    std::cout << "GraphVisual: lines drawn with shaderlines aren't exported to gltf\n";
+                    break;
+                }
+            }
+        }
+
+        //! (Re)create the marker mesh of dataset dsi. Called from render(), with a context current.
+        void setupMarkerBuffers (const size_t dsi)
+        {
+            markerdata& md = this->markers[dsi];
+            if (md.vao == 0) {
+                glGenVertexArrays (1, &md.vao);
+                glBindVertexArray (md.vao);
+                glGenBuffers (1, &md.posvbo);
+                glGenBuffers (1, &md.idxvbo);
+                glGenBuffers (1, &md.instvbo);
+            }
+            glBindVertexArray (md.vao);
+
+            std::vector<float> pos;
+            std::vector<VBOint> ind;
+            this->markerMesh (dsi, pos, ind);
+            md.nidx = static_cast<VBOint>(ind.size());
+
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, md.idxvbo);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, ind.size() * sizeof(VBOint), ind.data(), GL_STATIC_DRAW);
+            glBindBuffer (GL_ARRAY_BUFFER, md.posvbo);
+            glBufferData (GL_ARRAY_BUFFER, pos.size() * sizeof(float), pos.data(), GL_STATIC_DRAW);
+            glVertexAttribPointer (gl::posnLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (gl::posnLoc);
+
+            // Normals and colours are constant attributes, set in renderMarkers()
+            glBindBuffer (GL_ARRAY_BUFFER, md.instvbo);
+            glVertexAttribPointer (gl::instLoc, 4, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glVertexAttribDivisor (gl::instLoc, 1);
+            glEnableVertexAttribArray (gl::instLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            md.stale = false;
+        }
+
+        //! Upload any instances added since the last call. md's vertex array must be bound.
+        void uploadMarkerInstances (markerdata& md)
+        {
+            if (md.uploaded == md.instances.size()) { return; }
+            const size_t bytes = md.instances.size() * sizeof(float);
+            glBindBuffer (GL_ARRAY_BUFFER, md.instvbo);
+            if (bytes > md.capacity) {
+                // Grow geometrically, as appended graphs keep on growing
+                md.capacity = std::max (bytes, 2 * md.capacity);
+                glBufferData (GL_ARRAY_BUFFER, md.capacity, nullptr, GL_DYNAMIC_DRAW);
+                md.uploaded = 0;
+            }
+            glBufferSubData (GL_ARRAY_BUFFER, md.uploaded * sizeof(float),
+                             bytes - md.uploaded * sizeof(float), md.instances.data() + md.uploaded);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            md.uploaded = md.instances.size();
+        }
+
+        void deleteMarkerBuffers (markerdata& md)
+        {
+            if (md.vao != 0) {
+                glDeleteBuffers (1, &md.posvbo);
+                glDeleteBuffers (1, &md.idxvbo);
+                glDeleteBuffers (1, &md.instvbo);
+                glDeleteVertexArrays (1, &md.vao);
+                md.vao = 0;
+            }
+        }
+
+        //! Draw the markers of each dataset
+        void renderMarkers()
+        {
+            if (this->hide == true) { return; }
+
+            glUseProgram (this->shaderprog);
+
+            const morph::gl::UniformLocations& ul = this->uniforms();
+            if (ul.alpha != -1) { glUniform1f (ul.alpha, this->alpha); }
+            if (ul.v_matrix != -1) { glUniformMatrix4fv (ul.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            if (ul.m_matrix != -1) {
+                glUniformMatrix4fv (ul.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+            }
+
+            for (size_t dsi = 0; dsi < this->markers.size(); ++dsi) {
+                markerdata& md = this->markers[dsi];
+                if (md.instances.empty()) { continue; }
+                if (md.vao == 0 || md.stale) { this->setupMarkerBuffers (dsi); }
+                glBindVertexArray (md.vao);
+                this->uploadMarkerInstances (md);
+
+                // The normal and colour arrays are disabled in md.vao, so these apply to every vertex
+                glVertexAttrib3f (gl::normLoc, this->uz[0], this->uz[1], this->uz[2]);
+                glVertexAttrib3fv (gl::colLoc, this->datastyles[dsi].markercolour.data());
+                glDrawElementsInstanced (GL_TRIANGLES, md.nidx, VBO_ENUM_TYPE, 0, md.instances.size() / 4);
+            }
+            glBindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        /*
+         * Lines drawn by the line shader program (VisLine.vert.glsl), if shaderlines is
+         * set. The vertex buffer holds just the data points (the first and last
+         * repeated at either end), bound to the shader's four point attributes at
+         * successive offsets. Each segment is then an instance of a four vertex triangle
+         * strip, which the shader widens and joins to its neighbours.
+         */
+        struct linedata
+        {
+            //! True if the dataset's lines are drawn by the line shader
+            bool active = false;
+            //! True if the dataset is drawn decimated (see GraphVisual::lod)
+            bool lod = false;
+            //! The points of the decimated dataset, and the visible range, level and
+            //! dataset size from which they were made
+            std::vector<Vector<float>> lodpts;
+            std::array<size_t, 4> lodstate = {};
+            //! Number of the dataset's points already in vbo
+            size_t uploaded = 0;
+            //! Number of points (slots) allocated for vbo, including the two end slots
+            size_t capacity = 0;
+            GLuint vao = 0;
+            GLuint vbo = 0;
+            //! Scratch space for assembling an upload
+            std::vector<float> scratch;
+        };
+
+        //! Shader line buffers, one per dataset (indexed as graphDataCoords)
+        std::vector<linedata> lines;
+
+        //! Create the buffers for one dataset's shader lines. Called from render(), with a context current.
+        void setupLineBuffers (linedata& ld)
+        {
+            glGenVertexArrays (1, &ld.vao);
+            glBindVertexArray (ld.vao);
+            glGenBuffers (1, &ld.vbo);
+            glBindBuffer (GL_ARRAY_BUFFER, ld.vbo);
+            // Attributes 0 to 3 are the points before, at the start of, at the end of and after a segment
+            for (GLuint k = 0; k < 4; ++k) {
+                glVertexAttribPointer (k, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(k * 3 * sizeof(float)));
+                glVertexAttribDivisor (k, 1);
+                glEnableVertexAttribArray (k);
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! Upload the points of \a pts that were appended since the last call, as one glBufferSubData. ld.vao must be bound.
+        void uploadLinePoints (linedata& ld, const std::vector<Vector<float>>& pts)
+        {
+            const size_t n = pts.size();
+            if (ld.uploaded == n) { return; }
+            glBindBuffer (GL_ARRAY_BUFFER, ld.vbo);
+            // Slot s holds point s-1. Rewrite from the old end slot onwards.
+            size_t first = (ld.uploaded == 0 || ld.uploaded > n) ? 0 : ld.uploaded + 1;
+            if (n + 2 > ld.capacity) {
+                ld.capacity = std::max (n + 2, 2 * ld.capacity);
+                glBufferData (GL_ARRAY_BUFFER, ld.capacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+                first = 0;
+            }
+            ld.scratch.resize ((n + 2 - first) * 3);
+            float* p = ld.scratch.data();
+            for (size_t s = first; s < n + 2; ++s) {
+                const Vector<float>& pt = pts[s == 0 ? 0 : std::min (s - 1, n - 1)];
+                *p++ = pt[0]; *p++ = pt[1]; *p++ = pt[2];
+            }
+            glBufferSubData (GL_ARRAY_BUFFER, first * 3 * sizeof(float), ld.scratch.size() * sizeof(float), ld.scratch.data());
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            ld.uploaded = n;
+        }
+
+        void deleteLineBuffers (linedata& ld)
+        {
+            if (ld.vao != 0) {
+                glDeleteBuffers (1, &ld.vbo);
+                glDeleteVertexArrays (1, &ld.vao);
+                ld.vao = 0;
+            }
+        }
+
+        //! Min/max pyramids of the (transformed) ordinates of each dataset, if lod is set
+        std::vector<morph::MinMaxPyramid<float>> pyramids;
+        //! Scratch space for decimateLine
+        std::vector<size_t> lodidx;
+
+        //! The width of the axes on the screen in pixels, or 0 if the projection isn't known
+        float axesPixels() const
+        {
+            if (this->viewport[0] == 0) { return 0.0f; }
+            TransformMatrix<float> pvm = this->projection * this->scenematrix * this->model_scaling * this->viewmatrix;
+            Vector<float, 4> a = pvm * Vector<float>({0.0f, 0.0f, 0.0f});
+            Vector<float, 4> b = pvm * Vector<float>({this->width, 0.0f, 0.0f});
+            if (a[3] == 0.0f || b[3] == 0.0f) { return 0.0f; }
+            return 0.5f * std::abs (b[0] / b[3] - a[0] / a[3]) * static_cast<float>(this->viewport[0]);
+        }
+
+        /*!
+         * Choose the pyramid level for the visible part of dataset dsi at the current
+         * size of the graph on screen and, if that or the data has changed since last
+         * time, refill ld.lodpts. Returns true if ld.lodpts changed. Requires the
+         * abscissae to be increasing.
+         */
+        bool decimateLine (const size_t dsi, linedata& ld)
+        {
+            const std::vector<Vector<float>>& gdc = *this->graphDataCoords[dsi];
+            const morph::MinMaxPyramid<float>& pyr = this->pyramids[dsi];
+            const size_t n = pyr.size();
+            size_t i0 = 0;
+            size_t i1 = n;
+            if (this->draw_beyond_axes == false) {
+                // Only the points within the axes, plus one either side to reach the edges
+                auto xless = [](const Vector<float>& p, const float x) { return p[0] < x; };
+                i0 = std::lower_bound (gdc.begin(), gdc.begin() + n, 0.0f, xless) - gdc.begin();
+                i1 = std::lower_bound (gdc.begin() + i0, gdc.begin() + n, this->width, xless) - gdc.begin();
+                if (i0 > 0) { --i0; }
+                if (i1 < n) { ++i1; }
+            }
+            const float px = this->axesPixels();
+            const size_t buckets = px >= 1.0f ? static_cast<size_t>(px) : this->lod_buckets;
+            std::array<size_t, 4> state = { i0, i1, pyr.levelFor (i1 - i0, buckets), n };
+            if (state == ld.lodstate) { return false; }
+            ld.lodstate = state;
+            pyr.decimate (i0, i1, buckets, this->lodidx);
+            ld.lodpts.resize (this->lodidx.size());
+            for (size_t j = 0; j < this->lodidx.size(); ++j) { ld.lodpts[j] = gdc[this->lodidx[j]]; }
+            return true;
+        }
+
+        //! Draw the shader lines of each dataset, one instanced call apiece
+        void renderLines()
+        {
+            if (this->hide == true) { return; }
+
+            GLFWwindow* ctx = glfwGetCurrentContext();
+            GLuint lprog = morph::VisualResources::i()->getLineProgram (ctx);
+            const morph::gl::UniformLocations& ul = morph::VisualResources::i()->getUniformLocations (lprog, ctx);
+            glUseProgram (lprog);
+            if (ul.alpha != -1) { glUniform1f (ul.alpha, this->alpha); }
+            if (ul.v_matrix != -1) { glUniformMatrix4fv (ul.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            if (ul.m_matrix != -1) {
+                glUniformMatrix4fv (ul.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+            }
+            if (ul.axes_clip != -1) {
+                glUniform3f (ul.axes_clip, this->width, this->height, this->draw_beyond_axes ? 0.0f : 1.0f);
+            }
+            // In front of the axes, as far forward as the mesh lines reached, so as not to z-fight with the plot
+            if (ul.line_z != -1) { glUniform1f (ul.line_z, this->thickness * 0.7f); }
+
+            for (size_t dsi = 0; dsi < this->lines.size(); ++dsi) {
+                linedata& ld = this->lines[dsi];
+                if (ld.active == false) { continue; }
+                if (ld.lod == true && this->decimateLine (dsi, ld) == true) { ld.uploaded = 0; }
+                const std::vector<Vector<float>>& pts = ld.lod ? ld.lodpts : *this->graphDataCoords[dsi];
+                if (pts.size() < 2) { continue; }
+                if (ld.vao == 0) { this->setupLineBuffers (ld); }
+                glBindVertexArray (ld.vao);
+                this->uploadLinePoints (ld, pts);
+
+                const DatasetStyle& ds = this->datastyles[dsi];
+                if (ul.line_colour != -1) { glUniform3fv (ul.line_colour, 1, ds.linecolour.data()); }
+                if (ul.line_width != -1) { glUniform1f (ul.line_width, ds.linewidth); }
+                if (ul.line_gap != -1) { glUniform1f (ul.line_gap, ds.markergap); }
+                glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, pts.size() - 1);
+            }
+            glBindVertexArray (0);
+            // Leave the regular program in use, as it was
+            glUseProgram (this->shaderprog);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
         //! Draw the graph legend, above the graph, rather than inside it (so much simpler!)
         void drawLegend()
         {
@@ -1308,74 +2007,13 @@ namespace morph {
         //! Generate vertices for a marker of the given style at location p
         void marker (morph::Vector<float>& p, const morph::DatasetStyle& style)
         {
-            switch (style.markerstyle) {
-            case morph::markerstyle::triangle:
-            case morph::markerstyle::uptriangle:
-            {
-                this->polygonMarker (p, 3, style);
-                break;
-            }
-            case morph::markerstyle::downtriangle:
-            {
-                this->polygonFlattop (p, 3, style);
-                break;
-            }
-            case morph::markerstyle::square:
-            {
-                this->polygonFlattop (p, 4, style);
-                break;
-            }
-            case morph::markerstyle::diamond:
-            {
-                this->polygonMarker (p, 4, style);
-                break;
-            }
-            case morph::markerstyle::pentagon:
-            {
-                this->polygonFlattop (p, 5, style);
-                break;
-            }
-            case morph::markerstyle::uppentagon:
-            {
-                this->polygonMarker (p, 5, style);
-                break;
-            }
-            case morph::markerstyle::hexagon:
-            {
-                this->polygonFlattop (p, 6, style);
-                break;
-            }
-            case morph::markerstyle::uphexagon:
-            {
-                this->polygonMarker (p, 6, style);
-                break;
-            }
-            case morph::markerstyle::heptagon:
-            {
-                this->polygonFlattop (p, 7, style);
-                break;
-            }
-            case morph::markerstyle::upheptagon:
-            {
-                this->polygonMarker (p, 7, style);
-                break;
-            }
-            case morph::markerstyle::octagon:
-            {
-                this->polygonFlattop (p, 8, style);
-                break;
-            }
-            case morph::markerstyle::upoctagon:
-            {
-                this->polygonMarker (p, 8, style);
-                break;
-            }
-            case morph::markerstyle::circle:
-            default:
-            {
-                this->polygonMarker (p, 20, style);
-                break;
-            }
+            int n = 20;
+            bool flattop = false;
+            markerShape (style.markerstyle, n, flattop);
+            if (flattop) {
+                this->polygonFlattop (p, n, style);
+            } else {
+                this->polygonMarker (p, n, style);
             }
         }
 
@@ -1535,6 +2173,25 @@ namespace morph {
         // might need tickfontsize and axisfontsize
         //! If this is true, then draw data lines even where they extend beyond the axes.
         bool draw_beyond_axes = false;
+        /*!
+         * If true, data lines are not built from triangles on the CPU. Instead, the raw
+         * data points are uploaded and the line shader widens and joins them, which
+         * takes about a tenth of the memory and makes appending a point a single small
+         * upload. Set before finalize() (or call reinit() after changing it).
+         */
+        bool shaderlines = false;
+        /*!
+         * If true, datasets (other than bar charts) are drawn at a level of detail to suit
+         * the screen: each dataset's ordinates go into a min/max pyramid (built up as data
+         * is appended) and, at render time, the visible range is drawn with the min and max
+         * of about one bucket of samples per pixel of the axes' width, using the line shader.
+         * Peaks are kept, and the number of vertices is bounded by the width of the graph,
+         * however long the dataset. The abscissae must be increasing. Markers are not drawn
+         * for these datasets. Set before finalize() (or call reinit() after changing it).
+         */
+        bool lod = false;
+        //! The number of buckets to use for lod datasets if the graph's size on screen isn't known
+        size_t lod_buckets = 2000;
         //! EITHER Gap from the y axis to the right hand of the y axis tick label text
         //! quads OR from the x axis to the top of the x axis tick label text quads
         float ticklabelgap = 0.05;
@@ -1573,6 +2230,11 @@ namespace morph {
         //! Temporary storage for the max width of the ytick labels
         float ytick_label_width = 0.0f;
         float ytick_label_width2 = 0.0f;
+
+        //! Scratch space for the scaled ordinates and abscissae in update() and setdata(),
+        //! kept so that an update doesn't allocate
+        std::vector<Flt> sd;
+        std::vector<Flt> ad;
     };
 
 } // namespace morph
@@ -279,6 +279,19 @@ namespace morph {
          */
         ReadErrorAction read_error_action = ReadErrorAction::Info;
 
+        //! Return true if there is a group or dataset at \a path in the file. Every group
+        //! on the way to it is checked in turn, so a missing parent just gives false.
+        bool exists (const std::string& path) const
+        {
+            std::vector<std::string> pbits = morph::Tools::stringToVector (path, "/");
+            std::string p("");
+            for (unsigned int i = 1; i < pbits.size(); ++i) {
+                p += "/" + pbits[i];
+                if (H5Lexists (this->file_id, p.c_str(), H5P_DEFAULT) <= 0) { return false; }
+            }
+            return !p.empty();
+        }
+
         /*!
          * Templated version of read_contained_vals, for vector/list/deque (but not map,
          * which is more complex) and whatever simple value (int, double, float, etc) is
@@ -10,6 +10,9 @@
 #include <morph/BezCoord.h>
 #include <morph/MathConst.h>
 #include <morph/HdfData.h>
+#include <morph/KdTree.h>
+#include <morph/LatticeConvolution.h>
+#include <morph/Vector.h>
 
 #include <set>
 #include <list>
@@ -36,6 +39,29 @@ namespace morph {
         Boundary // The shape of the arbitrary boundary set with HexGrid::setBoundary
     };
 
+    /*!
+     * How HexGrid::save() lays out hexen in the file. The layout is written to
+     * /hexen_layout, which HexGrid::load() reads to know how to read hexen back. Files
+     * written before /hexen_layout was added have a group per Hex.
+     */
+    enum class HexenLayout : unsigned int {
+        GroupPerHex = 1,       // /hexen/0/vi, /hexen/0/x, ... /hexen/1/vi, ... as read by every version
+        DatasetPerAttribute = 2 // /hexen/vi, /hexen/x, ... each holding the attribute of every Hex
+    };
+
+    /*!
+     * Where a HexGrid keeps its hexes. With List, hexen is the grid and the d_ vectors
+     * are filled from it once a boundary or domain has been set. With Arrays, the d_
+     * vectors are the grid from construction on: the hexes are made, bounded and
+     * measured in them, with no list at all, which is much faster for large grids.
+     * hexen is then empty until HexGrid::populate_hexen() makes it from the d_ vectors.
+     * Arrays supports the Boundary and Hexagon domain shapes.
+     */
+    enum class HexStorage {
+        List,
+        Arrays
+    };
+
     /*!
      * This class is used to build an hexagonal grid of hexagons. The member hexagons
      * are all arranged with a vertex pointing vertically - "point up". The extent of
@@ -54,6 +80,11 @@ namespace morph {
      * may be used to index into external data structures (arrays or vectors) which
      * contain information about the 2D surface represented by the HexGrid which is to
      * be computed.
+     *
+     * Constructed with HexStorage::Arrays, the grid lives only in the d_ vectors, with
+     * each hex's index in them as its vi and di. The code that works from the d_
+     * vectors (HexGridVisual, RD_Base and the like) is unchanged, but code that walks
+     * hexen or holds its iterators must first call populate_hexen().
      */
     class alignas(8) HexGrid
     {
@@ -208,13 +239,18 @@ namespace morph {
             this->d_gi.clear();
             this->d_bi.clear();
             this->d_flags.clear();
+            this->d_distToBoundary.clear();
         }
 
         /*!
          * Save this HexGrid (and all the Hexes in it) into the HDF5 file at the
          * location @path.
+         *
+         * hexen is saved with one dataset per Hex attribute, unless \a layout is
+         * HexenLayout::GroupPerHex, which writes the group per Hex that builds from
+         * before HexenLayout can read (but which is much slower to write and read).
          */
-        void save (const std::string& path)
+        void save (const std::string& path, HexenLayout layout = HexenLayout::DatasetPerAttribute)
         {
             morph::HdfData hgdata (path);
             hgdata.add_val ("/d", d);
@@ -256,15 +292,24 @@ namespace morph {
             hgdata.add_contained_vals ("/d_flags", d_flags);
 
             // list<Hex> hexen
-            // for i in list, save Hex
-            std::list<morph::Hex>::const_iterator h = this->hexen.begin();
-            unsigned int hcount = 0;
-            while (h != this->hexen.end()) {
-                // Make up a path
-                std::string h5path = "/hexen/" + std::to_string(hcount);
-                h->save (hgdata, h5path);
-                ++h;
-                ++hcount;
+            unsigned int hcount = this->hexen.size();
+            hgdata.add_val ("/hexen_layout", static_cast<unsigned int>(layout));
+            if (this->storage == HexStorage::Arrays) {
+                // hexen is written as the Hexes that populate_hexen() would make
+                hcount = this->d_x.size();
+                if (layout == HexenLayout::GroupPerHex) {
+                    for (unsigned int i = 0; i < hcount; ++i) { this->hexFromArrays (i).save (hgdata, "/hexen/" + std::to_string(i)); }
+                } else if (hcount > 0) {
+                    this->saveHexenDatasetsFromArrays (hgdata);
+                }
+                hgdata.add_val ("/hcount", hcount);
+                return;
+            }
+            if (layout == HexenLayout::GroupPerHex) {
+                unsigned int i = 0;
+                for (const morph::Hex& h : this->hexen) { h.save (hgdata, "/hexen/" + std::to_string(i++)); }
+            } else if (hcount > 0) {
+                this->saveHexenDatasets (hgdata);
             }
             hgdata.add_val ("/hcount", hcount);
 
@@ -276,10 +321,12 @@ namespace morph {
         }
 
         /*!
-         * Populate this HexGrid from the HDF5 file at the location @path.
+         * Populate this HexGrid from the HDF5 file at the location @path. The loaded
+         * grid has HexStorage::List.
          */
         void load (const std::string& path)
         {
+            this->storage = HexStorage::List;
             morph::HdfData hgdata (path, true);
             hgdata.read_val ("/d", this->d);
             hgdata.read_val ("/v", this->v);
@@ -311,118 +358,52 @@ namespace morph {
 
             unsigned int hcount = 0;
             hgdata.read_val ("/hcount", hcount);
-            for (unsigned int i = 0; i < hcount; ++i) {
-                std::string h5path = "/hexen/" + std::to_string(i);
-                morph::Hex h (hgdata, h5path);
-                this->hexen.push_back (h);
+            // Files from before /hexen_layout have a group per Hex. A few written while the
+            // datasets were new have them but no /hexen_layout.
+            unsigned int layout = static_cast<unsigned int>(HexenLayout::GroupPerHex);
+            if (hgdata.exists ("/hexen_layout")) {
+                hgdata.read_val ("/hexen_layout", layout);
+            } else if (hgdata.exists ("/hexen/vi")) {
+                layout = static_cast<unsigned int>(HexenLayout::DatasetPerAttribute);
+            }
+            if (layout == static_cast<unsigned int>(HexenLayout::DatasetPerAttribute)) {
+                if (hcount > 0) { this->loadHexenDatasets (hgdata, hcount); }
+            } else if (layout == static_cast<unsigned int>(HexenLayout::GroupPerHex)) {
+                for (unsigned int i = 0; i < hcount; ++i) {
+                    std::string h5path = "/hexen/" + std::to_string(i);
+                    morph::Hex h (hgdata, h5path);
+                    this->hexen.push_back (h);
+                }
+            } else {
+                std::stringstream ee;
+                ee << "HexGrid::load: " << path << " has hexen in an unknown layout (" << layout << ")";
+                throw std::runtime_error (ee.str());
             }
 
             // After creating hexen list, need to set neighbour relations in each Hex, as loaded in d_ne,
-            // etc.
+            // etc. Look up each neighbour's Hex by its vector index.
+            std::vector<std::list<morph::Hex>::iterator> byvi;
+            for (auto hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                if (hi->vi >= byvi.size()) { byvi.resize (hi->vi + 1, this->hexen.end()); }
+                byvi[hi->vi] = hi;
+            }
+            auto hexWithVi = [this, &byvi](const int neighb_vi, const char* relation) {
+                if (neighb_vi < 0 || static_cast<size_t>(neighb_vi) >= byvi.size()
+                    || byvi[neighb_vi] == this->hexen.end()) {
+                    std::stringstream ee;
+                    ee << "Failed to match hexen neighbour " << relation << " relation...";
+                    throw std::runtime_error (ee.str());
+                }
+                return byvi[neighb_vi];
+            };
             for (morph::Hex& _h : this->hexen) {
                 DBG ("Set neighbours for Hex " << _h.outputRG());
-                // For each Hex, six loops through hexen:
-                if (_h.has_ne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_ne[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.ne = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour E relation...");
-                    }
-                }
-
-                if (_h.has_nne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nne[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nne = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour NE relation...");
-                    }
-                }
-
-                if (_h.has_nnw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nnw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nnw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour NW relation...");
-                    }
-                }
-
-                if (_h.has_nw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour W relation...");
-                    }
-                }
-
-                if (_h.has_nsw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nsw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nsw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour SW relation...");
-                    }
-                }
-
-                if (_h.has_nse() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nse[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nse = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour SE relation...");
-                    }
-                }
+                if (_h.has_ne() == true) { _h.ne = hexWithVi (this->d_ne[_h.vi], "E"); }
+                if (_h.has_nne() == true) { _h.nne = hexWithVi (this->d_nne[_h.vi], "NE"); }
+                if (_h.has_nnw() == true) { _h.nnw = hexWithVi (this->d_nnw[_h.vi], "NW"); }
+                if (_h.has_nw() == true) { _h.nw = hexWithVi (this->d_nw[_h.vi], "W"); }
+                if (_h.has_nsw() == true) { _h.nsw = hexWithVi (this->d_nsw[_h.vi], "SW"); }
+                if (_h.has_nse() == true) { _h.nse = hexWithVi (this->d_nse[_h.vi], "SE"); }
             }
         }
 
@@ -440,16 +421,23 @@ namespace morph {
          * Construct the hexagonal hex grid with a hex to hex distance of @a d_
          * (centre to centre) and approximate diameter of @a x_span_. Set z to @a z_
          * which may be useful as an identifier if several HexGrids are being managed
-         * by client code, but is not otherwise made use of.
+         * by client code, but is not otherwise made use of. \a storage_ chooses where
+         * the hexes are kept (see HexStorage).
          */
         HexGrid (float d_, float x_span_, float z_ = 0.0f,
-                 HexDomainShape shape = HexDomainShape::Boundary)
+                 HexDomainShape shape = HexDomainShape::Boundary,
+                 HexStorage storage_ = HexStorage::List)
         {
             this->d = d_;
             this->v = this->d * SQRT_OF_3_OVER_2_F;
             this->x_span = x_span_;
             this->z = z_;
             this->domainShape = shape;
+            this->storage = storage_;
+            if (this->storage == HexStorage::Arrays
+                && shape != HexDomainShape::Boundary && shape != HexDomainShape::Hexagon) {
+                throw std::runtime_error ("HexStorage::Arrays supports the Boundary and Hexagon domain shapes only.");
+            }
             this->init();
         }
 
@@ -476,7 +464,7 @@ namespace morph {
             std::pair<float, float> centroid;
             centroid.first = 0;
             centroid.second = 0;
-            for (auto h : pHexes) {
+            for (const auto& h : pHexes) {
                 centroid.first += h.x;
                 centroid.second += h.y;
             }
@@ -487,22 +475,39 @@ namespace morph {
 
         /*!
          * Find the Hex in the Hex grid which is closest to the x,y position given by
-         * pos.
+         * pos. Where several are equally close, the first in hexen is returned; if pos
+         * is not finite (or there are no hexes), hexen.end() is.
+         *
+         * The position is converted to the (ri, gi) of the nearest point on the hex
+         * lattice, which is looked up in a table; only if that hex isn't in the grid
+         * (because pos is outside it) is the search made with a k-d tree. The table is
+         * built on the first call after hexen changes size, the tree when it is first needed.
          */
         std::list<Hex>::iterator findHexNearest (const std::pair<float, float>& pos)
         {
-            std::list<morph::Hex>::iterator nearest = this->hexen.end();
-            std::list<morph::Hex>::iterator hi = this->hexen.begin();
-            float dist = std::numeric_limits<float>::max();
-            while (hi != this->hexen.end()) {
-                float dx = pos.first - hi->x;
-                float dy = pos.second - hi->y;
-                float dl = std::sqrt (dx*dx + dy*dy);
-                if (dl < dist) {
-                    dist = dl;
-                    nearest = hi;
-                }
-                ++hi;
+            this->requireHexen ("findHexNearest");
+            this->buildNearestIndex();
+            int k = this->nearestHex (pos);
+            if (k == -2) {
+                this->buildNearestTree();
+                k = static_cast<int>(this->nearest_tree.nearest ({ pos.first, pos.second }));
+            }
+            return k < 0 ? this->hexen.end() : this->nearest_its[k];
+        }
+
+        //! findHexNearest() for each of \a positions, found in parallel
+        std::vector<std::list<Hex>::iterator> findHexesNearest (const std::vector<std::pair<float, float>>& positions)
+        {
+            this->requireHexen ("findHexesNearest");
+            this->buildNearestIndex();
+            this->buildNearestTree();
+            std::vector<std::list<Hex>::iterator> nearest (positions.size());
+            const int n = static_cast<int>(positions.size());
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i) {
+                int k = this->nearestHex (positions[i]);
+                if (k == -2) { k = static_cast<int>(this->nearest_tree.nearest ({ positions[i].first, positions[i].second })); }
+                nearest[i] = k < 0 ? this->hexen.end() : this->nearest_its[k];
             }
             return nearest;
         }
@@ -516,20 +521,34 @@ namespace morph {
         {
             this->boundaryCentroid = this->computeCentroid (pHexes);
 
+            // NB: The assumption right now is that the pHexes are from the same dimension hex grid
+            // as this->hexen.
+            std::set<std::pair<int, int>> prg;
+            for (const morph::Hex& ph : pHexes) { prg.insert (std::make_pair (ph.ri, ph.gi)); }
+
+            if (this->storage == HexStorage::Arrays) {
+                this->bstart = 0;
+                for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                    if (prg.count (std::make_pair (this->d_ri[i], this->d_gi[i])) > 0) {
+                        this->d_flags[i] |= (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
+                        this->bstart = i;
+                    }
+                }
+                if (this->domainShape != morph::HexDomainShape::Boundary) {
+                    throw std::runtime_error ("For now, setBoundary (const list<Hex>& pHexes) doesn't know what to "
+                                              "do if domain shape is not HexDomainShape::Boundary.");
+                }
+                this->discardOutsideBoundaryArrays();
+                return;
+            }
+
             std::list<morph::Hex>::iterator bpoint = this->hexen.begin();
             std::list<morph::Hex>::iterator bpi = this->hexen.begin();
             while (bpi != this->hexen.end()) {
-                std::list<morph::Hex>::const_iterator ppi = pHexes.begin();
-                while (ppi != pHexes.end()) {
-                    // NB: The assumption right now is that the pHexes are from the same dimension hex grid
-                    // as this->hexen.
-                    if (bpi->ri == ppi->ri && bpi->gi == ppi->gi) {
-                        // Set h as boundary hex.
-                        bpi->setFlag (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
-                        bpoint = bpi;
-                        break;
-                    }
-                    ++ppi;
+                if (prg.count (std::make_pair (bpi->ri, bpi->gi)) > 0) {
+                    // Set h as boundary hex.
+                    bpi->setFlag (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
+                    bpoint = bpi;
                 }
                 ++bpi;
             }
@@ -618,6 +637,11 @@ namespace morph {
                 bpi = bpoints.begin();
             }
 
+            if (this->storage == HexStorage::Arrays) {
+                this->setBoundaryArrays (bpoints);
+                return;
+            }
+
             // now proceed with centroid changed or unchanged
             std::list<morph::Hex>::iterator nearbyBoundaryPoint = this->hexen.begin(); // i.e the Hex at 0,0
             bpi = bpoints.begin();
@@ -659,6 +683,9 @@ namespace morph {
          */
         void setBoundaryOnly (std::vector<BezCoord<float>>& bpoints, bool loffset)
         {
+            if (this->storage == HexStorage::Arrays) {
+                throw std::runtime_error ("HexGrid::setBoundaryOnly works on hexen, so isn't available with HexStorage::Arrays.");
+            }
             this->boundaryCentroid = morph::BezCurvePath<float>::getCentroid (bpoints);
 
             auto bpi = bpoints.begin();
@@ -705,6 +732,10 @@ namespace morph {
          */
         void setBoundaryOnOuterEdge()
         {
+            if (this->storage == HexStorage::Arrays) {
+                this->setBoundaryOnOuterEdgeArrays();
+                return;
+            }
             // From centre head to boundary, then mark boundary and walk
             // around the edge.
             std::list<morph::Hex>::iterator bpi = this->hexen.begin();
@@ -918,29 +949,76 @@ namespace morph {
          */
         void leaveAsHexagon()
         {
+            if (this->storage == HexStorage::Arrays) {
+                this->setDomainArrays();
+                return;
+            }
             this->renumberVectorIndices();
             this->setDomain();
         }
 
+        //! Where this HexGrid keeps its hexes
+        HexStorage getStorage() const { return this->storage; }
+
+        /*!
+         * With HexStorage::Arrays, make hexen (and vhexen and bhexen) from the d_
+         * vectors, for code that walks the Hexes or holds iterators to them. The Hexes
+         * are a copy: changes made to them don't reach the d_ vectors, and hexen is
+         * emptied again by anything that changes the grid. Does nothing with
+         * HexStorage::List, where hexen is the grid.
+         */
+        void populate_hexen()
+        {
+            if (this->storage != HexStorage::Arrays) { return; }
+            this->clearHexen();
+            const unsigned int n = this->d_x.size();
+            std::vector<std::list<morph::Hex>::iterator> its (n);
+            for (unsigned int i = 0; i < n; ++i) {
+                this->hexen.push_back (this->hexFromArrays (i));
+                its[i] = std::prev (this->hexen.end());
+            }
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->d_ne[i] >= 0) { its[i]->set_ne (its[this->d_ne[i]]); }
+                if (this->d_nne[i] >= 0) { its[i]->set_nne (its[this->d_nne[i]]); }
+                if (this->d_nnw[i] >= 0) { its[i]->set_nnw (its[this->d_nnw[i]]); }
+                if (this->d_nw[i] >= 0) { its[i]->set_nw (its[this->d_nw[i]]); }
+                if (this->d_nsw[i] >= 0) { its[i]->set_nsw (its[this->d_nsw[i]]); }
+                if (this->d_nse[i] >= 0) { its[i]->set_nse (its[this->d_nse[i]]); }
+            }
+            this->renumberVectorIndices();
+            // bhexen is walked from the same boundary hex as it would be with HexStorage::List
+            if (this->bstart >= 0) {
+                std::set<unsigned int> seen;
+                this->boundaryContiguous (its[this->bstart], its[this->bstart], seen);
+            }
+        }
+
         /*!
          * \brief Accessor for the size of hexen.
          *
          * return The number of hexes in the grid.
          */
-        unsigned int num() const { return this->hexen.size(); }
+        unsigned int num() const
+        {
+            return this->storage == HexStorage::Arrays ? this->d_x.size() : this->hexen.size();
+        }
 
         /*!
          * \brief Obtain the vector index of the last Hex in hexen.
          *
          * return Hex::vi from the last Hex in the grid.
          */
-        unsigned int lastVectorIndex() const { return this->hexen.rbegin()->vi; }
+        unsigned int lastVectorIndex() const
+        {
+            return this->storage == HexStorage::Arrays ? this->d_x.size() - 1 : this->hexen.rbegin()->vi;
+        }
 
         /*!
          * Output some text information about the hexgrid.
          */
         std::string output() const
         {
+            this->requireHexen ("output");
             std::stringstream ss;
             ss << "Hex grid with " << this->hexen.size() << " hexes.\n";
             auto i = this->hexen.begin();
@@ -1044,7 +1122,15 @@ namespace morph {
             float xmin = 0.0f;
             float x_ = 0.0f;
             bool first = true;
-            for (auto h : this->hexen) {
+            if (this->storage == HexStorage::Arrays) {
+                for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                    x_ = this->d_x[i] * std::cos (phi) + this->d_y[i] * std::sin (phi);
+                    if (first || x_ < xmin) { xmin = x_; }
+                    first = false;
+                }
+                return xmin;
+            }
+            for (const auto& h : this->hexen) {
                 x_ = h.x * std::cos (phi) + h.y * std::sin (phi);
                 if (first) {
                     xmin = x_;
@@ -1066,7 +1152,15 @@ namespace morph {
             float xmax = 0.0f;
             float x_ = 0.0f;
             bool first = true;
-            for (auto h : this->hexen) {
+            if (this->storage == HexStorage::Arrays) {
+                for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                    x_ = this->d_x[i] * std::cos (phi) + this->d_y[i] * std::sin (phi);
+                    if (first || x_ > xmax) { xmax = x_; }
+                    first = false;
+                }
+                return xmax;
+            }
+            for (const auto& h : this->hexen) {
                 x_ = h.x * std::cos (phi) + h.y * std::sin (phi);
                 if (first) {
                     xmax = x_;
@@ -1085,29 +1179,43 @@ namespace morph {
          */
         void computeDistanceToBoundary()
         {
-            std::list<morph::Hex>::iterator h = this->hexen.begin();
-            while (h != this->hexen.end()) {
-                if (h->testFlags(HEX_IS_BOUNDARY) == true) {
-                    h->distToBoundary = 0.0f;
+            if (this->storage == HexStorage::Arrays) {
+                this->computeDistanceToBoundaryArrays();
+                return;
+            }
+            // The boundary hexes' positions, contiguous, and the hexes inside the boundary
+            std::vector<float> bx, by;
+            std::vector<morph::Hex*> inside;
+            for (morph::Hex& h : this->hexen) {
+                if (h.testFlags(HEX_IS_BOUNDARY) == true) {
+                    h.distToBoundary = 0.0f;
+                    bx.push_back (h.x);
+                    by.push_back (h.y);
+                } else if (h.testFlags(HEX_INSIDE_BOUNDARY) == false) {
+                    // Set to a dummy, negative value
+                    h.distToBoundary = -100.0;
                 } else {
-                    if (h->testFlags(HEX_INSIDE_BOUNDARY) == false) {
-                        // Set to a dummy, negative value
-                        h->distToBoundary = -100.0;
-                    } else {
-                        // Not a boundary hex, but inside boundary
-                        std::list<morph::Hex>::iterator bh = this->hexen.begin();
-                        while (bh != this->hexen.end()) {
-                            if (bh->testFlags(HEX_IS_BOUNDARY) == true) {
-                                float delta = h->distanceFrom (*bh);
-                                if (delta < h->distToBoundary || h->distToBoundary < 0.0f) {
-                                    h->distToBoundary = delta;
-                                }
-                            }
-                            ++bh;
-                        }
-                    }
+                    inside.push_back (&h);
+                }
+            }
+
+            // Not a boundary hex, but inside boundary. Compare squared distances, which
+            // have the same order as the distances.
+            const int n_inside = static_cast<int>(inside.size());
+            const size_t n_bnd = bx.size();
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n_inside; ++i) {
+                morph::Hex* h = inside[i];
+                float d2min = std::numeric_limits<float>::max();
+                for (size_t j = 0; j < n_bnd; ++j) {
+                    float dx = bx[j] - h->x;
+                    float dy = by[j] - h->y;
+                    d2min = std::min (d2min, dx*dx + dy*dy);
+                }
+                if (n_bnd > 0) {
+                    float delta = std::sqrt (d2min);
+                    if (delta < h->distToBoundary || h->distToBoundary < 0.0f) { h->distToBoundary = delta; }
                 }
-                ++h;
             }
         }
 
@@ -1117,6 +1225,8 @@ namespace morph {
          */
         void populate_d_vectors()
         {
+            // With HexStorage::Arrays, the d_ vectors are the grid, so there's nothing to populate
+            if (this->storage == HexStorage::Arrays) { return; }
             std::array<int, 6> extnts = this->findBoundaryExtents();
             this->populate_d_vectors (extnts);
         }
@@ -1126,6 +1236,7 @@ namespace morph {
          */
         void populate_d_vectors (const std::array<int, 6>& extnts)
         {
+            if (this->storage == HexStorage::Arrays) { return; }
             // First, find the starting hex. For Rectangular and parallelogram domains,
             // that's the bottom left hex.
             std::list<morph::Hex>::iterator hi = this->hexen.begin();
@@ -1265,6 +1376,7 @@ namespace morph {
         std::vector<std::list<Hex>::iterator> getRegion (std::vector<BezCoord<float>>& bpoints, std::pair<float, float>& regionCentroid,
                                                          bool applyOriginalBoundaryCentroid = true)
         {
+            this->requireHexen ("getRegion");
             // First clear all region boundary flags, as we'll be defining a new region boundary
             this->clearRegionBoundaryFlags();
 
@@ -1335,6 +1447,20 @@ namespace morph {
          * Using this HexGrid as the domain, convolve the domain data \a data with the
          * kernel data \a kerneldata, which exists on another HexGrid, \a
          * kernelgrid. Return the result in \a result.
+         *
+         * Each result is the sum, over the kernel hexes, of the kernel value times the
+         * datum of the hex offset from the result's hex by the kernel hex's (ri, gi);
+         * hexes outside the boundary contribute nothing. The offsets are worked out
+         * (see morph::LatticeConvolution) on the first call, and again only when the
+         * lattice coordinates of this grid's or the kernel grid's hexes differ from the
+         * last call's, so repeated convolutions only gather and sum, in parallel. For
+         * large kernels, the sum is made with an FFT, which agrees to within rounding
+         * error.
+         *
+         * The offsets are kept in this HexGrid, so convolve() must not be called on one
+         * HexGrid from more than one thread at once. To convolve from several threads,
+         * get a morph::LatticeConvolution from convolution() and call its (const)
+         * convolve() instead.
          */
         template<typename T>
         void convolve (const HexGrid& kernelgrid, const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result)
@@ -1352,78 +1478,42 @@ namespace morph {
                 throw std::runtime_error ("Pass in separate memory for the result.");
             }
 
-            // For each hex in this HexGrid, compute the convolution kernel
-            std::list<Hex>::iterator hi = this->hexen.begin();
-            for (; hi != this->hexen.end(); ++hi) {
-                T sum = T{0};
-                // For each kernel hex, sum up.
-                for (auto kh : kernelgrid.hexen) {
-                    std::list<Hex>::iterator dhi = hi;
-                    // Kernel hex coords r,g are: kh.ri, kh.gi, which may be (are EXPECTED to be) +ve or -ve
-                    //
-                    // Origin hex coords are h.ri, h.gi
-                    //
-                    // To get the hex whose data we want to multiply with kh's value,
-                    // can go via neighbour relations, but must be prepared to take a
-                    // variable path because going directly in r direction then directly
-                    // in g direction could take us temporarily outside the boundary of
-                    // the HexGrid.
-                    int rr = kh.ri;
-                    int gg = kh.gi;
-                    bool failed = false;
-                    bool finished = false;
-                    //while (gg != 0 && rr != 0) {
-                    while (!finished) {
-                        bool moved = false;
-                        // Try to move in r direction
-                        if (rr > 0) {
-                            if (dhi->has_ne()) {
-                                dhi = dhi->ne;
-                                --rr;
-                                moved = true;
-                            } // Didn't move in +r direction
-                        } else if (rr < 0) {
-                            if (dhi->has_nw()) {
-                                dhi = dhi->nw;
-                                ++rr;
-                                moved = true;
-                            } // Didn't move in -r direction
-                        }
-                        // Try to move in g direction
-                        if (gg > 0) {
-                            if (dhi->has_nne()) {
-                                dhi = dhi->nne;
-                                --gg;
-                                moved = true;
-                            } // Didn't move in +g direction
-                        } else if (gg < 0) {
-                            if (dhi->has_nsw()) {
-                                dhi = dhi->nsw;
-                                ++gg;
-                                moved = true;
-                            } // Didn't move in -g direction
-                        }
-
-                        if (rr == 0 && gg == 0) {
-                            finished = true;
-                            break;
-                        }
-
-                        if (!moved) {
-                            // We're stuck; Can't move in r or g direction, so can't add a contribution
-                            failed = true;
-                            break;
-                        }
-                    }
-
-                    if (!failed) {
-                        // Can do the sum
-                        sum +=  data[dhi->vi] * kerneldata[kh.vi];
-                    }
-                }
+            // Set up the convolution again unless both grids' hexes are where they were
+            // last time. They are compared in full, not by the kernel grid's address,
+            // which a new grid may reuse once the old one has gone.
+            std::vector<std::array<int, 2>> dcoords, kcoords;
+            std::vector<unsigned int> dindex, kindex;
+            this->latticeLayout (dcoords, dindex);
+            kernelgrid.latticeLayout (kcoords, kindex);
+            if (dcoords != this->conv_dcoords || dindex != this->conv_dindex
+                || kcoords != this->conv_kcoords || kindex != this->conv_kindex) {
+                this->conv.init (dcoords, dindex, kcoords, kindex);
+                this->conv_dcoords.swap (dcoords);
+                this->conv_dindex.swap (dindex);
+                this->conv_kcoords.swap (kcoords);
+                this->conv_kindex.swap (kindex);
+            }
+            this->conv.convolve (kerneldata, data, result);
+        }
 
-                result[hi->vi] = sum;
+        /*!
+         * The convolution of data on this HexGrid with kernel data on \a kernelgrid,
+         * as carried out by convolve(), for the caller to keep. Its convolve() is const,
+         * so it may be called from any number of threads at once. It holds no reference
+         * to either grid, but must be made again if the hexes of either change.
+         */
+        morph::LatticeConvolution convolution (const HexGrid& kernelgrid) const
+        {
+            if (kernelgrid.getd() != this->d) {
+                throw std::runtime_error ("The kernel HexGrid must have same d as this HexGrid to carry out convolution.");
             }
+            std::vector<std::array<int, 2>> dcoords, kcoords;
+            std::vector<unsigned int> dindex, kindex;
+            this->latticeLayout (dcoords, dindex);
+            kernelgrid.latticeLayout (kcoords, kindex);
+            morph::LatticeConvolution c;
+            c.init (dcoords, dindex, kcoords, kindex);
+            return c;
         }
 
         /*!
@@ -1522,6 +1612,10 @@ namespace morph {
          */
         void init()
         {
+            if (this->storage == HexStorage::Arrays) {
+                this->initArrays();
+                return;
+            }
             // Use span_x to determine how many rings out to traverse.
             float halfX = this->x_span/2.0f;
             unsigned int maxRing = std::abs(std::ceil(halfX/this->d));
@@ -1886,6 +1980,370 @@ namespace morph {
             DBG ("Finished creating " << this->hexen.size() << " hexes in " << maxRing << " rings.");
         }
 
+        /*
+         * HexStorage::Arrays counterparts of the list code. The d_ vectors hold the hexes in
+         * the order that hexen would, with each hex's index in them as its vi and di, and the
+         * d_ne and friends as its neighbours (-1 for none).
+         */
+
+        //! init() for HexStorage::Arrays: the same spiral of hexes, made in the d_ vectors
+        void initArrays()
+        {
+            this->clearHexen();
+            this->d_clear();
+            this->d_ne.clear();
+            this->d_nne.clear();
+            this->d_nnw.clear();
+            this->d_nw.clear();
+            this->d_nsw.clear();
+            this->d_nse.clear();
+
+            float halfX = this->x_span/2.0f;
+            const int maxRing = std::abs(std::ceil(halfX/this->d));
+            const size_t n = 1 + 3 * static_cast<size_t>(maxRing) * (maxRing + 1);
+            this->d_ri.reserve (n);
+            this->d_gi.reserve (n);
+
+            // Walk the rings just as init() does, r, -b, -g, -r, b then g
+            int ri = 0;
+            int gi = 0;
+            this->d_ri.push_back (ri);
+            this->d_gi.push_back (gi);
+            const std::array<std::array<int, 2>, 6> walks = {{ {{1, 0}}, {{1, -1}}, {{0, -1}}, {{-1, 0}}, {{-1, 1}}, {{0, 1}} }};
+            for (int ring = 1; ring <= maxRing; ++ring) {
+                --ri; ++gi;
+                for (const auto& w : walks) {
+                    for (int i = 0; i < ring; ++i) {
+                        this->d_ri.push_back (ri);
+                        this->d_gi.push_back (gi);
+                        ri += w[0];
+                        gi += w[1];
+                    }
+                }
+            }
+
+            // Positions, as Hex::computeLocation() works them out (bi is 0)
+            this->d_x.resize (n);
+            this->d_y.resize (n);
+            this->d_bi.assign (n, 0);
+            this->d_flags.assign (n, 0);
+            this->d_distToBoundary.assign (n, -1.0f);
+            const float hd = this->d;
+            const float hv = (hd * morph::SQRT_OF_3_F) / 2.0f;
+            const int ni = static_cast<int>(n);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < ni; ++i) {
+                this->d_x[i] = hd * this->d_ri[i] + (hd/2.0f) * this->d_gi[i];
+                this->d_y[i] = hv * this->d_gi[i];
+            }
+
+            // Neighbours, looked up by (ri, gi) in a table covering the hexagon
+            const int w = 2 * maxRing + 1;
+            std::vector<int> table (static_cast<size_t>(w) * w, -1);
+            for (int i = 0; i < ni; ++i) { table[(this->d_gi[i] + maxRing) * w + this->d_ri[i] + maxRing] = i; }
+            auto at = [&table, maxRing, w](const int r, const int g) {
+                return (r < -maxRing || r > maxRing || g < -maxRing || g > maxRing) ? -1 : table[(g + maxRing) * w + r + maxRing];
+            };
+            for (unsigned short dir = 0; dir < 6; ++dir) { this->d_nbr (dir).assign (n, -1); }
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < ni; ++i) {
+                const int r = this->d_ri[i];
+                const int g = this->d_gi[i];
+                const std::array<int, 6> nb = {{ at (r+1, g), at (r, g+1), at (r-1, g+1), at (r-1, g), at (r, g-1), at (r+1, g-1) }};
+                unsigned int flg = 0;
+                for (unsigned short dir = 0; dir < 6; ++dir) {
+                    this->d_nbr (dir)[i] = nb[dir];
+                    if (nb[dir] >= 0) { flg |= (HEX_HAS_NE << dir); }
+                }
+                this->d_flags[i] = flg;
+            }
+
+            this->bstart = -1;
+            // There are no vertexE (etc) iterators to keep valid
+            this->gridReduced = true;
+            DBG ("Finished creating " << n << " hexes in " << maxRing << " rings.");
+        }
+
+        //! setBoundary (bpoints) for HexStorage::Arrays, once bpoints have been offset
+        void setBoundaryArrays (const std::vector<BezCoord<float>>& bpoints)
+        {
+            if (this->d_x.empty()) { throw std::runtime_error ("HexGrid::setBoundary: there are no hexes."); }
+            int nearby = 0; // i.e the hex at 0,0
+            for (const auto& bp : bpoints) {
+                nearby = this->findHexNearPointArrays (bp, nearby);
+                this->d_flags[nearby] |= (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
+            }
+            this->bstart = nearby;
+            if (this->domainShape == morph::HexDomainShape::Boundary) {
+                this->discardOutsideBoundaryArrays();
+            } else {
+                this->setDomainArrays();
+            }
+        }
+
+        //! setBoundaryOnOuterEdge() for HexStorage::Arrays: the same walk around the edge
+        void setBoundaryOnOuterEdgeArrays()
+        {
+            constexpr unsigned int bflags = HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY;
+            int bpi = 0;
+            while (this->d_nne[bpi] >= 0) { bpi = this->d_nne[bpi]; }
+            this->d_flags[bpi] |= bflags;
+            for (unsigned short dir : { HEX_NEIGHBOUR_POS_E, HEX_NEIGHBOUR_POS_SE, HEX_NEIGHBOUR_POS_SW,
+                                        HEX_NEIGHBOUR_POS_W, HEX_NEIGHBOUR_POS_NW, HEX_NEIGHBOUR_POS_NE }) {
+                while (this->d_nbr (dir)[bpi] >= 0) {
+                    bpi = this->d_nbr (dir)[bpi];
+                    this->d_flags[bpi] |= bflags;
+                }
+            }
+            while (this->d_ne[bpi] >= 0 && (this->d_flags[this->d_ne[bpi]] & HEX_IS_BOUNDARY) == 0) {
+                bpi = this->d_ne[bpi];
+                this->d_flags[bpi] |= bflags;
+            }
+            this->bstart = bpi;
+            if (this->domainShape != morph::HexDomainShape::Boundary) {
+                throw std::runtime_error ("For now, setBoundary (const list<Hex>& pHexes) doesn't know what to do if domain shape is not HexDomainShape::Boundary.");
+            }
+            this->discardOutsideBoundaryArrays();
+        }
+
+        //! findHexNearPoint() for HexStorage::Arrays, from and returning indices into the d_ vectors
+        int findHexNearPointArrays (const BezCoord<float>& point, int startFrom) const
+        {
+            auto dist = [this, &point](const int i) {
+                float dx = point.x() - this->d_x[i];
+                float dy = point.y() - this->d_y[i];
+                return std::sqrt (dx*dx + dy*dy);
+            };
+            int h = startFrom;
+            float dh = dist (h);
+            bool neighbourNearer = true;
+            while (neighbourNearer == true) {
+                neighbourNearer = false;
+                // As findHexNearPoint(), move to the first neighbour (E, NE, NW, W, SW, SE) that is nearer
+                for (unsigned short dir = 0; dir < 6; ++dir) {
+                    const int k = this->d_nbr (dir)[h];
+                    float dk = 0.0f;
+                    if (k >= 0 && (dk = dist (k)) < dh) {
+                        dh = dk;
+                        h = k;
+                        neighbourNearer = true;
+                        break;
+                    }
+                }
+            }
+            return h;
+        }
+
+        //! The index of the hex nearest to \a pos (the first, of several as near)
+        int nearestIndexArrays (const std::pair<float, float>& pos) const
+        {
+            int nearest = -1;
+            float d2min = std::numeric_limits<float>::max();
+            for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                float dx = pos.first - this->d_x[i];
+                float dy = pos.second - this->d_y[i];
+                float d2 = dx*dx + dy*dy;
+                if (d2 < d2min) {
+                    d2min = d2;
+                    nearest = static_cast<int>(i);
+                }
+            }
+            return nearest;
+        }
+
+        /*!
+         * markHexesInside() for HexStorage::Arrays. Every hex that can be reached from
+         * the hex \a start without crossing a boundary hex is marked as inside the
+         * boundary. As the boundary is a closed chain of neighbouring hexes, that is every
+         * hex within it.
+         */
+        void markHexesInsideArrays (const int start)
+        {
+            if (start < 0 || (this->d_flags[start] & HEX_IS_BOUNDARY)) { return; }
+            std::vector<char> seen (this->d_x.size(), 0);
+            std::vector<int> todo (1, start);
+            seen[start] = 1;
+            while (!todo.empty()) {
+                const int i = todo.back();
+                todo.pop_back();
+                this->d_flags[i] |= HEX_INSIDE_BOUNDARY;
+                for (unsigned short dir = 0; dir < 6; ++dir) {
+                    const int k = this->d_nbr (dir)[i];
+                    if (k >= 0 && !seen[k] && (this->d_flags[k] & HEX_IS_BOUNDARY) == 0) {
+                        seen[k] = 1;
+                        todo.push_back (k);
+                    }
+                }
+            }
+        }
+
+        //! discardOutsideBoundary() for HexStorage::Arrays: keep the hexes inside the boundary, in order
+        void discardOutsideBoundaryArrays()
+        {
+            this->markHexesInsideArrays (this->nearestIndexArrays (this->boundaryCentroid));
+
+            // Where each kept hex goes, and -1 for those discarded
+            const unsigned int n = this->d_x.size();
+            std::vector<int> newidx (n, -1);
+            int m = 0;
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->d_flags[i] & HEX_INSIDE_BOUNDARY) { newidx[i] = m++; }
+            }
+            auto compact = [&newidx, n, m](auto& vec) {
+                for (unsigned int i = 0; i < n; ++i) {
+                    if (newidx[i] >= 0) { vec[newidx[i]] = vec[i]; }
+                }
+                vec.resize (m);
+            };
+            compact (this->d_x);
+            compact (this->d_y);
+            compact (this->d_ri);
+            compact (this->d_gi);
+            compact (this->d_bi);
+            compact (this->d_flags);
+            compact (this->d_distToBoundary);
+            for (unsigned short dir = 0; dir < 6; ++dir) { compact (this->d_nbr (dir)); }
+
+            // Point the neighbours at their new places, disconnecting any that were discarded
+#pragma omp parallel for schedule(static)
+            for (int j = 0; j < m; ++j) {
+                for (unsigned short dir = 0; dir < 6; ++dir) {
+                    int& k = this->d_nbr (dir)[j];
+                    if (k < 0) { continue; }
+                    k = newidx[k];
+                    if (k < 0) { this->d_flags[j] &= ~(HEX_HAS_NE << dir); }
+                }
+            }
+            this->bstart = this->bstart >= 0 ? newidx[this->bstart] : -1;
+            this->clearHexen();
+            this->gridReduced = true;
+        }
+
+        //! setDomain() for HexStorage::Arrays, which has only the Hexagon domain, so keeps every hex
+        void setDomainArrays()
+        {
+            if (this->domainShape != morph::HexDomainShape::Hexagon) {
+                throw std::runtime_error ("Unknown HexDomainShape");
+            }
+            std::array<int, 6> extnts = this->findBoundaryExtents();
+            this->d_rowlen = extnts[1]-extnts[0]+1;
+            this->d_numrows = extnts[3]-extnts[2]+1;
+            this->d_size = this->d_rowlen * this->d_numrows;
+            for (auto& f : this->d_flags) { f |= HEX_INSIDE_DOMAIN; }
+            this->markHexesInsideArrays (this->nearestIndexArrays (this->boundaryCentroid));
+            this->computeDistanceToBoundaryArrays();
+            this->clearHexen();
+            this->gridReduced = true;
+        }
+
+        //! computeDistanceToBoundary() for HexStorage::Arrays
+        void computeDistanceToBoundaryArrays()
+        {
+            std::vector<float> bx, by;
+            std::vector<int> inside;
+            for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                if (this->d_flags[i] & HEX_IS_BOUNDARY) {
+                    this->d_distToBoundary[i] = 0.0f;
+                    bx.push_back (this->d_x[i]);
+                    by.push_back (this->d_y[i]);
+                } else if ((this->d_flags[i] & HEX_INSIDE_BOUNDARY) == 0) {
+                    this->d_distToBoundary[i] = -100.0;
+                } else {
+                    inside.push_back (i);
+                }
+            }
+            const int n_inside = static_cast<int>(inside.size());
+            const size_t n_bnd = bx.size();
+#pragma omp parallel for schedule(static)
+            for (int ii = 0; ii < n_inside; ++ii) {
+                const int i = inside[ii];
+                float d2min = std::numeric_limits<float>::max();
+                for (size_t j = 0; j < n_bnd; ++j) {
+                    float dx = bx[j] - this->d_x[i];
+                    float dy = by[j] - this->d_y[i];
+                    d2min = std::min (d2min, dx*dx + dy*dy);
+                }
+                if (n_bnd > 0) {
+                    float delta = std::sqrt (d2min);
+                    float& dtb = this->d_distToBoundary[i];
+                    if (delta < dtb || dtb < 0.0f) { dtb = delta; }
+                }
+            }
+            this->clearHexen();
+        }
+
+        //! The d_ neighbour vector for direction \a dir (HEX_NEIGHBOUR_POS_E to HEX_NEIGHBOUR_POS_SE)
+        std::vector<int>& d_nbr (const unsigned short dir)
+        {
+            std::array<std::vector<int>*, 6> nbrs = {{ &this->d_ne, &this->d_nne, &this->d_nnw, &this->d_nw, &this->d_nsw, &this->d_nse }};
+            return *nbrs[dir];
+        }
+        const std::vector<int>& d_nbr (const unsigned short dir) const
+        {
+            std::array<const std::vector<int>*, 6> nbrs = {{ &this->d_ne, &this->d_nne, &this->d_nnw, &this->d_nw, &this->d_nsw, &this->d_nse }};
+            return *nbrs[dir];
+        }
+
+        //! The Hex at index \a i of the d_ vectors, without its neighbour iterators
+        morph::Hex hexFromArrays (const unsigned int i) const
+        {
+            morph::Hex h (i, this->d, this->d_ri[i], this->d_gi[i]);
+            h.bi = this->d_bi[i];
+            h.di = i;
+            h.x = this->d_x[i];
+            h.y = this->d_y[i];
+            h.distToBoundary = this->d_distToBoundary[i];
+            h.setFlags (this->d_flags[i]);
+            return h;
+        }
+
+        //! saveHexenDatasets() for HexStorage::Arrays, writing the Hexes populate_hexen() would make
+        void saveHexenDatasetsFromArrays (morph::HdfData& hgdata) const
+        {
+            const unsigned int n = this->d_x.size();
+            std::vector<unsigned int> h_vi (n), h_flags (n);
+            std::vector<float> h_z (n), h_r (n), h_phi (n), h_d (n, this->d);
+            for (unsigned int i = 0; i < n; ++i) {
+                morph::Hex h = this->hexFromArrays (i);
+                h_vi[i] = i;
+                h_z[i] = h.z;
+                h_r[i] = h.r;
+                h_phi[i] = h.phi;
+                h_flags[i] = h.getFlags();
+            }
+            hgdata.add_contained_vals ("/hexen/vi", h_vi);
+            hgdata.add_contained_vals ("/hexen/di", h_vi);
+            hgdata.add_contained_vals ("/hexen/x", this->d_x);
+            hgdata.add_contained_vals ("/hexen/y", this->d_y);
+            hgdata.add_contained_vals ("/hexen/z", h_z);
+            hgdata.add_contained_vals ("/hexen/r", h_r);
+            hgdata.add_contained_vals ("/hexen/phi", h_phi);
+            hgdata.add_contained_vals ("/hexen/d", h_d);
+            hgdata.add_contained_vals ("/hexen/ri", this->d_ri);
+            hgdata.add_contained_vals ("/hexen/gi", this->d_gi);
+            hgdata.add_contained_vals ("/hexen/bi", this->d_bi);
+            hgdata.add_contained_vals ("/hexen/distToBoundary", this->d_distToBoundary);
+            hgdata.add_contained_vals ("/hexen/flags", h_flags);
+        }
+
+        //! Empty hexen, vhexen and bhexen, which HexStorage::Arrays makes only on demand
+        void clearHexen()
+        {
+            this->hexen.clear();
+            this->vhexen.clear();
+            this->bhexen.clear();
+        }
+
+        //! With HexStorage::Arrays, throw unless populate_hexen() has made the hexen that \a fn works on
+        void requireHexen (const char* fn) const
+        {
+            if (this->storage == HexStorage::Arrays && this->hexen.empty() && !this->d_x.empty()) {
+                std::stringstream ee;
+                ee << "HexGrid::" << fn << " works on hexen. With HexStorage::Arrays, call populate_hexen() first.";
+                throw std::runtime_error (ee.str());
+            }
+        }
+
         /*!
          * Starting from \a startFrom, and following nearest-neighbour relations, find
          * the closest Hex in hexen to the coordinate point \a point, and set its
@@ -2555,13 +3013,38 @@ namespace morph {
 
             // Check to see if there are any boundary hexes at all.
             unsigned int bhcount = 0;
-            for (auto h : this->hexen) { bhcount += h.testFlags(HEX_IS_BOUNDARY) == true ? 1 : 0; }
+            if (this->storage == HexStorage::Arrays) {
+                for (auto f : this->d_flags) { bhcount += (f & HEX_IS_BOUNDARY) ? 1 : 0; }
+            } else {
+                for (const auto& h : this->hexen) { bhcount += h.testFlags(HEX_IS_BOUNDARY) == true ? 1 : 0; }
+            }
             if (bhcount == 0) { return rtn; }
 
             // Find the furthest left and right hexes and the further up and down hexes.
             std::array<float, 4> limits = {{0,0,0,0}};
             bool first = true;
-            for (auto h : this->hexen) {
+            if (this->storage == HexStorage::Arrays) {
+                for (unsigned int i = 0; i < this->d_x.size(); ++i) {
+                    if ((this->d_flags[i] & HEX_IS_BOUNDARY) == 0) { continue; }
+                    const float x = this->d_x[i];
+                    const float y = this->d_y[i];
+                    if (first) {
+                        limits = {{x, x, y, y}};
+                        first = false;
+                    }
+                    if (x < limits[0]) {
+                        limits[0] = x;
+                        rtn[4] = this->d_gi[i];
+                    }
+                    if (x > limits[1]) {
+                        limits[1] = x;
+                        rtn[5] = this->d_gi[i];
+                    }
+                    if (y < limits[2]) { limits[2] = y; }
+                    if (y > limits[3]) { limits[3] = y; }
+                }
+            }
+            for (const auto& h : this->hexen) {
                 if (h.testFlags(HEX_IS_BOUNDARY) == true) {
                     if (first) {
                         limits = {{h.x, h.x, h.y, h.y}};
@@ -2587,8 +3070,9 @@ namespace morph {
             // Now compute the ri and gi values that these xmax/xmin/ymax/ymin correspond to. THIS, if
             // nothing else, should auto-vectorise!  d_ri is the distance moved in ri direction per x, d_gi
             // is distance
-            float d_ri = this->hexen.front().getD();
-            float d_gi = this->hexen.front().getV();
+            // (Hex::getD() and Hex::getV() of any hex)
+            float d_ri = this->d;
+            float d_gi = (this->d * morph::SQRT_OF_3_F) / 2.0f;
             rtn[0] = (int)(limits[0] / d_ri);
             rtn[1] = (int)(limits[1] / d_ri);
             rtn[2] = (int)(limits[2] / d_gi);
@@ -2702,6 +3186,241 @@ namespace morph {
          */
         bool gridReduced = false;
 
+        //! Whether the hexes live in hexen or only in the d_ vectors
+        HexStorage storage = HexStorage::List;
+
+        /*!
+         * With HexStorage::Arrays, the index in the d_ vectors of the boundary hex from
+         * which populate_hexen() walks the boundary into bhexen. -1 if there's no boundary.
+         */
+        int bstart = -1;
+
+        //! Write hexen to \a hgdata as HexenLayout::DatasetPerAttribute, in hexen order
+        void saveHexenDatasets (morph::HdfData& hgdata) const
+        {
+            std::vector<unsigned int> h_vi, h_di, h_flags;
+            std::vector<float> h_x, h_y, h_z, h_r, h_phi, h_d, h_distToBoundary;
+            std::vector<int> h_ri, h_gi, h_bi;
+            for (const morph::Hex& h : this->hexen) {
+                h_vi.push_back (h.vi);
+                h_di.push_back (h.di);
+                h_x.push_back (h.x);
+                h_y.push_back (h.y);
+                h_z.push_back (h.z);
+                h_r.push_back (h.r);
+                h_phi.push_back (h.phi);
+                h_d.push_back (h.d);
+                h_ri.push_back (h.ri);
+                h_gi.push_back (h.gi);
+                h_bi.push_back (h.bi);
+                h_distToBoundary.push_back (h.distToBoundary);
+                h_flags.push_back (h.getFlags());
+            }
+            hgdata.add_contained_vals ("/hexen/vi", h_vi);
+            hgdata.add_contained_vals ("/hexen/di", h_di);
+            hgdata.add_contained_vals ("/hexen/x", h_x);
+            hgdata.add_contained_vals ("/hexen/y", h_y);
+            hgdata.add_contained_vals ("/hexen/z", h_z);
+            hgdata.add_contained_vals ("/hexen/r", h_r);
+            hgdata.add_contained_vals ("/hexen/phi", h_phi);
+            hgdata.add_contained_vals ("/hexen/d", h_d);
+            hgdata.add_contained_vals ("/hexen/ri", h_ri);
+            hgdata.add_contained_vals ("/hexen/gi", h_gi);
+            hgdata.add_contained_vals ("/hexen/bi", h_bi);
+            hgdata.add_contained_vals ("/hexen/distToBoundary", h_distToBoundary);
+            hgdata.add_contained_vals ("/hexen/flags", h_flags);
+        }
+
+        //! Append the \a hcount hexes saved in \a hgdata as HexenLayout::DatasetPerAttribute to hexen
+        void loadHexenDatasets (morph::HdfData& hgdata, const unsigned int hcount)
+        {
+            std::vector<unsigned int> h_vi, h_di, h_flags;
+            std::vector<float> h_x, h_y, h_z, h_r, h_phi, h_d, h_distToBoundary;
+            std::vector<int> h_ri, h_gi, h_bi;
+            hgdata.read_contained_vals ("/hexen/vi", h_vi);
+            hgdata.read_contained_vals ("/hexen/di", h_di);
+            hgdata.read_contained_vals ("/hexen/x", h_x);
+            hgdata.read_contained_vals ("/hexen/y", h_y);
+            hgdata.read_contained_vals ("/hexen/z", h_z);
+            hgdata.read_contained_vals ("/hexen/r", h_r);
+            hgdata.read_contained_vals ("/hexen/phi", h_phi);
+            hgdata.read_contained_vals ("/hexen/d", h_d);
+            hgdata.read_contained_vals ("/hexen/ri", h_ri);
+            hgdata.read_contained_vals ("/hexen/gi", h_gi);
+            hgdata.read_contained_vals ("/hexen/bi", h_bi);
+            hgdata.read_contained_vals ("/hexen/distToBoundary", h_distToBoundary);
+            hgdata.read_contained_vals ("/hexen/flags", h_flags);
+            for (unsigned int i = 0; i < hcount; ++i) {
+                morph::Hex h (h_vi[i], h_d[i], h_ri[i], h_gi[i]);
+                h.di = h_di[i];
+                h.x = h_x[i];
+                h.y = h_y[i];
+                h.z = h_z[i];
+                h.r = h_r[i];
+                h.phi = h_phi[i];
+                h.bi = h_bi[i];
+                h.distToBoundary = h_distToBoundary[i];
+                h.setFlags (h_flags[i]);
+                this->hexen.push_back (h);
+            }
+        }
+
+        /*!
+         * The lattice coordinates of a Hex, with bi folded into ri and gi so that hexes
+         * in the same place share them.
+         */
+        static std::pair<int, int> latticeCoords (const Hex& h) { return std::make_pair (h.ri - h.bi, h.gi + h.bi); }
+
+        //! The lattice coordinates and vi of each Hex in hexen, for a morph::LatticeConvolution
+        void latticeLayout (std::vector<std::array<int, 2>>& coords, std::vector<unsigned int>& index) const
+        {
+            if (this->storage == HexStorage::Arrays) {
+                const unsigned int n = this->d_x.size();
+                coords.resize (n);
+                index.resize (n);
+                for (unsigned int i = 0; i < n; ++i) {
+                    coords[i] = {{ this->d_ri[i] - this->d_bi[i], this->d_gi[i] + this->d_bi[i] }};
+                    index[i] = i;
+                }
+                return;
+            }
+            coords.reserve (this->hexen.size());
+            index.reserve (this->hexen.size());
+            for (const Hex& h : this->hexen) {
+                std::pair<int, int> rg = latticeCoords (h);
+                coords.push_back ({{ rg.first, rg.second }});
+                index.push_back (h.vi);
+            }
+        }
+
+        //! (Re)build the lookup table for findHexNearest(), if hexen has changed
+        void buildNearestIndex()
+        {
+            const Hex* front = this->hexen.empty() ? nullptr : &this->hexen.front();
+            if (this->nearest_its.size() == this->hexen.size() && this->nearest_front == front) { return; }
+            this->nearest_front = front;
+            this->nearest_its.clear();
+            this->nearest_table.clear();
+            this->nearest_tree_built = false;
+            std::array<int, 4> ext = { std::numeric_limits<int>::max(), std::numeric_limits<int>::min(),
+                                       std::numeric_limits<int>::max(), std::numeric_limits<int>::min() };
+            for (auto hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                this->nearest_its.push_back (hi);
+                std::pair<int, int> rg = latticeCoords (*hi);
+                ext[0] = std::min (ext[0], rg.first);
+                ext[1] = std::max (ext[1], rg.first);
+                ext[2] = std::min (ext[2], rg.second);
+                ext[3] = std::max (ext[3], rg.second);
+            }
+            if (this->hexen.empty()) { return; }
+
+            // The table covers the lattice coordinates' bounding box; each cell holds the
+            // position in hexen of the first Hex there, or -1
+            this->nearest_ext = ext;
+            this->nearest_d = this->hexen.front().getD();
+            this->nearest_v = this->hexen.front().getV();
+            const size_t nr = static_cast<size_t>(ext[1] - ext[0] + 1);
+            const size_t ng = static_cast<size_t>(ext[3] - ext[2] + 1);
+            this->nearest_table.assign (nr * ng, -1);
+            for (size_t k = this->nearest_its.size(); k-- > 0;) {
+                std::pair<int, int> rg = latticeCoords (*this->nearest_its[k]);
+                this->nearest_table[(rg.second - ext[2]) * nr + (rg.first - ext[0])] = static_cast<int>(k);
+            }
+        }
+
+        //! Build the k-d tree for findHexNearest(), if it hasn't been since buildNearestIndex() was
+        void buildNearestTree()
+        {
+            if (this->nearest_tree_built == true) { return; }
+            std::vector<morph::Vector<float, 2>> pts (this->nearest_its.size());
+            for (size_t k = 0; k < this->nearest_its.size(); ++k) {
+                pts[k] = { this->nearest_its[k]->x, this->nearest_its[k]->y };
+            }
+            this->nearest_tree.build (pts);
+            this->nearest_tree_built = true;
+        }
+
+        //! The position in hexen of the Hex at lattice coordinates (r, g), or -1
+        int nearestTableAt (const int r, const int g) const
+        {
+            if (r < this->nearest_ext[0] || r > this->nearest_ext[1]
+                || g < this->nearest_ext[2] || g > this->nearest_ext[3]) { return -1; }
+            const size_t nr = static_cast<size_t>(this->nearest_ext[1] - this->nearest_ext[0] + 1);
+            return this->nearest_table[(g - this->nearest_ext[2]) * nr + (r - this->nearest_ext[0])];
+        }
+
+        /*!
+         * The position in hexen of the Hex nearest to \a pos by way of the lookup table
+         * (once buildNearestIndex() has been called), or -1 if there is none, or -2 if pos
+         * is off the grid and the k-d tree is needed. Safe to call in parallel.
+         */
+        int nearestHex (const std::pair<float, float>& pos) const
+        {
+            if (this->nearest_its.empty() || !std::isfinite (pos.first) || !std::isfinite (pos.second)) {
+                return -1;
+            }
+
+            // Fractional lattice coordinates of pos, rounded to the nearest lattice point
+            // by rounding in cube coordinates (fr, fg, -fr-fg)
+            const float fg = pos.second / this->nearest_v;
+            const float fr = pos.first / this->nearest_d - fg / 2.0f;
+            if (fr < this->nearest_ext[0] - 1.0f || fr > this->nearest_ext[1] + 1.0f
+                || fg < this->nearest_ext[2] - 1.0f || fg > this->nearest_ext[3] + 1.0f) {
+                return -2;
+            }
+            float rr = std::round (fr);
+            float rg = std::round (fg);
+            const float rs = std::round (-fr - fg);
+            const float er = std::abs (rr - fr);
+            const float eg = std::abs (rg - fg);
+            const float es = std::abs (rs + fr + fg);
+            if (er > eg && er > es) {
+                rr = -rg - rs;
+            } else if (eg > es) {
+                rg = -rr - rs;
+            }
+            const int r = static_cast<int>(rr);
+            const int g = static_cast<int>(rg);
+
+            int k = this->nearestTableAt (r, g);
+            if (k < 0) { return -2; } // pos is off the grid
+            // The nearest lattice point is in the grid, so it is the nearest hex, but for
+            // rounding error and ties, which are settled among its neighbours
+            static constexpr std::array<std::array<int, 2>, 6> nbrs = {{ {{1,0}}, {{0,1}}, {{-1,1}}, {{-1,0}}, {{0,-1}}, {{1,-1}} }};
+            const Hex& hk = *this->nearest_its[k];
+            float dist = std::sqrt ((pos.first - hk.x) * (pos.first - hk.x) + (pos.second - hk.y) * (pos.second - hk.y));
+            for (const auto& n : nbrs) {
+                const int kn = this->nearestTableAt (r + n[0], g + n[1]);
+                if (kn < 0) { continue; }
+                const Hex& hn = *this->nearest_its[kn];
+                const float dl = std::sqrt ((pos.first - hn.x) * (pos.first - hn.x) + (pos.second - hn.y) * (pos.second - hn.y));
+                if (dl < dist || (dl == dist && kn < k)) {
+                    dist = dl;
+                    k = kn;
+                }
+            }
+            return k;
+        }
+
+        //! For findHexNearest(): iterators to the hexes, in order; the lattice lookup table
+        //! and its extents {rmin, rmax, gmin, gmax}; the lattice spacing and a k-d tree of the
+        //! hex positions. nearest_front records which list they were built from.
+        std::vector<std::list<Hex>::iterator> nearest_its;
+        std::vector<int> nearest_table;
+        std::array<int, 4> nearest_ext = {{0, 0, 0, 0}};
+        float nearest_d = 1.0f;
+        float nearest_v = 1.0f;
+        morph::KdTree<float> nearest_tree;
+        bool nearest_tree_built = false;
+        const Hex* nearest_front = nullptr;
+
+        //! For convolve(): the convolution, and the lattice coordinates and vi of this
+        //! grid's and the kernel grid's hexes when it was set up
+        morph::LatticeConvolution conv;
+        std::vector<std::array<int, 2>> conv_dcoords;
+        std::vector<unsigned int> conv_dindex;
+        std::vector<std::array<int, 2>> conv_kcoords;
+        std::vector<unsigned int> conv_kindex;
     };
 
 } // namespace morph
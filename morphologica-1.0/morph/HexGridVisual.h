@@ -9,6 +9,7 @@
 #endif
 #include <morph/tools.h>
 #include <morph/VisualDataModel.h>
+#include <morph/VisualGridData.h>
 #include <morph/ColourMap.h>
 #include <morph/HexGrid.h>
 #include <morph/MathAlgo.h>
@@ -272,6 +273,10 @@ namespace morph {
         //! HexGrid.
         void initializeVertices()
         {
+            if (this->gpuData == true) {
+                this->initializeVerticesGPU();
+                return;
+            }
             switch (this->hexVisMode) {
             case HexVisMode::Triangles:
             {
@@ -299,332 +304,100 @@ namespace morph {
             this->zScale.transform (*(this->scalarData), dcopy);
             this->dcolour.resize (this->scalarData->size());
             this->colourScale.transform (*(this->scalarData), dcolour);
+            this->cm.convert (this->dcolour, this->dclr);
 
-            std::array<float, 3> blkclr = {0,0,0};
+            const std::array<float, 3> blkclr = {0,0,0};
 
+            // One vertex per hex, so each hex can be written independently
+            this->vertexPositions.resize (3 * nhex);
+            this->vertexNormals.resize (3 * nhex);
+            this->vertexColors.resize (3 * nhex);
+#pragma omp parallel for schedule(static)
             for (unsigned int hi = 0; hi < nhex; ++hi) {
-                std::array<float, 3> clr = this->setColour (hi);
-                this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi], dcopy[hi], this->vertexPositions);
-                if (this->markedHexes.count(hi)) {
-                    this->vertex_push (blkclr, this->vertexColors);
-                } else {
-                    this->vertex_push (clr, this->vertexColors);
-                }
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+                std::array<float, 3> clr = this->markedHexes.count(hi) ? blkclr : this->setColour (hi);
+                float* p = this->vertexPositions.data() + 3 * hi;
+                float* n = this->vertexNormals.data() + 3 * hi;
+                float* c = this->vertexColors.data() + 3 * hi;
+                p[0] = this->hg->d_x[hi];
+                p[1] = this->hg->d_y[hi];
+                p[2] = this->dcopy[hi];
+                n[0] = 0.0f;
+                n[1] = 0.0f;
+                n[2] = 1.0f;
+                c[0] = clr[0];
+                c[1] = clr[1];
+                c[2] = clr[2];
             }
 
-            // Build indices based on neighbour relations in the HexGrid
-            for (unsigned int hi = 0; hi < nhex; ++hi) {
-                if (HAS_NNE(hi) && HAS_NE(hi)) {
-                    //std::cout << "1st triangle " << hi << "->" << NNE(hi) << "->" << NE(hi) << std::endl;
-                    this->indices.push_back (hi);
-                    this->indices.push_back (NNE(hi));
-                    this->indices.push_back (NE(hi));
-                }
-
-                if (HAS_NW(hi) && HAS_NSW(hi)) {
-                    //std::cout << "2nd triangle " << hi << "->" << NW(hi) << "->" << NSW(hi) << std::endl;
-                    this->indices.push_back (hi);
-                    this->indices.push_back (NW(hi));
-                    this->indices.push_back (NSW(hi));
-                }
-            }
+            this->initializeIndicesTris();
         }
 
         //! Show a set of hexes at the zero?
         bool zerogrid = false;
 
-        //! Initialize as hexes, with z position of each of the 6
-        //! outer edges of the hexes interpolated, but a single colour
-        //! for each hex. Gives a smooth surface.
+        /*!
+         * Initialize as hexes, with z position of each of the 6 outer edges of the
+         * hexes interpolated, but a single colour for each hex. Gives a smooth surface.
+         *
+         * Every hex is 7 vertices and 18 indices (and the zero grid, if shown, as many
+         * again), so the buffers are sized up front and the hexes are filled in
+         * independently, in parallel when compiled with OpenMP. This is re-run by
+         * every reinit(), so for a large grid it's the bulk of the cost of a frame.
+         * Note that setColour() is called from several threads at once.
+         */
         void initializeVerticesHexesInterpolated()
         {
-            float sr = this->hg->getSR();
-            float vne = this->hg->getVtoNE();
-            float lr = this->hg->getLR();
-
             unsigned int nhex = this->hg->num();
-            unsigned int idx = 0;
 
             this->dcopy.resize (this->scalarData->size());
             this->zScale.transform (*(this->scalarData), dcopy);
             this->dcolour.resize (this->scalarData->size());
             this->colourScale.transform (*(this->scalarData), dcolour);
+            this->cm.convert (this->dcolour, this->dclr);
 
-            // These Ts are all floats, right?
-            float datumC = 0.0f;   // datum at the centre
-            float datumNE = 0.0f;  // datum at the hex to the east.
-            float datumNNE = 0.0f; // etc
-            float datumNNW = 0.0f;
-            float datumNW = 0.0f;
-            float datumNSW = 0.0f;
-            float datumNSE = 0.0f;
-
-            float datum = 0.0f;
-            float third = 0.3333333f;
-            float half = 0.5f;
-            morph::Vector<float> vtx_0, vtx_1, vtx_2;
-            for (unsigned int hi = 0; hi < nhex; ++hi) {
+            const size_t nslots = this->zerogrid == true ? 2 * nhex : nhex;
+            this->vertexPositions.resize (21 * nslots);
+            this->vertexNormals.resize (21 * nslots);
+            this->vertexColors.resize (21 * nslots);
+            this->indices.resize (18 * nslots);
 
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
                 // Use the linear scaled copy of the data, dcopy.
-                datumC   = dcopy[hi];
-                datumNE  = HAS_NE(hi)  ? dcopy[NE(hi)]  : datumC; // datum Neighbour East
-                datumNNE = HAS_NNE(hi) ? dcopy[NNE(hi)] : datumC; // datum Neighbour North East
-                datumNNW = HAS_NNW(hi) ? dcopy[NNW(hi)] : datumC; // etc
-                datumNW  = HAS_NW(hi)  ? dcopy[NW(hi)]  : datumC;
-                datumNSW = HAS_NSW(hi) ? dcopy[NSW(hi)] : datumC;
-                datumNSE = HAS_NSE(hi) ? dcopy[NSE(hi)] : datumC;
+                const float datumC   = this->dcopy[hi];
+                const float datumNE  = HAS_NE(hi)  ? this->dcopy[NE(hi)]  : datumC; // datum Neighbour East
+                const float datumNNE = HAS_NNE(hi) ? this->dcopy[NNE(hi)] : datumC; // datum Neighbour North East
+                const float datumNNW = HAS_NNW(hi) ? this->dcopy[NNW(hi)] : datumC; // etc
+                const float datumNW  = HAS_NW(hi)  ? this->dcopy[NW(hi)]  : datumC;
+                const float datumNSW = HAS_NSW(hi) ? this->dcopy[NSW(hi)] : datumC;
+                const float datumNSE = HAS_NSE(hi) ? this->dcopy[NSE(hi)] : datumC;
+
+                // The centre, then the NE, SE, S, SW, NW and N vertices
+                const std::array<float, 7> z = {
+                    datumC,
+                    cornerDatum (datumC, HAS_NNE(hi), datumNNE, HAS_NE(hi), datumNE),
+                    cornerDatum (datumC, HAS_NE(hi), datumNE, HAS_NSE(hi), datumNSE),
+                    cornerDatum (datumC, HAS_NSE(hi), datumNSE, HAS_NSW(hi), datumNSW),
+                    cornerDatum (datumC, HAS_NW(hi), datumNW, HAS_NSW(hi), datumNSW),
+                    cornerDatum (datumC, HAS_NNW(hi), datumNNW, HAS_NW(hi), datumNW),
+                    cornerDatum (datumC, HAS_NNW(hi), datumNNW, HAS_NNE(hi), datumNNE)
+                };
 
                 // Use a single colour for each hex, even though hex z positions are
                 // interpolated. Do the _colour_ scaling:
-                std::array<float, 3> clr = this->setColour (hi);
-                std::array<float, 3> blkclr = {0,0,0};
-
-                // First push the 7 positions of the triangle vertices, starting with the centre
-                this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi], datumC, this->vertexPositions);
-
-                // Use the centre position as the first location for finding the normal vector
-                vtx_0 = {{this->hg->d_x[hi], this->hg->d_y[hi], datumC}};
-
-                // NE vertex
-                if (HAS_NNE(hi) && HAS_NE(hi)) {
-                    // Compute mean of this->data[hi] and NE and E hexes
-                    datum = third * (datumC + datumNNE + datumNE);
-                } else if (HAS_NNE(hi) || HAS_NE(hi)) {
-                    if (HAS_NNE(hi)) {
-                        datum = half * (datumC + datumNNE);
-                    } else {
-                        datum = half * (datumC + datumNE);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi]+sr, this->hg->d_y[hi]+vne, datum, this->vertexPositions);
-                vtx_1 = {{this->hg->d_x[hi]+sr, this->hg->d_y[hi]+vne, datum}};
-
-                // SE vertex
-                if (HAS_NE(hi) && HAS_NSE(hi)) {
-                    datum = third * (datumC + datumNE + datumNSE);
-                } else if (HAS_NE(hi) || HAS_NSE(hi)) {
-                    if (HAS_NE(hi)) {
-                        datum = half * (datumC + datumNE);
-                    } else {
-                        datum = half * (datumC + datumNSE);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi]+sr, this->hg->d_y[hi]-vne, datum, this->vertexPositions);
-                vtx_2 = {{this->hg->d_x[hi]+sr, this->hg->d_y[hi]-vne, datum}};
-
-                // S
-                if (HAS_NSE(hi) && HAS_NSW(hi)) {
-                    datum = third * (datumC + datumNSE + datumNSW);
-                } else if (HAS_NSE(hi) || HAS_NSW(hi)) {
-                    if (HAS_NSE(hi)) {
-                        datum = half * (datumC + datumNSE);
-                    } else {
-                        datum = half * (datumC + datumNSW);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi]-lr, datum, this->vertexPositions);
-
-                // SW
-                if (HAS_NW(hi) && HAS_NSW(hi)) {
-                    datum = third * (datumC + datumNW + datumNSW);
-                } else if (HAS_NW(hi) || HAS_NSW(hi)) {
-                    if (HAS_NW(hi)) {
-                        datum = half * (datumC + datumNW);
-                    } else {
-                        datum = half * (datumC + datumNSW);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi]-sr, this->hg->d_y[hi]-vne, datum, this->vertexPositions);
-
-                // NW
-                if (HAS_NNW(hi) && HAS_NW(hi)) {
-                    datum = third * (datumC + datumNNW + datumNW);
-                } else if (HAS_NNW(hi) || HAS_NW(hi)) {
-                    if (HAS_NNW(hi)) {
-                        datum = half * (datumC + datumNNW);
-                    } else {
-                        datum = half * (datumC + datumNW);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi]-sr, this->hg->d_y[hi]+vne, datum, this->vertexPositions);
-
-                // N
-                if (HAS_NNW(hi) && HAS_NNE(hi)) {
-                    datum = third * (datumC + datumNNW + datumNNE);
-                } else if (HAS_NNW(hi) || HAS_NNE(hi)) {
-                    if (HAS_NNW(hi)) {
-                        datum = half * (datumC + datumNNW);
-                    } else {
-                        datum = half * (datumC + datumNNE);
-                    }
-                } else {
-                    datum = datumC;
-                }
-                this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi]+lr, datum, this->vertexPositions);
-
-                // From vtx_0,1,2 compute normal. This sets the correct normal, but note
-                // that there is only one 'layer' of vertices; the back of the
-                // HexGridVisual will be coloured the same as the front. To get lighting
-                // effects to look really good, the back of the surface could need the
-                // opposite normal.
-                morph::Vector<float> plane1 = vtx_1 - vtx_0;
-                morph::Vector<float> plane2 = vtx_2 - vtx_0;
-                morph::Vector<float> vnorm = plane2.cross (plane1);
-                vnorm.renormalize();
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-
-                // Usually seven vertices with the same colour, but if the hex is
-                // marked, then three of the vertices are given the colour black,
-                // marking the hex out visually.
-                this->vertex_push (clr, this->vertexColors);
-                if (this->markedHexes.count(hi)) {
-                    this->vertex_push (blkclr, this->vertexColors);
-                } else {
-                    this->vertex_push (clr, this->vertexColors);
-                }
-                this->vertex_push (clr, this->vertexColors);
-                if (this->markedHexes.count(hi)) {
-                    this->vertex_push (blkclr, this->vertexColors);
-                } else {
-                    this->vertex_push (clr, this->vertexColors);
-                }
-                this->vertex_push (clr, this->vertexColors);
-                if (this->markedHexes.count(hi)) {
-                    this->vertex_push (blkclr, this->vertexColors);
-                } else {
-                    this->vertex_push (clr, this->vertexColors);
-                }
-                this->vertex_push (clr, this->vertexColors);
-
-                // Define indices now to produce the 6 triangles in the hex
-                this->indices.push_back (idx+1);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+2);
-
-                this->indices.push_back (idx+2);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+3);
-
-                this->indices.push_back (idx+3);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+4);
-
-                this->indices.push_back (idx+4);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+5);
-
-                this->indices.push_back (idx+5);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+6);
-
-                this->indices.push_back (idx+6);
-                this->indices.push_back (idx);
-                this->indices.push_back (idx+1);
-
-                idx += 7; // 7 vertices (each of 3 floats for x/y/z), 18 indices.
+                this->hexSlot (hi, hi, z, this->setColour (hi), this->markedHexes.count(hi) > 0);
             }
 
             // Show a Flat surface for the zero plane? This is expensively plotting out all the hexes...
             if (this->zerogrid == true) {
+                // z position is always 0 and a single colour is used for the zero grid
+                const std::array<float, 7> z0 = {};
+                const std::array<float, 3> clr = { .8f, .8f, .8f};
+#pragma omp parallel for schedule(static)
                 for (unsigned int hi = 0; hi < nhex; ++hi) {
-
-                    // z position is always 0
-                    datum = 0.0f;
-                    // Use a single colour for the zero grid
-                    std::array<float, 3> clr = { .8f, .8f, .8f};
-
-                    // First push the 7 positions of the triangle vertices, starting with the centre
-                    this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi], datum, this->vertexPositions);
-
-                    // Use the centre position as the first location for finding the normal vector
-                    vtx_0 = {{this->hg->d_x[hi], this->hg->d_y[hi], datum}};
-                    // NE vertex
-                    this->vertex_push (this->hg->d_x[hi]+sr, this->hg->d_y[hi]+vne, datum, this->vertexPositions);
-                    vtx_1 = {{this->hg->d_x[hi]+sr, this->hg->d_y[hi]+vne, datum}};
-                    // SE vertex
-                    this->vertex_push (this->hg->d_x[hi]+sr, this->hg->d_y[hi]-vne, datum, this->vertexPositions);
-                    vtx_2 = {{this->hg->d_x[hi]+sr, this->hg->d_y[hi]-vne, datum}};
-                    // S
-                    this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi]-lr, datum, this->vertexPositions);
-                    // SW
-                    this->vertex_push (this->hg->d_x[hi]-sr, this->hg->d_y[hi]-vne, datum, this->vertexPositions);
-                    // NW
-                    this->vertex_push (this->hg->d_x[hi]-sr, this->hg->d_y[hi]+vne, datum, this->vertexPositions);
-                    // N
-                    this->vertex_push (this->hg->d_x[hi], this->hg->d_y[hi]+lr, datum, this->vertexPositions);
-
-                    // From vtx_0,1,2 compute normal. This sets the correct normal, but note
-                    // that there is only one 'layer' of vertices; the back of the
-                    // HexGridVisual will be coloured the same as the front. To get lighting
-                    // effects to look really good, the back of the surface could need the
-                    // opposite normal.
-                    morph::Vector<float> plane1 = vtx_1 - vtx_0;
-                    morph::Vector<float> plane2 = vtx_2 - vtx_0;
-                    morph::Vector<float> vnorm = plane2.cross (plane1);
-                    vnorm.renormalize();
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->vertex_push (vnorm, this->vertexNormals);
-
-                    // Seven vertices with the same colour
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (clr, this->vertexColors);
-
-                    // Define indices now to produce the 6 triangles in the hex
-                    this->indices.push_back (idx+1);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+2);
-
-                    this->indices.push_back (idx+2);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+3);
-
-                    this->indices.push_back (idx+3);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+4);
-
-                    this->indices.push_back (idx+4);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+5);
-
-                    this->indices.push_back (idx+5);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+6);
-
-                    this->indices.push_back (idx+6);
-                    this->indices.push_back (idx);
-                    this->indices.push_back (idx+1);
-
-                    idx += 7; // 7 vertices (each of 3 floats for x/y/z), 18 indices.
+                    this->hexSlot (hi, nhex + hi, z0, clr, false);
                 }
             }
-            // End trial grid
         }
 
         //! Initialize as hexes, with a step quad between each
@@ -635,12 +408,213 @@ namespace morph {
         //! the scale of the hexes in your sim
         HexVisMode hexVisMode = HexVisMode::HexInterp;
 
+        /*!
+         * If true, the surface is computed on the GPU, by the grid shader program
+         * (VisGrid.vert.glsl), from the data as it is. The vertices and indices depend
+         * only on the HexGrid, so they're uploaded once, by finalize(), and thereafter
+         * updateData() (or updateZScale() or updateCScale()) uploads one float per hex,
+         * rather than rebuilding the whole mesh. Set before finalize(). Either
+         * hexVisMode may be used, but the colour of a hex always comes from the colour
+         * map, so markedHexes and an overridden setColour() (as in HexGridVisualManual)
+         * have no effect.
+         */
+        bool gpuData = false;
+
+        //! For gpuData, update the data (and the scaling) on the GPU without re-meshing
+        void reinitData() override
+        {
+            if (this->gpuData == false) {
+                this->reinit();
+                return;
+            }
+            this->uploadData();
+            this->changed = true;
+        }
+
+        //! Render, first setting the grid program up, for gpuData
+        void render() override
+        {
+            if (this->gpuData == true && this->hide == false) {
+                glUseProgram (this->shaderprog);
+                const int vpe = this->hexVisMode == HexVisMode::Triangles ? 1 : 7;
+                this->griddata.bind (this->uniforms(), this->gpu_zscale, this->gpu_cscale, vpe,
+                                     static_cast<int>(this->hg->num()), {this->hg->getSR(), this->hg->getVtoNE()});
+            }
+            VisualDataModel<T>::render();
+        }
+
+        /*!
+         * Initialize for gpuData: the x and y of each vertex (the shader sets z), the
+         * indices and the neighbours of each hex, none of which depend on the data. Then
+         * upload the data.
+         */
+        void initializeVerticesGPU()
+        {
+            unsigned int nhex = this->hg->num();
+            this->useGridProgram();
+
+            if (this->hexVisMode == HexVisMode::Triangles) {
+                this->vertexPositions.resize (3 * nhex);
+#pragma omp parallel for schedule(static)
+                for (unsigned int hi = 0; hi < nhex; ++hi) {
+                    float* p = this->vertexPositions.data() + 3 * hi;
+                    p[0] = this->hg->d_x[hi];
+                    p[1] = this->hg->d_y[hi];
+                    p[2] = 0.0f;
+                }
+                this->initializeIndicesTris();
+            } else {
+                // As initializeVerticesHexesInterpolated(), the zero grid after the hexes
+                const size_t nslots = this->zerogrid == true ? 2 * nhex : nhex;
+                this->vertexPositions.resize (21 * nslots);
+                this->indices.resize (18 * nslots);
+#pragma omp parallel for schedule(static)
+                for (size_t slot = 0; slot < nslots; ++slot) {
+                    std::array<float, 7> vx;
+                    std::array<float, 7> vy;
+                    this->hexCorners (slot % nhex, vx, vy);
+                    float* p = this->vertexPositions.data() + 21 * slot;
+                    for (unsigned int k = 0; k < 7; ++k) {
+                        p[3 * k] = vx[k];
+                        p[3 * k + 1] = vy[k];
+                        p[3 * k + 2] = 0.0f;
+                    }
+                    this->hexIndices (slot);
+                }
+            }
+            // The shader computes the normals and colours
+            this->vertexNormals.clear();
+            this->vertexColors.clear();
+
+            // In the order VisGrid.vert.glsl expects
+            std::vector<GLint> nbrs (8 * nhex, -1);
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                GLint* nb = nbrs.data() + 8 * hi;
+                nb[0] = NE(hi);
+                nb[1] = NNE(hi);
+                nb[2] = NNW(hi);
+                nb[3] = NW(hi);
+                nb[4] = NSW(hi);
+                nb[5] = NSE(hi);
+            }
+            this->griddata.setNeighbours (nbrs);
+
+            this->uploadData();
+        }
+
     protected:
         //! An overridable function to set the colour of hex hi
         virtual std::array<float, 3> setColour (unsigned int hi)
         {
-            std::array<float, 3> clr = this->cm.convert (this->dcolour[hi]);
-            return clr;
+            return this->dclr[hi];
+        }
+
+        //! The z of a hex corner from the centre datum \a c and those of the two
+        //! neighbours, \a a and \a b, which share the corner (if they exist)
+        static float cornerDatum (const float c, const bool has_a, const float a, const bool has_b, const float b)
+        {
+            if (has_a && has_b) { return 0.3333333f * (c + a + b); }
+            if (has_a) { return 0.5f * (c + a); }
+            if (has_b) { return 0.5f * (c + b); }
+            return c;
+        }
+
+        /*!
+         * Write the 7 vertices of hex \a hi, with heights \a z (centre, then NE, SE, S,
+         * SW, NW and N), and the indices of its 6 triangles, into the \a slot'th block of
+         * 7 vertices and 18 indices. Usually all seven vertices have colour \a clr, but if
+         * the hex is \a marked, then three of them are black, marking the hex out.
+         */
+        void hexSlot (const unsigned int hi, const size_t slot, const std::array<float, 7>& z,
+                      const std::array<float, 3>& clr, const bool marked)
+        {
+            std::array<float, 7> vx;
+            std::array<float, 7> vy;
+            this->hexCorners (hi, vx, vy);
+
+            // From the centre, NE and SE vertices compute normal. This sets the correct
+            // normal, but note that there is only one 'layer' of vertices; the back of the
+            // HexGridVisual will be coloured the same as the front. To get lighting
+            // effects to look really good, the back of the surface could need the
+            // opposite normal.
+            morph::Vector<float> plane1 = { vx[1] - vx[0], vy[1] - vy[0], z[1] - z[0] };
+            morph::Vector<float> plane2 = { vx[2] - vx[0], vy[2] - vy[0], z[2] - z[0] };
+            morph::Vector<float> vnorm = plane2.cross (plane1);
+            vnorm.renormalize();
+
+            const std::array<float, 3> blkclr = {0,0,0};
+            float* p = this->vertexPositions.data() + 21 * slot;
+            float* n = this->vertexNormals.data() + 21 * slot;
+            float* c = this->vertexColors.data() + 21 * slot;
+            for (unsigned int k = 0; k < 7; ++k) {
+                const std::array<float, 3>& kclr = (marked && k % 2 == 1) ? blkclr : clr;
+                for (unsigned int j = 0; j < 3; ++j) {
+                    n[3 * k + j] = vnorm[j];
+                    c[3 * k + j] = kclr[j];
+                }
+                p[3 * k] = vx[k];
+                p[3 * k + 1] = vy[k];
+                p[3 * k + 2] = z[k];
+            }
+
+            this->hexIndices (slot);
+        }
+
+        //! The x and y of the centre, then the NE, SE, S, SW, NW and N vertices of hex \a hi
+        void hexCorners (const unsigned int hi, std::array<float, 7>& vx, std::array<float, 7>& vy) const
+        {
+            const float sr = this->hg->getSR();
+            const float vne = this->hg->getVtoNE();
+            const float lr = this->hg->getLR();
+            const float x = this->hg->d_x[hi];
+            const float y = this->hg->d_y[hi];
+            vx = { x, x + sr, x + sr, x, x - sr, x - sr, x };
+            vy = { y, y + vne, y - vne, y - lr, y - vne, y + vne, y + lr };
+        }
+
+        //! The indices of the 6 triangles in the \a slot'th hex, each from the centre to
+        //! two adjacent corners
+        void hexIndices (const size_t slot)
+        {
+            const VBOint base = static_cast<VBOint>(7 * slot);
+            VBOint* ix = this->indices.data() + 18 * slot;
+            for (VBOint t = 0; t < 6; ++t) {
+                ix[3 * t] = base + 1 + t;
+                ix[3 * t + 1] = base;
+                ix[3 * t + 2] = base + 1 + (t + 1) % 6;
+            }
+        }
+
+        //! Build the Triangles mode indices from the neighbour relations in the HexGrid
+        void initializeIndicesTris()
+        {
+            unsigned int nhex = this->hg->num();
+            // Each hex starts zero, one or two triangles, so first count them to find
+            // where each hex's indices go, then fill them in.
+            this->tri_first.resize (nhex + 1);
+            this->tri_first[0] = 0;
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                this->tri_first[hi + 1] = 3 * ((HAS_NNE(hi) && HAS_NE(hi) ? 1 : 0) + (HAS_NW(hi) && HAS_NSW(hi) ? 1 : 0));
+            }
+            for (unsigned int hi = 0; hi < nhex; ++hi) { this->tri_first[hi + 1] += this->tri_first[hi]; }
+
+            this->indices.resize (this->tri_first[nhex]);
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                VBOint* ix = this->indices.data() + this->tri_first[hi];
+                if (HAS_NNE(hi) && HAS_NE(hi)) {
+                    *ix++ = hi;
+                    *ix++ = NNE(hi);
+                    *ix++ = NE(hi);
+                }
+                if (HAS_NW(hi) && HAS_NSW(hi)) {
+                    *ix++ = hi;
+                    *ix++ = NW(hi);
+                    *ix++ = NSW(hi);
+                }
+            }
         }
 
         //! The HexGrid to visualize
@@ -650,6 +624,35 @@ namespace morph {
         std::vector<float> dcopy;
         //! A copy of the scalarData, scaled to be a colour value
         std::vector<float> dcolour;
+        //! dcolour through the colour map, converted in one pass for setColour()
+        std::vector<std::array<float, 3>> dclr;
+        //! In Triangles mode, where each hex's indices start (and, at [num()], where they end)
+        std::vector<VBOint> tri_first;
+
+        //! For gpuData, switch to the grid program
+        void useGridProgram()
+        {
+            GLuint gprog = VisualResources::i()->getGridProgram (glfwGetCurrentContext());
+            if (this->shaderprog != gprog) {
+                this->shaderprog = gprog;
+                this->ulocs = nullptr;
+            }
+        }
+
+        //! For gpuData, upload the data, the scaling and the colour map
+        void uploadData()
+        {
+            this->griddata.setData (*this->scalarData);
+            this->gpu_zscale = VisualGridData::scaleParams (this->zScale, *this->scalarData);
+            this->gpu_cscale = VisualGridData::scaleParams (this->colourScale, *this->scalarData);
+            this->griddata.setColourMap (this->cm);
+        }
+
+        //! For gpuData, the textures from which the shader computes the surface
+        VisualGridData griddata;
+        //! For gpuData, the z and colour scaling as the shader takes them
+        std::array<float, 3> gpu_zscale;
+        std::array<float, 3> gpu_cscale;
     };
 
     //! Extended HexGridVisual class for plotting with individual red, green and blue
@@ -0,0 +1,133 @@
+/*!
+ * \file
+ *
+ * A static k-d tree over a set of 2D points, for finding the nearest of them to any
+ * query point in O(log N) time. build() copies the points and arranges them as an
+ * implicit, balanced tree: the median of each range (split alternately on x and y) is
+ * the node, and the two halves either side of it are its subtrees. There are no
+ * pointers, so the tree is two contiguous arrays.
+ *
+ * nearest() is const and may be called from any number of threads at once, but not
+ * while build() runs.
+ */
+#pragma once
+
+#include <morph/Vector.h>
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+
+namespace morph {
+
+    template <typename T>
+    class KdTree
+    {
+    public:
+        //! The value nearest() returns if the tree is empty
+        static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+        //! Build the tree over \a pts, which should all be finite.
+        void build (const std::vector<morph::Vector<T, 2>>& pts)
+        {
+            this->points = pts;
+            this->index.resize (pts.size());
+            for (size_t i = 0; i < pts.size(); ++i) { this->index[i] = i; }
+            this->buildRange (0, pts.size(), 0);
+        }
+
+        /*!
+         * The index, in the container given to build(), of the point nearest to \a p, or
+         * npos if there are no points. Where several points are equally near, the one
+         * with the lowest index is returned.
+         */
+        size_t nearest (const morph::Vector<T, 2>& p) const
+        {
+            size_t best = npos;
+            T bestd2 = std::numeric_limits<T>::max();
+            morph::Vector<T, 2> off = { T{0}, T{0} };
+            this->search (0, this->points.size(), 0, p, T{0}, off, best, bestd2);
+            return best;
+        }
+
+        //! The number of points in the tree
+        size_t size() const { return this->points.size(); }
+
+    private:
+        //! Arrange [lo, hi) as a subtree split on axis depth % 2
+        void buildRange (const size_t lo, const size_t hi, const unsigned int depth)
+        {
+            if (hi - lo < 2) { return; }
+            const size_t mid = lo + (hi - lo) / 2;
+            const unsigned int ax = depth % 2;
+            // Sort the points and their indices together, via an order of positions
+            this->order.resize (hi - lo);
+            for (size_t i = lo; i < hi; ++i) { this->order[i - lo] = i; }
+            std::nth_element (this->order.begin(), this->order.begin() + (mid - lo), this->order.end(),
+                              [this, ax](size_t a, size_t b) { return this->points[a][ax] < this->points[b][ax]; });
+            this->scratchPts.resize (hi - lo);
+            this->scratchIdx.resize (hi - lo);
+            for (size_t i = 0; i < hi - lo; ++i) {
+                this->scratchPts[i] = this->points[this->order[i]];
+                this->scratchIdx[i] = this->index[this->order[i]];
+            }
+            std::copy (this->scratchPts.begin(), this->scratchPts.end(), this->points.begin() + lo);
+            std::copy (this->scratchIdx.begin(), this->scratchIdx.end(), this->index.begin() + lo);
+            this->buildRange (lo, mid, depth + 1);
+            this->buildRange (mid + 1, hi, depth + 1);
+        }
+
+        /*!
+         * Search the subtree [lo, hi) for a point nearer to p than bestd2. The subtree's
+         * region is bounded by the split lines of its ancestors; off holds p's distance
+         * to the nearest of those on each axis, and rd is the sum of their squares, the
+         * squared distance from p to the region. A subtree whose rd exceeds bestd2 is
+         * skipped, which prunes much more than the distance to the one split line alone.
+         */
+        void search (const size_t lo, const size_t hi, const unsigned int depth,
+                     const morph::Vector<T, 2>& p, const T rd, morph::Vector<T, 2>& off,
+                     size_t& best, T& bestd2) const
+        {
+            if (lo >= hi) { return; }
+            const size_t mid = lo + (hi - lo) / 2;
+            const morph::Vector<T, 2>& q = this->points[mid];
+            const T dx = p[0] - q[0];
+            const T dy = p[1] - q[1];
+            const T d2 = dx * dx + dy * dy;
+            if (d2 < bestd2 || (d2 == bestd2 && this->index[mid] < best)) {
+                bestd2 = d2;
+                best = this->index[mid];
+            }
+            // The side of the split that p is on first, then the other if it could hold
+            // a point as near as the best so far
+            const unsigned int ax = depth % 2;
+            const T diff = p[ax] - q[ax];
+            const bool lower = diff < T{0};
+            if (lower) {
+                this->search (lo, mid, depth + 1, p, rd, off, best, bestd2);
+            } else {
+                this->search (mid + 1, hi, depth + 1, p, rd, off, best, bestd2);
+            }
+            const T old = off[ax];
+            const T farrd = rd - old * old + diff * diff;
+            if (farrd <= bestd2) {
+                off[ax] = diff;
+                if (lower) {
+                    this->search (mid + 1, hi, depth + 1, p, farrd, off, best, bestd2);
+                } else {
+                    this->search (lo, mid, depth + 1, p, farrd, off, best, bestd2);
+                }
+                off[ax] = old;
+            }
+        }
+
+        //! The points, arranged as the tree, and the index of each in build()'s container
+        std::vector<morph::Vector<T, 2>> points;
+        std::vector<size_t> index;
+        //! Scratch for build()
+        std::vector<size_t> order;
+        std::vector<morph::Vector<T, 2>> scratchPts;
+        std::vector<size_t> scratchIdx;
+    };
+
+} // namespace morph
@@ -0,0 +1,232 @@
+/*!
+ * \file
+ *
+ * Convolution of data on the elements of a grid whose elements sit on an integer
+ * lattice (HexGrid, with its (ri, gi) coordinates, or CartGrid, with (xi, yi)) with a
+ * kernel which sits on the same lattice. Each result is the sum, over the kernel
+ * elements, of the kernel value times the datum of the domain element offset from the
+ * result's element by the kernel element's coordinates. Domain elements which don't
+ * exist (because they would lie outside the boundary) contribute nothing.
+ *
+ * init() does the work which depends only on the shapes of the domain and kernel. It
+ * lays the domain out in a table over the bounding box of its lattice coordinates,
+ * padded by the reach of the kernel, so that the table position of each kernel
+ * element's partner is a fixed offset from that of the result's element. convolve()
+ * then gathers, multiplies and accumulates, in parallel over the results, or, for large
+ * kernels, multiplies in the frequency domain (see morph::FFT).
+ */
+#pragma once
+
+#include <morph/FFT.h>
+#include <vector>
+#include <array>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace morph {
+
+    //! How LatticeConvolution::convolve computes the convolution
+    enum class ConvolutionMethod
+    {
+        Auto,   // Whichever of Direct or FFT should be faster
+        Direct, // Sum the products over the kernel for each result element
+        FFT     // Multiply in the frequency domain
+    };
+
+    class LatticeConvolution
+    {
+    public:
+        /*!
+         * Set up to convolve data on the domain elements at lattice coordinates \a dcoords
+         * with a kernel whose elements are at \a kcoords (relative to the kernel's origin).
+         * \a dindex and \a kindex give the index of each element's value in the data and
+         * kernel vectors; the domain's indices must all be less than dcoords.size().
+         */
+        void init (const std::vector<std::array<int, 2>>& dcoords, const std::vector<unsigned int>& dindex,
+                   const std::vector<std::array<int, 2>>& kcoords, const std::vector<unsigned int>& kindex)
+        {
+            if (dcoords.size() != dindex.size() || kcoords.size() != kindex.size()) {
+                throw std::runtime_error ("LatticeConvolution::init: coordinates and indices differ in number");
+            }
+            this->n = dcoords.size();
+            this->dindex = dindex;
+            this->kindex = kindex;
+            this->kcoords = kcoords;
+            this->kmax = kindex.empty() ? 0 : *std::max_element (kindex.begin(), kindex.end()) + 1;
+
+            // The bounding boxes of the domain and the kernel, and the kernel's reach
+            this->dext = bounds (dcoords);
+            const std::array<int, 4> kext = bounds (kcoords);
+            this->reach = { std::max (std::abs (kext[0]), std::abs (kext[1])),
+                            std::max (std::abs (kext[2]), std::abs (kext[3])) };
+            if (this->n == 0) { return; }
+            this->w = static_cast<size_t>(this->dext[1] - this->dext[0] + 1 + 2 * this->reach[0]);
+            this->h = static_cast<size_t>(this->dext[3] - this->dext[2] + 1 + 2 * this->reach[1]);
+
+            // The padded table: each cell holds the data index of the element there, or
+            // n, which convolve() points at a zero
+            this->table.assign (this->w * this->h, static_cast<unsigned int>(this->n));
+            this->pos.resize (this->n);
+            for (size_t i = this->n; i-- > 0;) {
+                if (dindex[i] >= this->n) {
+                    throw std::runtime_error ("LatticeConvolution::init: a data index is out of range");
+                }
+                this->pos[i] = this->cell (dcoords[i][0], dcoords[i][1]);
+                this->table[this->pos[i]] = dindex[i];
+            }
+            this->fsz = {{ morph::FFT<double>::nextPow2 (static_cast<size_t>(this->dext[1] - this->dext[0] + 1 + this->reach[0])),
+                           morph::FFT<double>::nextPow2 (static_cast<size_t>(this->dext[3] - this->dext[2] + 1 + this->reach[1])) }};
+            this->off.resize (kcoords.size());
+            for (size_t k = 0; k < kcoords.size(); ++k) {
+                this->off[k] = static_cast<std::ptrdiff_t>(kcoords[k][1]) * static_cast<std::ptrdiff_t>(this->w)
+                + static_cast<std::ptrdiff_t>(kcoords[k][0]);
+            }
+        }
+
+        /*!
+         * Convolve \a data with \a kerneldata, writing \a result. data and result must
+         * have an element for each domain element. FFT is only used for floating point
+         * T, and agrees with Direct to within rounding error.
+         */
+        template <typename T>
+        void convolve (const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result,
+                       const ConvolutionMethod method = ConvolutionMethod::Auto) const
+        {
+            if (data.size() != this->n || result.size() != this->n) {
+                throw std::runtime_error ("LatticeConvolution::convolve: data and result must be the size of the domain");
+            }
+            if (kerneldata.size() < this->kmax) {
+                throw std::runtime_error ("LatticeConvolution::convolve: the kernel data is smaller than the kernel");
+            }
+            if constexpr (std::is_floating_point<T>::value == true) {
+                if (method == ConvolutionMethod::FFT
+                    || (method == ConvolutionMethod::Auto && this->fftIsFaster())) {
+                    this->convolveFFT (kerneldata, data, result);
+                    return;
+                }
+            }
+            this->convolveDirect (kerneldata, data, result);
+        }
+
+        //! True if convolve() with ConvolutionMethod::Auto would use the FFT
+        bool fftIsFaster() const
+        {
+            if (this->n == 0) { return false; }
+            // The direct sum costs a gather and a multiply-add per element per kernel
+            // element; the transforms, around 8 of those per butterfly
+            const double m = static_cast<double>(this->fsz[0] * this->fsz[1]);
+            return static_cast<double>(this->n) * static_cast<double>(this->kindex.size()) > 8.0 * m * std::log2 (m);
+        }
+
+    private:
+        //! {xmin, xmax, ymin, ymax} of \a c, or all zero if c is empty
+        static std::array<int, 4> bounds (const std::vector<std::array<int, 2>>& c)
+        {
+            if (c.empty()) { return {{ 0, 0, 0, 0 }}; }
+            std::array<int, 4> b = {{ std::numeric_limits<int>::max(), std::numeric_limits<int>::min(),
+                                      std::numeric_limits<int>::max(), std::numeric_limits<int>::min() }};
+            for (const auto& p : c) {
+                b[0] = std::min (b[0], p[0]);
+                b[1] = std::max (b[1], p[0]);
+                b[2] = std::min (b[2], p[1]);
+                b[3] = std::max (b[3], p[1]);
+            }
+            return b;
+        }
+
+        //! The position in the padded table of lattice point (x, y)
+        size_t cell (const int x, const int y) const
+        {
+            return static_cast<size_t>(y - this->dext[2] + this->reach[1]) * this->w
+            + static_cast<size_t>(x - this->dext[0] + this->reach[0]);
+        }
+
+        //! \a v modulo \a m, in [0, m)
+        static size_t wrap (const int v, const size_t m)
+        {
+            const long long mm = static_cast<long long>(m);
+            return static_cast<size_t>(((static_cast<long long>(v) % mm) + mm) % mm);
+        }
+
+        template <typename T>
+        void convolveDirect (const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result) const
+        {
+            // The data, with a zero at index n for the table cells with no element
+            std::vector<T> dz (this->n + 1, T{0});
+            std::copy (data.begin(), data.end(), dz.begin());
+            const size_t nk = this->kindex.size();
+            std::vector<T> kd (nk);
+            for (size_t k = 0; k < nk; ++k) { kd[k] = kerneldata[this->kindex[k]]; }
+
+            const int ni = static_cast<int>(this->n);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < ni; ++i) {
+                const unsigned int* tp = this->table.data() + this->pos[i];
+                T sum = T{0};
+                for (size_t k = 0; k < nk; ++k) { sum += dz[tp[this->off[k]]] * kd[k]; }
+                result[this->dindex[i]] = sum;
+            }
+        }
+
+        template <typename T>
+        void convolveFFT (const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result) const
+        {
+            // Data at (x - xmin, y - ymin); kernel element k at -kcoords[k], wrapped, so
+            // that the circular convolution of the two is the sum we want. The arrays are
+            // large enough that nothing wraps onto the domain.
+            const size_t fw = this->fsz[0];
+            const size_t fh = this->fsz[1];
+            std::vector<std::complex<double>> dft (fw * fh, std::complex<double>(0.0, 0.0));
+            std::vector<std::complex<double>> kft (fw * fh, std::complex<double>(0.0, 0.0));
+            for (size_t i = 0; i < this->n; ++i) { dft[this->fftCell (i)] = static_cast<double>(data[this->dindex[i]]); }
+            for (size_t k = 0; k < this->kindex.size(); ++k) {
+                kft[wrap (-this->kcoords[k][1], fh) * fw + wrap (-this->kcoords[k][0], fw)] += static_cast<double>(kerneldata[this->kindex[k]]);
+            }
+            morph::FFT<double>::transform2 (dft, fw, fh);
+            morph::FFT<double>::transform2 (kft, fw, fh);
+            for (size_t j = 0; j < dft.size(); ++j) {
+                const std::complex<double> a = dft[j];
+                const std::complex<double> b = kft[j];
+                dft[j] = std::complex<double> (a.real() * b.real() - a.imag() * b.imag(),
+                                               a.real() * b.imag() + a.imag() * b.real());
+            }
+            morph::FFT<double>::transform2 (dft, fw, fh, true);
+            for (size_t i = 0; i < this->n; ++i) { result[this->dindex[i]] = static_cast<T>(dft[this->fftCell (i)].real()); }
+        }
+
+        //! The position in the FFT arrays of domain element i
+        size_t fftCell (const size_t i) const
+        {
+            const size_t y = this->pos[i] / this->w - static_cast<size_t>(this->reach[1]);
+            const size_t x = this->pos[i] % this->w - static_cast<size_t>(this->reach[0]);
+            return y * this->fsz[0] + x;
+        }
+
+        //! The number of domain elements, and the data index of each
+        size_t n = 0;
+        std::vector<unsigned int> dindex;
+        //! The kernel elements' coordinates and kernel data indices, and one more than the largest index
+        std::vector<std::array<int, 2>> kcoords;
+        std::vector<unsigned int> kindex;
+        size_t kmax = 0;
+        //! The bounding box of the domain, {xmin, xmax, ymin, ymax}, and the kernel's reach in x and y
+        std::array<int, 4> dext = {{ 0, 0, 0, 0 }};
+        std::array<int, 2> reach = {{ 0, 0 }};
+        //! The padded table, w by h, the position in it of each domain element and the
+        //! offset from there of each kernel element's partner
+        size_t w = 0;
+        size_t h = 0;
+        std::vector<unsigned int> table;
+        std::vector<size_t> pos;
+        std::vector<std::ptrdiff_t> off;
+        //! The sizes of the FFT arrays: the domain's box, plus the kernel's reach, up to powers of two
+        std::array<size_t, 2> fsz = {{ 1, 1 }};
+    };
+
+} // namespace morph
@@ -248,6 +248,41 @@ namespace morph {
             return std::make_pair (vmax, vmin);
         }
 
+        /*!
+         * Scalar maxmin for a std::vector, which Scale::autoscale_from uses. It's still
+         * one pass, but keeps four running maxima and minima, so that each comparison
+         * needn't wait for the last and the loop can vectorise.
+         */
+        template <typename T, typename Allocator>
+        static std::pair<T, T> maxmin (const std::vector<T, Allocator>& values) {
+            constexpr size_t lanes = 4;
+            T vmax[lanes];
+            T vmin[lanes];
+            for (size_t j = 0; j < lanes; ++j) {
+                vmax[j] = std::numeric_limits<T>::lowest();
+                vmin[j] = std::numeric_limits<T>::max();
+            }
+            const size_t n = values.size();
+            const size_t nl = n - n % lanes;
+            for (size_t i = 0; i < nl; i += lanes) {
+                for (size_t j = 0; j < lanes; ++j) {
+                    const T v = values[i + j];
+                    vmax[j] = v > vmax[j] ? v : vmax[j];
+                    vmin[j] = v < vmin[j] ? v : vmin[j];
+                }
+            }
+            for (size_t i = nl; i < n; ++i) {
+                const T v = values[i];
+                vmax[0] = v > vmax[0] ? v : vmax[0];
+                vmin[0] = v < vmin[0] ? v : vmin[0];
+            }
+            for (size_t j = 1; j < lanes; ++j) {
+                vmax[0] = vmax[j] > vmax[0] ? vmax[j] : vmax[0];
+                vmin[0] = vmin[j] < vmin[0] ? vmin[j] : vmin[0];
+            }
+            return std::make_pair (vmax[0], vmin[0]);
+        }
+
 #if 0
         //! Scalar centroid implementation. This throws runtime exception. Really it'd
         //! be better to omit it to give a compiler error.
@@ -0,0 +1,135 @@
+/*!
+ * \file
+ *
+ * A min/max pyramid over a growing sequence of values, for drawing a series which has
+ * far more points than there are pixels to show them. Level k divides the sequence
+ * into buckets of 2^k values and records where the smallest and largest value of each
+ * bucket lie. decimate() covers a range of the sequence with the buckets of the finest
+ * level that needs no more than a given number of them, and returns the indices of
+ * each bucket's minimum and maximum in sequence order. A line through those points has
+ * the same envelope as one through every point, so no peak goes missing, however long
+ * the series is.
+ *
+ * Appending a value is amortised O(1), and the pyramid adds about one bucket (two
+ * indices) per value to the storage of the values themselves.
+ */
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace morph {
+
+    template <typename T>
+    class MinMaxPyramid
+    {
+    public:
+        //! Append \a v to the sequence
+        void push (const T& v)
+        {
+            this->values.push_back (v);
+            const size_t n = this->values.size();
+            if (n % 2 != 0) { return; }
+            // A level 1 bucket is now complete, which may complete one at each level above
+            this->add (1, this->combine ({n - 2, n - 2}, {n - 1, n - 1}));
+            for (size_t k = 1; this->levels[k-1].size() % 2 == 0; ++k) {
+                const std::vector<bucket>& lk = this->levels[k-1];
+                this->add (k + 1, this->combine (lk[lk.size() - 2], lk.back()));
+            }
+        }
+
+        //! Replace the sequence with \a vals
+        void assign (const std::vector<T>& vals)
+        {
+            this->clear();
+            this->values.reserve (vals.size());
+            for (const auto& v : vals) { this->push (v); }
+        }
+
+        void clear()
+        {
+            this->values.clear();
+            this->levels.clear();
+        }
+
+        size_t size() const { return this->values.size(); }
+        const T& operator[] (const size_t i) const { return this->values[i]; }
+
+        //! The number of levels above the values themselves
+        size_t numLevels() const { return this->levels.size(); }
+
+        //! The level at which \a n values span no more than \a maxbuckets buckets
+        size_t levelFor (const size_t n, const size_t maxbuckets) const
+        {
+            size_t k = 0;
+            while (k < this->levels.size() && (n >> k) > std::max (maxbuckets, size_t{1})) { ++k; }
+            return k;
+        }
+
+        /*!
+         * Fill \a idx with the indices, in increasing order, of the points which outline
+         * values [i0, i1) in about \a maxbuckets buckets: the minimum and maximum of each
+         * bucket, plus up to two buckets at each finer level where the range doesn't
+         * line up with the buckets.
+         */
+        void decimate (size_t i0, size_t i1, const size_t maxbuckets, std::vector<size_t>& idx) const
+        {
+            idx.clear();
+            i1 = std::min (i1, this->values.size());
+            if (i1 <= i0) { return; }
+            this->collect (this->levelFor (i1 - i0, maxbuckets), i0, i1, idx);
+        }
+
+    private:
+        //! The indices of the smallest and largest values in a bucket
+        struct bucket
+        {
+            size_t lo;
+            size_t hi;
+        };
+
+        //! The values, then the buckets of levels 1, 2, ... (levels[k-1] is level k)
+        std::vector<T> values;
+        std::vector<std::vector<bucket>> levels;
+
+        //! The bucket covering buckets a and b, where a comes first. Ties go to the earlier value.
+        bucket combine (const bucket& a, const bucket& b) const
+        {
+            return { this->values[b.lo] < this->values[a.lo] ? b.lo : a.lo,
+                     this->values[a.hi] < this->values[b.hi] ? b.hi : a.hi };
+        }
+
+        void add (const size_t k, const bucket& b)
+        {
+            if (this->levels.size() < k) { this->levels.resize (k); }
+            this->levels[k-1].push_back (b);
+        }
+
+        //! Append the outline of [i0, i1) at level k (and finer levels at the ends) to idx
+        void collect (const size_t k, const size_t i0, const size_t i1, std::vector<size_t>& idx) const
+        {
+            if (i1 <= i0) { return; }
+            if (k == 0) {
+                for (size_t i = i0; i < i1; ++i) { idx.push_back (i); }
+                return;
+            }
+            const size_t bsz = size_t{1} << k;
+            const std::vector<bucket>& lk = this->levels[k-1];
+            const size_t j0 = (i0 + bsz - 1) / bsz;
+            const size_t j1 = std::min (i1 / bsz, lk.size());
+            if (j1 <= j0) {
+                this->collect (k - 1, i0, i1, idx);
+                return;
+            }
+            this->collect (k - 1, i0, j0 * bsz, idx);
+            for (size_t j = j0; j < j1; ++j) {
+                const bucket& b = lk[j];
+                idx.push_back (std::min (b.lo, b.hi));
+                if (b.lo != b.hi) { idx.push_back (std::max (b.lo, b.hi)); }
+            }
+            this->collect (k - 1, j1 * bsz, i1, idx);
+        }
+    };
+
+} // namespace morph
@@ -394,6 +394,78 @@ namespace morph {
             DBG ("HexGrid says d = " << this->d);
             this->set_v(this->hg->getv());
             DBG ("HexGrid says v = " << this->v);
+            // Neighbour indices for the stencils of spacegrad2D and compute_laplace
+            this->build_stencils();
+        }
+
+        /*!
+         * Work out, once, the neighbour indices and scale factors used by
+         * spacegrad2D and compute_laplace, so that neither needs to test for missing
+         * neighbours in its loop. A missing neighbour is replaced by a 'ghost' index
+         * which points back at the hex itself. allocate() calls this; call it again
+         * if hg is changed afterwards.
+         */
+        void build_stencils()
+        {
+            const unsigned int n = this->hg->num();
+            // A ghost neighbour is the hex itself: ghost(dn, hi) is dn[hi], or hi if that's -1
+            auto ghost = [](const std::vector<int>& dn, std::vector<unsigned int>& gn) {
+                gn.resize (dn.size());
+                for (unsigned int hi = 0; hi < dn.size(); ++hi) {
+                    gn[hi] = dn[hi] == -1 ? hi : static_cast<unsigned int>(dn[hi]);
+                }
+            };
+            ghost (this->hg->d_ne, this->gh_ne);
+            ghost (this->hg->d_nne, this->gh_nne);
+            ghost (this->hg->d_nnw, this->gh_nnw);
+            ghost (this->hg->d_nw, this->gh_nw);
+            ghost (this->hg->d_nsw, this->gh_nsw);
+            ghost (this->hg->d_nse, this->gh_nse);
+
+            // The x gradient is (f[gx_p] - f[gx_m]) * gx_s and the y gradient is
+            // ((f[gy_q[0]] - f[gy_q[1]]) + (f[gy_q[2]] - f[gy_q[3]])) * gy_s, with the
+            // neighbours and scale chosen from those each hex has.
+            this->gx_p.resize (n);
+            this->gx_m.resize (n);
+            this->gx_s.resize (n);
+            for (auto& g : this->gy_q) { g.resize (n); }
+            this->gy_s.resize (n);
+            for (unsigned int hi = 0; hi < n; ++hi) {
+                this->gx_p[hi] = this->gh_ne[hi];
+                this->gx_m[hi] = this->gh_nw[hi];
+                if (HAS_NE(hi) && HAS_NW(hi)) {
+                    this->gx_s[hi] = this->oneover2d;
+                } else if (HAS_NE(hi) || HAS_NW(hi)) {
+                    this->gx_s[hi] = this->oneoverd;
+                } else {
+                    this->gx_s[hi] = Flt{0};
+                }
+
+                std::array<unsigned int, 4> q = {{ hi, hi, hi, hi }};
+                Flt s = Flt{0};
+                if (HAS_NNW(hi) && HAS_NNE(hi) && HAS_NSW(hi) && HAS_NSE(hi)) {
+                    // The mean of the nse->nne and nsw->nnw gradients
+                    q = {{ this->gh_nne[hi], this->gh_nse[hi], this->gh_nnw[hi], this->gh_nsw[hi] }};
+                    s = this->oneover4v;
+                } else if (HAS_NNW(hi) && HAS_NNE(hi)) {
+                    // The gradient from hi to the mean of nne and nnw
+                    q = {{ this->gh_nne[hi], hi, this->gh_nnw[hi], hi }};
+                    s = this->oneover2v;
+                } else if (HAS_NSW(hi) && HAS_NSE(hi)) {
+                    q = {{ hi, this->gh_nse[hi], hi, this->gh_nsw[hi] }};
+                    s = this->oneover2v;
+                } else if (HAS_NNW(hi) && HAS_NSW(hi)) {
+                    q = {{ this->gh_nnw[hi], this->gh_nsw[hi], hi, hi }};
+                    s = this->oneover2v;
+                } else if (HAS_NNE(hi) && HAS_NSE(hi)) {
+                    q = {{ this->gh_nne[hi], this->gh_nse[hi], hi, hi }};
+                    s = this->oneover2v;
+                }
+                for (unsigned int j = 0; j < 4; ++j) { this->gy_q[j][hi] = q[j]; }
+                this->gy_s[hi] = s;
+            }
+            this->stencil_d = this->d;
+            this->stencil_v = this->v;
         }
 
         /*!
@@ -426,6 +498,34 @@ namespace morph {
             this->oneover4v = 1.0/(this->twov+this->twov);
         }
 
+        /*!
+         * The stencils built by build_stencils(). gh_ne[hi] is the index of hex hi's
+         * neighbour to the east, or hi if it has none, and so on around the hex.
+         */
+        std::vector<unsigned int> gh_ne;
+        std::vector<unsigned int> gh_nne;
+        std::vector<unsigned int> gh_nnw;
+        std::vector<unsigned int> gh_nw;
+        std::vector<unsigned int> gh_nsw;
+        std::vector<unsigned int> gh_nse;
+        //! The neighbours and scale factor of each hex's x and y gradients
+        std::vector<unsigned int> gx_p;
+        std::vector<unsigned int> gx_m;
+        std::vector<Flt> gx_s;
+        std::array<std::vector<unsigned int>, 4> gy_q;
+        std::vector<Flt> gy_s;
+        //! The d and v the scale factors were computed for
+        Flt stencil_d = Flt{0};
+        Flt stencil_v = Flt{0};
+
+        //! Build the stencils if the grid or its d or v have changed since they were built
+        void check_stencils()
+        {
+            if (this->gh_ne.size() != this->hg->num() || this->stencil_d != this->d || this->stencil_v != this->v) {
+                this->build_stencils();
+            }
+        }
+
     public:
         /*!
          * Public getters for d and v
@@ -593,44 +693,30 @@ namespace morph {
          * 2D spatial integration of the function f. Result placed in gradf.
          *
          * For each Hex, work out the gradient in x and y directions
-         * using whatever neighbours can contribute to an estimate.
+         * using whatever neighbours can contribute to an estimate. The
+         * choice of neighbours is made by build_stencils(), so the loop
+         * here is a plain gather, which the compiler can vectorise.
          */
         void spacegrad2D (std::vector<Flt>& f, std::array<std::vector<Flt>, 2>& gradf) {
 
+            this->check_stencils();
+            const Flt* fp = f.data();
+            Flt* gx = gradf[0].data();
+            Flt* gy = gradf[1].data();
+            const unsigned int* xp = this->gx_p.data();
+            const unsigned int* xm = this->gx_m.data();
+            const Flt* xs = this->gx_s.data();
+            const unsigned int* ya = this->gy_q[0].data();
+            const unsigned int* yb = this->gy_q[1].data();
+            const unsigned int* yc = this->gy_q[2].data();
+            const unsigned int* ye = this->gy_q[3].data();
+            const Flt* ys = this->gy_s.data();
+
             // Note - East is positive x; North is positive y.
-#pragma omp parallel for schedule(static)
+#pragma omp parallel for simd schedule(static)
             for (unsigned int hi=0; hi<this->nhex; ++hi) {
-
-                // Find x gradient
-                if (HAS_NE(hi) && HAS_NW(hi)) {
-                    gradf[0][hi] = (f[NE(hi)] - f[NW(hi)]) * oneover2d;
-                } else if (HAS_NE(hi)) {
-                    gradf[0][hi] = (f[NE(hi)] - f[hi]) * oneoverd;
-                } else if (HAS_NW(hi)) {
-                    gradf[0][hi] = (f[hi] - f[NW(hi)]) * oneoverd;
-                } else {
-                    // zero gradient in x direction as no neighbours in
-                    // those directions? Or possibly use the average of
-                    // the gradient between the nw,ne and sw,se neighbours
-                    gradf[0][hi] = Flt{0};
-                }
-
-                // Find y gradient
-                if (HAS_NNW(hi) && HAS_NNE(hi) && HAS_NSW(hi) && HAS_NSE(hi)) {
-                    // Full complement. Compute the mean of the nse->nne and nsw->nnw gradients
-                    gradf[1][hi] = ( (f[NNE(hi)] - f[NSE(hi)]) + (f[NNW(hi)] - f[NSW(hi)]) ) * oneover4v;
-                } else if (HAS_NNW(hi) && HAS_NNE(hi)) {
-                    gradf[1][hi] = ( (f[NNE(hi)] + f[NNW(hi)]) * Flt{0.5} - f[hi]) * oneoverv;
-                } else if (HAS_NSW(hi) && HAS_NSE(hi)) {
-                    gradf[1][hi] = (f[hi] - (f[NSE(hi)] + f[NSW(hi)]) * Flt{0.5}) * oneoverv;
-                } else if (HAS_NNW(hi) && HAS_NSW(hi)) {
-                    gradf[1][hi] = (f[NNW(hi)] - f[NSW(hi)]) * oneover2v;
-                } else if (HAS_NNE(hi) && HAS_NSE(hi)) {
-                    gradf[1][hi] = (f[NNE(hi)] - f[NSE(hi)]) * oneover2v;
-                } else {
-                    // Leave grady at 0
-                    gradf[1][hi] = Flt{0};
-                }
+                gx[hi] = (fp[xp[hi]] - fp[xm[hi]]) * xs[hi];
+                gy[hi] = ((fp[ya[hi]] - fp[yb[hi]]) + (fp[yc[hi]] - fp[ye[hi]])) * ys[hi];
             }
         }
 
@@ -638,48 +724,49 @@ namespace morph {
          * Compute laplacian of scalar field F, with result placed in lapF.
          */
         virtual void compute_laplace (const std::vector<Flt>& F, std::vector<Flt>& lapF) {
+            Flt* lp = lapF.data();
+            this->compute_laplace_fused (F, [lp](unsigned int hi, Flt lap) { lp[hi] = lap; });
+        }
 
-            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+        /*!
+         * Compute the laplacian of scalar field F and, in the same pass, call
+         * update (hi, lap) with the laplacian, lap, at each hex hi. This saves writing
+         * the laplacian out and reading it back in when it is only needed for one
+         * reaction term, e.g.
+         *
+         *   this->compute_laplace_fused (A, [&](unsigned int h, Flt lapA) {
+         *       dAdt[h] = this->k1 - this->k2 * A[h] + this->D_A * lapA;
+         *   });
+         *
+         * The loop is parallel and vectorised (omp parallel for simd), so update is
+         * called for many hi at once and should only read and write element hi of the
+         * vectors it changes.
+         */
+        template <typename Fn>
+        void compute_laplace_fused (const std::vector<Flt>& F, Fn update) {
 
-#pragma omp parallel for schedule(static)
+            this->check_stencils();
+            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            const Flt* f = F.data();
+            const unsigned int* ne = this->gh_ne.data();
+            const unsigned int* nne = this->gh_nne.data();
+            const unsigned int* nnw = this->gh_nnw.data();
+            const unsigned int* nw = this->gh_nw.data();
+            const unsigned int* nsw = this->gh_nsw.data();
+            const unsigned int* nse = this->gh_nse.data();
+
+#pragma omp parallel for simd schedule(static)
             for (unsigned int hi=0; hi<this->nhex; ++hi) {
-
-                // 1. The D Del^2 term
-
-                // Compute the sum around the neighbours
-                Flt thesum = Flt{-6} * F[hi];
-                if (HAS_NE(hi)) {
-                    thesum += F[NE(hi)];
-                } else {
-                    thesum += F[hi]; // A ghost neighbour-east with same value as Hex_0
-                }
-                if (HAS_NNE(hi)) {
-                    thesum += F[NNE(hi)];
-                } else {
-                    thesum += F[hi];
-                }
-                if (HAS_NNW(hi)) {
-                    thesum += F[NNW(hi)];
-                } else {
-                    thesum += F[hi];
-                }
-                if (HAS_NW(hi)) {
-                    thesum += F[NW(hi)];
-                } else {
-                    thesum += F[hi];
-                }
-                if (HAS_NSW(hi)) {
-                    thesum += F[NSW(hi)];
-                } else {
-                    thesum += F[hi];
-                }
-                if (HAS_NSE(hi)) {
-                    thesum += F[NSE(hi)];
-                } else {
-                    thesum += F[hi];
-                }
-
-                lapF[hi] = norm * thesum;
+                // The sum around the neighbours, where a missing neighbour is a ghost
+                // with the same value as hex hi
+                Flt thesum = Flt{-6} * f[hi];
+                thesum += f[ne[hi]];
+                thesum += f[nne[hi]];
+                thesum += f[nnw[hi]];
+                thesum += f[nw[hi]];
+                thesum += f[nsw[hi]];
+                thesum += f[nse[hi]];
+                update (hi, norm * thesum);
             }
         }
 
@@ -41,6 +41,8 @@
 
 #include <stdexcept>
 #include <cmath>
+#include <vector>
+#include <utility>
 #include <morph/MathAlgo.h>
 #include <morph/number_type.h>
 
@@ -241,6 +243,8 @@ namespace morph {
             this->type = ScaleFn::Linear;
         }
 
+        ScaleFn getType() const { return this->type; }
+
         virtual bool ready() const = 0;
 
     protected:
@@ -416,6 +420,57 @@ namespace morph {
             return rtn;
         }
 
+        // The scalar transform()s below overload those for any container in ScaleImplBase
+        using ScaleImplBase<T, S>::transform;
+
+        /*!
+         * \brief Transform a std::vector of scalars.
+         *
+         * The same as ScaleImplBase::transform, but without a virtual call per element:
+         * the work is done by transform (const T*, S*, size_t). \a data and \a output may
+         * be the same vector (if T and S are the same type), to transform in place.
+         */
+        void transform (const std::vector<T>& data, std::vector<S>& output)
+        {
+            if (output.size() != data.size()) {
+                throw std::runtime_error ("ScaleImpl::transform(): Ensure data.size()==output.size()");
+            }
+            if (this->do_autoscale == true && this->autoscaled == false) {
+                this->autoscale_from (data);
+            }
+            this->transform (data.data(), output.data(), data.size());
+        }
+
+        /*!
+         * \brief Transform \a n scalars from \a data into \a output
+         *
+         * Gives the same results as transform_one(), element by element: the arithmetic is
+         * done in the same type (that of a T times an S, so double for double data into
+         * float output) and only the result is converted to S. The loops have no calls or
+         * branches in them, so that the compiler can vectorise them. \a output may be
+         * \a data (if T and S are the same type), to transform in place, but the two must
+         * not otherwise overlap. This does not autoscale; params must be set.
+         */
+        void transform (const T* data, S* output, const size_t n) const
+        {
+            if (!this->ready()) {
+                throw std::runtime_error ("ScaleImpl::transform(): Scale has no params; set do_autoscale or call setParams()");
+            }
+            // The type transform_one_linear computes datum * params[0] + params[1] in
+            using C = decltype(std::declval<T>() * std::declval<S>());
+            // Local copies, which the compiler can see don't alias output
+            const C m = static_cast<C>(this->params[0]);
+            const C c = static_cast<C>(this->params[1]);
+            if (this->type == ScaleFn::Logarithmic) {
+                // transform_one_log passes log(datum) on as a T
+                for (size_t i = 0; i < n; ++i) { output[i] = static_cast<S>(static_cast<T>(std::log (data[i])) * m + c); }
+            } else if (this->type == ScaleFn::Linear) {
+                for (size_t i = 0; i < n; ++i) { output[i] = static_cast<S>(data[i] * m + c); }
+            } else {
+                throw std::runtime_error ("Unknown scaling");
+            }
+        }
+
         virtual T inverse_one (const S& datum) const
         {
             T rtn = T{0};
@@ -36,26 +36,32 @@ namespace morph {
             this->viewmatrix.translate (this->mv_offset);
             this->zScale.setParams (1, 0);
             this->colourScale.do_autoscale = true;
+            // One unit sphere, drawn at each point. Set false before finalize() to
+            // build a sphere per point instead (e.g. to export the plot with savegltf)
+            this->instanced = true;
         }
 
-        //! Quick hack to add an additional point
+        //! Quick hack to add an additional point. Only the new point is uploaded.
         void add (morph::Vector<float> coord, Flt value)
         {
-            std::array<float, 3> clr = this->cm.convert (this->colourScale.transform_one (value));
-            this->computeSphere (this->idx, coord, clr, this->radiusFixed, 16, 20);
-            this->reinit_buffers();
+            this->add (coord, value, this->radiusFixed);
         }
         //! Additional point with variable size
         void add (morph::Vector<float> coord, Flt value, Flt size)
         {
             std::array<float, 3> clr = this->cm.convert (this->colourScale.transform_one (value));
-            this->computeSphere (this->idx, coord, clr, size, 16, 20);
+            this->sphere (coord, clr, size);
             this->reinit_buffers();
         }
 
         //! Compute spheres for a scatter plot
         void initializeVertices()
         {
+            // The base mesh of an instanced scatter plot
+            if (this->instanced == true) {
+                this->computeSphere (this->idx, {0.0f, 0.0f, 0.0f}, morph::colour::white, 1.0f, 16, 20);
+            }
+
             unsigned int ncoords = this->dataCoords == nullptr ? 0 : this->dataCoords->size();
             if (ncoords == 0) { return; }
             unsigned int ndata = this->scalarData == nullptr ? 0 : this->scalarData->size();
@@ -120,13 +126,23 @@ namespace morph {
                     clr = this->cm.convert (vdcopy1[i], vdcopy2[i]);
                 }
                 if (this->sizeFactor == Flt{0}) {
-                    this->computeSphere (this->idx, (*this->dataCoords)[i], clr, this->radiusFixed, 16, 20);
+                    this->sphere ((*this->dataCoords)[i], clr, this->radiusFixed);
                 } else {
-                    this->computeSphere (this->idx, (*this->dataCoords)[i], clr, dcopy[i]*this->sizeFactor, 16, 20);
+                    this->sphere ((*this->dataCoords)[i], clr, dcopy[i]*this->sizeFactor);
                 }
             }
         }
 
+        //! Add a sphere of radius \a r at \a coord: an instance of the unit sphere, or its own mesh
+        void sphere (const morph::Vector<float>& coord, const std::array<float, 3>& clr, const float r)
+        {
+            if (this->instanced == true) {
+                this->instance_push (coord, r, clr);
+            } else {
+                this->computeSphere (this->idx, coord, clr, r, 16, 20);
+            }
+        }
+
         //! Set this->radiusFixed, then re-compute vertices.
         void setRadius (float fr)
         {
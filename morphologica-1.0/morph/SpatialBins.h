@@ -0,0 +1,166 @@
+/*!
+ * \file
+ *
+ * A uniform grid of square bins over a set of 2D points, for finding the points within
+ * a fixed radius of each other without comparing every pair. build() sorts the points
+ * into bins whose side is at least the radius, so every point within the radius of p
+ * lies in p's bin or one of the eight around it; forEachNear() visits the points in
+ * those nine bins. For agents which interact over a short range, that makes a step of
+ * a simulation O(N) rather than O(N^2).
+ *
+ * The grid covers the bounding box of the points, which is found again on each build,
+ * so points may wander anywhere. Rebuilding is a counting sort: two passes over the
+ * points, and no allocation once the storage has grown to fit. The points are copied,
+ * in bin order, so that a query reads contiguous memory. build() and forEachNear() may
+ * not run at the same time, but any number of forEachNear() calls may.
+ */
+#pragma once
+
+#include <morph/Vector.h>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+namespace morph {
+
+    template <typename T>
+    class SpatialBins
+    {
+    public:
+        /*!
+         * Sort \a pts into bins for queries out to \a radius. If the points are so spread
+         * out that bins of side radius would greatly outnumber the points, the bins are
+         * made larger, which is still correct, just less selective. Points with a
+         * non-finite coordinate are left out of every bin.
+         */
+        void build (const std::vector<morph::Vector<T, 2>>& pts, const T radius)
+        {
+            if (!(radius > T{0})) { throw std::runtime_error ("SpatialBins::build: radius must be > 0"); }
+
+            // The bounding box of the (finite) points
+            morph::Vector<T, 2> lo = { std::numeric_limits<T>::max(), std::numeric_limits<T>::max() };
+            morph::Vector<T, 2> hi = { std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest() };
+            for (const auto& p : pts) {
+                if (!std::isfinite (p[0]) || !std::isfinite (p[1])) { continue; }
+                lo[0] = std::min (lo[0], p[0]);
+                lo[1] = std::min (lo[1], p[1]);
+                hi[0] = std::max (hi[0], p[0]);
+                hi[1] = std::max (hi[1], p[1]);
+            }
+            if (lo[0] > hi[0]) { lo = { T{0}, T{0} }; hi = { T{0}, T{0} }; } // no finite points
+
+            // Bins of side radius, unless that would give more than a few per point. The
+            // numbers of bins are found as T, and only cast once they're known to be
+            // small, so that a huge extent (or a tiny radius) can't overflow the cast.
+            const size_t maxbins = 4 * pts.size() + 16;
+            const T maxb = static_cast<T>(maxbins);
+            this->origin = lo;
+            this->side = radius;
+            for (;;) {
+                const T bx = std::floor (this->binCoord (hi[0], 0)) + T{1};
+                const T by = std::floor (this->binCoord (hi[1], 1)) + T{1};
+                if (bx <= maxb && by <= maxb && bx * by <= maxb) {
+                    this->nx = static_cast<size_t>(bx);
+                    this->ny = static_cast<size_t>(by);
+                    break;
+                }
+                this->side *= T{2};
+            }
+
+            // Count the points in each bin, then place them, in order, after the points of
+            // the bins before
+            const size_t nbins = this->nx * this->ny;
+            this->bin.resize (pts.size());
+            this->start.assign (nbins + 1, 0);
+            for (size_t i = 0; i < pts.size(); ++i) {
+                this->bin[i] = this->binOf (pts[i]);
+                if (this->bin[i] < nbins) { ++this->start[this->bin[i] + 1]; }
+            }
+            for (size_t b = 0; b < nbins; ++b) { this->start[b + 1] += this->start[b]; }
+            const size_t nbinned = this->start[nbins];
+            this->index.resize (nbinned);
+            this->points.resize (nbinned);
+            this->fill.assign (this->start.begin(), this->start.end() - 1);
+            for (size_t i = 0; i < pts.size(); ++i) {
+                if (this->bin[i] >= nbins) { continue; }
+                const size_t j = this->fill[this->bin[i]]++;
+                this->index[j] = i;
+                this->points[j] = pts[i];
+            }
+        }
+
+        /*!
+         * Call \a f (i, pt) for each point which could be within the radius of \a p: pt is
+         * the point and i its index in the container passed to build(). Points further
+         * away are visited too, so f should check the distance if it matters.
+         */
+        template <typename F>
+        void forEachNear (const morph::Vector<T, 2>& p, F f) const
+        {
+            if (this->start.empty() || !std::isfinite (p[0]) || !std::isfinite (p[1])) { return; }
+            // p's bin, which may be outside the grid, as a real number so it can't overflow
+            const T fx = std::floor (this->binCoord (p[0], 0));
+            const T fy = std::floor (this->binCoord (p[1], 1));
+            if (fx < T{-1} || fy < T{-1} || fx > static_cast<T>(this->nx) || fy > static_cast<T>(this->ny)) { return; }
+            const long long bx = static_cast<long long>(fx);
+            const long long by = static_cast<long long>(fy);
+            const long long x0 = std::max (bx - 1, 0LL);
+            const long long x1 = std::min (bx + 1, static_cast<long long>(this->nx) - 1);
+            const long long y0 = std::max (by - 1, 0LL);
+            const long long y1 = std::min (by + 1, static_cast<long long>(this->ny) - 1);
+            for (long long y = y0; y <= y1; ++y) {
+                // The bins of a row are contiguous, and so are their points
+                const size_t b0 = static_cast<size_t>(y) * this->nx + static_cast<size_t>(x0);
+                const size_t b1 = static_cast<size_t>(y) * this->nx + static_cast<size_t>(x1);
+                for (size_t j = this->start[b0]; j < this->start[b1 + 1]; ++j) {
+                    f (this->index[j], this->points[j]);
+                }
+            }
+        }
+
+        //! The side of a bin, which is at least the radius given to build()
+        T binSide() const { return this->side; }
+        //! The number of bins across and up
+        size_t width() const { return this->nx; }
+        size_t height() const { return this->ny; }
+
+    private:
+        //! The bin of \a p, or a number >= nx * ny if p has a non-finite coordinate
+        size_t binOf (const morph::Vector<T, 2>& p) const
+        {
+            if (!std::isfinite (p[0]) || !std::isfinite (p[1])) { return this->nx * this->ny; }
+            const size_t x = static_cast<size_t>(std::min (this->binCoord (p[0], 0), static_cast<T>(this->nx - 1)));
+            const size_t y = static_cast<size_t>(std::min (this->binCoord (p[1], 1), static_cast<T>(this->ny - 1)));
+            return y * this->nx + x;
+        }
+
+        /*!
+         * (v - origin[ax]) / side, the distance of v from the grid's lower edge on axis
+         * ax in bins. It is worked out with the operands halved (which is exact), so that
+         * v - origin can't overflow to infinity for finite v however far apart they are.
+         */
+        T binCoord (const T v, const unsigned int ax) const
+        {
+            return (v * T{0.5} - this->origin[ax] * T{0.5}) / (this->side * T{0.5});
+        }
+
+        //! The lower left corner of bin 0, and the side of a bin
+        morph::Vector<T, 2> origin = { T{0}, T{0} };
+        T side = T{1};
+        size_t nx = 0;
+        size_t ny = 0;
+        //! start[b] is the position in index and points of bin b's first point; start[nx*ny]
+        //! is the number of points binned
+        std::vector<size_t> start;
+        //! The points' indices and coordinates, in bin order
+        std::vector<size_t> index;
+        std::vector<morph::Vector<T, 2>> points;
+        //! Scratch for build(): the bin of each point, and the next free place in each bin
+        std::vector<size_t> bin;
+        std::vector<size_t> fill;
+    };
+
+} // namespace morph
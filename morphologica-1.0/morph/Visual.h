@@ -32,6 +32,7 @@
 #endif
 
 #include <morph/VisualResources.h>
+#include <morph/Profiler.h>
 #include <morph/nlohmann/json.hpp>
 #include <morph/CoordArrows.h>
 #include <morph/Quaternion.h>
@@ -48,7 +49,12 @@
 // Use Lode Vandevenne's PNG encoder
 #define LODEPNG_NO_COMPILE_DECODER 1
 #define LODEPNG_NO_COMPILE_ANCILLARY_CHUNKS 1
-#include <morph/lodepng.h>
+// FrameEncoder includes lodepng.h, which may only be included once
+#include <morph/FrameEncoder.h>
+#include <memory>
+#include <deque>
+#include <cstdlib>
+#include <cstdio>
 
 //! The default z=0 position for VisualModels
 #define Z_DEFAULT -5
@@ -118,11 +124,18 @@ namespace morph {
         /*!
          * Construct a new visualiser. The rule is 1 window to one Visual object. So,
          * this creates a new window and a new OpenGL context.
+         *
+         * If \a _headless, the window is never shown and the scene is rendered into an
+         * offscreen framebuffer of width x height, for saveImage() or startRecording() in
+         * batch jobs. Where there's no display at all (neither DISPLAY nor WAYLAND_DISPLAY
+         * is set), GLFW is started on its null platform with an OSMesa context, which
+         * needs GLFW 3.4 or later; with an older GLFW, run under xvfb-run instead.
          */
-        Visual (int width, int height, const std::string& _title)
+        Visual (int width, int height, const std::string& _title, const bool _headless = false)
             : window_w(width)
             , window_h(height)
             , title(_title)
+            , headless(_headless)
         {
             this->init();
         }
@@ -157,8 +170,17 @@ namespace morph {
             }
             for (auto t : this->texts) { delete t; }
             this->texts.clear();
+            glfwMakeContextCurrent (this->window);
+            if (this->encoder) { this->stopRecording(); }
+            if (this->headless) {
+                glDeleteFramebuffers (2, this->offscreen_fbo);
+                glDeleteRenderbuffers (3, this->offscreen_rbo);
+            }
+            // The line and grid programs, which VisualResources forgets in deregister()
+            glDeleteProgram (this->lshaderprog);
+            glDeleteProgram (this->gshaderprog);
             glfwDestroyWindow (this->window);
-            morph::VisualResources::deregister();
+            morph::VisualResources::deregister (this->window);
         }
 
         //! Take a screenshot of the window
@@ -194,6 +216,49 @@ namespace morph {
             delete[] bits;
         }
 
+        /*!
+         * Write every frame rendered from now on to a file named \a prefix, then the frame
+         * number (from 0, in five digits), then \a suffix. A suffix of ".png" gives PNG files;
+         * anything else gives raw RGBA (see morph::FrameEncoder). Each frame is read back
+         * asynchronously, into one of a ring of pixel buffer objects, and is only copied out
+         * a frame or two later, once the GPU has finished with it. It is then encoded on
+         * one of \a nthreads worker threads, so recording costs the render loop about a
+         * memcpy per frame.
+         */
+        void startRecording (const std::string& prefix, const std::string& suffix = ".png", const unsigned int nthreads = 2)
+        {
+            if (this->encoder) { this->stopRecording(); }
+            this->rec_prefix = prefix;
+            this->rec_suffix = suffix;
+            this->rec_frame = 0;
+            this->encoder = std::make_unique<morph::FrameEncoder> (nthreads);
+        }
+
+        //! Stop recording, once every frame rendered so far has been written
+        void stopRecording()
+        {
+            if (!this->encoder) { return; }
+            glfwMakeContextCurrent (this->window);
+            while (!this->pending_readbacks.empty()) { this->collectFrame (true); }
+            this->encoder->finish();
+            if (this->encoder->failed() > 0) {
+                std::cerr << "Visual: " << this->encoder->failed() << " frames could not be written\n";
+            }
+            this->encoder.reset();
+            for (auto& rb : this->readbacks) {
+                if (rb.pbo != 0) { glDeleteBuffers (1, &rb.pbo); }
+                rb = readback();
+            }
+            this->next_readback = 0;
+        }
+
+        bool isRecording() const { return static_cast<bool>(this->encoder); }
+        //! The number of frames captured since startRecording()
+        uint64_t framesRecorded() const { return this->rec_frame; }
+
+        //! Make the next render() draw the scene, even if it can't see anything that has changed
+        void markChanged() { this->scene_changed = true; }
+
         //! Make this Visual the current one, so that when creating/adding a visual
         //! model, the vao ids relate to the correct OpenGL context.
         void setCurrent() { glfwMakeContextCurrent (this->window); }
@@ -208,6 +273,7 @@ namespace morph {
         unsigned int addVisualModel (VisualModel* model)
         {
             this->vm.push_back (model);
+            this->scene_changed = true;
             unsigned int rtn = (this->vm.size()-1);
             return rtn;
         }
@@ -226,6 +292,7 @@ namespace morph {
         {
             delete this->vm[modelId];
             this->vm.erase (this->vm.begin() + modelId);
+            this->scene_changed = true;
         }
 
         //! Add a text label to the scene at a given location. Return the width and
@@ -254,13 +321,16 @@ namespace morph {
             tm = new morph::VisualTextModel (this->tshaderprog, _font, _fontsize, _fontres);
             tm->setupText (_text, _toffset, _tcolour);
             this->texts.push_back (tm);
+            this->scene_changed = true;
             return tm->getTextGeometry();
         }
 
         /*!
          * Keep on rendering until readToFinish is set true. Used to keep a window open,
-         * and responsive, while displaying the result of a simulation. FIXME: This
-         * won't work for two or more windows because it will block.
+         * and responsive, while displaying the result of a simulation. Frames in which
+         * nothing has changed are not drawn (see render()), so an idle window costs
+         * next to nothing. FIXME: This won't work for two or more windows because it
+         * will block.
          */
         void keepOpen()
         {
@@ -270,17 +340,31 @@ namespace morph {
             }
         }
 
-        //! Render the scene
+        /*!
+         * Render the scene, if it has changed since the last frame. The scene has changed
+         * if any of the settings it is drawn with (the view, projection, background,
+         * lighting, window size and so on) have changed, a model or text has been added or
+         * removed, or any VisualModel reports hasChanged(). Otherwise this returns at
+         * once, without drawing or swapping buffers, so it is cheap to call render()
+         * every time round a loop. While recording, every call draws a frame.
+         *
+         * Call markChanged() first for a change that render() can't see.
+         */
         void render()
         {
+            if (this->needsRender() == false) { return; }
+            MORPH_PROFILE_SCOPE ("Visual::render");
 #ifdef PROFILE_RENDER
             steady_clock::time_point renderstart = steady_clock::now();
 #endif
             glfwMakeContextCurrent (this->window);
+            // A headless Visual draws into its offscreen framebuffer
+            if (this->headless) { glBindFramebuffer (GL_FRAMEBUFFER, this->offscreen_fbo[0]); }
 
 #ifdef __OSX__
             // https://stackoverflow.com/questions/35715579/opengl-created-window-size-twice-as-large
-            const double retinaScale = 2; // deals with quadrant issue on osx
+            // The offscreen framebuffer of a headless Visual is window_w x window_h, though.
+            const double retinaScale = this->headless ? 1 : 2; // deals with quadrant issue on osx
 #else
             const double retinaScale = 1; // Qt has devicePixelRatio() to get retinaScale.
 #endif
@@ -317,27 +401,7 @@ namespace morph {
             glClearBufferfv (GL_COLOR, 0, bgcolour.data());
 
             // Lighting shader variables
-            //
-            // Ambient light colour
-            GLint loc_lightcol = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("light_colour"));
-            if (loc_lightcol != -1) {
-                glUniform3fv (loc_lightcol, 1, this->light_colour.data());
-            }
-            // Ambient light intensity
-            GLint loc_ai = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("ambient_intensity"));
-            if (loc_ai != -1) {
-                glUniform1f (loc_ai, this->ambient_intensity);
-            }
-            // Diffuse light position
-            GLint loc_dp = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("diffuse_position"));
-            if (loc_dp != -1) {
-                glUniform3fv (loc_dp, 1, this->diffuse_position.data());
-            }
-            // Diffuse light intensity
-            GLint loc_di = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("diffuse_intensity"));
-            if (loc_di != -1) {
-                glUniform1f (loc_di, this->diffuse_intensity);
-            }
+            this->setLighting (this->ulocs);
 
 #if 0
             // A quick-n-dirty attempt to keep the light position fixed in camera space.
@@ -351,23 +415,38 @@ namespace morph {
             TransformMatrix<float> lv_matrix;
             lv_matrix.translate (l_v0);
             lv_matrix.rotate (this->rotation);
-            GLint loc_lv = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("lv_matrix"));
-            if (loc_lv != -1) { glUniformMatrix4fv (loc_lv, 1, GL_FALSE, lv_matrix.mat.data()); }
+            if (this->ulocs->lv_matrix != -1) { glUniformMatrix4fv (this->ulocs->lv_matrix, 1, GL_FALSE, lv_matrix.mat.data()); }
             std::cout << "lv_matrix:\n" << lv_matrix.str() << std::endl;
             std::cout << "p_matrix:\n" << this->projection.str() << std::endl;
             morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
             // Switch to text shader program and set the projection matrix
             glUseProgram (this->tshaderprog);
-            GLint loc_p = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("p_matrix"));
-            if (loc_p != -1) { glUniformMatrix4fv (loc_p, 1, GL_FALSE, this->projection.mat.data()); }
+            if (this->tulocs->p_matrix != -1) {
+                glUniformMatrix4fv (this->tulocs->p_matrix, 1, GL_FALSE, this->projection.mat.data());
+            }
+
+            // The line shader program has the same lighting and projection
+            glUseProgram (this->lshaderprog);
+            this->setLighting (this->lulocs);
+            if (this->lulocs->p_matrix != -1) {
+                glUniformMatrix4fv (this->lulocs->p_matrix, 1, GL_FALSE, this->projection.mat.data());
+            }
+
+            // As does the grid shader program
+            glUseProgram (this->gshaderprog);
+            this->setLighting (this->gulocs);
+            if (this->gulocs->p_matrix != -1) {
+                glUniformMatrix4fv (this->gulocs->p_matrix, 1, GL_FALSE, this->projection.mat.data());
+            }
 
             // Switch back to the regular shader prog and render the VisualModels.
             glUseProgram (this->shaderprog);
 
             // Set the projection matrix just once
-            loc_p = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("p_matrix"));
-            if (loc_p != -1) { glUniformMatrix4fv (loc_p, 1, GL_FALSE, this->projection.mat.data()); }
+            if (this->ulocs->p_matrix != -1) {
+                glUniformMatrix4fv (this->ulocs->p_matrix, 1, GL_FALSE, this->projection.mat.data());
+            }
 
             if (this->showCoordArrows == true) {
                 // Ensure coordarrows centre sphere will be visible on BG:
@@ -392,6 +471,7 @@ namespace morph {
                 } else {
                     (*vmi)->setSceneMatrix (sceneview);
                 }
+                (*vmi)->setProjection (this->projection, this->window_w * retinaScale, this->window_h * retinaScale);
                 (*vmi)->render();
                 ++vmi;
             }
@@ -414,7 +494,20 @@ namespace morph {
                 t->render();
             }
 
-            glfwSwapBuffers (this->window);
+            if (this->headless) {
+                // Resolve the multisampled image, leaving it bound for reading (saveImage and recording)
+                glBindFramebuffer (GL_READ_FRAMEBUFFER, this->offscreen_fbo[0]);
+                glBindFramebuffer (GL_DRAW_FRAMEBUFFER, this->offscreen_fbo[1]);
+                glBlitFramebuffer (0, 0, this->window_w, this->window_h, 0, 0, this->window_w, this->window_h,
+                                   GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer (GL_READ_FRAMEBUFFER, this->offscreen_fbo[1]);
+            }
+            // Read back before the swap, while the back buffer holds this frame
+            if (this->encoder) { this->captureFrame(); }
+
+            if (!this->headless) { glfwSwapBuffers (this->window); }
+
+            this->markDrawn();
 
 #ifdef PROFILE_RENDER
             steady_clock::time_point renderend = steady_clock::now();
@@ -446,6 +539,21 @@ namespace morph {
         //! The text shader program, which uses textures to draw text on quads.
         GLuint tshaderprog;
 
+        //! Uniform locations for shaderprog, looked up once when the program is linked
+        const morph::gl::UniformLocations* ulocs = nullptr;
+        //! Uniform locations for tshaderprog
+        const morph::gl::UniformLocations* tulocs = nullptr;
+        //! The thick line shader program (see GraphVisual::shaderlines), which shares
+        //! shaderprog's fragment shader
+        GLuint lshaderprog;
+        //! Uniform locations for lshaderprog
+        const morph::gl::UniformLocations* lulocs = nullptr;
+        //! The grid shader program, which computes the surfaces of HexGridVisuals and
+        //! CartGridVisuals from their data (see HexGridVisual::gpuData)
+        GLuint gshaderprog;
+        //! Uniform locations for gshaderprog
+        const morph::gl::UniformLocations* gulocs = nullptr;
+
         //! The colour of ambient and diffuse light sources
         Vector<float> light_colour = {1,1,1};
         //! Strength of the ambient light
@@ -618,93 +726,105 @@ namespace morph {
             std::ofstream fout;
             fout.open (gltf_file, std::ios::out|std::ios::trunc);
             if (!fout.is_open()) { throw std::runtime_error ("Visual::savegltf(): Failed to open file for writing"); }
+
+            // The meshes to export, with instances expanded. Models with nothing to draw are left out.
+            std::vector<VisualModel*> ex;
+            for (auto m : this->vm) {
+                m->gltf_prepare();
+                if (m->gltf_empty()) {
+                    m->gltf_release();
+                } else {
+                    ex.push_back (m);
+                }
+            }
+
             fout << "{\n  \"scenes\" : [ { \"nodes\" : [ ";
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
-                fout << vmi << (vmi < this->vm.size()-1 ? ", " : "");
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
+                fout << vmi << (vmi < ex.size()-1 ? ", " : "");
             }
             fout << " ] } ],\n";
 
             fout << "  \"nodes\" : [\n";
             // for loop over VisualModels "mesh" : 0, etc
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
                 fout << "    { \"mesh\" : " << vmi
-                     << ", \"translation\" : " << this->vm[vmi]->translation_str()
-                     << (vmi < this->vm.size()-1 ? " },\n" : " }\n");
+                     << ", \"translation\" : " << ex[vmi]->translation_str()
+                     << (vmi < ex.size()-1 ? " },\n" : " }\n");
             }
             fout << "  ],\n";
 
             fout << "  \"meshes\" : [\n";
             // for each VisualModel:
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
                 fout << "    { \"primitives\" : [ { \"attributes\" : { \"POSITION\" : " << 1+vmi*4
                      << ", \"COLOR_0\" : " << 2+vmi*4
                      << ", \"NORMAL\" : " << 3+vmi*4 << " }, \"indices\" : " << vmi*4 << ", \"material\": 0 } ] }"
-                     << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                     << (vmi < ex.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
             fout << "  \"buffers\" : [\n";
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
                 // indices
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->indices_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << "},\n";
+                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << ex[vmi]->indices_base64() << "\", "
+                     << "\"byteLength\" : " << ex[vmi]->indices_bytes() << "},\n";
                 // pos
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vpos_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << "},\n";
+                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << ex[vmi]->vpos_base64() << "\", "
+                     << "\"byteLength\" : " << ex[vmi]->vpos_bytes() << "},\n";
                 // col
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vcol_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << "},\n";
+                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << ex[vmi]->vcol_base64() << "\", "
+                     << "\"byteLength\" : " << ex[vmi]->vcol_bytes() << "},\n";
                 // norm
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vnorm_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << ex[vmi]->vnorm_base64() << "\", "
+                     << "\"byteLength\" : " << ex[vmi]->vnorm_bytes() << "}";
+                fout << (vmi < ex.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
             fout << "  \"bufferViews\" : [\n";
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
                 // indices
                 fout << "    { ";
                 fout << "\"buffer\" : " << vmi*4 << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << ", ";
+                fout << "\"byteLength\" : " << ex[vmi]->indices_bytes() << ", ";
                 fout << "\"target\" : 34963 ";
                 fout << " },\n";
                 // vpos
                 fout << "    { ";
                 fout << "\"buffer\" : " << 1+vmi*4 << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << ", ";
+                fout << "\"byteLength\" : " << ex[vmi]->vpos_bytes() << ", ";
                 fout << "\"target\" : 34962 ";
                 fout << " },\n";
                 // vcol
                 fout << "    { ";
                 fout << "\"buffer\" : " << 2+vmi*4 << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << ", ";
+                fout << "\"byteLength\" : " << ex[vmi]->vcol_bytes() << ", ";
                 fout << "\"target\" : 34962 ";
                 fout << " },\n";
                 // vnorm
                 fout << "    { ";
                 fout << "\"buffer\" : " << 3+vmi*4 << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << ", ";
+                fout << "\"byteLength\" : " << ex[vmi]->vnorm_bytes() << ", ";
                 fout << "\"target\" : 34962 ";
                 fout << " }";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                fout << (vmi < ex.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
             fout << "  \"accessors\" : [\n";
-            for (size_t vmi = 0; vmi < this->vm.size(); ++vmi) {
-                this->vm[vmi]->computeVertexMaxMins();
+            for (size_t vmi = 0; vmi < ex.size(); ++vmi) {
+                ex[vmi]->computeVertexMaxMins();
                 // indices
                 fout << "    { ";
                 fout << "\"bufferView\" : " << vmi*4 << ", ";
                 fout << "\"byteOffset\" : 0, ";
                 fout << "\"componentType\" : 5125, "; // 5123 unsigned short, 5121 unsigned byte, 5125 unsigned int, 5126 float
                 fout << "\"type\" : \"SCALAR\", ";
-                fout << "\"count\" : " << this->vm[vmi]->indices_size();
+                fout << "\"count\" : " << ex[vmi]->indices_size();
                 fout << "},\n";
                 // vpos
                 fout << "    { ";
@@ -712,10 +832,10 @@ namespace morph {
                 fout << "\"byteOffset\" : 0, ";
                 fout << "\"componentType\" : 5126, ";
                 fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vpos_size()/3;
+                fout << "\"count\" : " << ex[vmi]->vpos_size()/3;
                 // vertex position requires max/min to be specified in the gltf format
-                fout << ", \"max\" : " << this->vm[vmi]->vpos_max() << ", ";
-                fout << "\"min\" : " << this->vm[vmi]->vpos_min();
+                fout << ", \"max\" : " << ex[vmi]->vpos_max() << ", ";
+                fout << "\"min\" : " << ex[vmi]->vpos_min();
                 fout << " },\n";
                 // vcol
                 fout << "    { ";
@@ -723,7 +843,7 @@ namespace morph {
                 fout << "\"byteOffset\" : 0, ";
                 fout << "\"componentType\" : 5126, ";
                 fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vcol_size()/3;
+                fout << "\"count\" : " << ex[vmi]->vcol_size()/3;
                 fout << "},\n";
                 // vnorm
                 fout << "    { ";
@@ -731,9 +851,9 @@ namespace morph {
                 fout << "\"byteOffset\" : 0, ";
                 fout << "\"componentType\" : 5126, ";
                 fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vnorm_size()/3;
+                fout << "\"count\" : " << ex[vmi]->vnorm_size()/3;
                 fout << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                fout << (vmi < ex.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
@@ -746,6 +866,7 @@ namespace morph {
                  << "  }\n";
             fout << "}\n";
             fout.close();
+            for (auto m : ex) { m->gltf_release(); }
         }
 
     protected:
@@ -754,14 +875,196 @@ namespace morph {
         std::vector<VisualModel*> vm;
 
     private:
+        //! Set the lighting uniforms of the program (which must be in use) with locations \a ul
+        void setLighting (const morph::gl::UniformLocations* ul)
+        {
+            // Ambient light colour
+            if (ul->light_colour != -1) { glUniform3fv (ul->light_colour, 1, this->light_colour.data()); }
+            // Ambient light intensity
+            if (ul->ambient_intensity != -1) { glUniform1f (ul->ambient_intensity, this->ambient_intensity); }
+            // Diffuse light position
+            if (ul->diffuse_position != -1) { glUniform3fv (ul->diffuse_position, 1, this->diffuse_position.data()); }
+            // Diffuse light intensity
+            if (ul->diffuse_intensity != -1) { glUniform1f (ul->diffuse_intensity, this->diffuse_intensity); }
+        }
+
+        //! The number of values in a viewState()
+        static constexpr size_t viewstate_size = 32;
+
+        /*!
+         * The settings the scene is drawn with, in one array, to compare against those
+         * of the last frame. Client code may set many of these directly.
+         */
+        std::array<float, viewstate_size> viewState() const
+        {
+            return {
+                this->scenetrans[0], this->scenetrans[1], this->scenetrans[2],
+                this->rotation.w, this->rotation.x, this->rotation.y, this->rotation.z,
+                this->fov, this->zNear, this->zFar, static_cast<float>(this->ptype),
+                this->ortho_bl[0], this->ortho_bl[1], this->ortho_tr[0], this->ortho_tr[1],
+                this->bgcolour[0], this->bgcolour[1], this->bgcolour[2], this->bgcolour[3],
+                this->light_colour[0], this->light_colour[1], this->light_colour[2], this->ambient_intensity,
+                this->diffuse_position[0], this->diffuse_position[1], this->diffuse_position[2], this->diffuse_intensity,
+                static_cast<float>(this->showCoordArrows), static_cast<float>(this->coordArrowsInScene),
+                static_cast<float>(this->showTitle), static_cast<float>(this->window_w), static_cast<float>(this->window_h)
+            };
+        }
+
+        //! Does the scene need to be drawn? See render().
+        bool needsRender() const
+        {
+            if (this->scene_changed == true || this->encoder) { return true; }
+            if (this->viewState() != this->drawn_state) { return true; }
+            if (this->showCoordArrows == true && this->coordArrows->hasChanged()) { return true; }
+            if (this->showTitle == true && this->textModel->hasChanged()) { return true; }
+            for (auto m : this->vm) { if (m->hasChanged()) { return true; } }
+            for (auto t : this->texts) { if (t->hasChanged()) { return true; } }
+            return false;
+        }
+
+        //! Record that the scene, as it is now, has been drawn
+        void markDrawn()
+        {
+            this->scene_changed = false;
+            this->drawn_state = this->viewState();
+            this->coordArrows->markDrawn();
+            if (this->textModel != nullptr) { this->textModel->markDrawn(); }
+            for (auto m : this->vm) { m->markDrawn(); }
+            for (auto t : this->texts) { t->markDrawn(); }
+        }
+
+        /*!
+         * Create the framebuffer that a headless Visual renders into. It is
+         * multisampled, as a window would be, and render() resolves it into a second,
+         * plain framebuffer, which is what saveImage() and recording read from.
+         */
+        void setupOffscreen()
+        {
+            glGenFramebuffers (2, this->offscreen_fbo);
+            glGenRenderbuffers (3, this->offscreen_rbo);
+            this->sizeOffscreen();
+
+            glBindFramebuffer (GL_FRAMEBUFFER, this->offscreen_fbo[0]);
+            glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->offscreen_rbo[0]);
+            glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->offscreen_rbo[1]);
+            if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::runtime_error ("Visual: The offscreen (multisampled) framebuffer is incomplete");
+            }
+
+            glBindFramebuffer (GL_FRAMEBUFFER, this->offscreen_fbo[1]);
+            glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->offscreen_rbo[2]);
+            if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::runtime_error ("Visual: The offscreen framebuffer is incomplete");
+            }
+
+            glBindFramebuffer (GL_FRAMEBUFFER, this->offscreen_fbo[0]);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! (Re)allocate the offscreen renderbuffers at the window size, window_w x window_h
+        void sizeOffscreen()
+        {
+            glBindRenderbuffer (GL_RENDERBUFFER, this->offscreen_rbo[0]);
+            glRenderbufferStorageMultisample (GL_RENDERBUFFER, 4, GL_RGBA8, this->window_w, this->window_h);
+            glBindRenderbuffer (GL_RENDERBUFFER, this->offscreen_rbo[1]);
+            glRenderbufferStorageMultisample (GL_RENDERBUFFER, 4, GL_DEPTH_COMPONENT24, this->window_w, this->window_h);
+            glBindRenderbuffer (GL_RENDERBUFFER, this->offscreen_rbo[2]);
+            glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, this->window_w, this->window_h);
+            glBindRenderbuffer (GL_RENDERBUFFER, 0);
+        }
+
+        //! Start reading the frame just rendered into the next pixel buffer object of the ring
+        void captureFrame()
+        {
+            readback& rb = this->readbacks[this->next_readback];
+            // If the ring is full, this is the oldest readback, and it has to be finished first
+            if (rb.fence != nullptr) { this->collectFrame (true); }
+
+            GLint viewport[4];
+            glGetIntegerv (GL_VIEWPORT, viewport);
+            if (rb.pbo == 0) { glGenBuffers (1, &rb.pbo); }
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, rb.pbo);
+            if (viewport[2] != rb.w || viewport[3] != rb.h) {
+                rb.w = viewport[2];
+                rb.h = viewport[3];
+                glBufferData (GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(rb.w) * rb.h * 4, nullptr, GL_STREAM_READ);
+            }
+            glPixelStorei (GL_PACK_ALIGNMENT, 1);
+            glPixelStorei (GL_PACK_ROW_LENGTH, 0);
+            glPixelStorei (GL_PACK_SKIP_ROWS, 0);
+            glPixelStorei (GL_PACK_SKIP_PIXELS, 0);
+            // With a pack buffer bound, this returns at once; the copy happens on the GPU
+            glReadPixels (0, 0, rb.w, rb.h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            rb.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            rb.frame = this->rec_frame++;
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+
+            this->pending_readbacks.push_back (this->next_readback);
+            this->next_readback = (this->next_readback + 1) % this->readbacks.size();
+
+            // Pass on any earlier frames which have arrived in the meantime
+            while (!this->pending_readbacks.empty() && this->collectFrame (false)) {}
+        }
+
+        /*!
+         * Copy the oldest pending readback out of its pixel buffer object and give it to
+         * the encoder. If \a wait, block until the GPU has written it, otherwise return
+         * false if it is not there yet.
+         */
+        bool collectFrame (const bool wait)
+        {
+            readback& rb = this->readbacks[this->pending_readbacks.front()];
+            GLenum r = glClientWaitSync (rb.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+            while (wait && r == GL_TIMEOUT_EXPIRED) {
+                r = glClientWaitSync (rb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            }
+            if (r == GL_TIMEOUT_EXPIRED) { return false; }
+            glDeleteSync (rb.fence);
+            rb.fence = nullptr;
+            this->pending_readbacks.pop_front();
+
+            const size_t bytes = static_cast<size_t>(rb.w) * rb.h * 4;
+            std::vector<uint8_t> frame = this->encoder->buffer (bytes);
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, rb.pbo);
+            const void* p = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+            if (p != nullptr) {
+                std::memcpy (frame.data(), p, bytes);
+                glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+            if (p == nullptr) {
+                std::cerr << "Visual: could not map frame " << rb.frame << "\n";
+                return true;
+            }
+
+            char num[32];
+            std::snprintf (num, sizeof(num), "%05llu", static_cast<unsigned long long>(rb.frame));
+            this->encoder->submit (std::move (frame), rb.w, rb.h, this->rec_prefix + num + this->rec_suffix);
+            return true;
+        }
+
         //! Private initialization, used by constructors.
         void init()
         {
+            // With no display, GLFW has to be told before it starts, which happens in VisualResources::i()
+            if (this->headless && std::getenv ("DISPLAY") == nullptr && std::getenv ("WAYLAND_DISPLAY") == nullptr) {
+                morph::VisualResources::no_display = true;
+            }
+
             // VisualResources provides font management and GLFW management.
             this->resources = morph::VisualResources::i();
             morph::VisualResources::register_visual();
 
+            if (this->headless) {
+                glfwWindowHint (GLFW_VISIBLE, GLFW_FALSE);
+                if (morph::VisualResources::no_display) {
+                    glfwWindowHint (GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+                    glfwWindowHint (GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+                }
+            }
             this->window = glfwCreateWindow (this->window_w, this->window_h, this->title.c_str(), NULL, NULL);
+            if (this->headless) { glfwWindowHint (GLFW_VISIBLE, GLFW_TRUE); }
             if (!this->window) {
                 // Window or OpenGL context creation failed
                 throw std::runtime_error("GLFW window creation failed!");
@@ -776,6 +1079,7 @@ namespace morph {
             glfwSetWindowSizeCallback (this->window, window_size_callback_dispatch);
             glfwSetWindowCloseCallback (this->window, window_close_callback_dispatch);
             glfwSetScrollCallback (this->window, scroll_callback_dispatch);
+            glfwSetWindowRefreshCallback (this->window, window_refresh_callback_dispatch);
 
             glfwMakeContextCurrent (this->window);
 
@@ -797,6 +1101,8 @@ namespace morph {
             // Swap as fast as possible (fixes lag of scene with mouse movements)
             glfwSwapInterval (0);
 
+            if (this->headless) { this->setupOffscreen(); }
+
             // Load up the shaders
             ShaderInfo shaders[] = {
                 {GL_VERTEX_SHADER, "Visual.vert.glsl", morph::defaultVtxShader },
@@ -814,6 +1120,30 @@ namespace morph {
             };
             this->tshaderprog = this->LoadShaders (tshaders);
 
+            // And another expands polylines into thick lines on the GPU
+            ShaderInfo lshaders[] = {
+                {GL_VERTEX_SHADER, "VisLine.vert.glsl", morph::defaultLineVtxShader },
+                {GL_FRAGMENT_SHADER, "Visual.frag.glsl", morph::defaultFragShader },
+                {GL_NONE, NULL, NULL }
+            };
+            this->lshaderprog = this->LoadShaders (lshaders);
+            this->resources->setLineProgram (this->lshaderprog, this->window);
+
+            // And another computes grid surfaces from raw data
+            ShaderInfo gshaders[] = {
+                {GL_VERTEX_SHADER, "VisGrid.vert.glsl", morph::defaultGridVtxShader },
+                {GL_FRAGMENT_SHADER, "Visual.frag.glsl", morph::defaultFragShader },
+                {GL_NONE, NULL, NULL }
+            };
+            this->gshaderprog = this->LoadShaders (gshaders);
+            this->resources->setGridProgram (this->gshaderprog, this->window);
+
+            // Look up the uniform locations in each program once, now that they're linked
+            this->ulocs = &this->resources->register_program (this->shaderprog, this->window);
+            this->tulocs = &this->resources->register_program (this->tshaderprog, this->window);
+            this->lulocs = &this->resources->register_program (this->lshaderprog, this->window);
+            this->gulocs = &this->resources->register_program (this->gshaderprog, this->window);
+
             // Now client code can set up HexGridVisuals.
             glEnable (GL_DEPTH_TEST);
 
@@ -1049,6 +1379,39 @@ namespace morph {
         //! The title for the Visual. Used in window title and if saving out 3D model or png image.
         std::string title = "morph::Visual";
 
+        //! Set when the scene needs drawing for a reason render() can't see for itself
+        bool scene_changed = true;
+        //! The viewState() of the last frame drawn
+        std::array<float, viewstate_size> drawn_state = {};
+
+        //! If true, there's no visible window and the scene is rendered offscreen
+        bool headless = false;
+        //! The multisampled framebuffer a headless Visual renders into, and the one it's resolved into
+        GLuint offscreen_fbo[2] = {0, 0};
+        //! Colour and depth renderbuffers of offscreen_fbo[0] and the colour renderbuffer of offscreen_fbo[1]
+        GLuint offscreen_rbo[3] = {0, 0, 0};
+
+        //! A pixel buffer object into which a frame is being read back for recording
+        struct readback
+        {
+            GLuint pbo = 0;
+            //! Signalled when the frame is in pbo; nullptr if the pbo is free
+            GLsync fence = nullptr;
+            int w = 0;
+            int h = 0;
+            uint64_t frame = 0;
+        };
+        //! The ring of readbacks. Three lets a frame take two frames to arrive before render() waits.
+        std::array<readback, 3> readbacks;
+        //! Indices into readbacks of the frames in flight, oldest first
+        std::deque<size_t> pending_readbacks;
+        size_t next_readback = 0;
+        //! Writes the recorded frames. Non-null while recording.
+        std::unique_ptr<morph::FrameEncoder> encoder;
+        std::string rec_prefix;
+        std::string rec_suffix;
+        uint64_t rec_frame = 0;
+
         //! The user's 'selected visual model'. For model specific changes to alpha and possibly colour
         unsigned int selectedVisualModel = 0;
 
@@ -1147,6 +1510,11 @@ namespace morph {
             Visual* self = static_cast<Visual*>(glfwGetWindowUserPointer (_window));
             self->window_close_callback (_window);
         }
+        static void window_refresh_callback_dispatch (GLFWwindow* _window)
+        {
+            Visual* self = static_cast<Visual*>(glfwGetWindowUserPointer (_window));
+            self->window_refresh_callback (_window);
+        }
         static void scroll_callback_dispatch (GLFWwindow* _window, double xoffset, double yoffset)
         {
             Visual* self = static_cast<Visual*>(glfwGetWindowUserPointer (_window));
@@ -1159,6 +1527,9 @@ namespace morph {
 
         virtual void key_callback (GLFWwindow* _window, int key, int scancode, int action, int mods)
         {
+            // Most keys change something in the scene; it's cheapest just to draw it again
+            if (action != GLFW_RELEASE) { this->scene_changed = true; }
+
             // Exit action
             if (key == GLFW_KEY_X && action == GLFW_PRESS) {
                 std::cout << "User requested exit.\n";
@@ -1475,6 +1846,19 @@ namespace morph {
         {
             this->window_w = width;
             this->window_h = height;
+            // A headless Visual's offscreen framebuffer has to follow the window's size
+            if (this->headless && this->offscreen_fbo[0] != 0) {
+                glfwMakeContextCurrent (this->window);
+                this->sizeOffscreen();
+            }
+            this->scene_changed = true;
+            this->render();
+        }
+
+        //! The window has been uncovered (or otherwise damaged) and has to be drawn again
+        virtual void window_refresh_callback (GLFWwindow* _window)
+        {
+            this->scene_changed = true;
             this->render();
         }
 
@@ -1492,6 +1876,7 @@ namespace morph {
         {
             if (this->sceneLocked) { return; }
             // x and y can be +/- 1
+            this->scene_changed = true;
             this->scenetrans[0] -= xoffset * this->scenetrans_stepsize;
             if (this->translateMode) {
                 this->scenetrans[1]/*z really*/ += yoffset * this->scenetrans_stepsize;
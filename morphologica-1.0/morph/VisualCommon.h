@@ -20,13 +20,73 @@ namespace morph {
     namespace gl {
 
         //! The locations for the position, normal and colour vertex attributes in the
-        //! morph::Visual GLSL programs
-        enum AttribLocn { posnLoc = 0, normLoc = 1, colLoc = 2, textureLoc = 3 };
+        //! morph::Visual GLSL programs, and for the per-instance offset/scale and colour
+        //! of instanced models
+        enum AttribLocn { posnLoc = 0, normLoc = 1, colLoc = 2, textureLoc = 3, instLoc = 4, instColLoc = 5 };
+
+        /*!
+         * The locations of the uniforms in a morph::Visual GLSL program. These are
+         * looked up once, after the program has been linked, so that models don't need
+         * to call glGetUniformLocation every time they're rendered. A location of -1
+         * means the uniform is not active in the program.
+         */
+        struct UniformLocations
+        {
+            GLint alpha = -1;
+            GLint v_matrix = -1;
+            GLint m_matrix = -1;
+            GLint p_matrix = -1;
+            GLint lv_matrix = -1;
+            GLint light_colour = -1;
+            GLint ambient_intensity = -1;
+            GLint diffuse_position = -1;
+            GLint diffuse_intensity = -1;
+            GLint textColor = -1;
+            GLint line_colour = -1;
+            GLint line_width = -1;
+            GLint line_gap = -1;
+            GLint line_z = -1;
+            GLint axes_clip = -1;
+            GLint grid_data = -1;
+            GLint grid_nbrs = -1;
+            GLint grid_cmap = -1;
+            GLint grid_zscale = -1;
+            GLint grid_cscale = -1;
+            GLint grid_layout = -1;
+            GLint grid_corner = -1;
+
+            //! Query all the locations from the linked program \a prog
+            void locate (GLuint prog)
+            {
+                this->alpha = glGetUniformLocation (prog, static_cast<const GLchar*>("alpha"));
+                this->v_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("v_matrix"));
+                this->m_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("m_matrix"));
+                this->p_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("p_matrix"));
+                this->lv_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("lv_matrix"));
+                this->light_colour = glGetUniformLocation (prog, static_cast<const GLchar*>("light_colour"));
+                this->ambient_intensity = glGetUniformLocation (prog, static_cast<const GLchar*>("ambient_intensity"));
+                this->diffuse_position = glGetUniformLocation (prog, static_cast<const GLchar*>("diffuse_position"));
+                this->diffuse_intensity = glGetUniformLocation (prog, static_cast<const GLchar*>("diffuse_intensity"));
+                this->textColor = glGetUniformLocation (prog, static_cast<const GLchar*>("textColor"));
+                this->line_colour = glGetUniformLocation (prog, static_cast<const GLchar*>("line_colour"));
+                this->line_width = glGetUniformLocation (prog, static_cast<const GLchar*>("line_width"));
+                this->line_gap = glGetUniformLocation (prog, static_cast<const GLchar*>("line_gap"));
+                this->line_z = glGetUniformLocation (prog, static_cast<const GLchar*>("line_z"));
+                this->axes_clip = glGetUniformLocation (prog, static_cast<const GLchar*>("axes_clip"));
+                this->grid_data = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_data"));
+                this->grid_nbrs = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_nbrs"));
+                this->grid_cmap = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_cmap"));
+                this->grid_zscale = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_zscale"));
+                this->grid_cscale = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_cscale"));
+                this->grid_layout = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_layout"));
+                this->grid_corner = glGetUniformLocation (prog, static_cast<const GLchar*>("grid_corner"));
+            }
+        };
 
         //! A struct to hold information about font glyph properties
         struct CharInfo
         {
-            //! ID handle of the glyph texture
+            //! ID handle of the atlas texture that holds the glyph
             unsigned int textureID;
             //! Size of glyph
             morph::Vector<int,2>  size;
@@ -34,6 +94,10 @@ namespace morph {
             morph::Vector<int,2>  bearing;
             //! Offset to advance to next glyph
             unsigned int advance;
+            //! Texture coordinates of the top left corner of the glyph in its atlas
+            morph::Vector<float,2> uv0;
+            //! Texture coordinates of the bottom right corner of the glyph in its atlas
+            morph::Vector<float,2> uv1;
         };
 
         //! A class containing a static function to check the GL errors.
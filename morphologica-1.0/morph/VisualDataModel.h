@@ -46,16 +46,20 @@ namespace morph {
         void setVectorData (const std::vector<Vector<float>>* _vectors) { this->vectorData = _vectors; }
         void setDataCoords (std::vector<Vector<float>>* _coords) { this->dataCoords = _coords; }
 
+        //! Called when only the scalar data, or its scaling, has changed. Models which
+        //! can update their data without rebuilding their vertices override this.
+        virtual void reinitData() { this->reinit(); }
+
         void updateZScale (const Scale<T, float>& zscale)
         {
             this->zScale = zscale;
-            this->reinit();
+            this->reinitData();
         }
 
         void updateCScale (const Scale<T, float>& cscale)
         {
             this->colourScale = cscale;
-            this->reinit();
+            this->reinitData();
         }
 
         void setVectorScale (const Scale<Vector<T>>& vscale)
@@ -74,7 +78,7 @@ namespace morph {
         void updateData (const std::vector<T>* _data)
         {
             this->scalarData = _data;
-            this->reinit();
+            this->reinitData();
         }
 
         //! Update the scalar data with an associated z-scaling
@@ -82,7 +86,7 @@ namespace morph {
         {
             this->scalarData = _data;
             this->zScale = zscale;
-            this->reinit();
+            this->reinitData();
         }
 
         //! Update the scalar data, along with both the z-scaling and the colour-scaling
@@ -91,7 +95,7 @@ namespace morph {
             this->scalarData = _data;
             this->zScale = zscale;
             this->colourScale = cscale;
-            this->reinit();
+            this->reinitData();
         }
 
         //! Update coordinate data and scalar data along with z-scaling for scalar data
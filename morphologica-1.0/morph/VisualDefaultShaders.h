@@ -104,6 +104,8 @@ namespace morph {
     "layout(location = 0) in vec4 position;\n"
     "layout(location = 1) in vec4 normalin;\n"
     "layout(location = 2) in vec3 color;\n"
+    "layout(location = 4) in vec4 instance;\n"
+    "layout(location = 5) in vec4 instcolor;\n"
     "out VERTEX\n"
     "{\n"
     "    vec4 normal;\n"
@@ -112,9 +114,10 @@ namespace morph {
     "} vertex;\n"
     "void main (void)\n"
     "{\n"
-    "    gl_Position = (p_matrix * v_matrix * m_matrix * position);\n"
-    "    vertex.color = vec4(color, alpha);\n"
-    "    vertex.fragpos = vec3(m_matrix * position);\n"
+    "    vec4 p = vec4(position.xyz * instance.w + instance.xyz, 1.0);\n"
+    "    gl_Position = (p_matrix * v_matrix * m_matrix * p);\n"
+    "    vertex.color = vec4(mix(instcolor.rgb, color, instcolor.w), alpha);\n"
+    "    vertex.fragpos = vec3(m_matrix * p);\n"
     "    vertex.normal = normalin;\n"
     "}\n";
 
@@ -142,6 +145,156 @@ namespace morph {
     "    finalcolor = vec4(result, vertex.color.w);\n"
     "}\n";
 
+    // Default thick line vertex shader, used with defaultFragShader. See VisLine.vert.glsl.
+    const char* defaultLineVtxShader = OpenGL_VersionString
+    "uniform mat4 m_matrix;\n"
+    "uniform mat4 v_matrix;\n"
+    "uniform mat4 p_matrix;\n"
+    "uniform float alpha;\n"
+    "uniform vec3 line_colour;\n"
+    "uniform float line_width;\n"
+    "uniform float line_gap;\n"
+    "uniform float line_z;\n"
+    "uniform vec3 axes_clip;\n"
+    "layout(location = 0) in vec3 pprev;\n"
+    "layout(location = 1) in vec3 p0;\n"
+    "layout(location = 2) in vec3 p1;\n"
+    "layout(location = 3) in vec3 pnext;\n"
+    "out VERTEX\n"
+    "{\n"
+    "    vec4 normal;\n"
+    "    vec4 color;\n"
+    "    vec3 fragpos;\n"
+    "} vertex;\n"
+    "bool outside (vec3 p)\n"
+    "{\n"
+    "    return p.x < 0.0 || p.x > axes_clip.x || p.y < 0.0 || p.y > axes_clip.y;\n"
+    "}\n"
+    "vec2 mitre (vec2 da, vec2 db, vec2 n)\n"
+    "{\n"
+    "    vec2 t = da + db;\n"
+    "    if (length(t) < 1e-6) { return n; }\n"
+    "    t = normalize(t);\n"
+    "    vec2 m = vec2(t.y, -t.x);\n"
+    "    return m / max(dot(m, n), 0.25);\n"
+    "}\n"
+    "void main (void)\n"
+    "{\n"
+    "    int end = gl_VertexID / 2;\n"
+    "    float side = (gl_VertexID % 2 == 0) ? 1.0 : -1.0;\n"
+    "    vec3 p = (end == 0) ? p0 : p1;\n"
+    "    vec2 d = p1.xy - p0.xy;\n"
+    "    float len = length(d);\n"
+    "    vec2 off = vec2(0.0);\n"
+    "    if (len > 0.0 && !(axes_clip.z > 0.5 && (outside(p0) || outside(p1)))) {\n"
+    "        d /= len;\n"
+    "        vec2 n = vec2(d.y, -d.x);\n"
+    "        if (line_gap > 0.0) {\n"
+    "            if (len > 2.0 * line_gap) {\n"
+    "                p.xy += (end == 0 ? line_gap : -line_gap) * d;\n"
+    "                off = n;\n"
+    "            }\n"
+    "        } else {\n"
+    "            vec2 o = (end == 0) ? p0.xy - pprev.xy : pnext.xy - p1.xy;\n"
+    "            float olen = length(o);\n"
+    "            if (olen > 0.0) {\n"
+    "                off = (end == 0) ? mitre(o / olen, d, n) : mitre(d, o / olen, n);\n"
+    "            } else {\n"
+    "                off = n;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    vec4 position = vec4(p.xy + side * 0.5 * line_width * off, p.z + line_z, 1.0);\n"
+    "    gl_Position = (p_matrix * v_matrix * m_matrix * position);\n"
+    "    vertex.color = vec4(line_colour, alpha);\n"
+    "    vertex.fragpos = vec3(m_matrix * position);\n"
+    "    vertex.normal = vec4(0.0, 0.0, 1.0, 0.0);\n"
+    "}\n";
+
+    // Default grid vertex shader, used with defaultFragShader. See VisGrid.vert.glsl.
+    const char* defaultGridVtxShader = OpenGL_VersionString
+    "uniform mat4 m_matrix;\n"
+    "uniform mat4 v_matrix;\n"
+    "uniform mat4 p_matrix;\n"
+    "uniform float alpha;\n"
+    "uniform samplerBuffer grid_data;\n"
+    "uniform isamplerBuffer grid_nbrs;\n"
+    "uniform sampler1D grid_cmap;\n"
+    "uniform vec3 grid_zscale;\n"
+    "uniform vec3 grid_cscale;\n"
+    "uniform ivec2 grid_layout;\n"
+    "uniform vec2 grid_corner;\n"
+    "layout(location = 0) in vec4 position;\n"
+    "out VERTEX\n"
+    "{\n"
+    "    vec4 normal;\n"
+    "    vec4 color;\n"
+    "    vec3 fragpos;\n"
+    "} vertex;\n"
+    "float scaled (float x, vec3 s)\n"
+    "{\n"
+    "    return s.x * (s.z > 0.5 ? log(x) : x) + s.y;\n"
+    "}\n"
+    "float zof (int e)\n"
+    "{\n"
+    "    return scaled (texelFetch(grid_data, e).r, grid_zscale);\n"
+    "}\n"
+    "int nbr (int e, int i)\n"
+    "{\n"
+    "    return texelFetch(grid_nbrs, 2 * e + i / 4)[i % 4];\n"
+    "}\n"
+    "float hexCorner (int e, float zc, int k)\n"
+    "{\n"
+    "    const ivec2 sharers[6] = ivec2[6](ivec2(1, 0), ivec2(0, 5), ivec2(5, 4),\n"
+    "                                     ivec2(3, 4), ivec2(2, 3), ivec2(2, 1));\n"
+    "    int a = nbr (e, sharers[k - 1].x);\n"
+    "    int b = nbr (e, sharers[k - 1].y);\n"
+    "    if (a >= 0 && b >= 0) { return 0.3333333 * (zc + zof(a) + zof(b)); }\n"
+    "    if (a >= 0) { return 0.5 * (zc + zof(a)); }\n"
+    "    if (b >= 0) { return 0.5 * (zc + zof(b)); }\n"
+    "    return zc;\n"
+    "}\n"
+    "float rectCorner (int e, float zc, int k)\n"
+    "{\n"
+    "    const ivec3 sharers[4] = ivec3[4](ivec3(2, 0, 1), ivec3(6, 0, 7), ivec3(6, 4, 5), ivec3(2, 4, 3));\n"
+    "    int v = nbr (e, sharers[k - 1].x);\n"
+    "    int h = nbr (e, sharers[k - 1].y);\n"
+    "    int d = nbr (e, sharers[k - 1].z);\n"
+    "    if (v >= 0 && h >= 0 && d >= 0) { return 0.25 * (zc + zof(v) + zof(h) + zof(d)); }\n"
+    "    if (h >= 0) { return 0.5 * (zc + zof(h)); }\n"
+    "    if (v >= 0) { return 0.5 * (zc + zof(v)); }\n"
+    "    return zc;\n"
+    "}\n"
+    "float corner (int e, float zc, int k)\n"
+    "{\n"
+    "    if (k == 0) { return zc; }\n"
+    "    return grid_layout.x == 7 ? hexCorner (e, zc, k) : rectCorner (e, zc, k);\n"
+    "}\n"
+    "void main (void)\n"
+    "{\n"
+    "    int e = gl_VertexID / grid_layout.x;\n"
+    "    int k = gl_VertexID % grid_layout.x;\n"
+    "    float z = 0.0;\n"
+    "    vec3 norm = vec3(0.0, 0.0, 1.0);\n"
+    "    vec3 clr = vec3(0.8, 0.8, 0.8);\n"
+    "    if (e < grid_layout.y) {\n"
+    "        float zc = zof (e);\n"
+    "        z = corner (e, zc, k);\n"
+    "        if (grid_layout.x > 1) {\n"
+    "            vec3 p1 = vec3(grid_corner, corner (e, zc, 1) - zc);\n"
+    "            vec3 p2 = vec3(grid_corner.x, -grid_corner.y, corner (e, zc, 2) - zc);\n"
+    "            norm = normalize(cross(p2, p1));\n"
+    "        }\n"
+    "        float c = clamp(scaled (texelFetch(grid_data, e).r, grid_cscale), 0.0, 1.0);\n"
+    "        clr = texture(grid_cmap, (c * 255.0 + 0.5) / 256.0).rgb;\n"
+    "    }\n"
+    "    vec4 p = vec4(position.xy, z, 1.0);\n"
+    "    gl_Position = (p_matrix * v_matrix * m_matrix * p);\n"
+    "    vertex.color = vec4(clr, alpha);\n"
+    "    vertex.fragpos = vec3(m_matrix * p);\n"
+    "    vertex.normal = vec4(norm, 0.0);\n"
+    "}\n";
+
     // Default text vertex shader. See VisText.vert.glsl
     const char* defaultTextVtxShader = OpenGL_VersionString
     "uniform mat4 m_matrix;\n"
@@ -2,7 +2,8 @@
  * \file
  *
  * Declares a VisualFace class to hold the information about a (Freetype-managed) font
- * face and the GL-textures that will reproduce it.
+ * face and the GL-textures that will reproduce it. All of a face's glyphs are packed
+ * into one (or, for very large font sizes, a few) atlas textures.
  *
  * \author Seb James
  * \date November 2020
@@ -14,6 +15,8 @@
 #include <iostream>
 #include <utility>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #include <morph/tools.h>
 #include <morph/VisualCommon.h>
@@ -386,6 +389,20 @@ namespace morph {
                 // Can I check this->face for how many glyphs it has? Yes:
                 // std::cout << "This face has " << this->face->num_glyphs << " glyphs.\n";
 
+                // Glyphs are packed, in codepoint order, into rows ('shelves') of a
+                // shared atlas texture, so that a VisualTextModel can draw all of its
+                // quads with one texture bound. Codepoint order keeps the common
+                // (ASCII, Latin and Greek) glyphs together on the first page; a page
+                // that fills up is uploaded and packing continues on a new one.
+                GLint maxtex = 0;
+                glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxtex);
+                this->atlas_w = maxtex > 0 && maxtex < atlas_max ? maxtex : atlas_max;
+                std::vector<unsigned char> page (static_cast<size_t>(this->atlas_w) * this->atlas_w, 0);
+                std::vector<char32_t> onpage; // the characters packed into the current page
+                int shelf_x = 0;
+                int shelf_y = 0;
+                int shelf_h = 0;
+
                 // How far to loop. In principle, up to 21 bits worth - that's 2097151 possible characters!
                 for (char32_t c = 0; c < 2097151; c++) {
                     // Check glyph index first, if it's 0 it's a blank so skip.
@@ -398,40 +415,53 @@ namespace morph {
                         continue;
                     }
 
-                    // generate texture
-                    unsigned int texture;
-                    glGenTextures (1, &texture);
-                    glBindTexture (GL_TEXTURE_2D, texture);
-                    glTexImage2D(
-                        GL_TEXTURE_2D,
-                        0,
-                        GL_RED,
-                        this->face->glyph->bitmap.width,
-                        this->face->glyph->bitmap.rows,
-                        0,
-                        GL_RED,
-                        GL_UNSIGNED_BYTE,
-                        this->face->glyph->bitmap.buffer
-                        );
-                    // set texture options
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
-                    // now store character for later use
+                    const FT_Bitmap& bm = this->face->glyph->bitmap;
+                    const int gw = static_cast<int>(bm.width);
+                    const int gh = static_cast<int>(bm.rows);
+                    if (gw + atlas_pad > this->atlas_w || gh + atlas_pad > this->atlas_w) {
+                        std::cout << "WARNING: glyph for Unicode 0x" << std::hex << static_cast<unsigned int>(c)
+                                  << std::dec << " is larger than a font atlas page; skipping it\n";
+                        continue;
+                    }
+                    // Next shelf, or next page, if the glyph doesn't fit
+                    if (shelf_x + gw + atlas_pad > this->atlas_w) {
+                        shelf_x = 0;
+                        shelf_y += shelf_h;
+                        shelf_h = 0;
+                    }
+                    if (shelf_y + gh + atlas_pad > this->atlas_w) {
+                        this->uploadPage (page, shelf_y + shelf_h, onpage);
+                        std::fill (page.begin(), page.end(), 0);
+                        shelf_x = shelf_y = shelf_h = 0;
+                    }
+
+                    // Copy the bitmap in, row by row, as its pitch need not equal its width
+                    for (int row = 0; row < gh; ++row) {
+                        std::copy (bm.buffer + row * bm.pitch, bm.buffer + row * bm.pitch + gw,
+                                   page.begin() + (shelf_y + row) * this->atlas_w + shelf_x);
+                    }
+
+                    // Store the character for later use. The UV rectangle is in pixels
+                    // until uploadPage() knows the page's height.
                     morph::gl::CharInfo glchar = {
-                        texture,
-                        {static_cast<int>(this->face->glyph->bitmap.width), static_cast<int>(this->face->glyph->bitmap.rows)}, // size
+                        0,
+                        {gw, gh}, // size
                         {this->face->glyph->bitmap_left, this->face->glyph->bitmap_top}, // bearing
-                        static_cast<unsigned int>(this->face->glyph->advance.x)          // advance
+                        static_cast<unsigned int>(this->face->glyph->advance.x),         // advance
+                        {static_cast<float>(shelf_x), static_cast<float>(shelf_y)},       // uv0 (top left)
+                        {static_cast<float>(shelf_x + gw), static_cast<float>(shelf_y + gh)} // uv1 (bottom right)
                     };
-
-                    if constexpr (debug_visualface == true) {
-                        std::cout << "Inserting character into this->glchars with info: ID:" << glchar.textureID
-                                  << ", Size:" << glchar.size << ", Bearing:" << glchar.bearing
-                                  << ", Advance:" << glchar.advance << std::endl;
-                    }
                     this->glchars.insert (std::pair<char32_t, morph::gl::CharInfo>(c, glchar));
+                    onpage.push_back (c);
+
+                    shelf_x += gw + atlas_pad;
+                    if (gh + atlas_pad > shelf_h) { shelf_h = gh + atlas_pad; }
+                }
+                if (!onpage.empty()) { this->uploadPage (page, shelf_y + shelf_h, onpage); }
+
+                if constexpr (debug_visualface == true) {
+                    std::cout << "Packed " << this->glchars.size() << " glyphs into " << this->pages.size()
+                              << " atlas page(s) of width " << this->atlas_w << std::endl;
                 }
                 glBindTexture(GL_TEXTURE_2D, 0);
                 // At this point could FT_Done_Face() etc, I think. as we no longer do anything Freetypey with it.
@@ -449,7 +479,51 @@ namespace morph {
             //! The OpenGL character info stuff
             std::map<char32_t, morph::gl::CharInfo> glchars;
 
+            //! The atlas textures, usually just one. CharInfo::textureID says which holds a glyph
+            std::vector<GLuint> pages;
+
         private:
+            //! Largest atlas page side, in pixels
+            static constexpr int atlas_max = 4096;
+            //! Empty pixels between glyphs, so that linear filtering can't pick up a neighbour
+            static constexpr int atlas_pad = 1;
+            //! Width of the atlas pages
+            int atlas_w = atlas_max;
+
+            /*!
+             * Upload the first \a height rows of \a page as a new atlas texture and
+             * convert the pixel UV rectangles of the characters in \a onpage (which
+             * is then cleared) into texture coordinates on it.
+             */
+            void uploadPage (const std::vector<unsigned char>& page, int height, std::vector<char32_t>& onpage)
+            {
+                if (height > this->atlas_w) { height = this->atlas_w; }
+                GLuint texture;
+                glGenTextures (1, &texture);
+                glBindTexture (GL_TEXTURE_2D, texture);
+                glTexImage2D (GL_TEXTURE_2D, 0, GL_RED, this->atlas_w, height, 0, GL_RED, GL_UNSIGNED_BYTE, page.data());
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
+                this->pages.push_back (texture);
+
+                const float sx = 1.0f / static_cast<float>(this->atlas_w);
+                const float sy = 1.0f / static_cast<float>(height);
+                for (char32_t c : onpage) {
+                    morph::gl::CharInfo& ci = this->glchars[c];
+                    ci.textureID = texture;
+                    ci.uv0 = { ci.uv0.x() * sx, ci.uv0.y() * sy };
+                    ci.uv1 = { ci.uv1.x() * sx, ci.uv1.y() * sy };
+                    if constexpr (debug_visualface == true) {
+                        std::cout << "Character 0x" << std::hex << static_cast<unsigned int>(c) << std::dec
+                                  << " in atlas " << texture << ", Size:" << ci.size << ", Bearing:" << ci.bearing
+                                  << ", Advance:" << ci.advance << ", UV: " << ci.uv0 << " to " << ci.uv1 << std::endl;
+                    }
+                }
+                onpage.clear();
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
 
             //! Create a temporary font file at fontpath, using the embedded data
             //! starting from filestart and extending to filenend
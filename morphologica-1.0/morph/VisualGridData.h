@@ -0,0 +1,166 @@
+/*!
+ * \file
+ *
+ * The GPU side of a HexGridVisual or CartGridVisual whose surface is computed in the
+ * grid vertex shader (VisGrid.vert.glsl; see HexGridVisual::gpuData). The shader reads
+ * the raw data, the neighbours of each element and the colour map from textures, which
+ * a VisualGridData owns. The neighbours are uploaded once, so that an update of the
+ * data costs one float per element, however the surface is drawn.
+ */
+#pragma once
+
+#ifndef USE_GLEW
+#ifdef __OSX__
+# include <OpenGL/gl3.h>
+#else
+# include <GL3/gl3.h>
+#endif
+#endif
+#include <morph/VisualCommon.h>
+#include <morph/ColourMap.h>
+#include <morph/Scale.h>
+#include <vector>
+#include <array>
+#include <type_traits>
+
+namespace morph {
+
+    class VisualGridData
+    {
+    public:
+        //! The texture units used for the data, the neighbours and the colour map. Unit 0
+        //! is left to the text.
+        static constexpr GLint dataUnit = 1;
+        static constexpr GLint nbrsUnit = 2;
+        static constexpr GLint cmapUnit = 3;
+        //! The number of points in the colour map lookup table (which VisGrid.vert.glsl assumes)
+        static constexpr unsigned int lutSize = 256;
+
+        VisualGridData() {}
+        VisualGridData (const VisualGridData&) = delete;
+        VisualGridData& operator= (const VisualGridData&) = delete;
+
+        ~VisualGridData()
+        {
+            if (this->bufs[0] != 0) {
+                glDeleteTextures (3, this->texs.data());
+                glDeleteBuffers (2, this->bufs.data());
+            }
+        }
+
+        //! Upload the neighbours of each element, 8 per element with -1 for none, in the
+        //! order given in VisGrid.vert.glsl
+        void setNeighbours (const std::vector<GLint>& nbrs)
+        {
+            this->create();
+            glBindBuffer (GL_TEXTURE_BUFFER, this->bufs[1]);
+            glBufferData (GL_TEXTURE_BUFFER, nbrs.size() * sizeof(GLint), nbrs.data(), GL_STATIC_DRAW);
+            glBindBuffer (GL_TEXTURE_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! Upload \a data, as floats. The old store is orphaned rather than overwritten,
+        //! so that the upload doesn't wait for frames which are still drawing from it.
+        template <typename T>
+        void setData (const std::vector<T>& data)
+        {
+            this->create();
+            const float* src = nullptr;
+            if constexpr (std::is_same<std::decay_t<T>, float>::value == true) {
+                src = data.data();
+            } else {
+                this->fdata.assign (data.begin(), data.end());
+                src = this->fdata.data();
+            }
+            glBindBuffer (GL_TEXTURE_BUFFER, this->bufs[0]);
+            glBufferData (GL_TEXTURE_BUFFER, data.size() * sizeof(float), src, GL_STREAM_DRAW);
+            glBindBuffer (GL_TEXTURE_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! Sample \a cm into the colour map lookup table
+        template <typename T>
+        void setColourMap (ColourMap<T>& cm)
+        {
+            this->create();
+            for (unsigned int i = 0; i < lutSize; ++i) {
+                std::array<float, 3> c = cm.convert (static_cast<T>(i) / static_cast<T>(lutSize - 1));
+                for (unsigned int j = 0; j < 3; ++j) { this->lut[3 * i + j] = c[j]; }
+            }
+            glBindTexture (GL_TEXTURE_1D, this->texs[2]);
+            glTexImage1D (GL_TEXTURE_1D, 0, GL_RGB32F, lutSize, 0, GL_RGB, GL_FLOAT, this->lut.data());
+            glBindTexture (GL_TEXTURE_1D, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        /*!
+         * Bind the textures and set the grid uniforms of the program in use. \a zscale and
+         * \a cscale are as from scaleParams(). Each element has \a vtx_per_element vertices;
+         * \a nelements is the number of elements, and \a corner is the offset of an element's
+         * NE corner from its centre.
+         */
+        void bind (const morph::gl::UniformLocations& ul,
+                   const std::array<float, 3>& zscale, const std::array<float, 3>& cscale,
+                   const int vtx_per_element, const int nelements, const std::array<float, 2>& corner)
+        {
+            glActiveTexture (GL_TEXTURE0 + dataUnit);
+            glBindTexture (GL_TEXTURE_BUFFER, this->texs[0]);
+            glActiveTexture (GL_TEXTURE0 + nbrsUnit);
+            glBindTexture (GL_TEXTURE_BUFFER, this->texs[1]);
+            glActiveTexture (GL_TEXTURE0 + cmapUnit);
+            glBindTexture (GL_TEXTURE_1D, this->texs[2]);
+            glActiveTexture (GL_TEXTURE0);
+
+            if (ul.grid_data != -1) { glUniform1i (ul.grid_data, dataUnit); }
+            if (ul.grid_nbrs != -1) { glUniform1i (ul.grid_nbrs, nbrsUnit); }
+            if (ul.grid_cmap != -1) { glUniform1i (ul.grid_cmap, cmapUnit); }
+            if (ul.grid_zscale != -1) { glUniform3fv (ul.grid_zscale, 1, zscale.data()); }
+            if (ul.grid_cscale != -1) { glUniform3fv (ul.grid_cscale, 1, cscale.data()); }
+            if (ul.grid_layout != -1) { glUniform2i (ul.grid_layout, vtx_per_element, nelements); }
+            if (ul.grid_corner != -1) { glUniform2fv (ul.grid_corner, 1, corner.data()); }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! The parameters of a linear or logarithmic \a s as the shader takes them: m, c
+        //! and 1 if logarithmic. If s is to autoscale, and hasn't yet, it does so from \a data.
+        template <typename T>
+        static std::array<float, 3> scaleParams (Scale<T, float>& s, const std::vector<T>& data)
+        {
+            if (s.do_autoscale == true && s.autoscaled == false) { s.autoscale_from (data); }
+            return { static_cast<float>(s.getParams (0)), static_cast<float>(s.getParams (1)),
+                     s.getType() == ScaleFn::Logarithmic ? 1.0f : 0.0f };
+        }
+
+    private:
+        //! Create the buffers and textures, once
+        void create()
+        {
+            if (this->bufs[0] != 0) { return; }
+            glGenBuffers (2, this->bufs.data());
+            glGenTextures (3, this->texs.data());
+            // A buffer texture refers to its buffer, whatever data store that has
+            glBindTexture (GL_TEXTURE_BUFFER, this->texs[0]);
+            glTexBuffer (GL_TEXTURE_BUFFER, GL_R32F, this->bufs[0]);
+            glBindTexture (GL_TEXTURE_BUFFER, this->texs[1]);
+            glTexBuffer (GL_TEXTURE_BUFFER, GL_RGBA32I, this->bufs[1]);
+            glBindTexture (GL_TEXTURE_BUFFER, 0);
+            // The lookup table has no mipmaps, and is interpolated between its points
+            glBindTexture (GL_TEXTURE_1D, this->texs[2]);
+            glTexParameteri (GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri (GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri (GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glBindTexture (GL_TEXTURE_1D, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+        }
+
+        //! The data (R32F) and neighbour (RGBA32I) buffers
+        std::array<GLuint, 2> bufs = {0, 0};
+        //! The data and neighbour buffer textures, then the colour map
+        std::array<GLuint, 3> texs = {0, 0, 0};
+        //! The data as floats, where T is not float
+        std::vector<float> fdata;
+        //! The colour map lookup table, RGB
+        std::array<float, 3 * lutSize> lut;
+    };
+
+} // namespace morph
@@ -22,6 +22,8 @@
 #include <morph/MathConst.h>
 #include <morph/VisualCommon.h>
 #include <morph/VisualTextModel.h>
+#include <morph/VisualResources.h>
+#include <morph/Profiler.h>
 #include <morph/VisualFace.h>
 #include <morph/colour.h>
 #include <morph/base64.h>
@@ -31,6 +33,8 @@
 #include <algorithm>
 #include <iterator>
 #include <string>
+#include <utility>
+#include <cstdint>
 
 // Switches on some changes where I carefully unbind gl buffers after calling
 // glBufferData() and rebind when changing the vertex model. Makes no difference on my
@@ -110,6 +114,7 @@ namespace morph {
         //! Common code to call after the vertices have been set up.
         void postVertexInit()
         {
+            this->changed = true;
             // Do gl memory allocation of vertex array once only
             if (this->vbos == nullptr) {
                 // Create vertex array object
@@ -143,6 +148,18 @@ namespace morph {
             this->setupVBO (this->vbos[normVBO], this->vertexNormals, gl::normLoc);
             this->setupVBO (this->vbos[colVBO], this->vertexColors, gl::colLoc);
 
+            // The buffers are now exactly the size of the data, and all of it is on the GPU
+            this->vbo_capacity[idxVBO] = this->vbo_clean[idxVBO] = sz;
+            this->vbo_capacity[posnVBO] = this->vbo_clean[posnVBO] = this->vertexPositions.size() * sizeof(float);
+            this->vbo_capacity[normVBO] = this->vbo_clean[normVBO] = this->vertexNormals.size() * sizeof(float);
+            this->vbo_capacity[colVBO] = this->vbo_clean[colVBO] = this->vertexColors.size() * sizeof(float);
+            for (auto& d : this->vbo_dirty) { d = {0, 0}; }
+
+            if (this->instanced == true) {
+                this->setupInstanceVBO (instVBO, this->instanceData, gl::instLoc);
+                this->setupInstanceVBO (instColVBO, this->instanceColours, gl::instColLoc);
+            }
+
 #ifdef CAREFULLY_UNBIND_AND_REBIND
             // Unbind only the vertex array (not the buffers, that causes GL_INVALID_ENUM errors)
             glBindVertexArray(0);
@@ -153,21 +170,33 @@ namespace morph {
         //! Initialize vertex buffer objects and vertex array object. Empty for 'text only' VisualModels.
         virtual void initializeVertices() {};
 
-        //! Re-initialize the buffers. Client code might have appended to
-        //! vertexPositions/Colors/Normals and indices before calling this method.
+        /*!
+         * Re-initialize the buffers. Client code might have appended to
+         * vertexPositions/Colors/Normals and indices before calling this method.
+         *
+         * Only the out of date parts of each buffer are uploaded: anything beyond
+         * what was uploaded last time (i.e. appended data) plus any range flagged
+         * with setDirty(). The GPU buffers keep their storage between calls and only
+         * grow (geometrically) when the data outgrows them, so appending a few
+         * vertices costs O(appended), not O(model). After reinit() or clear(), which
+         * rebuild the whole model, everything is re-uploaded, but still into the
+         * existing storage if it fits.
+         */
         void reinit_buffers()
         {
+            this->changed = true;
+            MORPH_PROFILE_SCOPE ("VisualModel::reinit_buffers");
             morph::gl::Util::checkError (__FILE__, __LINE__);
-            // Now re-set up the VBOs
-#ifdef CAREFULLY_UNBIND_AND_REBIND // Experimenting with better buffer binding.
+            // The element array binding is part of the VAO state, so bind the VAO first
             glBindVertexArray (this->vao);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
-#endif
-            int sz = this->indices.size() * sizeof(VBOint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, gl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, gl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, gl::colLoc);
+            this->updateVBO (idxVBO, GL_ELEMENT_ARRAY_BUFFER, this->indices);
+            this->updateVBO (posnVBO, GL_ARRAY_BUFFER, this->vertexPositions);
+            this->updateVBO (normVBO, GL_ARRAY_BUFFER, this->vertexNormals);
+            this->updateVBO (colVBO, GL_ARRAY_BUFFER, this->vertexColors);
+            if (this->instanced == true) {
+                this->updateVBO (instVBO, GL_ARRAY_BUFFER, this->instanceData);
+                this->updateVBO (instColVBO, GL_ARRAY_BUFFER, this->instanceColours);
+            }
 
 #ifdef CAREFULLY_UNBIND_AND_REBIND
             glBindVertexArray(0);
@@ -177,6 +206,7 @@ namespace morph {
 
         void clearTexts()
         {
+            this->changed = true;
             for (auto& tm : this->texts) { delete (tm); }
             this->texts.clear();
         }
@@ -188,8 +218,11 @@ namespace morph {
             this->vertexNormals.clear();
             this->vertexColors.clear();
             this->indices.clear();
+            this->instanceData.clear();
+            this->instanceColours.clear();
             this->clearTexts();
             this->idx = 0;
+            this->setAllDirty();
             this->reinit_buffers();
         }
 
@@ -201,9 +234,12 @@ namespace morph {
             this->vertexNormals.clear();
             this->vertexColors.clear();
             this->indices.clear();
+            this->instanceData.clear();
+            this->instanceColours.clear();
             // NB: Do NOT call clearTexts() here! We're only updating the model itself.
             this->idx = 0;
             this->initializeVertices();
+            this->setAllDirty();
             this->reinit_buffers();
         }
 
@@ -221,27 +257,27 @@ namespace morph {
         {
             if (this->hide == true) { return; }
 
-            GLint prev_shader;
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-
-            // Ensure the correct program is in play for this VisualModel
+            // Ensure the correct program is in play for this VisualModel. Each model
+            // (and each VisualTextModel) sets its own program, so there's no need to
+            // query and restore the previous one.
             glUseProgram (this->shaderprog);
 
             if (!this->indices.empty()) {
+                const morph::gl::UniformLocations& ul = this->uniforms();
+
                 // It is only necessary to bind the vertex array object before rendering
                 // (not the vertex buffer objects)
                 glBindVertexArray (this->vao);
 
                 // Pass this->float to GLSL so the model can have an alpha value.
-                GLint loc_a = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("alpha"));
-                if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
+                if (ul.alpha != -1) { glUniform1f (ul.alpha, this->alpha); }
 
-                GLint loc_v = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("v_matrix"));
-                if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
+                if (ul.v_matrix != -1) { glUniformMatrix4fv (ul.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
 
                 // Should be able to apply scaling to the model matrix
-                GLint loc_m = glGetUniformLocation (this->shaderprog, static_cast<const GLchar*>("m_matrix"));
-                if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
+                if (ul.m_matrix != -1) {
+                    glUniformMatrix4fv (ul.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+                }
 
                 if constexpr (debug_render) {
                     std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
@@ -249,7 +285,12 @@ namespace morph {
                 }
 
                 // Draw the triangles
-                glDrawElements (GL_TRIANGLES, this->indices.size(), VBO_ENUM_TYPE, 0);
+                if (this->instanced == false) {
+                    glDrawElements (GL_TRIANGLES, this->indices.size(), VBO_ENUM_TYPE, 0);
+                } else if (!this->instanceData.empty()) {
+                    glDrawElementsInstanced (GL_TRIANGLES, this->indices.size(), VBO_ENUM_TYPE, 0,
+                                             this->instanceData.size() / 4);
+                }
 
                 // Unbind the VAO
                 glBindVertexArray(0);
@@ -258,8 +299,6 @@ namespace morph {
             // Now render any VisualTextModels
             for (auto t : this->texts) { t->render(); }
 
-            glUseProgram (prev_shader);
-
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
@@ -281,6 +320,7 @@ namespace morph {
             morph::VisualTextModel* tm = new morph::VisualTextModel (this->tshaderprog, _font, _fontsize, _fontres);
             tm->setupText (_text, _toffset+this->mv_offset, _tcolour);
             this->texts.push_back (tm);
+            this->changed = true;
             return tm->getTextGeometry();
         }
 
@@ -298,24 +338,34 @@ namespace morph {
             }
             tm = new morph::VisualTextModel (this->tshaderprog, _font, _fontsize, _fontres);
             tm->setupText (_text, _toffset+this->mv_offset, _tcolour);
+            this->changed = true;
             this->texts.push_back (tm);
             return tm->getTextGeometry();
         }
 
         //! Setter for the viewmatrix
-        void setViewMatrix (const TransformMatrix<float>& mv) { this->viewmatrix = mv; }
+        void setViewMatrix (const TransformMatrix<float>& mv) { this->viewmatrix = mv; this->changed = true; }
 
         //! When setting the scene matrix, also have to set the text's scene matrices.
         void setSceneMatrix (const TransformMatrix<float>& sv)
         {
+            this->changed = true;
             this->scenematrix = sv;
             // For each text model, also set scene matrix
             for (auto& t : this->texts) { t->setSceneMatrix (sv); }
         }
 
+        //! Set the projection and the viewport size (in pixels) that the model is rendered with
+        void setProjection (const TransformMatrix<float>& p, const int vw, const int vh)
+        {
+            this->projection = p;
+            this->viewport = {vw, vh};
+        }
+
         //! Set a translation into the scene and into any child texts
         void setSceneTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->scenematrix.setToIdentity();
             this->sv_offset = v0;
             this->scenematrix.translate (this->sv_offset);
@@ -326,6 +376,7 @@ namespace morph {
         //! Set a translation (only) into the scene view matrix
         void addSceneTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->sv_offset += v0;
             this->scenematrix.translate (v0);
         }
@@ -333,6 +384,7 @@ namespace morph {
         //! Set a rotation (only) into the scene view matrix
         void setSceneRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->scenematrix.setToIdentity();
             this->sv_rotation = r;
             this->scenematrix.translate (this->sv_offset);
@@ -342,6 +394,7 @@ namespace morph {
         //! Add a rotation to the scene view matrix
         void addSceneRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->sv_rotation.premultiply (r);
             this->scenematrix.rotate (r);
         }
@@ -349,6 +402,7 @@ namespace morph {
         //! Set a translation to the model view matrix
         void setViewTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->viewmatrix.setToIdentity();
             this->mv_offset = v0;
             this->viewmatrix.translate (this->mv_offset);
@@ -358,6 +412,7 @@ namespace morph {
         //! Add a translation to the model view matrix
         void addViewTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->mv_offset += v0;
             this->viewmatrix.translate (v0);
         }
@@ -365,6 +420,7 @@ namespace morph {
         //! Set a rotation (only) into the view
         void setViewRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->viewmatrix.setToIdentity();
             this->mv_rotation = r;
             this->viewmatrix.translate (this->mv_offset);
@@ -387,6 +443,7 @@ namespace morph {
         //! Apply a further rotation to the model view matrix
         void addViewRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->mv_rotation.premultiply (r);
             this->viewmatrix.rotate (r);
             std::cout << "VisualModel::addViewRotation: FIXME? or t->addSceneRotation(r)?\n";
@@ -394,15 +451,17 @@ namespace morph {
         }
 
         // The alpha attribute accessors
-        void setAlpha (const float _a) { this->alpha = _a; }
+        void setAlpha (const float _a) { this->alpha = _a; this->changed = true; }
         float getAlpha() const { return this->alpha; }
         void incAlpha()
         {
+            this->changed = true;
             this->alpha += 0.1f;
             this->alpha = this->alpha > 1.0f ? 1.0f : this->alpha;
         }
         void decAlpha()
         {
+            this->changed = true;
             this->alpha -= 0.1f;
             this->alpha = this->alpha < 0.0f ? 0.0f : this->alpha;
         }
@@ -412,24 +471,103 @@ namespace morph {
         void toggleHide() { this->hide = this->hide ? false : true; }
         float hidden() const { return this->hide; }
 
+        /*!
+         * True if the model would look different from when it was last drawn: its
+         * vertices, transforms, alpha or texts have changed, or it has been hidden or
+         * shown. Changes to a hidden model don't count until it's shown again. Visual
+         * uses this to skip drawing frames in which nothing has changed.
+         */
+        bool hasChanged() const
+        {
+            if (this->hide != this->drawn_hidden) { return true; }
+            if (this->hide == true) { return false; }
+            if (this->changed == true) { return true; }
+            for (auto t : this->texts) { if (t->hasChanged()) { return true; } }
+            return false;
+        }
+        //! Flag a change that hasChanged() can't see, such as to data drawn from a derived class's own buffers
+        void markChanged() { this->changed = true; }
+        //! Called by Visual once the model has been drawn
+        void markDrawn()
+        {
+            this->changed = false;
+            this->drawn_hidden = this->hide;
+            for (auto t : this->texts) { t->markDrawn(); }
+        }
+
         /*
          * Methods used by Visual::savegltf()
          */
 
+        /*!
+         * Make the mesh that the methods below export. That's the model's own mesh, except
+         * that an instanced model's base mesh is copied to each of its instances (so an
+         * instanced model with no instances exports nothing), plus anything that
+         * gltf_append() adds. Call gltf_release() when done.
+         */
+        void gltf_prepare()
+        {
+            this->gltf_release();
+            if (this->instanced == false) {
+                this->gx_indices = this->indices;
+                this->gx_positions = this->vertexPositions;
+                this->gx_colors = this->vertexColors;
+                this->gx_normals = this->vertexNormals;
+            } else {
+                // As the default vertex shader places and colours each instance
+                const size_t nv = this->vertexPositions.size() / 3;
+                const size_t ninst = this->instanceData.size() / 4;
+                for (size_t k = 0; k < ninst; ++k) {
+                    const float* inst = &this->instanceData[4*k];
+                    const float* icol = &this->instanceColours[4*k];
+                    const VBOint base = static_cast<VBOint>(this->gx_positions.size() / 3);
+                    for (auto i : this->indices) { this->gx_indices.push_back (base + i); }
+                    for (size_t j = 0; j < 3*nv; ++j) {
+                        const size_t c = j % 3;
+                        this->gx_positions.push_back (this->vertexPositions[j] * inst[3] + inst[c]);
+                        this->gx_colors.push_back (icol[c] + (this->vertexColors[j] - icol[c]) * icol[3]);
+                    }
+                    this->gx_normals.insert (this->gx_normals.end(), this->vertexNormals.begin(), this->vertexNormals.end());
+                }
+            }
+            this->gltf_append (this->gx_indices, this->gx_positions, this->gx_colors, this->gx_normals);
+
+            this->vpos_maxes.fill (std::numeric_limits<float>::lowest());
+            this->vpos_mins.fill (std::numeric_limits<float>::max());
+            this->vcol_maxes.fill (std::numeric_limits<float>::lowest());
+            this->vcol_mins.fill (std::numeric_limits<float>::max());
+            this->vnorm_maxes.fill (std::numeric_limits<float>::lowest());
+            this->vnorm_mins.fill (std::numeric_limits<float>::max());
+            this->idx_max = 0;
+            this->idx_min = std::numeric_limits<VBOint>::max();
+        }
+
+        //! Free the mesh made by gltf_prepare()
+        void gltf_release()
+        {
+            std::vector<VBOint>().swap (this->gx_indices);
+            std::vector<float>().swap (this->gx_positions);
+            std::vector<float>().swap (this->gx_colors);
+            std::vector<float>().swap (this->gx_normals);
+        }
+
+        //! True if gltf_prepare() made a mesh with nothing in it
+        bool gltf_empty() const { return this->gx_indices.empty(); }
+
         // Get mv_offset in a json-friendly string
         std::string translation_str() { return this->mv_offset.str_mat(); }
 
-        // Return the number of elements in this->indices
-        size_t indices_size() { return this->indices.size(); }
+        // Return the number of elements in this->gx_indices
+        size_t indices_size() { return this->gx_indices.size(); }
         float indices_max() { return this->idx_max; }
         float indices_min() { return this->idx_min; }
-        size_t indices_bytes() { return this->indices.size() * sizeof (VBOint); }
+        size_t indices_bytes() { return this->gx_indices.size() * sizeof (VBOint); }
         // Return base64 encoded version of indices
         std::string indices_base64()
         {
-            std::vector<std::uint8_t> idx_bytes (this->indices.size()<<2, 0);
+            std::vector<std::uint8_t> idx_bytes (this->gx_indices.size()<<2, 0);
             size_t b = 0;
-            for (auto i : this->indices) {
+            for (auto i : this->gx_indices) {
                 idx_bytes[b++] = i & 0xff;
                 idx_bytes[b++] = i >> 8 & 0xff;
                 idx_bytes[b++] = i >> 16 & 0xff;
@@ -442,50 +580,50 @@ namespace morph {
         void computeVertexMaxMins()
         {
             // Compute index maxmins
-            for (size_t i = 0; i < this->indices.size(); ++i) {
-                idx_max = this->indices[i] > idx_max ? this->indices[i] : idx_max;
-                idx_min = this->indices[i] < idx_min ? this->indices[i] : idx_min;
+            for (size_t i = 0; i < this->gx_indices.size(); ++i) {
+                idx_max = this->gx_indices[i] > idx_max ? this->gx_indices[i] : idx_max;
+                idx_min = this->gx_indices[i] < idx_min ? this->gx_indices[i] : idx_min;
             }
             // Check every 0th entry in vertex Positions, every 1st, etc for max in the
 
-            if (this->vertexPositions.size() != this->vertexColors.size()
-                ||this->vertexPositions.size() != this->vertexNormals.size()) {
+            if (this->gx_positions.size() != this->gx_colors.size()
+                ||this->gx_positions.size() != this->gx_normals.size()) {
                 throw std::runtime_error ("Expect vertexPositions, Colors and Normals vectors all to have same size");
             }
 
-            for (size_t i = 0; i < this->vertexPositions.size(); i+=3) {
-                vpos_maxes[0] =  (vertexPositions[i] > vpos_maxes[0]) ? vertexPositions[i] : vpos_maxes[0];
-                vpos_maxes[1] =  (vertexPositions[i+1] > vpos_maxes[1]) ? vertexPositions[i+1] : vpos_maxes[1];
-                vpos_maxes[2] =  (vertexPositions[i+2] > vpos_maxes[2]) ? vertexPositions[i+2] : vpos_maxes[2];
-                vcol_maxes[0] =  (vertexColors[i] > vcol_maxes[0]) ? vertexColors[i] : vcol_maxes[0];
-                vcol_maxes[1] =  (vertexColors[i+1] > vcol_maxes[1]) ? vertexColors[i+1] : vcol_maxes[1];
-                vcol_maxes[2] =  (vertexColors[i+2] > vcol_maxes[2]) ? vertexColors[i+2] : vcol_maxes[2];
-                vnorm_maxes[0] =  (vertexNormals[i] > vnorm_maxes[0]) ? vertexNormals[i] : vnorm_maxes[0];
-                vnorm_maxes[1] =  (vertexNormals[i+1] > vnorm_maxes[1]) ? vertexNormals[i+1] : vnorm_maxes[1];
-                vnorm_maxes[2] =  (vertexNormals[i+2] > vnorm_maxes[2]) ? vertexNormals[i+2] : vnorm_maxes[2];
-
-                vpos_mins[0] =  (vertexPositions[i] < vpos_mins[0]) ? vertexPositions[i] : vpos_mins[0];
-                vpos_mins[1] =  (vertexPositions[i+1] < vpos_mins[1]) ? vertexPositions[i+1] : vpos_mins[1];
-                vpos_mins[2] =  (vertexPositions[i+2] < vpos_mins[2]) ? vertexPositions[i+2] : vpos_mins[2];
-                vcol_mins[0] =  (vertexColors[i] < vcol_mins[0]) ? vertexColors[i] : vcol_mins[0];
-                vcol_mins[1] =  (vertexColors[i+1] < vcol_mins[1]) ? vertexColors[i+1] : vcol_mins[1];
-                vcol_mins[2] =  (vertexColors[i+2] < vcol_mins[2]) ? vertexColors[i+2] : vcol_mins[2];
-                vnorm_mins[0] =  (vertexNormals[i] < vnorm_mins[0]) ? vertexNormals[i] : vnorm_mins[0];
-                vnorm_mins[1] =  (vertexNormals[i+1] < vnorm_mins[1]) ? vertexNormals[i+1] : vnorm_mins[1];
-                vnorm_mins[2] =  (vertexNormals[i+2] < vnorm_mins[2]) ? vertexNormals[i+2] : vnorm_mins[2];
+            for (size_t i = 0; i < this->gx_positions.size(); i+=3) {
+                vpos_maxes[0] =  (gx_positions[i] > vpos_maxes[0]) ? gx_positions[i] : vpos_maxes[0];
+                vpos_maxes[1] =  (gx_positions[i+1] > vpos_maxes[1]) ? gx_positions[i+1] : vpos_maxes[1];
+                vpos_maxes[2] =  (gx_positions[i+2] > vpos_maxes[2]) ? gx_positions[i+2] : vpos_maxes[2];
+                vcol_maxes[0] =  (gx_colors[i] > vcol_maxes[0]) ? gx_colors[i] : vcol_maxes[0];
+                vcol_maxes[1] =  (gx_colors[i+1] > vcol_maxes[1]) ? gx_colors[i+1] : vcol_maxes[1];
+                vcol_maxes[2] =  (gx_colors[i+2] > vcol_maxes[2]) ? gx_colors[i+2] : vcol_maxes[2];
+                vnorm_maxes[0] =  (gx_normals[i] > vnorm_maxes[0]) ? gx_normals[i] : vnorm_maxes[0];
+                vnorm_maxes[1] =  (gx_normals[i+1] > vnorm_maxes[1]) ? gx_normals[i+1] : vnorm_maxes[1];
+                vnorm_maxes[2] =  (gx_normals[i+2] > vnorm_maxes[2]) ? gx_normals[i+2] : vnorm_maxes[2];
+
+                vpos_mins[0] =  (gx_positions[i] < vpos_mins[0]) ? gx_positions[i] : vpos_mins[0];
+                vpos_mins[1] =  (gx_positions[i+1] < vpos_mins[1]) ? gx_positions[i+1] : vpos_mins[1];
+                vpos_mins[2] =  (gx_positions[i+2] < vpos_mins[2]) ? gx_positions[i+2] : vpos_mins[2];
+                vcol_mins[0] =  (gx_colors[i] < vcol_mins[0]) ? gx_colors[i] : vcol_mins[0];
+                vcol_mins[1] =  (gx_colors[i+1] < vcol_mins[1]) ? gx_colors[i+1] : vcol_mins[1];
+                vcol_mins[2] =  (gx_colors[i+2] < vcol_mins[2]) ? gx_colors[i+2] : vcol_mins[2];
+                vnorm_mins[0] =  (gx_normals[i] < vnorm_mins[0]) ? gx_normals[i] : vnorm_mins[0];
+                vnorm_mins[1] =  (gx_normals[i+1] < vnorm_mins[1]) ? gx_normals[i+1] : vnorm_mins[1];
+                vnorm_mins[2] =  (gx_normals[i+2] < vnorm_mins[2]) ? gx_normals[i+2] : vnorm_mins[2];
             }
         }
 
-        size_t vpos_size() { return this->vertexPositions.size(); }
+        size_t vpos_size() { return this->gx_positions.size(); }
         std::string vpos_max() { return this->vpos_maxes.str_mat(); }
         std::string vpos_min() { return this->vpos_mins.str_mat(); }
-        size_t vpos_bytes() { return this->vertexPositions.size() * sizeof (float); }
+        size_t vpos_bytes() { return this->gx_positions.size() * sizeof (float); }
         std::string vpos_base64()
         {
-            std::vector<std::uint8_t> _bytes (this->vertexPositions.size()<<2, 0);
+            std::vector<std::uint8_t> _bytes (this->gx_positions.size()<<2, 0);
             size_t b = 0;
             float_bytes fb;
-            for (auto i : this->vertexPositions) {
+            for (auto i : this->gx_positions) {
                 fb.f = i;
                 _bytes[b++] = fb.bytes[0];
                 _bytes[b++] = fb.bytes[1];
@@ -494,16 +632,16 @@ namespace morph {
             }
             return base64::encode (_bytes);
         }
-        size_t vcol_size() { return this->vertexColors.size(); }
+        size_t vcol_size() { return this->gx_colors.size(); }
         std::string vcol_max() { return this->vcol_maxes.str_mat(); }
         std::string vcol_min() { return this->vcol_mins.str_mat(); }
-        size_t vcol_bytes() { return this->vertexColors.size() * sizeof (float); }
+        size_t vcol_bytes() { return this->gx_colors.size() * sizeof (float); }
         std::string vcol_base64()
         {
-            std::vector<std::uint8_t> _bytes (this->vertexColors.size()<<2, 0);
+            std::vector<std::uint8_t> _bytes (this->gx_colors.size()<<2, 0);
             size_t b = 0;
             float_bytes fb;
-            for (auto i : this->vertexColors) {
+            for (auto i : this->gx_colors) {
                 fb.f = i;
                 _bytes[b++] = fb.bytes[0];
                 _bytes[b++] = fb.bytes[1];
@@ -512,16 +650,16 @@ namespace morph {
             }
             return base64::encode (_bytes);
         }
-        size_t vnorm_size() { return this->vertexNormals.size(); }
+        size_t vnorm_size() { return this->gx_normals.size(); }
         std::string vnorm_max() { return this->vnorm_maxes.str_mat(); }
         std::string vnorm_min() { return this->vnorm_mins.str_mat(); }
-        size_t vnorm_bytes() { return this->vertexNormals.size() * sizeof (float); }
+        size_t vnorm_bytes() { return this->gx_normals.size() * sizeof (float); }
         std::string vnorm_base64()
         {
-            std::vector<std::uint8_t> _bytes (this->vertexNormals.size()<<2, 0);
+            std::vector<std::uint8_t> _bytes (this->gx_normals.size()<<2, 0);
             size_t b = 0;
             float_bytes fb;
-            for (auto i : this->vertexNormals) {
+            for (auto i : this->gx_normals) {
                 fb.f = i;
                 _bytes[b++] = fb.bytes[0];
                 _bytes[b++] = fb.bytes[1];
@@ -541,6 +679,7 @@ namespace morph {
         //! Set scaling in all dimensions
         void setSizeScale (const float scl)
         {
+            this->changed = true;
             this->model_scaling.setToIdentity();
             this->model_scaling[0] = scl;
             this->model_scaling[5] = scl;
@@ -549,6 +688,7 @@ namespace morph {
         //! Set scaling in xy only
         void setSizeScale (const float xscl, const float yscl)
         {
+            this->changed = true;
             this->model_scaling.setToIdentity();
             this->model_scaling[0] = xscl;
             this->model_scaling[5] = yscl;
@@ -562,6 +702,10 @@ namespace morph {
         TransformMatrix<float> scenematrix;
         //! An additional scaling applied to viewmatrix to scale the size of the model [see render()]
         TransformMatrix<float> model_scaling;
+        //! The projection and viewport, as last set by Visual::render(), for models whose
+        //! level of detail depends on their size on the screen. The viewport is {0,0} until set.
+        TransformMatrix<float> projection;
+        Vector<int, 2> viewport = {0, 0};
 
         /*!
          * The spatial offset of this VisualModel within the morph::Visual 'model
@@ -584,7 +728,7 @@ namespace morph {
 
         //! This enum contains the positions within the vbo array of the different
         //! vertex buffer objects
-        enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, numVBO };
+        enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, instVBO, instColVBO, numVBO };
 
         //! A copy of the reference to the shader program
         GLuint shaderprog;
@@ -592,6 +736,19 @@ namespace morph {
         //! A copy of the reference to the text-specific shader program
         GLuint tshaderprog;
 
+        //! Cached uniform locations for shaderprog. Use uniforms() to access.
+        const morph::gl::UniformLocations* ulocs = nullptr;
+
+        //! The uniform locations for shaderprog, obtained from VisualResources on the
+        //! first call (which must be made with this model's GL context current).
+        const morph::gl::UniformLocations& uniforms()
+        {
+            if (this->ulocs == nullptr) {
+                this->ulocs = &morph::VisualResources::i()->getUniformLocations (this->shaderprog, glfwGetCurrentContext());
+            }
+            return *this->ulocs;
+        }
+
         /*
          * Compute positions and colours of vertices for the hexes and store in these:
          */
@@ -611,6 +768,46 @@ namespace morph {
         //! CPU-side data for vertex colours
         std::vector<float> vertexColors;
 
+        /*!
+         * Instancing. If instanced is set before finalize(), then the mesh in
+         * vertexPositions/Normals/Colors is a base mesh which render() draws once per
+         * instance in a single glDrawElementsInstanced call. Each instance is four
+         * floats in instanceData (an offset x, y, z and a scale factor for the mesh) and
+         * four in instanceColours (r, g, b and 0; a 1 in place of the 0 keeps the
+         * mesh's own colours). Push instances with instance_push(); reinit_buffers()
+         * then uploads just the new ones. Visual::savegltf() exports a copy of the
+         * base mesh for each instance.
+         */
+        bool instanced = false;
+        //! CPU-side per-instance offsets and scales
+        std::vector<float> instanceData;
+        //! CPU-side per-instance colours
+        std::vector<float> instanceColours;
+
+        //! Bytes of storage allocated on the GPU for each of the vbos
+        std::array<size_t, numVBO> vbo_capacity = {};
+        //! Bytes at the start of each vbo that match the CPU-side vector. Anything
+        //! beyond this (e.g. appended vertices) has yet to be uploaded.
+        std::array<size_t, numVBO> vbo_clean = {};
+        //! Byte ranges [first, second) within the clean part of each vbo that were
+        //! modified in place (see setDirty)
+        std::array<std::pair<size_t, size_t>, numVBO> vbo_dirty;
+
+        //! The mesh that Visual::savegltf() exports, made by gltf_prepare()
+        std::vector<VBOint> gx_indices;
+        std::vector<float> gx_positions;
+        std::vector<float> gx_colors;
+        std::vector<float> gx_normals;
+
+        /*!
+         * Append to the exported mesh anything that render() draws other than from
+         * indices and the vertex vectors (or their instances), as a mesh in the same
+         * model coordinates. Models drawing extra things from their own buffers
+         * (GraphVisual's markers, for one) override this.
+         */
+        virtual void gltf_append (std::vector<VBOint>& idx, std::vector<float>& posn,
+                                  std::vector<float>& col, std::vector<float>& norm) {}
+
         // The max and min values in the next 8 attriubutes are only computed if gltf files are going to be output by Visual::safegltf()
 
         //! Max values of 0th, 1st and 2nd coordinates in vertexPositions
@@ -630,6 +827,10 @@ namespace morph {
         float alpha = 1.0f;
         //! If true, then calls to VisualModel::render should return
         bool hide = false;
+        //! Set when the model changes, cleared by markDrawn()
+        bool changed = true;
+        //! The value of hide when the model was last drawn
+        bool drawn_hidden = false;
 
         //! Push three floats onto the vector of floats \a vp
         void vertex_push (const float& x, const float& y, const float& z, std::vector<float>& vp)
@@ -651,6 +852,71 @@ namespace morph {
             std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
         }
 
+        //! Add an instance of the base mesh, scaled by \a scale, at \a posn, in colour \a col
+        void instance_push (const Vector<float>& posn, const float scale, const std::array<float, 3>& col)
+        {
+            this->instanceData.insert (this->instanceData.end(), {posn[0], posn[1], posn[2], scale});
+            this->instanceColours.insert (this->instanceColours.end(), {col[0], col[1], col[2], 0.0f});
+        }
+
+        //! Flag elements [first, first+n) of one of the CPU-side vectors as modified in
+        //! place, so that the next reinit_buffers() uploads them.
+        void setDirty (const VBOPos vbo, const size_t first, const size_t n)
+        {
+            size_t elsz = vbo == idxVBO ? sizeof(VBOint) : sizeof(float);
+            std::pair<size_t, size_t>& d = this->vbo_dirty[vbo];
+            size_t lo = first * elsz;
+            size_t hi = (first + n) * elsz;
+            if (d.second > d.first) {
+                d.first = std::min (d.first, lo);
+                d.second = std::max (d.second, hi);
+            } else {
+                d = {lo, hi};
+            }
+        }
+
+        //! Flag everything as needing upload (the vectors have been rebuilt from scratch)
+        void setAllDirty()
+        {
+            for (auto& c : this->vbo_clean) { c = 0; }
+            for (auto& d : this->vbo_dirty) { d = {0, 0}; }
+        }
+
+        /*!
+         * Bring the GPU copy of buffer \a vb up to date with \a dat, uploading only the
+         * parts that have changed (see reinit_buffers). If \a dat has outgrown the
+         * buffer's storage, the storage is reallocated at (at least) double its
+         * previous size with GL_DYNAMIC_DRAW, as this is evidently a model that
+         * changes. Attribute pointers are VAO state tied to the buffer name, so they
+         * remain valid across the reallocation.
+         */
+        template <typename T>
+        void updateVBO (const VBOPos vb, const GLenum target, const std::vector<T>& dat)
+        {
+            size_t bytes = dat.size() * sizeof(T);
+            glBindBuffer (target, this->vbos[vb]);
+            if (bytes > this->vbo_capacity[vb]) {
+                size_t newcap = std::max (bytes, 2 * this->vbo_capacity[vb]);
+                glBufferData (target, newcap, nullptr, GL_DYNAMIC_DRAW);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                this->vbo_capacity[vb] = newcap;
+                this->vbo_clean[vb] = 0;
+                this->vbo_dirty[vb] = {0, 0};
+            }
+            const uint8_t* base = reinterpret_cast<const uint8_t*>(dat.data());
+            // In-place modifications within the part that was already uploaded
+            std::pair<size_t, size_t>& d = this->vbo_dirty[vb];
+            size_t dhi = std::min (d.second, std::min (bytes, this->vbo_clean[vb]));
+            if (dhi > d.first) { glBufferSubData (target, d.first, dhi - d.first, base + d.first); }
+            // Appended (or never uploaded) data
+            if (bytes > this->vbo_clean[vb]) {
+                glBufferSubData (target, this->vbo_clean[vb], bytes - this->vbo_clean[vb], base + this->vbo_clean[vb]);
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            this->vbo_clean[vb] = bytes;
+            d = {0, 0};
+        }
+
         //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
         void setupVBO (GLuint& buf, std::vector<float>& dat, unsigned int bufferAttribPosition)
         {
@@ -665,6 +931,19 @@ namespace morph {
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
 
+        //! Set up a per-instance vertex buffer object: four floats per instance, advancing once per instance
+        void setupInstanceVBO (const VBOPos vb, std::vector<float>& dat, unsigned int bufferAttribPosition)
+        {
+            size_t sz = dat.size() * sizeof(float);
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[vb]);
+            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_DYNAMIC_DRAW);
+            glVertexAttribPointer (bufferAttribPosition, 4, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glVertexAttribDivisor (bufferAttribPosition, 1);
+            glEnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            this->vbo_capacity[vb] = this->vbo_clean[vb] = sz;
+        }
+
         /*!
          * Create a tube from \a start to \a end, with radius \a r and a colour which
          * transitions from the colour \a colStart to \a colEnd.
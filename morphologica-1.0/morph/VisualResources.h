@@ -34,6 +34,10 @@ namespace morph {
 
         void glfw_init()
         {
+#ifdef GLFW_PLATFORM_NULL
+            // A headless Visual with no display server (GLFW 3.4+)
+            if (VisualResources::no_display) { glfwInitHint (GLFW_PLATFORM, GLFW_PLATFORM_NULL); }
+#endif
             if (!glfwInit()) { std::cerr << "GLFW initialization failed!\n"; }
 
             // Set up error callback
@@ -80,7 +84,20 @@ namespace morph {
         //! FreeType library object, public for access by client code?
         std::map<GLFWwindow*, FT_Library> freetypes;
 
+        //! Uniform locations for each linked GLSL program. Program IDs are only unique
+        //! within an OpenGL context, so the key includes the window.
+        std::map<std::pair<GLFWwindow*, GLuint>, morph::gl::UniformLocations> uniformlocs;
+
+        //! The thick line program of each window's Visual (see Visual::lshaderprog)
+        std::map<GLFWwindow*, GLuint> lineprogs;
+
+        //! The grid program of each window's Visual (see Visual::gshaderprog)
+        std::map<GLFWwindow*, GLuint> gridprogs;
+
     public:
+        //! Set (by a headless morph::Visual) when there's no display to open windows on. Has
+        //! to be set before the first call to i().
+        static bool no_display;
 
         //! Initialize a freetype library instance and add to this->freetypes. I wanted
         //! to have only a single freetype library instance, but this didn't work, so I
@@ -120,10 +137,14 @@ namespace morph {
         //! register a morph::Visual as being handled by this VisualResources singleton instance
         static void register_visual() { VisualResources::numVisuals++; }
 
-        //! De-register a morph::Visual. When there are no morph::Visuals left,
-        //! deconstruct this VisualResources and delete self.
-        static void deregister()
+        //! De-register a morph::Visual, forgetting the programs of its window \a _win.
+        //! When there are no morph::Visuals left, deconstruct this VisualResources and
+        //! delete self.
+        static void deregister (GLFWwindow* _win = nullptr)
         {
+            if (_win != nullptr && VisualResources::pInstance != nullptr) {
+                VisualResources::pInstance->release_window (_win);
+            }
             VisualResources::numVisuals--;
             if (VisualResources::numVisuals <= 0) {
                 VisualResources::pInstance->deconstruct();
@@ -133,6 +154,22 @@ namespace morph {
             }
         }
 
+        //! Forget the uniform locations, line program and grid program of window \a _win,
+        //! which is closing. Program IDs are reused by new contexts, so stale entries
+        //! could otherwise be found for a later window.
+        void release_window (GLFWwindow* _win)
+        {
+            for (auto ul = this->uniformlocs.begin(); ul != this->uniformlocs.end();) {
+                if (ul->first.first == _win) {
+                    ul = this->uniformlocs.erase (ul);
+                } else {
+                    ++ul;
+                }
+            }
+            this->lineprogs.erase (_win);
+            this->gridprogs.erase (_win);
+        }
+
         //! Deallocate memory for faces, FT_Librarys and the GLFW system.
         void deconstruct()
         {
@@ -148,6 +185,10 @@ namespace morph {
             // We're done with freetype, so clear those up
             for (auto& ft : this->freetypes) { FT_Done_FreeType (ft.second); }
 
+            this->uniformlocs.clear();
+            this->lineprogs.clear();
+            this->gridprogs.clear();
+
             // Shut down GLFW
             glfwTerminate();
 
@@ -168,10 +209,59 @@ namespace morph {
             }
             return rtn;
         }
+
+        //! Look up the uniform locations in the freshly linked program \a prog, which
+        //! belongs to the OpenGL context of window \a _win. Call once after linking
+        //! (and again if the program is ever re-linked).
+        const morph::gl::UniformLocations& register_program (GLuint prog, GLFWwindow* _win)
+        {
+            morph::gl::UniformLocations& ul = this->uniformlocs[std::make_pair(_win, prog)];
+            ul.locate (prog);
+            return ul;
+        }
+
+        //! Return the cached uniform locations for program \a prog in the context of
+        //! window \a _win. A program that was not registered is located on first use. The
+        //! returned reference remains valid for the lifetime of the VisualResources.
+        const morph::gl::UniformLocations& getUniformLocations (GLuint prog, GLFWwindow* _win)
+        {
+            auto ul = this->uniformlocs.find (std::make_pair(_win, prog));
+            if (ul != this->uniformlocs.end()) { return ul->second; }
+            return this->register_program (prog, _win);
+        }
+
+        //! Record \a prog as the thick line program for the context of window \a _win
+        void setLineProgram (GLuint prog, GLFWwindow* _win) { this->lineprogs[_win] = prog; }
+
+        //! The thick line program for the context of window \a _win, for VisualModels
+        //! which don't otherwise know about their Visual's programs
+        GLuint getLineProgram (GLFWwindow* _win)
+        {
+            auto lp = this->lineprogs.find (_win);
+            if (lp == this->lineprogs.end()) {
+                throw std::runtime_error ("VisualResources: No line shader program for this window");
+            }
+            return lp->second;
+        }
+
+        //! Record \a prog as the grid program for the context of window \a _win
+        void setGridProgram (GLuint prog, GLFWwindow* _win) { this->gridprogs[_win] = prog; }
+
+        //! The grid program for the context of window \a _win (see HexGridVisual::gpuData)
+        GLuint getGridProgram (GLFWwindow* _win)
+        {
+            auto gp = this->gridprogs.find (_win);
+            if (gp == this->gridprogs.end()) {
+                throw std::runtime_error ("VisualResources: No grid shader program for this window");
+            }
+            return gp->second;
+        }
     };
 
     //! Globally initialise instance pointer to nullptr
     VisualResources* VisualResources::pInstance = nullptr;
+
+    bool VisualResources::no_display = false;
     //! The number of morph::Visuals to which this singleston class provides resources.
     int VisualResources::numVisuals = 0;
 } // namespace morph
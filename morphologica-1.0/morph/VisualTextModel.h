@@ -2,7 +2,8 @@
  * \file
  *
  * Declares a class to hold vertices of the quads that are the backing for a sequence of
- * text characters.
+ * text characters. The glyphs come from the atlas texture(s) of a VisualFace, so a text
+ * model is drawn with one draw call per atlas page it uses (normally just the one).
  *
  * \author Seb James
  * \date Oct 2020
@@ -131,21 +132,18 @@ namespace morph {
         {
             if (this->hide == true) { return; }
 
-            GLint prev_shader;
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-
             // Ensure the correct program is in play for this VisualModel
             glUseProgram (this->tshaderprog);
 
-            // Set uniforms
-            GLint loc_tc = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("textColor"));
-            if (loc_tc != -1) { glUniform3f (loc_tc, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
-            GLint loc_a = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("alpha"));
-            if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
-            GLint loc_v = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("v_matrix"));
-            if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
-            GLint loc_m = glGetUniformLocation (this->tshaderprog, static_cast<const GLchar*>("m_matrix"));
-            if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, this->viewmatrix.mat.data()); }
+            // Set uniforms, using locations cached when the program was linked
+            if (this->ulocs == nullptr) {
+                this->ulocs = &morph::VisualResources::i()->getUniformLocations (this->tshaderprog, glfwGetCurrentContext());
+            }
+            const morph::gl::UniformLocations& ul = *this->ulocs;
+            if (ul.textColor != -1) { glUniform3f (ul.textColor, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
+            if (ul.alpha != -1) { glUniform1f (ul.alpha, this->alpha); }
+            if (ul.v_matrix != -1) { glUniformMatrix4fv (ul.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            if (ul.m_matrix != -1) { glUniformMatrix4fv (ul.m_matrix, 1, GL_FALSE, this->viewmatrix.mat.data()); }
 #ifdef __DEBUG__
             std::cout << "VisualTextModel::render: ("<<txt<<") scenematrix:\n" << scenematrix << std::endl;
             std::cout << "VisualTextModel::render: ("<<txt<<") model viewmatrix:\n" << viewmatrix << std::endl;
@@ -155,19 +153,13 @@ namespace morph {
             // It is only necessary to bind the vertex array object before rendering
             glBindVertexArray (this->vao);
 
-            for (size_t i = 0; i < quads.size(); ++i) {
-                // Bind the right texture for the quad.
-                glBindTexture (GL_TEXTURE_2D, this->quad_ids[i]);
-                // This is 'draw a subset of the elements from the vertex array
-                // object'. You say how many indices to draw and which base *vertex* you
-                // start from. In my scheme, I have 4 vertices for each two triangles
-                // that are constructed. Thus, I draw 6 indices, but increment the base
-                // vertex by 4 for each letter.
-                glDrawElementsBaseVertex (GL_TRIANGLES, 6, VBO_ENUM_TYPE, 0, 4*i);
+            // The indices are grouped by atlas page, so each page's quads are one draw
+            for (const auto& b : this->batches) {
+                glBindTexture (GL_TEXTURE_2D, b.texture);
+                glDrawElements (GL_TRIANGLES, b.count, VBO_ENUM_TYPE, (void*)(b.first * sizeof(VBOint)));
             }
 
             glBindVertexArray(0);
-            glUseProgram (prev_shader);
 
             morph::gl::Util::checkError (__FILE__, __LINE__);
         }
@@ -175,6 +167,7 @@ namespace morph {
         //! Set clr_text to a value suitable to be visible on the background colour bgcolour
         void setVisibleOn (const std::array<float, 4>& bgcolour)
         {
+            this->changed = true;
             float factor = 0.85f;
             this->clr_text = {1.0f-bgcolour[0] * factor,
                               1.0f-bgcolour[1] * factor,
@@ -182,14 +175,20 @@ namespace morph {
         }
 
         //! Setter for VisualTextModel::viewmatrix, the model view
-        void setViewMatrix (const TransformMatrix<float>& mv) { this->viewmatrix = mv; }
+        void setViewMatrix (const TransformMatrix<float>& mv) { this->viewmatrix = mv; this->changed = true; }
 
         //! Setter for VisualTextModel::scenematrix, the scene view
-        void setSceneMatrix (const TransformMatrix<float>& sv) { this->scenematrix = sv; }
+        void setSceneMatrix (const TransformMatrix<float>& sv) { this->scenematrix = sv; this->changed = true; }
+
+        //! True if the text, its colour or its transforms have changed since it was last drawn
+        bool hasChanged() const { return this->changed; }
+        //! Called once the text has been drawn
+        void markDrawn() { this->changed = false; }
 
         //! Set the translation specified by \a v0 into the scene translation
         void setSceneTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->sv_offset = v0;
             this->scenematrix.setToIdentity();
             this->scenematrix.translate (this->sv_offset);
@@ -199,6 +198,7 @@ namespace morph {
         //! Set a translation (only) into the scene view matrix
         void addSceneTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->sv_offset += v0;
             this->scenematrix.translate (v0);
         }
@@ -206,6 +206,7 @@ namespace morph {
         //! Set a rotation (only) into the scene view matrix
         void setSceneRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->sv_rotation = r;
             this->scenematrix.setToIdentity();
             //std::cout << "Translate by sv_offset: "  << sv_offset << std::endl;
@@ -217,6 +218,7 @@ namespace morph {
         //! Add a rotation to the scene view matrix
         void addSceneRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->sv_rotation.premultiply (r);
             this->scenematrix.rotate (r);
         }
@@ -224,6 +226,7 @@ namespace morph {
         //! Set a translation to the model view matrix
         void setViewTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->mv_offset = v0;
             this->viewmatrix.setToIdentity();
             this->viewmatrix.translate (this->mv_offset);
@@ -233,6 +236,7 @@ namespace morph {
         //! Add a translation to the model view matrix
         void addViewTranslation (const Vector<float>& v0)
         {
+            this->changed = true;
             this->mv_offset += v0;
             this->viewmatrix.translate (v0);
         }
@@ -240,6 +244,7 @@ namespace morph {
         //! Set a rotation (only) into the model view matrix
         void setViewRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->mv_rotation = r;
             this->viewmatrix.setToIdentity();
             // Confirms that mv_offset contains the additional model offset
@@ -252,6 +257,7 @@ namespace morph {
         //! Apply a further rotation to the model view matrix
         void addViewRotation (const Quaternion<float>& r)
         {
+            this->changed = true;
             this->mv_rotation.premultiply (r);
             this->viewmatrix.rotate (r);
         }
@@ -320,10 +326,12 @@ namespace morph {
         //! With the given text and font size information, create the quads for the text.
         void setupText (const std::basic_string<char32_t>& _txt)
         {
+            this->changed = true;
             this->txt = _txt;
             // With glyph information from txt, set up this->quads.
             this->quads.clear();
             this->quad_ids.clear();
+            this->quad_uvs.clear();
             // Our string of letters starts at this location
             float letter_pos = 0.0f;
             float letter_y = 0.0f;
@@ -370,6 +378,7 @@ namespace morph {
 #endif
                 this->quads.push_back (tbox);
                 this->quad_ids.push_back (ci.textureID);
+                this->quad_uvs.push_back ({ ci.uv0.x(), ci.uv0.y(), ci.uv1.x(), ci.uv1.y() });
 
                 // The value in ci.advance has to be divided by 64 to bring it into the
                 // same units as the ci.size and ci.bearing values.
@@ -380,10 +389,9 @@ namespace morph {
 
             // Ensure we've cleared out vertex info
             this->vertexPositions.clear();
-            this->vertexNormals.clear();
-            this->vertexColors.clear();
             this->vertexTextures.clear();
             this->indices.clear();
+            this->batches.clear();
 
             this->initializeVertices();
 
@@ -413,35 +421,27 @@ namespace morph {
                 this->vertex_push (quad[6], quad[7],  quad[8],  this->vertexPositions); //3
                 this->vertex_push (quad[9], quad[10], quad[11], this->vertexPositions); //4
 
-                // Add the info for drawing the textures on the quads
-                this->vertex_push (0.0f, 1.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (0.0f, 0.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (1.0f, 0.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (1.0f, 1.0f, 0.0f, this->vertexTextures);
-
-                // All same colours
-                this->vertex_push (this->clr_backing, this->vertexColors);
-                this->vertex_push (this->clr_backing, this->vertexColors);
-                this->vertex_push (this->clr_backing, this->vertexColors);
-                this->vertex_push (this->clr_backing, this->vertexColors);
-
-                // All same normals
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-
-                // Two triangles per quad
-                // qi * 4 + 1, 2 3 or 4
-                VBOint ib = (VBOint)qi*4;
-                this->indices.push_back (ib++); // 0
-                this->indices.push_back (ib++); // 1
-                this->indices.push_back (ib);   // 2
-
-                this->indices.push_back (ib++); // 2
-                this->indices.push_back (ib);   // 3
-                ib -= 3;
-                this->indices.push_back (ib);   // 0
+                // The glyph's rectangle in its atlas. Bottom left, top left, top right, bottom right.
+                const std::array<float, 4>& uv = this->quad_uvs[qi];
+                this->vertexTextures.insert (this->vertexTextures.end(),
+                                             { uv[0], uv[3],  uv[0], uv[1],  uv[2], uv[1],  uv[2], uv[3] });
+            }
+
+            // Two triangles per quad, with the quads on each atlas page together
+            std::vector<bool> done (nquads, false);
+            for (unsigned int q0 = 0; q0 < nquads; ++q0) {
+                if (done[q0]) { continue; }
+                textbatch b;
+                b.texture = this->quad_ids[q0];
+                b.first = this->indices.size();
+                for (unsigned int qi = q0; qi < nquads; ++qi) {
+                    if (done[qi] || this->quad_ids[qi] != b.texture) { continue; }
+                    done[qi] = true;
+                    VBOint ib = (VBOint)qi*4;
+                    this->indices.insert (this->indices.end(), { ib, ib + 1, ib + 2, ib + 2, ib + 3, ib });
+                }
+                b.count = this->indices.size() - b.first;
+                this->batches.push_back (b);
             }
         }
 
@@ -472,22 +472,19 @@ namespace morph {
                 morph::gl::Util::checkError (__FILE__, __LINE__);
             }
 
-            // Set up the indices buffer - bind and buffer the data in this->indices
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
-            morph::gl::Util::checkError (__FILE__, __LINE__);
-
-            //std::cout << "indices.size(): " << this->indices.size() << std::endl;
-            int sz = this->indices.size() * sizeof(VBOint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
+            // Refill the indices buffer with the data in this->indices. The element
+            // array binding is part of the vertex array object state.
+            this->fillVBO (idxVBO, GL_ELEMENT_ARRAY_BUFFER, this->indices);
             morph::gl::Util::checkError (__FILE__, __LINE__);
 
             // Binds data from the "C++ world" to the OpenGL shader world for
-            // "position", "normalin" and "color"
-            // (bind, buffer and set vertex array object attribute)
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, gl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, gl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, gl::colLoc);
-            this->setupVBO (this->vbos[textureVBO], this->vertexTextures, gl::textureLoc);
+            // "position" and "texture" (the text shader uses no normals or colours)
+            this->fillVBO (posnVBO, GL_ARRAY_BUFFER, this->vertexPositions);
+            glVertexAttribPointer (gl::posnLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (gl::posnLoc);
+            this->fillVBO (textureVBO, GL_ARRAY_BUFFER, this->vertexTextures);
+            glVertexAttribPointer (gl::textureLoc, 2, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (gl::textureLoc);
 
 #ifdef CAREFULLY_UNBIND_AND_REBIND
             // Possibly release (unbind) the vertex buffers, but have to unbind vertex
@@ -505,8 +502,6 @@ namespace morph {
     protected:
         //! A face for this text
         morph::gl::VisualFace* face = nullptr;
-        //! The colour of the backing quad's vertices. Doesn't have any effect.
-        std::array<float, 3> clr_backing = {1.0f, 1.0f, 0.0f};
         //! the desired width of an 'm'.
         float m_width = 1.0f;
         //! A scaling factor based on the desired width of an 'm'
@@ -550,12 +545,27 @@ namespace morph {
         //! VisualTextModel. setupText should modify these as it sets up quads. Order of
         //! numbers is left, right, bottom, top
         Vector<float, 4> extents = { 1e7, -1e7, 1e7, -1e7 };
-        //! The texture ID for each quad - so that we draw the right texture image over each quad.
+        //! The texture ID (atlas page) for each quad - so that we draw the right texture image over each quad.
         std::vector<unsigned int> quad_ids;
+        //! The glyph's rectangle within its atlas page for each quad: u0, v0 (top left), u1, v1 (bottom right)
+        std::vector<std::array<float, 4>> quad_uvs;
+        //! A run of indices whose quads all sample the same atlas page
+        struct textbatch
+        {
+            GLuint texture = 0;
+            size_t first = 0;
+            size_t count = 0;
+        };
+        //! The draw calls that render() makes, one per atlas page
+        std::vector<textbatch> batches;
         //! Position within vertex buffer object (if I use an array of VBO)
-        enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, textureVBO, numVBO };
+        enum VBOPos { posnVBO, idxVBO, textureVBO, numVBO };
+        //! Bytes allocated in each VBO, so that new text of no greater length refills rather than reallocates
+        std::array<size_t, numVBO> vbo_capacity = {};
         //! A copy of the reference to the text shader program
         GLuint tshaderprog;
+        //! Uniform locations for tshaderprog, cached on first render
+        const morph::gl::UniformLocations* ulocs = nullptr;
         //! The OpenGL Vertex Array Object
         GLuint vao;
         //! Single vbo to use as in example
@@ -566,25 +576,31 @@ namespace morph {
         std::vector<VBOint> indices;
         //! CPU-side data for quad vertex positions
         std::vector<float> vertexPositions;
-        //! CPU-side data for quad vertex normals
-        std::vector<float> vertexNormals;
-        //! CPU-side data for vertex colours
-        std::vector<float> vertexColors;
-        //! data for textures
+        //! Atlas texture coordinates, two per vertex
         std::vector<float> vertexTextures;
         //! A model-wide alpha value for the shader
         float alpha = 1.0f;
         //! If true, then calls to VisualModel::render should return
         bool hide = false;
+        //! Set when anything that affects the drawn text changes, cleared by markDrawn()
+        bool changed = true;
 
-        //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
-        void setupVBO (GLuint& buf, std::vector<float>& dat, unsigned int bufferAttribPosition)
+        /*!
+         * Bind vbos[vb] to target and copy dat into it. The buffer's storage is only
+         * reallocated when dat has outgrown it, so changing a label to one of the same
+         * length or shorter is a single glBufferSubData.
+         */
+        template <typename T>
+        void fillVBO (const VBOPos vb, const GLenum target, const std::vector<T>& dat)
         {
-            int sz = dat.size() * sizeof(float);
-            glBindBuffer (GL_ARRAY_BUFFER, buf);
-            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
-            glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
-            glEnableVertexAttribArray (bufferAttribPosition);
+            const size_t sz = dat.size() * sizeof(T);
+            glBindBuffer (target, this->vbos[vb]);
+            if (sz > this->vbo_capacity[vb] || this->vbo_capacity[vb] == 0) {
+                glBufferData (target, sz, dat.data(), GL_DYNAMIC_DRAW);
+                this->vbo_capacity[vb] = sz;
+            } else if (sz > 0) {
+                glBufferSubData (target, 0, sz, dat.data());
+            }
         }
 
         //! Push three floats onto the vector of floats \a vp
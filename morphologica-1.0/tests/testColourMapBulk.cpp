@@ -0,0 +1,80 @@
+// Test that ColourMap's container convert() agrees with its single datum convert()
+#include "morph/ColourMap.h"
+#include <iostream>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cmath>
+
+template <typename T>
+int compare (morph::ColourMap<T>& cm, const std::vector<T>& data, const float tol, const char* name)
+{
+    std::vector<std::array<float, 3>> bulk;
+    cm.convert (data, bulk);
+    if (bulk.size() != data.size()) {
+        std::cout << name << ": " << bulk.size() << " colours for " << data.size() << " data\n";
+        return -1;
+    }
+    for (size_t i = 0; i < data.size(); ++i) {
+        std::array<float, 3> c = cm.convert (data[i]);
+        for (unsigned int j = 0; j < 3; ++j) {
+            if (std::abs (bulk[i][j] - c[j]) > tol) {
+                std::cout << name << ": datum " << data[i] << " gives " << bulk[i][j]
+                          << " in channel " << j << ", not " << c[j] << std::endl;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Evenly spaced data, with out of range values, table boundaries, 0 and nan
+    std::vector<float> fdata;
+    for (int i = -100; i <= 10100; ++i) { fdata.push_back (static_cast<float>(i) / 10000.0f); }
+    fdata.push_back (0.0f);
+    fdata.push_back (0.5f / 255.0f);
+    fdata.push_back (std::numeric_limits<float>::quiet_NaN());
+    std::vector<double> ddata (fdata.begin(), fdata.end());
+
+    morph::ColourMapType types[] = {
+        morph::ColourMapType::Jet, morph::ColourMapType::Rainbow,
+        morph::ColourMapType::RainbowZeroBlack, morph::ColourMapType::RainbowZeroWhite,
+        morph::ColourMapType::Magma, morph::ColourMapType::Inferno, morph::ColourMapType::Plasma,
+        morph::ColourMapType::Viridis, morph::ColourMapType::Cividis, morph::ColourMapType::Twilight,
+        morph::ColourMapType::Greyscale, morph::ColourMapType::GreyscaleInv,
+        morph::ColourMapType::Monochrome, morph::ColourMapType::MonochromeRed,
+        morph::ColourMapType::MonochromeBlue, morph::ColourMapType::MonochromeGreen,
+        morph::ColourMapType::Fixed
+    };
+
+    for (auto t : types) {
+        morph::ColourMap<float> cmf (t);
+        // The tabulated maps are looked up exactly; the rest are interpolated
+        rtn += compare (cmf, fdata, 2e-3f, "float");
+        morph::ColourMap<double> cmd (t);
+        rtn += compare (cmd, ddata, 2e-3f, "double");
+    }
+
+    // The table follows changes to the map
+    morph::ColourMap<float> cm (morph::ColourMapType::Monochrome);
+    cm.setHue (0.2f);
+    rtn += compare (cm, fdata, 2e-3f, "hue 0.2");
+    cm.setHue (0.7f);
+    rtn += compare (cm, fdata, 2e-3f, "hue 0.7");
+    cm.setType (morph::ColourMapType::Viridis);
+    rtn += compare (cm, fdata, 0.0f, "viridis");
+
+    // Integral data, with the map's range
+    std::vector<int> idata;
+    for (int i = -5; i < 1100; ++i) { idata.push_back (i); }
+    morph::ColourMap<int> cmi (morph::ColourMapType::Jet);
+    cmi.range_max = 1000;
+    rtn += compare (cmi, idata, 2e-3f, "int");
+
+    if (rtn == 0) { std::cout << "ColourMap container convert tests PASSED\n"; }
+    return rtn;
+}
@@ -0,0 +1,89 @@
+// Test the FFT against a direct discrete Fourier transform, and that the inverse inverts
+#include "morph/FFT.h"
+#include "morph/MathConst.h"
+#include <vector>
+#include <complex>
+#include <random>
+#include <cmath>
+#include <iostream>
+
+typedef std::complex<double> cd;
+
+//! The largest difference between a and b
+double maxdiff (const std::vector<cd>& a, const std::vector<cd>& b)
+{
+    double m = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) { m = std::max (m, std::abs (a[i] - b[i])); }
+    return m;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    std::mt19937 rng (5);
+    std::uniform_real_distribution<double> dist (-1.0, 1.0);
+
+    // 1D, against the DFT
+    for (size_t n : { 1, 2, 8, 64 }) {
+        std::vector<cd> x (n);
+        for (auto& v : x) { v = cd (dist (rng), dist (rng)); }
+        std::vector<cd> dft (n, cd (0.0, 0.0));
+        for (size_t k = 0; k < n; ++k) {
+            for (size_t j = 0; j < n; ++j) {
+                const double a = -morph::TWO_PI_D * static_cast<double>(j * k) / static_cast<double>(n);
+                dft[k] += x[j] * cd (std::cos (a), std::sin (a));
+            }
+        }
+        std::vector<cd> f (x);
+        morph::FFT<double>::transform (f);
+        if (maxdiff (f, dft) > 1e-10) {
+            std::cout << "FFT of " << n << " points differs from the DFT by " << maxdiff (f, dft) << std::endl;
+            --rtn;
+        }
+        morph::FFT<double>::transform (f, true);
+        if (maxdiff (f, x) > 1e-12) {
+            std::cout << "Inverse FFT of " << n << " points differs by " << maxdiff (f, x) << std::endl;
+            --rtn;
+        }
+    }
+
+    // 2D, against the DFT
+    const size_t w = 16;
+    const size_t h = 4;
+    std::vector<cd> x (w * h);
+    for (auto& v : x) { v = cd (dist (rng), 0.0); }
+    std::vector<cd> dft (w * h, cd (0.0, 0.0));
+    for (size_t ky = 0; ky < h; ++ky) {
+        for (size_t kx = 0; kx < w; ++kx) {
+            for (size_t y = 0; y < h; ++y) {
+                for (size_t xx = 0; xx < w; ++xx) {
+                    const double a = -morph::TWO_PI_D * (static_cast<double>(kx * xx) / w + static_cast<double>(ky * y) / h);
+                    dft[ky * w + kx] += x[y * w + xx] * cd (std::cos (a), std::sin (a));
+                }
+            }
+        }
+    }
+    std::vector<cd> f (x);
+    morph::FFT<double>::transform2 (f, w, h);
+    if (maxdiff (f, dft) > 1e-10) {
+        std::cout << "2D FFT differs from the DFT by " << maxdiff (f, dft) << std::endl;
+        --rtn;
+    }
+    morph::FFT<double>::transform2 (f, w, h, true);
+    if (maxdiff (f, x) > 1e-12) {
+        std::cout << "Inverse 2D FFT differs by " << maxdiff (f, x) << std::endl;
+        --rtn;
+    }
+
+    // Sizes which aren't powers of two are refused
+    try {
+        std::vector<cd> bad (12);
+        morph::FFT<double>::transform (bad);
+        std::cout << "FFT of 12 points didn't throw\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    if (rtn == 0) { std::cout << "FFT tests PASSED\n"; }
+    return rtn;
+}
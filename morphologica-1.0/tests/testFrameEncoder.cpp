@@ -0,0 +1,69 @@
+// Test the threaded frame writer, morph::FrameEncoder
+#include "morph/FrameEncoder.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+int main()
+{
+    int rtn = 0;
+    const unsigned int w = 64;
+    const unsigned int h = 33;
+    const int nframes = 20;
+
+    {
+        // A small queue, so that submit() has to wait for the encoders
+        morph::FrameEncoder enc (3, 2);
+        for (int f = 0; f < nframes; ++f) {
+            std::vector<uint8_t> frame = enc.buffer (w * h * 4);
+            // Bottom up, as from glReadPixels: row r (from the bottom) is filled with r + f
+            for (unsigned int r = 0; r < h; ++r) {
+                for (unsigned int c = 0; c < w * 4; ++c) { frame[r * w * 4 + c] = static_cast<uint8_t>(r + f); }
+            }
+            enc.submit (std::move (frame), w, h, "testFrameEncoder_" + std::to_string (f) + ".rgba");
+        }
+        std::vector<uint8_t> frame = enc.buffer (w * h * 4);
+        enc.submit (std::move (frame), w, h, "testFrameEncoder.png", false);
+        enc.finish();
+        if (enc.written() != static_cast<uint64_t>(nframes + 1) || enc.failed() != 0) {
+            std::cout << "written " << enc.written() << ", failed " << enc.failed() << "\n";
+            --rtn;
+        }
+    }
+
+    // The raw files are top down
+    for (int f = 0; f < nframes; ++f) {
+        std::string fn = "testFrameEncoder_" + std::to_string (f) + ".rgba";
+        std::ifstream fi (fn, std::ios::binary);
+        std::vector<char> data ((std::istreambuf_iterator<char>(fi)), std::istreambuf_iterator<char>());
+        if (data.size() != w * h * 4) {
+            std::cout << fn << " is " << data.size() << " bytes\n";
+            --rtn;
+        } else {
+            for (unsigned int r = 0; r < h; ++r) {
+                if (static_cast<uint8_t>(data[r * w * 4]) != static_cast<uint8_t>(h - 1 - r + f)) {
+                    std::cout << fn << " row " << r << " is not flipped\n";
+                    --rtn;
+                    break;
+                }
+            }
+        }
+        std::remove (fn.c_str());
+    }
+
+    // And the PNG has a PNG signature
+    std::ifstream pi ("testFrameEncoder.png", std::ios::binary);
+    char sig[8] = {0};
+    pi.read (sig, 8);
+    if (!pi.good() || sig[1] != 'P' || sig[2] != 'N' || sig[3] != 'G') {
+        std::cout << "testFrameEncoder.png is not a PNG\n";
+        --rtn;
+    }
+    std::remove ("testFrameEncoder.png");
+
+    if (rtn == 0) { std::cout << "FrameEncoder tests PASSED\n"; }
+    return rtn;
+}
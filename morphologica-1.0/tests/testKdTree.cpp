@@ -0,0 +1,88 @@
+// Test that KdTree finds the same nearest point as a search of all points does
+#include "morph/KdTree.h"
+#include "morph/Vector.h"
+#include <vector>
+#include <random>
+#include <limits>
+#include <iostream>
+
+//! The nearest of pts to q, the first of any which are equally near
+size_t bruteNearest (const std::vector<morph::Vector<float, 2>>& pts, const morph::Vector<float, 2>& q)
+{
+    size_t best = morph::KdTree<float>::npos;
+    float bestd2 = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < pts.size(); ++i) {
+        const float dx = q[0] - pts[i][0];
+        const float dy = q[1] - pts[i][1];
+        const float d2 = dx * dx + dy * dy;
+        if (d2 < bestd2) {
+            bestd2 = d2;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int check (const std::vector<morph::Vector<float, 2>>& pts, const std::vector<morph::Vector<float, 2>>& queries,
+           const char* name)
+{
+    morph::KdTree<float> tree;
+    tree.build (pts);
+    if (tree.size() != pts.size()) {
+        std::cout << name << ": tree has " << tree.size() << " points, not " << pts.size() << std::endl;
+        return -1;
+    }
+    for (const auto& q : queries) {
+        const size_t n = tree.nearest (q);
+        const size_t b = bruteNearest (pts, q);
+        if (n != b) {
+            std::cout << name << ": nearest to " << q << " is " << n << ", not " << b << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    std::mt19937 rng (11);
+    std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+    std::vector<morph::Vector<float, 2>> pts (3000);
+    for (auto& p : pts) { p = { dist (rng), dist (rng) }; }
+    std::vector<morph::Vector<float, 2>> queries (2000);
+    for (auto& q : queries) { q = { 3.0f * dist (rng) - 1.0f, 3.0f * dist (rng) - 1.0f }; }
+    queries.push_back ({ -1000.0f, 0.5f });
+    queries.push_back (pts[17]);
+    rtn += check (pts, queries, "uniform");
+
+    // A lattice, queried at its points and half way between them, where there are ties
+    std::vector<morph::Vector<float, 2>> grid;
+    for (int i = 0; i <= 20; ++i) {
+        for (int j = 0; j <= 20; ++j) { grid.push_back ({ 0.125f * i, 0.125f * j }); }
+    }
+    std::vector<morph::Vector<float, 2>> gq;
+    for (int i = -2; i <= 42; ++i) {
+        for (int j = -2; j <= 42; ++j) { gq.push_back ({ 0.0625f * i, 0.0625f * j }); }
+    }
+    rtn += check (grid, gq, "lattice");
+
+    // Repeated points
+    std::vector<morph::Vector<float, 2>> same (50, { 0.5f, 0.5f });
+    same.push_back ({ 0.25f, 0.5f });
+    rtn += check (same, queries, "repeated");
+
+    // One point, and none
+    std::vector<morph::Vector<float, 2>> one = { { 0.3f, 0.4f } };
+    rtn += check (one, queries, "one");
+    morph::KdTree<float> empty;
+    empty.build (std::vector<morph::Vector<float, 2>>());
+    if (empty.nearest ({ 0.0f, 0.0f }) != morph::KdTree<float>::npos) {
+        std::cout << "empty: found a point\n";
+        --rtn;
+    }
+
+    if (rtn == 0) { std::cout << "KdTree tests PASSED\n"; }
+    return rtn;
+}
@@ -0,0 +1,107 @@
+// Test LatticeConvolution, directly and by FFT, against a sum over a map of the lattice
+#include "morph/LatticeConvolution.h"
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <iostream>
+
+typedef std::array<int, 2> pt;
+
+//! The points of the lattice within an ellipse of radii a, b, less those in a hole, in a shuffled order
+std::vector<pt> shape (const int a, const int b, const bool hole, std::mt19937& rng)
+{
+    std::vector<pt> p;
+    for (int y = -b; y <= b; ++y) {
+        for (int x = -a; x <= a; ++x) {
+            if (x * x * b * b + y * y * a * a > a * a * b * b) { continue; }
+            if (hole && x > 0 && x < a / 2 && std::abs (y) < b / 3) { continue; }
+            p.push_back ({{ x, y }});
+        }
+    }
+    std::shuffle (p.begin(), p.end(), rng);
+    return p;
+}
+
+int check (const int da, const int db, const int ka, const int kb, const char* name)
+{
+    std::mt19937 rng (9);
+    std::uniform_real_distribution<double> dist (0.0, 1.0);
+    std::vector<pt> dc = shape (da, db, true, rng);
+    std::vector<pt> kc = shape (ka, kb, false, rng);
+    // Shift the kernel off centre, so that it isn't symmetric
+    for (auto& k : kc) { k[0] += 1; }
+
+    // Data indices in reverse order, to check they're followed
+    std::vector<unsigned int> di (dc.size()), ki (kc.size());
+    for (size_t i = 0; i < dc.size(); ++i) { di[i] = static_cast<unsigned int>(dc.size() - 1 - i); }
+    for (size_t k = 0; k < kc.size(); ++k) { ki[k] = static_cast<unsigned int>(k); }
+    std::vector<double> data (dc.size()), kd (kc.size());
+    for (auto& d : data) { d = dist (rng); }
+    for (auto& d : kd) { d = dist (rng); }
+
+    // The expected result
+    std::map<pt, unsigned int> at;
+    for (size_t i = 0; i < dc.size(); ++i) { at[dc[i]] = di[i]; }
+    std::vector<double> expected (dc.size(), 0.0);
+    for (size_t i = 0; i < dc.size(); ++i) {
+        for (size_t k = 0; k < kc.size(); ++k) {
+            auto it = at.find ({{ dc[i][0] + kc[k][0], dc[i][1] + kc[k][1] }});
+            if (it != at.end()) { expected[di[i]] += data[it->second] * kd[ki[k]]; }
+        }
+    }
+
+    morph::LatticeConvolution lc;
+    lc.init (dc, di, kc, ki);
+    int rtn = 0;
+    for (auto m : { morph::ConvolutionMethod::Direct, morph::ConvolutionMethod::FFT }) {
+        std::vector<double> result (dc.size(), -1.0);
+        lc.convolve (kd, data, result, m);
+        for (size_t i = 0; i < result.size(); ++i) {
+            if (std::abs (result[i] - expected[i]) > 1e-9 * (1.0 + std::abs (expected[i]))) {
+                std::cout << name << (m == morph::ConvolutionMethod::FFT ? " (FFT)" : " (direct)")
+                          << ": result " << i << " is " << result[i] << ", not " << expected[i] << std::endl;
+                --rtn;
+                break;
+            }
+        }
+    }
+
+    // Integer data is convolved directly
+    std::vector<int> idata (dc.size(), 1), ikd (kc.size(), 1), iresult (dc.size(), 0);
+    lc.convolve (ikd, idata, iresult, morph::ConvolutionMethod::FFT);
+    for (size_t i = 0; i < dc.size(); ++i) {
+        int n = 0;
+        for (size_t k = 0; k < kc.size(); ++k) { n += at.count ({{ dc[i][0] + kc[k][0], dc[i][1] + kc[k][1] }}) > 0 ? 1 : 0; }
+        if (iresult[di[i]] != n) {
+            std::cout << name << " (int): result " << di[i] << " is " << iresult[di[i]] << ", not " << n << std::endl;
+            --rtn;
+            break;
+        }
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    rtn += check (20, 12, 3, 2, "small kernel");
+    rtn += check (20, 12, 9, 7, "large kernel");
+    rtn += check (6, 5, 15, 15, "kernel larger than domain");
+    rtn += check (1, 1, 0, 0, "single point kernel");
+
+    // The sizes are checked
+    morph::LatticeConvolution lc;
+    lc.init ({ {{ 0, 0 }}, {{ 1, 0 }} }, { 0, 1 }, { {{ 0, 0 }} }, { 0 });
+    std::vector<float> k = { 1.0f }, d = { 1.0f, 2.0f }, r (3);
+    try {
+        lc.convolve (k, d, r);
+        std::cout << "A result of the wrong size didn't throw\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    if (rtn == 0) { std::cout << "LatticeConvolution tests PASSED\n"; }
+    return rtn;
+}
@@ -0,0 +1,85 @@
+// Test the min/max decimation of long series by morph::MinMaxPyramid
+#include "morph/MinMaxPyramid.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+int main()
+{
+    int rtn = 0;
+
+    std::mt19937 gen (42);
+    std::normal_distribution<float> noise (0.0f, 1.0f);
+    const size_t N = 100003; // Not a power of two, so the last buckets are incomplete
+    std::vector<float> data (N);
+    float walk = 0.0f;
+    for (size_t i = 0; i < N; ++i) {
+        walk += noise (gen);
+        data[i] = walk;
+    }
+    // Single sample spikes, which any decimation must keep
+    data[12345] = 1e6f;
+    data[77777] = -1e6f;
+
+    morph::MinMaxPyramid<float> pyr;
+    for (auto d : data) { pyr.push (d); }
+    if (pyr.size() != N) {
+        std::cout << "size " << pyr.size() << " != " << N << "\n";
+        --rtn;
+    }
+
+    // Building all at once gives the same result as appending
+    morph::MinMaxPyramid<float> pyr2;
+    pyr2.assign (data);
+
+    const std::vector<std::pair<size_t, size_t>> ranges = { {0, N}, {0, 1000}, {12000, 13000}, {5, 99999},
+                                                            {77000, N}, {500, 501}, {33333, 33340} };
+    for (auto r : ranges) {
+        for (size_t maxb : {1u, 10u, 640u, 1920u, 200000u}) {
+            std::vector<size_t> idx;
+            std::vector<size_t> idx2;
+            pyr.decimate (r.first, r.second, maxb, idx);
+            pyr2.decimate (r.first, r.second, maxb, idx2);
+            if (idx != idx2) {
+                std::cout << "incremental and assigned pyramids differ\n";
+                --rtn;
+            }
+            // Strictly increasing indices within the range
+            bool ordered = !idx.empty() && idx.front() >= r.first && idx.back() < r.second;
+            for (size_t j = 1; j < idx.size(); ++j) { if (idx[j] <= idx[j-1]) { ordered = false; } }
+            if (!ordered) {
+                std::cout << "indices for [" << r.first << "," << r.second << ") out of order or range\n";
+                --rtn;
+            }
+            // The extremes of the range are kept
+            auto mm = std::minmax_element (data.begin() + r.first, data.begin() + r.second);
+            float dmin = *mm.first;
+            float dmax = *mm.second;
+            float omin = data[idx[0]];
+            float omax = data[idx[0]];
+            for (auto i : idx) {
+                omin = std::min (omin, data[i]);
+                omax = std::max (omax, data[i]);
+            }
+            if (omin != dmin || omax != dmax) {
+                std::cout << "extremes of [" << r.first << "," << r.second << ") lost at maxbuckets " << maxb << "\n";
+                --rtn;
+            }
+            // Bounded size: two points per bucket, plus the ragged ends at each level
+            size_t bound = 2 * std::max (maxb, size_t{1}) + 4 * (pyr.numLevels() + 1);
+            if (idx.size() > bound) {
+                std::cout << idx.size() << " points for maxbuckets " << maxb << " exceeds " << bound << "\n";
+                --rtn;
+            }
+            // Ranges smaller than maxbuckets come back whole
+            if (r.second - r.first <= maxb && idx.size() != r.second - r.first) {
+                std::cout << "range smaller than maxbuckets was decimated\n";
+                --rtn;
+            }
+        }
+    }
+
+    if (rtn == 0) { std::cout << "MinMaxPyramid tests PASSED\n"; }
+    return rtn;
+}
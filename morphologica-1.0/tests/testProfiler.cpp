@@ -0,0 +1,79 @@
+// Test the stage timing histograms of morph::Profiler
+#define MORPH_PROFILE 1
+#include "morph/Profiler.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+void timed_work (int n)
+{
+    MORPH_PROFILE_SCOPE ("work");
+    volatile int x = 0;
+    for (int i = 0; i < n; ++i) { x = x + i; }
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Percentiles of a known distribution: 1000 us to 100000 us in steps of 1 us
+    morph::TimeHistogram h;
+    for (uint64_t v = 1000; v <= 100000; ++v) { h.add (v); }
+    uint64_t p50 = h.percentile (0.5);
+    if (p50 < 50500 || p50 > 50500 * 1.04) {
+        std::cout << "p50 " << p50 << " is not within 3% of 50500\n";
+        --rtn;
+    }
+    if (h.max() != 100000 || h.percentile (1.0) != 100000) {
+        std::cout << "max " << h.max() << " wrong\n";
+        --rtn;
+    }
+    // Small values are counted exactly
+    for (uint64_t v = 0; v < 64; ++v) {
+        if (morph::TimeHistogram::upper (morph::TimeHistogram::bucket (v)) != v) {
+            std::cout << "small value " << v << " not exact\n";
+            --rtn;
+        }
+    }
+    // Every value lies within its bucket and the bucket is no wider than 1/32 of its value
+    for (uint64_t v = 64; v < (1ull << 30); v = v * 3 / 2 + 7) {
+        int b = morph::TimeHistogram::bucket (v);
+        uint64_t lo = morph::TimeHistogram::upper (b - 1) + 1;
+        uint64_t hi = morph::TimeHistogram::upper (b);
+        if (v < lo || v > hi || (hi - lo + 1) * 32 > lo) {
+            std::cout << "value " << v << " not in its bucket [" << lo << "," << hi << "]\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // Per-thread recording, summed by snapshot()
+    const int nthreads = 4;
+    const int nper = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back ([] { for (int i = 0; i < nper; ++i) { timed_work (100); } });
+    }
+    for (auto& t : threads) { t.join(); }
+    bool found = false;
+    for (const auto& st : morph::Profiler::i().snapshot()) {
+        if (st.first != "work") { continue; }
+        found = true;
+        if (st.second.count() != nthreads * nper) {
+            std::cout << "work was timed " << st.second.count() << " times, not " << nthreads * nper << "\n";
+            --rtn;
+        }
+        st.second.print ("work");
+    }
+    if (!found) {
+        std::cout << "no stage called work\n";
+        --rtn;
+    }
+    if (morph::Profiler::i().stage ("work") != morph::Profiler::i().stage ("work")) {
+        std::cout << "stage ids are not stable\n";
+        --rtn;
+    }
+
+    return rtn;
+}
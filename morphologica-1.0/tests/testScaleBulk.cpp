@@ -0,0 +1,99 @@
+// Test that the std::vector transform and maxmin paths agree with the per-element ones
+#include <vector>
+#include <list>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <iostream>
+#include "morph/Scale.h"
+#include "morph/MathAlgo.h"
+
+template <typename T, typename S>
+int compare (morph::ScaleFn fn, const std::vector<T>& data, const char* name)
+{
+    // The vector fast path, and a list, which takes the per-element path
+    morph::Scale<T, S> s1;
+    morph::Scale<T, S> s2;
+    s1.do_autoscale = true;
+    s2.do_autoscale = true;
+    s1.setType (fn);
+    s2.setType (fn);
+    std::vector<S> out1 (data.size());
+    s1.transform (data, out1);
+    std::list<T> ldata (data.begin(), data.end());
+    std::list<S> out2 (data.size());
+    s2.transform (ldata, out2);
+
+    auto o2 = out2.begin();
+    for (size_t i = 0; i < data.size(); ++i, ++o2) {
+        if (out1[i] != *o2 && !(std::isnan (out1[i]) && std::isnan (*o2))) {
+            std::cout << name << ": datum " << data[i] << " scaled to " << out1[i] << ", not " << *o2 << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    std::mt19937 rng (42);
+    std::uniform_real_distribution<float> dist (0.01f, 100.0f);
+    // Not a multiple of 4, to test the tail of maxmin
+    std::vector<float> vf (1027);
+    for (auto& v : vf) { v = dist (rng); }
+    // A nan is skipped when finding the max and min
+    vf[5] = std::numeric_limits<float>::quiet_NaN();
+    std::vector<double> vd (vf.begin(), vf.end());
+    std::vector<int> vi (vf.begin(), vf.end());
+
+    // maxmin of a vector and of a list
+    for (size_t n : {0, 1, 3, 4, 5, 1027}) {
+        std::vector<float> sub (vf.begin(), vf.begin() + n);
+        std::list<float> lsub (sub.begin(), sub.end());
+        if (morph::MathAlgo::maxmin (sub) != morph::MathAlgo::maxmin (lsub)) {
+            std::cout << "maxmin differs for " << n << " elements\n";
+            --rtn;
+        }
+    }
+
+    rtn += compare<float, float> (morph::ScaleFn::Linear, vf, "float linear");
+    rtn += compare<float, float> (morph::ScaleFn::Logarithmic, vf, "float log");
+    rtn += compare<double, float> (morph::ScaleFn::Linear, vd, "double->float linear");
+    rtn += compare<double, float> (morph::ScaleFn::Logarithmic, vd, "double->float log");
+    rtn += compare<float, double> (morph::ScaleFn::Linear, vf, "float->double linear");
+    rtn += compare<double, double> (morph::ScaleFn::Logarithmic, vd, "double log");
+    rtn += compare<int, float> (morph::ScaleFn::Linear, vi, "int->float linear");
+
+    // In place
+    morph::Scale<float> s;
+    s.do_autoscale = true;
+    std::vector<float> ip = { 1, 2, 3, 5 };
+    s.transform (ip, ip);
+    if (ip[0] != 0.0f || ip[1] != 0.25f || ip[2] != 0.5f || ip[3] != 1.0f) {
+        std::cout << "In place transform failed\n";
+        --rtn;
+    }
+
+    // Into part of a caller's buffer, with the params already set
+    float buf[4] = { 1, 2, 3, -1 };
+    s.transform (buf, buf, 3);
+    if (buf[0] != 0.0f || buf[1] != 0.25f || buf[2] != 0.5f || buf[3] != -1.0f) {
+        std::cout << "Pointer transform failed\n";
+        --rtn;
+    }
+
+    // The pointer transform doesn't autoscale, so needs params
+    morph::Scale<float> unset;
+    try {
+        unset.transform (buf, buf, 3);
+        std::cout << "Expected an exception from a Scale with no params\n";
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        // expected
+    }
+
+    if (rtn == 0) { std::cout << "Scale bulk tests PASSED\n"; }
+    return rtn;
+}
@@ -0,0 +1,89 @@
+// Test that SpatialBins finds every point within the radius, as a search of all points does
+#include "morph/SpatialBins.h"
+#include "morph/Vector.h"
+#include <vector>
+#include <random>
+#include <limits>
+#include <iostream>
+
+int check (const std::vector<morph::Vector<float, 2>>& pts, const float radius, const char* name)
+{
+    morph::SpatialBins<float> bins;
+    bins.build (pts, radius);
+    if (bins.binSide() < radius) {
+        std::cout << name << ": bins are smaller than the radius\n";
+        return -1;
+    }
+    std::vector<morph::Vector<float, 2>> queries (pts);
+    queries.push_back ({ -1000.0f, 0.5f });
+    queries.push_back ({ 0.5f, 1000.0f });
+    queries.push_back ({ 0.0f, -radius * 1.5f });
+    for (const auto& q : queries) {
+        std::vector<int> seen (pts.size(), 0);
+        bins.forEachNear (q, [&](const size_t i, const morph::Vector<float, 2>& p) {
+            if (p != pts[i]) { seen[i] = -1000; }
+            ++seen[i];
+        });
+        for (size_t i = 0; i < pts.size(); ++i) {
+            const bool near = (q - pts[i]).length() <= radius;
+            if (seen[i] > 1 || seen[i] < 0 || (near && seen[i] != 1)) {
+                std::cout << name << ": point " << i << " at " << pts[i] << " visited "
+                          << seen[i] << " times from " << q << std::endl;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    std::mt19937 rng (7);
+    std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+    std::vector<morph::Vector<float, 2>> pts (2000);
+    for (auto& p : pts) { p = { dist (rng), dist (rng) }; }
+    rtn += check (pts, 0.1f, "uniform");
+    rtn += check (pts, 0.013f, "small radius");
+    rtn += check (pts, 5.0f, "large radius");
+
+    // Points on bin edges and on the bounding box
+    std::vector<morph::Vector<float, 2>> grid;
+    for (int i = 0; i <= 10; ++i) {
+        for (int j = 0; j <= 10; ++j) { grid.push_back ({ 0.1f * i, 0.1f * j }); }
+    }
+    rtn += check (grid, 0.1f, "grid");
+
+    // A far outlier makes the bins grow rather than the grid
+    pts.push_back ({ 1.0e6f, -1.0e6f });
+    rtn += check (pts, 0.1f, "outlier");
+
+    // Extents so large, or a radius so small, that the number of bins overflows a
+    // size_t; the bins grow until there are few enough
+    std::vector<morph::Vector<float, 2>> huge = { { -std::numeric_limits<float>::max(), 0.0f },
+                                                  { std::numeric_limits<float>::max(), 1.0f },
+                                                  { 0.5f, 0.5f }, { 0.5f, 0.50001f } };
+    rtn += check (huge, 0.1f, "huge extent");
+    rtn += check (pts, 1.0e-30f, "tiny radius");
+
+    // A non-finite point is never found, but doesn't spoil the rest
+    pts.push_back ({ std::numeric_limits<float>::quiet_NaN(), 0.5f });
+    morph::SpatialBins<float> bins;
+    bins.build (pts, 0.1f);
+    bins.forEachNear ({ 0.5f, 0.5f }, [&](const size_t i, const morph::Vector<float, 2>&) {
+        if (i == pts.size() - 1) {
+            std::cout << "Found the nan point\n";
+            --rtn;
+        }
+    });
+    pts.pop_back();
+    rtn += check (pts, 0.1f, "after nan");
+
+    // No points
+    std::vector<morph::Vector<float, 2>> none;
+    rtn += check (none, 0.1f, "empty");
+
+    if (rtn == 0) { std::cout << "SpatialBins tests PASSED\n"; }
+    return rtn;
+}